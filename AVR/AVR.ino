@@ -21,6 +21,37 @@
  */
  
 #include "MPU6050.h"
+#include "Protocolo.h"
+#include "Calibracion.h"
+#include "Filtro.h"
+#include "Transmisor.h"
+#include "Twi.h"
+
+//
+// Formato de telemetria: 1 = tramas binarias (ver Protocolo.h),
+// 0 = formato de texto {ax,ay,az,gx,gy,gz};
+//
+#define TELEMETRIA_BINARIA 1
+
+//
+// Frecuencia de muestreo: con el DLPF habilitado el MPU muestrea a 1 kHz,
+// la frecuencia de muestreo es 1 kHz / (1 + DIVISOR_MUESTREO). La
+// frecuencia con la que se mandan las tramas la elige el software de
+// control con la decimacion del filtro (ver Filtro.h).
+//
+#define DIVISOR_MUESTREO 0
+#define PERIODO_MUESTREO_US (1000UL * (1 + DIVISOR_MUESTREO))
+
+//
+// Pin conectado a la salida INT del MPU (ver tabla de abajo)
+//
+#define PIN_INT_MPU 2
+
+//
+// Numero maximo de muestras que se leen del FIFO en cada ciclo del loop,
+// para no retrasar la lectura de comandos y el control del motor
+//
+#define MAX_MUESTRAS_FIFO 8
 
 //
 // -------------------------------------
@@ -43,20 +74,65 @@
 static MPU6050 mpu;
 
 //
-// Datos de acelerometro
+// Muestras leidas del FIFO del MPU
+//
+static FifoFrame muestras[MAX_MUESTRAS_FIFO];
+
+//
+// Lectura asincrona del FIFO: primero se lee el numero de bytes en el FIFO
+// y despues las muestras, mientras tanto el loop sigue atendiendo al serial
+// y al motor
 //
-static float aX, aY, aZ;
+#define SENSOR_INACTIVO 0
+#define SENSOR_CUENTA   1
+#define SENSOR_FIFO     2
+
+static uint8_t estadoSensor = SENSOR_INACTIVO;
+static TwiTransaccion lecturaMpu;
+static uint8_t bufferMpu[MAX_MUESTRAS_FIFO * MPU6050_FIFO_FRAME_SIZE];
+static uint32_t tiempoLectura = 0;
+static uint16_t disponiblesLectura = 0;
+static uint8_t muestrasLectura = 0;
 
 //
-// Datos de giroscopio
+// Los actualiza la interrupcion de datos listos del MPU
 //
-static float gX, gY, gZ;
+static volatile bool datosListos = false;
+static volatile uint32_t tiempoInterrupcion = 0;
 
 //
 // Datos de control
 //
 static float velocidad = 0;
-static uint64_t ultimoTiempo = 0;
+
+//
+// Si no se recibe ningun comando en este tiempo (ms) se apaga el motor
+//
+#define WATCHDOG_COMANDOS 1000
+static uint32_t ultimoComando = 0;
+
+//
+// Tiempo (ms) que se espera a que el GMAS deje de moverse antes de
+// recalibrar el sensor
+//
+#define ESPERA_RECALIBRACION 500
+
+//
+// Datos de telemetria binaria, la secuencia avanza aunque la trama se
+// descarte para que el software de control cuente las tramas perdidas. La
+// trama mas grande es la de resumen.
+//
+static uint8_t configMpu = 0;
+static uint16_t secuencia = 0;
+static uint8_t trama[PROTOCOLO_TRAMA_RESUMEN];
+
+#if !TELEMETRIA_BINARIA
+//
+// Paquete de telemetria de texto, el mas largo mide 56 caracteres
+//
+#define MAX_TEXTO 64
+static char texto[MAX_TEXTO];
+#endif
 
 //
 // Para leer paquetes
@@ -64,8 +140,116 @@ static uint64_t ultimoTiempo = 0;
 static int countDatos = 0;
 static char paquete[255];
 
+//
+// Para leer comandos binarios
+//
+static uint8_t bytesComando = 0;
+static uint8_t comando[PROTOCOLO_ENCABEZADO +
+                       PROTOCOLO_MAX_DATOS_COMANDO +
+                       PROTOCOLO_CRC];
+static uint8_t ack[PROTOCOLO_TRAMA_ACK];
+
+///
+/// Detiene el motor, vuelve a calibrar el sensor y descarta las muestras
+/// que el FIFO guardo con los offsets anteriores. Regresa false si no se
+/// pudo leer el sensor (se conservan los offsets anteriores)
+///
+static bool recalibrar() {
+  velocidad = 0;
+  analogWrite(6, 0);
+  delay(ESPERA_RECALIBRACION);
+
+  // Terminar la lectura del FIFO que este en curso
+  if (estadoSensor != SENSOR_INACTIVO)
+    twiEsperar(&lecturaMpu);
+
+  estadoSensor = SENSOR_INACTIVO;
+  const bool calibrado = calibracionMedir(mpu);
+
+  mpu.resetFifo();
+  filtroReiniciar();
+  datosListos = false;
+  return calibrado;
+}
+
+///
+/// Ejecuta el comando binario completo y manda su confirmacion
+///
+static void ejecutarComando() {
+  const uint8_t tipo = comando[3];
+  const uint8_t longitud = comando[4];
+  const uint8_t* datos = comando + PROTOCOLO_ENCABEZADO;
+
+  uint8_t estado = PROTOCOLO_ACK_OK;
+  switch (tipo) {
+    case PROTOCOLO_TIPO_VELOCIDAD:
+      if (longitud == PROTOCOLO_DATOS_VELOCIDAD) {
+        if (datos[0])
+          velocidad = protocoloLeer16(datos + 1) * 0.01f;
+        else
+          velocidad = 0;
+      }
+
+      else
+        estado = PROTOCOLO_ACK_INVALIDO;
+      break;
+
+    case PROTOCOLO_TIPO_KEEPALIVE:
+      break;
+
+    case PROTOCOLO_TIPO_CALIBRAR:
+      if (longitud != PROTOCOLO_DATOS_CALIBRAR)
+        estado = PROTOCOLO_ACK_INVALIDO;
+      else if (!recalibrar())
+        estado = PROTOCOLO_ACK_FALLO;
+      break;
+
+    case PROTOCOLO_TIPO_MODO:
+      if (longitud != PROTOCOLO_DATOS_MODO ||
+          !filtroConfigurar(datos[0], datos[1]))
+        estado = PROTOCOLO_ACK_INVALIDO;
+      break;
+
+    default:
+      estado = PROTOCOLO_ACK_DESCONOCIDO;
+      break;
+  }
+
+  // Alimentar el watchdog y confirmar el comando
+  ultimoComando = millis();
+  uint8_t bytes = protocoloAck(ack, protocoloLeer16(comando + 5), tipo, estado);
+  transmisorEncolar(ack, bytes, true);
+}
+
 ///
-/// Obtiene la amplitud y la frecuencia deseada por el usuario
+/// Agrega el byte @a c al comando binario actual, descarta el comando si
+/// el encabezado o el CRC no son validos
+///
+static void leerComando(uint8_t c) {
+  comando[bytesComando++] = c;
+
+  // Validar encabezado
+  if ((bytesComando == 2 && c != PROTOCOLO_SYNC_1) ||
+      (bytesComando == 3 && c != PROTOCOLO_VERSION) ||
+      (bytesComando == 5 && c > PROTOCOLO_MAX_DATOS_COMANDO)) {
+    bytesComando = 0;
+    return;
+  }
+
+  // Esperar a tener el comando completo
+  if (bytesComando < PROTOCOLO_ENCABEZADO ||
+      bytesComando < PROTOCOLO_ENCABEZADO + comando[4] + PROTOCOLO_CRC)
+    return;
+
+  if (protocoloValidar(comando))
+    ejecutarComando();
+
+  bytesComando = 0;
+}
+
+///
+/// Obtiene la amplitud y la frecuencia deseada por el usuario, ya sea con
+/// comandos binarios (ver Protocolo.h) o con paquetes de texto "velocidad;"
 ///
 void actualizarSerial() {
   // Leer datos del serial
@@ -73,13 +257,21 @@ void actualizarSerial() {
     // Leer caracter
     char c = Serial.read();
 
+    // Leer comandos binarios
+    if (bytesComando > 0 || (uint8_t) c == PROTOCOLO_SYNC_0) {
+      leerComando((uint8_t) c);
+      continue;
+    }
+
     // Actualizar paquete de datos
     switch (c) {
       // Caracter de finalizacion de paquete, actualizar datos
       // y limpiar buffer del paquete
       case ';':
+        paquete[countDatos] = '\0';
         countDatos = 0;
         velocidad = strtod(paquete, NULL);
+        ultimoComando = millis();
         break;
 
       // Entrada de datos al elemento actual del paquete
@@ -101,40 +293,210 @@ void actualizarSerial() {
 /// que el usuario especifico
 ///
 static void actualizarMotor() {
+  // Apagar el motor si el software de control dejo de mandar comandos
+  if (millis() - ultimoComando > WATCHDOG_COMANDOS)
+    velocidad = 0;
+
   analogWrite(6, (int) (velocidad * 2.5));
 }
 
 ///
-/// Manda los datos del MPU 6050 al software de control para procesamiento
+/// Interrupcion del pin INT del MPU, se genera cada vez que el MPU
+/// guarda una nueva muestra en el FIFO
+///
+static void onDatosListos() {
+  tiempoInterrupcion = micros();
+  datosListos = true;
+}
+
+#if !TELEMETRIA_BINARIA
+///
+/// Escribe en @a destino el @a valor de punto fijo con el numero de
+/// @a decimales especificado sin usar operaciones de punto flotante,
+/// regresa el numero de caracteres escritos
+///
+static uint8_t escribirFijo(char* destino, int32_t valor, uint8_t decimales) {
+  uint8_t n = 0;
+  if (valor < 0) {
+    destino[n++] = '-';
+    valor = -valor;
+  }
+
+  // Obtener los digitos de derecha a izquierda, con al menos un digito
+  // antes del punto decimal
+  char digitos[11];
+  uint8_t d = 0;
+  do {
+    digitos[d++] = '0' + valor % 10;
+    valor /= 10;
+  } while (valor > 0 || d <= decimales);
+
+  while (d > 0) {
+    if (d == decimales)
+      destino[n++] = '.';
+
+    destino[n++] = digitos[--d];
+  }
+
+  return n;
+}
+#endif
+
+///
+/// Pasa la @a muestra del MPU 6050, tomada en el @a tiempo especificado
+/// (en us), por el filtro y encola su salida (si se completo una ventana)
+/// para mandarla al software de control. Si el serial no alcanza a mandar
+/// las tramas se descartan en lugar de esperar.
+///
+static void mandarDatos(const FifoFrame& muestra, uint32_t tiempo) {
+  int16_t salida[FILTRO_EJES];
+  FiltroResumen resumen;
+  if (!filtroAgregar(muestra.accel, muestra.gyro, salida, &resumen))
+    return;
+
+  // Compensar el retraso del filtro
+  tiempo -= (uint32_t) filtroRetraso() * PERIODO_MUESTREO_US / 2;
+
+#if TELEMETRIA_BINARIA
+  // Mandar lecturas crudas, el software de control las normaliza
+  uint8_t bytes;
+  if (filtroModo() == FILTRO_RESUMEN)
+    bytes = protocoloResumen(trama, secuencia++, tiempo, configMpu,
+                             filtroDecimacion(), resumen.minimo,
+                             resumen.maximo, resumen.media, resumen.rms);
+  else
+    bytes = protocoloTelemetria(trama, secuencia++, tiempo, configMpu,
+                                salida, salida + 3);
+
+  transmisorEncolar(trama, bytes);
+#else
+  // El formato de texto no tiene resumen, se manda la media de la ventana
+  const int16_t* valores = (filtroModo() == FILTRO_RESUMEN) ? resumen.media :
+                                                              salida;
+  FifoFrame decimada;
+  for (uint8_t i = 0; i < 3; ++i) {
+    decimada.accel[i] = valores[i];
+    decimada.gyro[i] = valores[i + 3];
+  }
+
+  // Normalizar con aritmetica entera (mm/s^2 y centesimas de grado/s)
+  FixedMotion m = mpu.normalizeMotion(decimada);
+
+  // Generar el paquete {ax,ay,az,gx,gy,gz};
+  uint8_t n = 0;
+  texto[n++] = '{';
+  for (uint8_t i = 0; i < 3; ++i) {
+    n += escribirFijo(texto + n, m.accel[i], 3);
+    texto[n++] = ',';
+  }
+
+  for (uint8_t i = 0; i < 3; ++i) {
+    n += escribirFijo(texto + n, m.gyro[i], 2);
+    texto[n++] = i < 2 ? ',' : '}';
+  }
+
+  texto[n++] = ';';
+  transmisorEncolar((const uint8_t*) texto, n);
+#endif
+}
+
+///
+/// Pide al MPU el numero de bytes en su FIFO cuando hay nuevas muestras
 ///
-static void mandarDatos() {
-  // Obtener valores del acelerometro
-  Vector normAccel = mpu.readNormalizeAccel();
-  aX = normAccel.XAxis;
-  aY = normAccel.YAxis;
-  aZ = normAccel.ZAxis;
+static void pedirCuenta() {
+  // Esperar a que el MPU tenga nuevas muestras
+  if (!datosListos)
+    return;
 
-  // Obtener valores del giroscopio
-  Vector normGiro = mpu.readNormalizeGyro();
-  gX = normGiro.XAxis;
-  gY = normGiro.YAxis;
-  gZ = normGiro.ZAxis;
+  noInterrupts();
+  tiempoLectura = tiempoInterrupcion;
+  datosListos = false;
+  interrupts();
 
-  // Mandar secuencia de inicio
-  Serial.print("{");
+  if (mpu.requestFifoCount(&lecturaMpu, bufferMpu))
+    estadoSensor = SENSOR_CUENTA;
+  else
+    datosListos = true;
+}
+
+///
+/// Pide al MPU las muestras de su FIFO una vez que se conoce su numero
+///
+static void pedirMuestras() {
+  if (!twiTerminada(&lecturaMpu))
+    return;
+
+  estadoSensor = SENSOR_INACTIVO;
+  if (lecturaMpu.estado != TWI_COMPLETA) {
+    datosListos = true;
+    return;
+  }
+
+  // Si el FIFO se lleno se perdieron muestras y las tramas del FIFO
+  // pueden estar desalineadas, descartar su contenido
+  uint16_t bytes = MPU6050::parseFifoCount(bufferMpu);
+  if (bytes > MPU6050_FIFO_SIZE - MPU6050_FIFO_FRAME_SIZE) {
+    mpu.resetFifo();
+    return;
+  }
+
+  // Leer un numero limitado de muestras, las demas se leen en la
+  // siguiente lectura
+  disponiblesLectura = bytes / MPU6050_FIFO_FRAME_SIZE;
+  muestrasLectura = disponiblesLectura;
+  if (disponiblesLectura > MAX_MUESTRAS_FIFO) {
+    muestrasLectura = MAX_MUESTRAS_FIFO;
+    datosListos = true;
+  }
+
+  if (muestrasLectura > 0 &&
+      mpu.requestFifo(&lecturaMpu, bufferMpu, muestrasLectura))
+    estadoSensor = SENSOR_FIFO;
+}
+
+///
+/// Manda las muestras leidas del FIFO al software de control
+///
+static void procesarMuestras() {
+  if (!twiTerminada(&lecturaMpu))
+    return;
 
-  // Mandar datos de acelerometro
-  Serial.print(aX); Serial.print(',');
-  Serial.print(aY); Serial.print(',');
-  Serial.print(aZ); Serial.print(',');
+  // Una lectura incompleta deja las tramas del FIFO desalineadas
+  estadoSensor = SENSOR_INACTIVO;
+  if (lecturaMpu.estado != TWI_COMPLETA) {
+    mpu.resetFifo();
+    return;
+  }
 
-  // Mandar datos de giroscopio
-  Serial.print(gX); Serial.print(',');
-  Serial.print(gY); Serial.print(',');
-  Serial.print(gZ); Serial.print('}');
+  MPU6050::parseFifo(bufferMpu, muestras, muestrasLectura);
 
-  // Mandar secuencia de terminacion
-  Serial.print(";");
+  // La muestra mas reciente del FIFO se tomo en el momento de la
+  // interrupcion, las anteriores se tomaron un periodo antes cada una
+  for (uint8_t i = 0; i < muestrasLectura; ++i) {
+    uint32_t atraso = (uint32_t) (disponiblesLectura - 1 - i) *
+                      PERIODO_MUESTREO_US;
+    mandarDatos(muestras[i], tiempoLectura - atraso);
+  }
+}
+
+///
+/// Lee las muestras que el MPU guardo en su FIFO desde la ultima
+/// interrupcion y las manda al software de control, sin esperar al bus
+///
+static void leerSensor() {
+  switch (estadoSensor) {
+    case SENSOR_INACTIVO:
+      pedirCuenta();
+      break;
+
+    case SENSOR_CUENTA:
+      pedirMuestras();
+      break;
+
+    case SENSOR_FIFO:
+      procesarMuestras();
+      break;
+  }
 }
 
 ///
@@ -164,6 +526,27 @@ void setup() {
   mpu.setMotionDetectionDuration(5);
   mpu.setZeroMotionDetectionThreshold(4);
   mpu.setZeroMotionDetectionDuration(2);  
+
+  // Con el DLPF el MPU muestrea a 1 kHz. Cargar los offsets del sensor de
+  // la EEPROM, si no hay una calibracion valida calibrar (el GMAS debe
+  // estar en reposo).
+  mpu.setDLPFMode(MPU6050_DLPF_3);
+  if (!calibracionCargar(mpu))
+    calibracionMedir(mpu);
+
+  // Muestrear a 1 kHz / (1 + DIVISOR_MUESTREO) y guardar las muestras en
+  // el FIFO, el MPU avisa con el pin INT cada vez que hay una nueva muestra
+  mpu.setSampleRateDivider(DIVISOR_MUESTREO);
+  mpu.setFifoEnabled(true);
+  mpu.resetFifo();
+  mpu.setIntDataReadyEnabled(true);
+
+  pinMode(PIN_INT_MPU, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_INT_MPU), onDatosListos, RISING);
+
+  // Registrar configuracion para que el software de control pueda
+  // normalizar las lecturas crudas
+  configMpu = (uint8_t) mpu.getRange() | ((uint8_t) mpu.getScale() << 2);
 }
 
 ///
@@ -174,9 +557,11 @@ void loop() {
   actualizarMotor();
   actualizarSerial();
 
-  // Actualizar datos de control cada 20 ms
-  if (millis() - ultimoTiempo >= 20) {
-    ultimoTiempo = millis();
-    mandarDatos();
-  }
+  // Leer las muestras que el MPU haya guardado en el FIFO y mandar las
+  // tramas encoladas que quepan en el buffer del serial
+  leerSensor();
+  transmisorVaciar();
+
+  // Abortar las transacciones I2C que no terminen y liberar el bus
+  twiVigilar();
 }
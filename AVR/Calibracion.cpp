@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Calibracion.h"
+#include "MPU6050.h"
+#include "Protocolo.h"
+
+#include <EEPROM.h>
+#include <stddef.h>
+
+//
+// Identifican una calibracion guardada por esta version del firmware
+//
+#define CALIBRACION_FIRMA   (0xCA)
+#define CALIBRACION_VERSION (0x01)
+
+///
+/// Contenido de la EEPROM: offsets del acelerometro y del giroscopio (X, Y,
+/// Z) y CRC-16 de los bytes anteriores
+///
+struct RegistroCalibracion {
+  uint8_t firma;
+  uint8_t version;
+  int16_t accel[3];
+  int16_t gyro[3];
+  uint16_t crc;
+};
+
+///
+/// Calcula el CRC de todos los campos del @a registro excepto el CRC
+///
+static uint16_t calcularCrc(const RegistroCalibracion& registro) {
+  const uint8_t* bytes = (const uint8_t*) &registro;
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < offsetof(RegistroCalibracion, crc); ++i)
+    crc = protocoloCrc16(crc, bytes[i]);
+
+  return crc;
+}
+
+bool calibracionCargar(MPU6050& mpu) {
+  RegistroCalibracion registro;
+  EEPROM.get(CALIBRACION_DIRECCION, registro);
+
+  if (registro.firma != CALIBRACION_FIRMA ||
+      registro.version != CALIBRACION_VERSION ||
+      registro.crc != calcularCrc(registro))
+    return false;
+
+  mpu.setAccelOffsetX(registro.accel[0]);
+  mpu.setAccelOffsetY(registro.accel[1]);
+  mpu.setAccelOffsetZ(registro.accel[2]);
+  mpu.setGyroOffsetX(registro.gyro[0]);
+  mpu.setGyroOffsetY(registro.gyro[1]);
+  mpu.setGyroOffsetZ(registro.gyro[2]);
+  return true;
+}
+
+bool calibracionMedir(MPU6050& mpu) {
+  if (!mpu.calibrateOffsets(CALIBRACION_MUESTRAS))
+    return false;
+
+  RegistroCalibracion registro;
+  registro.firma = CALIBRACION_FIRMA;
+  registro.version = CALIBRACION_VERSION;
+  registro.accel[0] = mpu.getAccelOffsetX();
+  registro.accel[1] = mpu.getAccelOffsetY();
+  registro.accel[2] = mpu.getAccelOffsetZ();
+  registro.gyro[0] = mpu.getGyroOffsetX();
+  registro.gyro[1] = mpu.getGyroOffsetY();
+  registro.gyro[2] = mpu.getGyroOffsetZ();
+  registro.crc = calcularCrc(registro);
+
+  // Solo se escriben los bytes que cambiaron
+  EEPROM.put(CALIBRACION_DIRECCION, registro);
+  return true;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CALIBRACION_H
+#define CALIBRACION_H
+
+#include <stdint.h>
+
+class MPU6050;
+
+//
+// Calibracion del MPU 6050. Los sesgos del acelerometro y del giroscopio se
+// restan en los registros de offset del sensor, el cual entrega las
+// lecturas ya corregidas. Los offsets se guardan en la EEPROM con un CRC y
+// al iniciar se cargan en lugar de volver a calibrar.
+//
+
+//
+// Numero de lecturas que se promedian al calibrar (1 ms por lectura)
+//
+#define CALIBRACION_MUESTRAS 256
+
+//
+// Direccion de la calibracion en la EEPROM
+//
+#define CALIBRACION_DIRECCION 0
+
+///
+/// Carga la calibracion de la EEPROM y la escribe en los registros de
+/// offset del @a mpu, regresa false si la EEPROM no tiene una calibracion
+/// valida
+///
+bool calibracionCargar(MPU6050& mpu);
+
+///
+/// Mide los sesgos del @a mpu (en reposo y con el eje Z hacia arriba),
+/// los resta en sus registros de offset y los guarda en la EEPROM. Regresa
+/// false sin modificar los offsets ni la EEPROM si no se pudo leer el
+/// sensor
+///
+bool calibracionMedir(MPU6050& mpu);
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Filtro.h"
+
+#include <string.h>
+
+//
+// Configuracion actual, por defecto se filtra y se decima a la mitad
+//
+static uint8_t modo = FILTRO_FILTRADO;
+static uint8_t decimacion = 2;
+static uint8_t bitsDecimacion = 1;
+static uint8_t contador = 0;
+static bool descartar = true;
+
+//
+// Estado de cada eje, solo se usa el del modo actual. Los integradores y
+// los peines del CIC trabajan con aritmetica modular, los desbordes de los
+// integradores se cancelan en los peines.
+//
+static union {
+  struct {
+    uint32_t integrador1[FILTRO_EJES];
+    uint32_t integrador2[FILTRO_EJES];
+    uint32_t peine1[FILTRO_EJES];
+    uint32_t peine2[FILTRO_EJES];
+  } cic;
+
+  struct {
+    int16_t minimo[FILTRO_EJES];
+    int16_t maximo[FILTRO_EJES];
+    int32_t suma[FILTRO_EJES];
+    uint64_t cuadrados[FILTRO_EJES];
+  } ventana;
+} estado;
+
+///
+/// Raiz cuadrada entera (redondeada hacia abajo) de @a valor
+///
+static uint16_t raizEntera(uint32_t valor) {
+  uint32_t raiz = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > valor)
+    bit >>= 2;
+
+  while (bit != 0) {
+    if (valor >= raiz + bit) {
+      valor -= raiz + bit;
+      raiz = (raiz >> 1) + bit;
+    }
+
+    else
+      raiz >>= 1;
+
+    bit >>= 2;
+  }
+
+  return (uint16_t) raiz;
+}
+
+///
+/// Integra la @a lectura del @a eje en el CIC, si la ventana termino
+/// calcula la salida decimada en @a salida
+///
+static void agregarCic(uint8_t eje, int16_t lectura, bool fin,
+                       int16_t* salida) {
+  estado.cic.integrador1[eje] += (uint32_t) (int32_t) lectura;
+  estado.cic.integrador2[eje] += estado.cic.integrador1[eje];
+  if (!fin)
+    return;
+
+  // Peines a la frecuencia de salida, la ganancia es decimacion^2
+  const uint32_t c1 = estado.cic.integrador2[eje] - estado.cic.peine1[eje];
+  estado.cic.peine1[eje] = estado.cic.integrador2[eje];
+  const uint32_t c2 = c1 - estado.cic.peine2[eje];
+  estado.cic.peine2[eje] = c1;
+
+  // Quitar la ganancia redondeando
+  const uint8_t bits = 2 * bitsDecimacion;
+  const int32_t valor = (int32_t) c2;
+  *salida = (int16_t) ((valor + (bits ? (1L << (bits - 1)) : 0)) >> bits);
+}
+
+///
+/// Agrega la @a lectura del @a eje a las estadisticas de la ventana
+///
+static void agregarVentana(uint8_t eje, int16_t lectura) {
+  if (contador == 0) {
+    estado.ventana.minimo[eje] = lectura;
+    estado.ventana.maximo[eje] = lectura;
+    estado.ventana.suma[eje] = 0;
+    estado.ventana.cuadrados[eje] = 0;
+  }
+
+  if (lectura < estado.ventana.minimo[eje])
+    estado.ventana.minimo[eje] = lectura;
+  if (lectura > estado.ventana.maximo[eje])
+    estado.ventana.maximo[eje] = lectura;
+
+  estado.ventana.suma[eje] += lectura;
+  estado.ventana.cuadrados[eje] += (uint32_t) ((int32_t) lectura * lectura);
+}
+
+///
+/// Calcula las estadisticas del @a eje al terminar la ventana
+///
+static void resumirVentana(uint8_t eje, FiltroResumen* resumen) {
+  resumen->minimo[eje] = estado.ventana.minimo[eje];
+  resumen->maximo[eje] = estado.ventana.maximo[eje];
+  resumen->media[eje] = (int16_t) ((estado.ventana.suma[eje] +
+                                    (decimacion >> 1)) >> bitsDecimacion);
+  resumen->rms[eje] = raizEntera((uint32_t) (estado.ventana.cuadrados[eje] >>
+                                             bitsDecimacion));
+}
+
+bool filtroConfigurar(uint8_t nuevoModo, uint8_t nuevaDecimacion) {
+  if (nuevoModo > FILTRO_RESUMEN || nuevaDecimacion == 0 ||
+      nuevaDecimacion > FILTRO_MAX_DECIMACION ||
+      (nuevaDecimacion & (nuevaDecimacion - 1)) != 0)
+    return false;
+
+  modo = nuevoModo;
+  decimacion = nuevaDecimacion;
+  bitsDecimacion = 0;
+  while ((1 << bitsDecimacion) < decimacion)
+    ++bitsDecimacion;
+
+  filtroReiniciar();
+  return true;
+}
+
+void filtroReiniciar() {
+  contador = 0;
+  descartar = (modo == FILTRO_FILTRADO);
+  memset(&estado, 0, sizeof(estado));
+}
+
+bool filtroAgregar(const int16_t accel[3], const int16_t gyro[3],
+                   int16_t salida[FILTRO_EJES], FiltroResumen* resumen) {
+  const bool fin = contador + 1 >= decimacion;
+
+  switch (modo) {
+    case FILTRO_CRUDO:
+      if (fin) {
+        for (uint8_t i = 0; i < 3; ++i) {
+          salida[i] = accel[i];
+          salida[i + 3] = gyro[i];
+        }
+      }
+      break;
+
+    case FILTRO_FILTRADO:
+      for (uint8_t i = 0; i < 3; ++i) {
+        agregarCic(i, accel[i], fin, salida + i);
+        agregarCic(i + 3, gyro[i], fin, salida + i + 3);
+      }
+
+      // Los peines necesitan una ventana completa antes de la primera
+      // salida valida
+      if (fin && descartar) {
+        descartar = false;
+        contador = 0;
+        return false;
+      }
+      break;
+
+    case FILTRO_RESUMEN:
+      for (uint8_t i = 0; i < 3; ++i) {
+        agregarVentana(i, accel[i]);
+        agregarVentana(i + 3, gyro[i]);
+      }
+
+      if (fin) {
+        for (uint8_t i = 0; i < FILTRO_EJES; ++i)
+          resumirVentana(i, resumen);
+      }
+      break;
+  }
+
+  contador = fin ? 0 : contador + 1;
+  return fin;
+}
+
+uint8_t filtroModo() {
+  return modo;
+}
+
+uint8_t filtroDecimacion() {
+  return decimacion;
+}
+
+uint16_t filtroRetraso() {
+  // El CIC de segundo orden tiene un retraso de decimacion - 1 muestras,
+  // la ventana del resumen esta centrada (decimacion - 1) / 2 muestras
+  // antes de la ultima
+  switch (modo) {
+    case FILTRO_FILTRADO:
+      return 2 * (decimacion - 1);
+    case FILTRO_RESUMEN:
+      return decimacion - 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FILTRO_H
+#define FILTRO_H
+
+#include "Protocolo.h"
+
+//
+// Etapa de filtrado y decimacion de las lecturas del MPU. Cada eje se
+// procesa por separado y por cada ventana de "decimacion" muestras se
+// genera una salida segun el modo:
+//
+//   FILTRO_CRUDO     la ultima muestra de la ventana, sin filtrar
+//   FILTRO_FILTRADO  filtro CIC de segundo orden (promedio movil doble) con
+//                    aritmetica entera, atenua lo que esta arriba de la
+//                    nueva frecuencia de Nyquist antes de decimar (la
+//                    primera ventana despues de reiniciar se descarta)
+//   FILTRO_RESUMEN   minimo, maximo, media y RMS de la ventana
+//
+// La decimacion es una potencia de 2 para que las divisiones entre el
+// numero de muestras (y la ganancia del CIC) sean corrimientos.
+//
+
+#define FILTRO_CRUDO    PROTOCOLO_MODO_CRUDO
+#define FILTRO_FILTRADO PROTOCOLO_MODO_FILTRADO
+#define FILTRO_RESUMEN  PROTOCOLO_MODO_RESUMEN
+
+//
+// Decimacion maxima, la ganancia del CIC (decimacion^2) multiplicada por
+// una lectura de 16 bits debe caber en 32 bits
+//
+#define FILTRO_MAX_DECIMACION 128
+
+//
+// Numero de ejes: acelerometro X, Y, Z y giroscopio X, Y, Z
+//
+#define FILTRO_EJES 6
+
+///
+/// Estadisticas de una ventana de lecturas crudas por eje
+///
+struct FiltroResumen {
+  int16_t minimo[FILTRO_EJES];
+  int16_t maximo[FILTRO_EJES];
+  int16_t media[FILTRO_EJES];
+  uint16_t rms[FILTRO_EJES];
+};
+
+///
+/// Cambia el @a modo y la @a decimacion y reinicia el filtro, regresa false
+/// (sin cambiar nada) si el modo no existe o si la decimacion no es una
+/// potencia de 2 entre 1 y FILTRO_MAX_DECIMACION
+///
+bool filtroConfigurar(uint8_t modo, uint8_t decimacion);
+
+///
+/// Descarta la ventana actual y el estado del filtro
+///
+void filtroReiniciar();
+
+///
+/// Agrega una muestra con las lecturas de los ejes especificadas, regresa
+/// true si se completo una ventana y la salida esta lista en @a salida
+/// (modos crudo y filtrado) o en @a resumen (modo resumen)
+///
+bool filtroAgregar(const int16_t accel[3], const int16_t gyro[3],
+                   int16_t salida[FILTRO_EJES], FiltroResumen* resumen);
+
+///
+/// Regresa el modo actual
+///
+uint8_t filtroModo();
+
+///
+/// Regresa la decimacion actual
+///
+uint8_t filtroDecimacion();
+
+///
+/// Regresa el retraso de la salida respecto a la ultima muestra de la
+/// ventana, en medios periodos de muestreo
+///
+uint16_t filtroRetraso();
+
+#endif
@@ -24,9 +24,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "WProgram.h"
 #endif
 
-#include <Wire.h>
 #include <math.h>
 
+#include "Twi.h"
+
 #include "MPU6050.h"
 
 bool MPU6050::begin(mpu6050_dps_t scale, mpu6050_range_t range, int mpua)
@@ -34,7 +35,8 @@ bool MPU6050::begin(mpu6050_dps_t scale, mpu6050_range_t range, int mpua)
     // Set Address
     mpuAddress = mpua;
 
-    Wire.begin();
+    // Fast-mode I2C (400 kHz), transactions are interrupt driven
+    twiIniciar(400000L);
 
     // Reset calibrate values
     dg.XAxis = 0;
@@ -89,6 +91,9 @@ void MPU6050::setScale(mpu6050_dps_t scale)
 	    break;
     }
 
+    // 0.01 dps per digit
+    gyroFixed = (int32_t)(dpsPerDigit * 100 * (1L << MPU6050_FIXED_SHIFT) + 0.5f);
+
     value = readRegister8(MPU6050_REG_GYRO_CONFIG);
     value &= 0b11100111;
     value |= (scale << 3);
@@ -126,6 +131,9 @@ void MPU6050::setRange(mpu6050_range_t range)
 	    break;
     }
 
+    // mm/s^2 per digit
+    accelFixed = (int32_t)(rangePerDigit * 9806.65f * (1L << MPU6050_FIXED_SHIFT) + 0.5f);
+
     value = readRegister8(MPU6050_REG_ACCEL_CONFIG);
     value &= 0b11100111;
     value |= (range << 3);
@@ -344,34 +352,18 @@ Activites MPU6050::readActivites(void)
 
 Vector MPU6050::readRawAccel(void)
 {
-    Wire.beginTransmission(mpuAddress);
-    #if ARDUINO >= 100
-	Wire.write(MPU6050_REG_ACCEL_XOUT_H);
-    #else
-	Wire.send(MPU6050_REG_ACCEL_XOUT_H);
-    #endif
-    Wire.endTransmission();
-
-    Wire.beginTransmission(mpuAddress);
-    Wire.requestFrom(mpuAddress, 6);
-
-    while (Wire.available() < 6);
-
-    #if ARDUINO >= 100
-	uint8_t xha = Wire.read();
-	uint8_t xla = Wire.read();
-        uint8_t yha = Wire.read();
-	uint8_t yla = Wire.read();
-	uint8_t zha = Wire.read();
-	uint8_t zla = Wire.read();
-    #else
-	uint8_t xha = Wire.receive();
-	uint8_t xla = Wire.receive();
-	uint8_t yha = Wire.receive();
-	uint8_t yla = Wire.receive();
-	uint8_t zha = Wire.receive();
-	uint8_t zla = Wire.receive();
-    #endif
+    uint8_t buffer[6];
+    if (!readRegisters(MPU6050_REG_ACCEL_XOUT_H, buffer, 6))
+    {
+	return ra;
+    }
+
+    uint8_t xha = buffer[0];
+    uint8_t xla = buffer[1];
+    uint8_t yha = buffer[2];
+    uint8_t yla = buffer[3];
+    uint8_t zha = buffer[4];
+    uint8_t zla = buffer[5];
 
     ra.XAxis = xha << 8 | xla;
     ra.YAxis = yha << 8 | yla;
@@ -405,34 +397,18 @@ Vector MPU6050::readScaledAccel(void)
 
 Vector MPU6050::readRawGyro(void)
 {
-    Wire.beginTransmission(mpuAddress);
-    #if ARDUINO >= 100
-	Wire.write(MPU6050_REG_GYRO_XOUT_H);
-    #else
-	Wire.send(MPU6050_REG_GYRO_XOUT_H);
-    #endif
-    Wire.endTransmission();
-
-    Wire.beginTransmission(mpuAddress);
-    Wire.requestFrom(mpuAddress, 6);
-
-    while (Wire.available() < 6);
-
-    #if ARDUINO >= 100
-	uint8_t xha = Wire.read();
-	uint8_t xla = Wire.read();
-        uint8_t yha = Wire.read();
-	uint8_t yla = Wire.read();
-	uint8_t zha = Wire.read();
-	uint8_t zla = Wire.read();
-    #else
-	uint8_t xha = Wire.receive();
-	uint8_t xla = Wire.receive();
-	uint8_t yha = Wire.receive();
-	uint8_t yla = Wire.receive();
-	uint8_t zha = Wire.receive();
-	uint8_t zla = Wire.receive();
-    #endif
+    uint8_t buffer[6];
+    if (!readRegisters(MPU6050_REG_GYRO_XOUT_H, buffer, 6))
+    {
+	return rg;
+    }
+
+    uint8_t xha = buffer[0];
+    uint8_t xla = buffer[1];
+    uint8_t yha = buffer[2];
+    uint8_t yla = buffer[3];
+    uint8_t zha = buffer[4];
+    uint8_t zla = buffer[5];
 
     rg.XAxis = xha << 8 | xla;
     rg.YAxis = yha << 8 | yla;
@@ -467,6 +443,72 @@ Vector MPU6050::readNormalizeGyro(void)
     return ng;
 }
 
+RawMotion MPU6050::readRawMotion(void)
+{
+    RawMotion m;
+    if (!readRawMotion(m))
+    {
+	memset(&m, 0, sizeof(m));
+    }
+
+    return m;
+}
+
+// Read accel, temperature and gyro in one burst, returns false (leaving m
+// untouched) if the read failed
+bool MPU6050::readRawMotion(RawMotion &m)
+{
+    uint8_t buffer[MPU6050_MOTION_SIZE];
+    if (!readRegisters(MPU6050_REG_ACCEL_XOUT_H, buffer, MPU6050_MOTION_SIZE))
+    {
+	return false;
+    }
+
+    // Registers are big-endian and laid out as accel, temperature, gyro
+    int16_t values[MPU6050_MOTION_SIZE / 2];
+    for (uint8_t i = 0; i < MPU6050_MOTION_SIZE / 2; ++i)
+    {
+	values[i] = buffer[2 * i] << 8 | buffer[2 * i + 1];
+    }
+
+    m.accel[0] = values[0];
+    m.accel[1] = values[1];
+    m.accel[2] = values[2];
+    m.temperature = values[3];
+    m.gyro[0] = values[4];
+    m.gyro[1] = values[5];
+    m.gyro[2] = values[6];
+
+    return true;
+}
+
+FixedMotion MPU6050::readFixedMotion(void)
+{
+    return normalizeMotion(readRawMotion());
+}
+
+FixedMotion MPU6050::normalizeMotion(const RawMotion &raw)
+{
+    FixedMotion m;
+    normalizeFixed(raw.accel, raw.gyro, &m);
+
+    // T / 340 + 36.53 in 0.01 C
+    m.temperature = (int16_t)(((int32_t)raw.temperature * 5) / 17 + 3653);
+
+    return m;
+}
+
+FixedMotion MPU6050::normalizeMotion(const FifoFrame &frame)
+{
+    FixedMotion m;
+    normalizeFixed(frame.accel, frame.gyro, &m);
+
+    // The FIFO does not store the temperature
+    m.temperature = 0;
+
+    return m;
+}
+
 float MPU6050::readTemperature(void)
 {
     int16_t T;
@@ -569,9 +611,9 @@ void MPU6050::calibrateGyro(uint8_t samples)
     dg.ZAxis = sumZ / samples;
 
     // Calculate threshold vectors
-    th.XAxis = sqrt((sigmaX / 50) - (dg.XAxis * dg.XAxis));
-    th.YAxis = sqrt((sigmaY / 50) - (dg.YAxis * dg.YAxis));
-    th.ZAxis = sqrt((sigmaZ / 50) - (dg.ZAxis * dg.ZAxis));
+    th.XAxis = sqrt((sigmaX / samples) - (dg.XAxis * dg.XAxis));
+    th.YAxis = sqrt((sigmaY / samples) - (dg.YAxis * dg.YAxis));
+    th.ZAxis = sqrt((sigmaZ / samples) - (dg.ZAxis * dg.ZAxis));
 
     // If already set threshold, recalculate threshold vectors
     if (actualThreshold > 0)
@@ -580,6 +622,73 @@ void MPU6050::calibrateGyro(uint8_t samples)
     }
 }
 
+// Measure the accelerometer and gyroscope biases with the sensor at rest
+// and level (Z axis up) and subtract them in the hardware offset registers,
+// so readings come out corrected at no cost per sample. The accelerometer
+// offsets are in +-16 g units and keep their reserved bit 0, the gyroscope
+// offsets are in +-1000 dps units. Failed reads are left out of the
+// average; returns false, leaving the offsets untouched, if every read
+// failed.
+bool MPU6050::calibrateOffsets(uint16_t samples)
+{
+    if (samples == 0)
+    {
+	return false;
+    }
+
+    uint8_t range = (uint8_t)getRange();
+    uint8_t scale = (uint8_t)getScale();
+
+    int32_t sum[6] = { 0, 0, 0, 0, 0, 0 };
+    int32_t valid = 0;
+    for (uint16_t i = 0; i < samples; ++i)
+    {
+	RawMotion m;
+	bool ok = readRawMotion(m);
+
+	// The sensor outputs a new reading every millisecond with the DLPF on
+	delayMicroseconds(1000);
+
+	if (!ok)
+	{
+	    continue;
+	}
+
+	for (uint8_t j = 0; j < 3; ++j)
+	{
+	    sum[j] += m.accel[j];
+	    sum[j + 3] += m.gyro[j];
+	}
+
+	++valid;
+    }
+
+    if (valid == 0)
+    {
+	return false;
+    }
+
+    // At rest the accelerometer reads 1 g on the Z axis only
+    const int32_t expected[3] = { 0, 0, (int32_t)16384 >> range };
+
+    for (uint8_t j = 0; j < 3; ++j)
+    {
+	// One accelerometer LSB is 2^range / 8 offset LSBs
+	uint8_t reg = MPU6050_REG_ACCEL_XOFFS_H + 2 * j;
+	int32_t error = sum[j] / valid - expected[j];
+	int16_t old = readRegister16(reg);
+	int16_t value = old - (int16_t)(error * (1 << range) / 8);
+	writeRegister16(reg, (value & ~1) | (old & 1));
+
+	// One gyroscope LSB is 2^scale / 4 offset LSBs
+	reg = MPU6050_REG_GYRO_XOFFS_H + 2 * j;
+	int32_t drift = sum[j + 3] / valid;
+	writeRegister16(reg, readRegister16(reg) - (int16_t)(drift * (1 << scale) / 4));
+    }
+
+    return true;
+}
+
 // Get current threshold value
 uint8_t MPU6050::getThreshold(void)
 {
@@ -616,111 +725,186 @@ void MPU6050::setThreshold(uint8_t multiple)
 // Fast read 8-bit from register
 uint8_t MPU6050::fastRegister8(uint8_t reg)
 {
-    uint8_t value;
+    uint8_t value = 0;
+    readRegisters(reg, &value, 1);
+    return value;
+}
 
-    Wire.beginTransmission(mpuAddress);
-    #if ARDUINO >= 100
-	Wire.write(reg);
-    #else
-	Wire.send(reg);
-    #endif
-    Wire.endTransmission();
-
-    Wire.beginTransmission(mpuAddress);
-    Wire.requestFrom(mpuAddress, 1);
-    #if ARDUINO >= 100
-	value = Wire.read();
-    #else
-	value = Wire.receive();
-    #endif;
-    Wire.endTransmission();
+// Sample Rate = Gyroscope Output Rate / (1 + divider), the gyroscope output
+// rate is 8 kHz when the DLPF is disabled and 1 kHz otherwise
+void MPU6050::setSampleRateDivider(uint8_t divider)
+{
+    writeRegister8(MPU6050_REG_SMPLRT_DIV, divider);
+}
 
-    return value;
+uint8_t MPU6050::getSampleRateDivider(void)
+{
+    return readRegister8(MPU6050_REG_SMPLRT_DIV);
 }
 
-// Read 8-bit from register
-uint8_t MPU6050::readRegister8(uint8_t reg)
+bool MPU6050::getIntDataReadyEnabled(void)
 {
-    uint8_t value;
+    return readRegisterBit(MPU6050_REG_INT_ENABLE, 0);
+}
 
-    Wire.beginTransmission(mpuAddress);
-    #if ARDUINO >= 100
-	Wire.write(reg);
-    #else
-	Wire.send(reg);
-    #endif
-    Wire.endTransmission();
-
-    Wire.beginTransmission(mpuAddress);
-    Wire.requestFrom(mpuAddress, 1);
-    while(!Wire.available()) {};
-    #if ARDUINO >= 100
-	value = Wire.read();
-    #else
-	value = Wire.receive();
-    #endif;
-    Wire.endTransmission();
+void MPU6050::setIntDataReadyEnabled(bool state)
+{
+    writeRegisterBit(MPU6050_REG_INT_ENABLE, 0, state);
+}
+
+bool MPU6050::getFifoEnabled(void)
+{
+    return readRegisterBit(MPU6050_REG_USER_CTRL, 6);
+}
+
+// Store accelerometer and gyroscope samples in the FIFO
+void MPU6050::setFifoEnabled(bool state)
+{
+    writeRegister8(MPU6050_REG_FIFO_EN, state ? 0b01111000 : 0);
+    writeRegisterBit(MPU6050_REG_USER_CTRL, 6, state);
+}
+
+// Discard the FIFO contents, used after an overflow to realign frames
+void MPU6050::resetFifo(void)
+{
+    bool enabled = getFifoEnabled();
+
+    writeRegisterBit(MPU6050_REG_USER_CTRL, 6, false);
+    writeRegisterBit(MPU6050_REG_USER_CTRL, 2, true);
+    writeRegisterBit(MPU6050_REG_USER_CTRL, 6, enabled);
+}
+
+uint16_t MPU6050::getFifoCount(void)
+{
+    return (uint16_t)readRegister16(MPU6050_REG_FIFO_COUNT_H);
+}
+
+// Burst read up to count frames from the FIFO, the caller must check with
+// getFifoCount() that they are available. Returns the number of frames read.
+uint8_t MPU6050::readFifo(FifoFrame *frames, uint8_t count)
+{
+    // Keep the buffer small on the stack, read four frames per transaction
+    const uint8_t framesPerRead = 4;
+    uint8_t buffer[framesPerRead * MPU6050_FIFO_FRAME_SIZE];
+
+    uint8_t read = 0;
+    while (read < count)
+    {
+	uint8_t n = count - read;
+	if (n > framesPerRead)
+	{
+	    n = framesPerRead;
+	}
+
+	if (!readRegisters(MPU6050_REG_FIFO_R_W, buffer, n * MPU6050_FIFO_FRAME_SIZE))
+	{
+	    break;
+	}
+
+	parseFifo(buffer, frames + read, n);
+	read += n;
+    }
+
+    return read;
+}
+
+// Post a read of FIFO_COUNT_H/L into buffer (2 bytes) without waiting for
+// the bus, the transaction and buffer must stay valid until it finishes
+bool MPU6050::requestFifoCount(TwiTransaccion *t, uint8_t *buffer)
+{
+    twiPreparar(t, mpuAddress, MPU6050_REG_FIFO_COUNT_H, buffer, 2, false);
+    return twiEncolar(t);
+}
 
+uint16_t MPU6050::parseFifoCount(const uint8_t *buffer)
+{
+    return (uint16_t)buffer[0] << 8 | buffer[1];
+}
+
+// Post a burst read of count frames into buffer, which must hold at least
+// count * MPU6050_FIFO_FRAME_SIZE (at most 255) bytes
+bool MPU6050::requestFifo(TwiTransaccion *t, uint8_t *buffer, uint8_t count)
+{
+    twiPreparar(t, mpuAddress, MPU6050_REG_FIFO_R_W, buffer, count * MPU6050_FIFO_FRAME_SIZE, false);
+    return twiEncolar(t);
+}
+
+// Convert count big-endian frames from the FIFO
+void MPU6050::parseFifo(const uint8_t *buffer, FifoFrame *frames, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; ++i)
+    {
+	// The FIFO stores the accelerometer axes before the gyroscope
+	for (uint8_t j = 0; j < 3; ++j, buffer += 2)
+	{
+	    frames[i].accel[j] = buffer[0] << 8 | buffer[1];
+	}
+
+	for (uint8_t j = 0; j < 3; ++j, buffer += 2)
+	{
+	    frames[i].gyro[j] = buffer[0] << 8 | buffer[1];
+	}
+    }
+}
+
+// Scale raw readings with integer multiplies only
+void MPU6050::normalizeFixed(const int16_t *accel, const int16_t *gyro, FixedMotion *m)
+{
+    const int32_t round = 1L << (MPU6050_FIXED_SHIFT - 1);
+
+    int32_t offset[3] = { 0, 0, 0 };
+    if (useCalibrate)
+    {
+	offset[0] = dg.XAxis;
+	offset[1] = dg.YAxis;
+	offset[2] = dg.ZAxis;
+    }
+
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+	int32_t a = accel[i];
+	int32_t g = gyro[i] - offset[i];
+
+	m->accel[i] = (a * accelFixed + round) >> MPU6050_FIXED_SHIFT;
+	m->gyro[i] = (g * gyroFixed + round) >> MPU6050_FIXED_SHIFT;
+    }
+}
+
+// Read count bytes starting at register, gives up after TWI_TIMEOUT_US
+bool MPU6050::readRegisters(uint8_t reg, uint8_t *buffer, uint8_t count)
+{
+    return twiLeer(mpuAddress, reg, buffer, count);
+}
+
+// Read 8-bit from register
+uint8_t MPU6050::readRegister8(uint8_t reg)
+{
+    uint8_t value = 0;
+    readRegisters(reg, &value, 1);
     return value;
 }
 
 // Write 8-bit to register
 void MPU6050::writeRegister8(uint8_t reg, uint8_t value)
 {
-    Wire.beginTransmission(mpuAddress);
-
-    #if ARDUINO >= 100
-	Wire.write(reg);
-	Wire.write(value);
-    #else
-	Wire.send(reg);
-	Wire.send(value);
-    #endif
-    Wire.endTransmission();
+    twiEscribir(mpuAddress, reg, &value, 1);
 }
 
 int16_t MPU6050::readRegister16(uint8_t reg)
 {
-    int16_t value;
-    Wire.beginTransmission(mpuAddress);
-    #if ARDUINO >= 100
-        Wire.write(reg);
-    #else
-        Wire.send(reg);
-    #endif
-    Wire.endTransmission();
-
-    Wire.beginTransmission(mpuAddress);
-    Wire.requestFrom(mpuAddress, 2);
-    while(!Wire.available()) {};
-    #if ARDUINO >= 100
-        uint8_t vha = Wire.read();
-        uint8_t vla = Wire.read();
-    #else
-        uint8_t vha = Wire.receive();
-        uint8_t vla = Wire.receive();
-    #endif;
-    Wire.endTransmission();
-
-    value = vha << 8 | vla;
+    uint8_t buffer[2] = { 0, 0 };
+    readRegisters(reg, buffer, 2);
 
-    return value;
+    return buffer[0] << 8 | buffer[1];
 }
 
 void MPU6050::writeRegister16(uint8_t reg, int16_t value)
 {
-    Wire.beginTransmission(mpuAddress);
-
-    #if ARDUINO >= 100
-	Wire.write(reg);
-	Wire.write((uint8_t)(value >> 8));
-	Wire.write((uint8_t)value);
-    #else
-	Wire.send(reg);
-	Wire.send((uint8_t)(value >> 8));
-	Wire.send((uint8_t)value);
-    #endif
-    Wire.endTransmission();
+    uint8_t buffer[2];
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)value;
+
+    twiEscribir(mpuAddress, reg, buffer, 2);
 }
 
 // Read register bit
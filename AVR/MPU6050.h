@@ -27,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "WProgram.h"
 #endif
 
+#include "Twi.h"
+
 #define MPU6050_ADDRESS             (0x68) // 0x69 when AD0 pin to Vcc
 
 #define MPU6050_REG_ACCEL_XOFFS_H     (0x06)
@@ -41,6 +43,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MPU6050_REG_GYRO_YOFFS_L      (0x16)
 #define MPU6050_REG_GYRO_ZOFFS_H      (0x17)
 #define MPU6050_REG_GYRO_ZOFFS_L      (0x18)
+#define MPU6050_REG_SMPLRT_DIV        (0x19) // Sample Rate Divider
 #define MPU6050_REG_CONFIG            (0x1A)
 #define MPU6050_REG_GYRO_CONFIG       (0x1B) // Gyroscope Configuration
 #define MPU6050_REG_ACCEL_CONFIG      (0x1C) // Accelerometer Configuration
@@ -50,6 +53,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MPU6050_REG_MOT_DURATION      (0x20)
 #define MPU6050_REG_ZMOT_THRESHOLD    (0x21)
 #define MPU6050_REG_ZMOT_DURATION     (0x22)
+#define MPU6050_REG_FIFO_EN           (0x23) // FIFO Enable
 #define MPU6050_REG_INT_PIN_CFG       (0x37) // INT Pin. Bypass Enable Configuration
 #define MPU6050_REG_INT_ENABLE        (0x38) // INT Enable
 #define MPU6050_REG_INT_STATUS        (0x3A)
@@ -71,6 +75,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define MPU6050_REG_MOT_DETECT_CTRL   (0x69)
 #define MPU6050_REG_USER_CTRL         (0x6A) // User Control
 #define MPU6050_REG_PWR_MGMT_1        (0x6B) // Power Management 1
+#define MPU6050_REG_FIFO_COUNT_H      (0x72)
+#define MPU6050_REG_FIFO_COUNT_L      (0x73)
+#define MPU6050_REG_FIFO_R_W          (0x74)
 #define MPU6050_REG_WHO_AM_I          (0x75) // Who Am I
 
 #ifndef VECTOR_STRUCT_H
@@ -98,6 +105,38 @@ struct Activites
     bool isDataReady;
 };
 
+// Accelerometer and gyroscope sample as stored in the FIFO
+struct FifoFrame
+{
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+#define MPU6050_FIFO_SIZE             (1024)
+#define MPU6050_FIFO_FRAME_SIZE       (12)
+
+// Raw ACCEL_XOUT_H..GYRO_ZOUT_L registers, read in a single transaction
+// (seven 16-bit fields, the struct has no padding)
+struct RawMotion
+{
+    int16_t accel[3];
+    int16_t temperature;
+    int16_t gyro[3];
+};
+
+#define MPU6050_MOTION_SIZE           (14)
+
+// Fixed-point motion sample: mm/s^2, 0.01 dps and 0.01 C
+struct FixedMotion
+{
+    int32_t accel[3];
+    int32_t gyro[3];
+    int16_t temperature;
+};
+
+// Fractional bits of the fixed-point scale factors
+#define MPU6050_FIXED_SHIFT           (12)
+
 typedef enum
 {
     MPU6050_CLOCK_KEEP_RESET      = 0b111,
@@ -220,6 +259,7 @@ class MPU6050
 	void setAccelOffsetZ(int16_t offset);
 
 	void calibrateGyro(uint8_t samples = 50);
+	bool calibrateOffsets(uint16_t samples = 256);
 	void setThreshold(uint8_t multiple = 1);
 	uint8_t getThreshold(void);
 
@@ -230,6 +270,28 @@ class MPU6050
 	Vector readNormalizeAccel(void);
 	Vector readScaledAccel(void);
 
+	RawMotion readRawMotion(void);
+	bool readRawMotion(RawMotion &m);
+	FixedMotion readFixedMotion(void);
+	FixedMotion normalizeMotion(const RawMotion &raw);
+	FixedMotion normalizeMotion(const FifoFrame &frame);
+
+	void setSampleRateDivider(uint8_t divider);
+	uint8_t getSampleRateDivider(void);
+	bool getIntDataReadyEnabled(void);
+	void setIntDataReadyEnabled(bool state);
+	bool getFifoEnabled(void);
+	void setFifoEnabled(bool state);
+	void resetFifo(void);
+	uint16_t getFifoCount(void);
+	uint8_t readFifo(FifoFrame *frames, uint8_t count);
+
+	// Non-blocking FIFO access through the TWI queue (see Twi.h)
+	bool requestFifoCount(TwiTransaccion *t, uint8_t *buffer);
+	bool requestFifo(TwiTransaccion *t, uint8_t *buffer, uint8_t count);
+	static uint16_t parseFifoCount(const uint8_t *buffer);
+	static void parseFifo(const uint8_t *buffer, FifoFrame *frames, uint8_t count);
+
     private:
 	Vector ra, rg; // Raw vectors
 	Vector na, ng; // Normalized vectors
@@ -238,11 +300,13 @@ class MPU6050
 	Activites a;   // Activities
 	
 	float dpsPerDigit, rangePerDigit;
+	int32_t gyroFixed, accelFixed;
 	float actualThreshold;
 	bool useCalibrate;
 	int mpuAddress;
 
 	uint8_t fastRegister8(uint8_t reg);
+	bool readRegisters(uint8_t reg, uint8_t *buffer, uint8_t count);
 
 	uint8_t readRegister8(uint8_t reg);
 	void writeRegister8(uint8_t reg, uint8_t value);
@@ -251,6 +315,7 @@ class MPU6050
 	void writeRegister16(uint8_t reg, int16_t value);
 
 	bool readRegisterBit(uint8_t reg, uint8_t pos);
+	void normalizeFixed(const int16_t *accel, const int16_t *gyro, FixedMotion *m);
 	void writeRegisterBit(uint8_t reg, uint8_t pos, bool state);
 
 };
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h>
+
+//
+// Formato de las tramas binarias (little-endian):
+//
+//   [0xA5][0x5A][VERSION][TIPO][LONGITUD][SECUENCIA x2][DATOS...][CRC x2]
+//
+// El CRC (CRC-16/CCITT-FALSE) se calcula desde VERSION hasta el ultimo byte
+// de DATOS. Esta definicion debe coincidir con Controller/src/Protocolo.h
+//
+#define PROTOCOLO_SYNC_0           (0xA5)
+#define PROTOCOLO_SYNC_1           (0x5A)
+#define PROTOCOLO_VERSION          (0x01)
+#define PROTOCOLO_ENCABEZADO       (7)
+#define PROTOCOLO_CRC              (2)
+
+//
+// Tipos de trama
+//
+#define PROTOCOLO_TIPO_TELEMETRIA  (0x01)
+#define PROTOCOLO_TIPO_VELOCIDAD   (0x02)
+#define PROTOCOLO_TIPO_KEEPALIVE   (0x03)
+#define PROTOCOLO_TIPO_ACK         (0x04)
+#define PROTOCOLO_TIPO_CALIBRAR    (0x05)
+#define PROTOCOLO_TIPO_MODO        (0x06)
+#define PROTOCOLO_TIPO_RESUMEN     (0x07)
+
+//
+// Datos de telemetria: tiempo en us, configuracion del MPU (rango del
+// acelerometro en bits 0-1 y escala del giroscopio en bits 2-3) y las
+// seis lecturas crudas del sensor
+//
+#define PROTOCOLO_DATOS_TELEMETRIA (17)
+#define PROTOCOLO_TRAMA_TELEMETRIA (PROTOCOLO_ENCABEZADO + \
+                                    PROTOCOLO_DATOS_TELEMETRIA + \
+                                    PROTOCOLO_CRC)
+
+//
+// Resumen de una ventana de lecturas crudas (modo resumen): tiempo en us
+// del centro de la ventana, configuracion del MPU, numero de muestras de
+// la ventana y el minimo, maximo, media y RMS de cada eje (acelerometro X,
+// Y, Z y giroscopio X, Y, Z, el RMS sin signo)
+//
+#define PROTOCOLO_DATOS_RESUMEN    (54)
+#define PROTOCOLO_TRAMA_RESUMEN    (PROTOCOLO_ENCABEZADO + \
+                                    PROTOCOLO_DATOS_RESUMEN + \
+                                    PROTOCOLO_CRC)
+
+//
+// Comando de velocidad: habilitado (0/1) y velocidad del motor en
+// centesimas de %. El comando de keepalive no lleva datos, tampoco el de
+// calibracion (el MCU detiene el motor, vuelve a medir los offsets del
+// sensor y los guarda en la EEPROM antes de confirmarlo).
+//
+#define PROTOCOLO_DATOS_VELOCIDAD  (3)
+#define PROTOCOLO_DATOS_KEEPALIVE  (0)
+#define PROTOCOLO_DATOS_CALIBRAR   (0)
+
+//
+// Comando de modo de telemetria: modo y decimacion (potencia de 2). El MCU
+// muestrea a 1 kHz y manda una trama por cada "decimacion" muestras: la
+// ultima muestra cruda, la salida del filtro pasabajas (tramas de
+// telemetria) o el resumen de la ventana (tramas de resumen).
+//
+#define PROTOCOLO_DATOS_MODO       (2)
+#define PROTOCOLO_MODO_CRUDO       (0x00)
+#define PROTOCOLO_MODO_FILTRADO    (0x01)
+#define PROTOCOLO_MODO_RESUMEN     (0x02)
+
+#define PROTOCOLO_MAX_DATOS_COMANDO PROTOCOLO_DATOS_VELOCIDAD
+
+//
+// Confirmacion de un comando: la secuencia de la trama es la del comando
+// confirmado, los datos son el tipo del comando y el estado
+//
+#define PROTOCOLO_DATOS_ACK        (2)
+#define PROTOCOLO_TRAMA_ACK        (PROTOCOLO_ENCABEZADO + \
+                                    PROTOCOLO_DATOS_ACK + \
+                                    PROTOCOLO_CRC)
+
+#define PROTOCOLO_ACK_OK           (0x00)
+#define PROTOCOLO_ACK_DESCONOCIDO  (0x01)
+#define PROTOCOLO_ACK_INVALIDO     (0x02)
+#define PROTOCOLO_ACK_FALLO        (0x03)
+
+///
+/// Actualiza el CRC-16/CCITT-FALSE con el byte @a dato
+///
+static inline uint16_t protocoloCrc16(uint16_t crc, uint8_t dato) {
+  crc ^= (uint16_t) dato << 8;
+  for (uint8_t i = 0; i < 8; ++i)
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+
+  return crc;
+}
+
+///
+/// Escribe @a valor en @a buffer en formato little-endian
+///
+static inline void protocoloEscribir16(uint8_t* buffer, uint16_t valor) {
+  buffer[0] = (uint8_t) (valor);
+  buffer[1] = (uint8_t) (valor >> 8);
+}
+
+///
+/// Escribe @a valor en @a buffer en formato little-endian
+///
+static inline void protocoloEscribir32(uint8_t* buffer, uint32_t valor) {
+  buffer[0] = (uint8_t) (valor);
+  buffer[1] = (uint8_t) (valor >> 8);
+  buffer[2] = (uint8_t) (valor >> 16);
+  buffer[3] = (uint8_t) (valor >> 24);
+}
+
+///
+/// Lee un entero little-endian de @a buffer
+///
+static inline uint16_t protocoloLeer16(const uint8_t* buffer) {
+  return (uint16_t) buffer[0] | ((uint16_t) buffer[1] << 8);
+}
+
+///
+/// Escribe el encabezado y el CRC de una trama cuyos @a longitud bytes de
+/// datos ya estan en trama + PROTOCOLO_ENCABEZADO. Regresa el numero de
+/// bytes de la trama.
+///
+static inline uint8_t protocoloFinalizar(uint8_t* trama,
+                                         uint8_t tipo,
+                                         uint16_t secuencia,
+                                         uint8_t longitud) {
+  // Generar encabezado
+  trama[0] = PROTOCOLO_SYNC_0;
+  trama[1] = PROTOCOLO_SYNC_1;
+  trama[2] = PROTOCOLO_VERSION;
+  trama[3] = tipo;
+  trama[4] = longitud;
+  protocoloEscribir16(trama + 5, secuencia);
+
+  // Calcular CRC
+  uint16_t crc = 0xFFFF;
+  const uint8_t fin = PROTOCOLO_ENCABEZADO + longitud;
+  for (uint8_t i = 2; i < fin; ++i)
+    crc = protocoloCrc16(crc, trama[i]);
+
+  protocoloEscribir16(trama + fin, crc);
+  return fin + PROTOCOLO_CRC;
+}
+
+///
+/// Regresa true si el CRC de la @a trama completa (encabezado, datos y
+/// CRC) es valido
+///
+static inline bool protocoloValidar(const uint8_t* trama) {
+  uint16_t crc = 0xFFFF;
+  const uint8_t fin = PROTOCOLO_ENCABEZADO + trama[4];
+  for (uint8_t i = 2; i < fin; ++i)
+    crc = protocoloCrc16(crc, trama[i]);
+
+  return crc == protocoloLeer16(trama + fin);
+}
+
+///
+/// Genera una trama de telemetria en @a trama, la cual debe tener al menos
+/// PROTOCOLO_TRAMA_TELEMETRIA bytes. Regresa el numero de bytes escritos.
+///
+static inline uint8_t protocoloTelemetria(uint8_t* trama,
+                                          uint16_t secuencia,
+                                          uint32_t tiempo,
+                                          uint8_t config,
+                                          const int16_t accel[3],
+                                          const int16_t gyro[3]) {
+  uint8_t* datos = trama + PROTOCOLO_ENCABEZADO;
+  protocoloEscribir32(datos, tiempo);
+  datos[4] = config;
+  for (uint8_t i = 0; i < 3; ++i) {
+    protocoloEscribir16(datos + 5 + i * 2, (uint16_t) accel[i]);
+    protocoloEscribir16(datos + 11 + i * 2, (uint16_t) gyro[i]);
+  }
+
+  return protocoloFinalizar(trama, PROTOCOLO_TIPO_TELEMETRIA, secuencia,
+                            PROTOCOLO_DATOS_TELEMETRIA);
+}
+
+///
+/// Genera una trama de resumen en @a trama, la cual debe tener al menos
+/// PROTOCOLO_TRAMA_RESUMEN bytes. Cada arreglo tiene los seis ejes.
+/// Regresa el numero de bytes escritos.
+///
+static inline uint8_t protocoloResumen(uint8_t* trama,
+                                       uint16_t secuencia,
+                                       uint32_t tiempo,
+                                       uint8_t config,
+                                       uint8_t muestras,
+                                       const int16_t minimo[6],
+                                       const int16_t maximo[6],
+                                       const int16_t media[6],
+                                       const uint16_t rms[6]) {
+  uint8_t* datos = trama + PROTOCOLO_ENCABEZADO;
+  protocoloEscribir32(datos, tiempo);
+  datos[4] = config;
+  datos[5] = muestras;
+  for (uint8_t i = 0; i < 6; ++i) {
+    protocoloEscribir16(datos + 6 + i * 2, (uint16_t) minimo[i]);
+    protocoloEscribir16(datos + 18 + i * 2, (uint16_t) maximo[i]);
+    protocoloEscribir16(datos + 30 + i * 2, (uint16_t) media[i]);
+    protocoloEscribir16(datos + 42 + i * 2, rms[i]);
+  }
+
+  return protocoloFinalizar(trama, PROTOCOLO_TIPO_RESUMEN, secuencia,
+                            PROTOCOLO_DATOS_RESUMEN);
+}
+
+///
+/// Genera una confirmacion para el comando con la @a secuencia y @a tipo
+/// especificados en @a trama, la cual debe tener al menos
+/// PROTOCOLO_TRAMA_ACK bytes. Regresa el numero de bytes escritos.
+///
+static inline uint8_t protocoloAck(uint8_t* trama,
+                                   uint16_t secuencia,
+                                   uint8_t tipo,
+                                   uint8_t estado) {
+  trama[PROTOCOLO_ENCABEZADO] = tipo;
+  trama[PROTOCOLO_ENCABEZADO + 1] = estado;
+  return protocoloFinalizar(trama, PROTOCOLO_TIPO_ACK, secuencia,
+                            PROTOCOLO_DATOS_ACK);
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Transmisor.h"
+
+#include <Arduino.h>
+
+//
+// Cola circular, los bytes pendientes van de inicio a fin
+//
+static uint8_t cola[TRANSMISOR_BYTES];
+static uint8_t inicio = 0;
+static uint8_t fin = 0;
+
+static_assert(TRANSMISOR_BYTES == 256, "Los indices de la cola son de 8 bits");
+
+static TransmisorContadores contadores;
+
+bool transmisorEncolar(const uint8_t* trama, uint8_t bytes, bool prioritaria) {
+  const uint8_t libres = (uint8_t) (inicio - fin - 1);
+  const uint8_t reserva = prioritaria ? 0 : TRANSMISOR_RESERVA;
+  if ((uint16_t) bytes + reserva > libres) {
+    ++contadores.descartadas;
+    return false;
+  }
+
+  for (uint8_t i = 0; i < bytes; ++i)
+    cola[fin++] = trama[i];
+
+  ++contadores.tramas;
+  if (transmisorPendientes() > contadores.maximo)
+    contadores.maximo = transmisorPendientes();
+
+  return true;
+}
+
+void transmisorVaciar() {
+  if (inicio == fin)
+    return;
+
+  int espacio = Serial.availableForWrite();
+  while (espacio > 0 && inicio != fin) {
+    // Bytes contiguos hasta el fin de la cola o hasta el final del arreglo
+    uint16_t bytes = fin > inicio ? fin - inicio : TRANSMISOR_BYTES - inicio;
+    if (bytes > (uint16_t) espacio)
+      bytes = espacio;
+
+    Serial.write(cola + inicio, bytes);
+    inicio += bytes;
+    espacio -= bytes;
+    contadores.bytes += bytes;
+  }
+}
+
+uint8_t transmisorPendientes() {
+  return (uint8_t) (fin - inicio);
+}
+
+const TransmisorContadores& transmisorContadores() {
+  return contadores;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TRANSMISOR_H
+#define TRANSMISOR_H
+
+#include <stdint.h>
+
+//
+// Cola de tramas de salida. El firmware encola tramas completas sin
+// esperar al serial y el loop pasa los bytes encolados al buffer de
+// transmision del HardwareSerial solo mientras tenga espacio, la
+// interrupcion de registro de datos vacio (UDRE) del USART los saca de
+// ahi. Si el enlace no alcanza a mandar las tramas la cola se llena y las
+// tramas nuevas se descartan completas (nunca a la mitad), de modo que el
+// muestreo y el control del motor no dependen de la velocidad del serial.
+//
+
+//
+// Tamano de la cola en bytes, los indices son de 8 bits y dan la vuelta
+// solos por lo que caben TRANSMISOR_BYTES - 1 bytes (~9 tramas de
+// telemetria binaria)
+//
+#define TRANSMISOR_BYTES 256
+
+//
+// Bytes de la cola que solo pueden usar las tramas prioritarias (las
+// confirmaciones de comandos), para que la telemetria no las desplace
+//
+#define TRANSMISOR_RESERVA 32
+
+///
+/// Contadores acumulados desde el inicio
+///
+struct TransmisorContadores {
+  uint32_t tramas;        ///< Tramas encoladas
+  uint32_t descartadas;   ///< Tramas descartadas porque la cola estaba llena
+  uint32_t bytes;         ///< Bytes pasados al serial
+  uint8_t maximo;         ///< Maximo numero de bytes en la cola
+};
+
+///
+/// Encola los @a bytes de la @a trama si caben completos, regresa false y
+/// cuenta la trama como descartada si no caben. Las tramas que no son
+/// @a prioritarias deben dejar libres TRANSMISOR_RESERVA bytes.
+///
+bool transmisorEncolar(const uint8_t* trama, uint8_t bytes,
+                       bool prioritaria = false);
+
+///
+/// Pasa al serial los bytes encolados que quepan en su buffer de
+/// transmision sin esperar, se debe llamar en cada iteracion del loop
+///
+void transmisorVaciar();
+
+///
+/// Regresa el numero de bytes en la cola
+///
+uint8_t transmisorPendientes();
+
+///
+/// Regresa los contadores acumulados
+///
+const TransmisorContadores& transmisorContadores();
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Twi.h"
+
+#include <Arduino.h>
+
+//
+// Cola circular de transacciones, la primera es la que esta en curso
+//
+static TwiTransaccion* cola[TWI_MAX_COLA];
+static volatile uint8_t primera = 0;
+static volatile uint8_t enCola = 0;
+
+//
+// Numero de transacciones comenzadas, permite a twiVigilar() saber si la
+// transaccion en curso es la misma que en la revision anterior y desde
+// cuando la esta vigilando
+//
+static volatile uint8_t comenzadas = 0;
+static bool vigilando = false;
+static uint8_t vigilada = 0;
+static uint32_t inicioVigilada = 0;
+
+static TwiContadores contadores;
+
+///
+/// Comienza la primera transaccion de la cola, si la hay
+///
+static void comenzarSiguiente() {
+  if (enCola == 0)
+    return;
+
+  TwiTransaccion* t = cola[primera];
+  t->estado = TWI_EN_CURSO;
+  ++comenzadas;
+  twiHwComenzar(t);
+}
+
+void twiTerminar(uint8_t estado) {
+  if (enCola == 0)
+    return;
+
+  switch (estado) {
+    case TWI_COMPLETA: ++contadores.completas; break;
+    case TWI_ERROR:    ++contadores.errores;   break;
+    case TWI_TIMEOUT:  ++contadores.timeouts;  break;
+  }
+
+  cola[primera]->estado = estado;
+  primera = (primera + 1) & (TWI_MAX_COLA - 1);
+  --enCola;
+
+  comenzarSiguiente();
+}
+
+void twiIniciar(uint32_t frecuencia) {
+  // Abortar las transacciones que hayan quedado en la cola
+  noInterrupts();
+  twiHwDetener();
+  while (enCola > 0) {
+    cola[primera]->estado = TWI_ERROR;
+    primera = (primera + 1) & (TWI_MAX_COLA - 1);
+    --enCola;
+  }
+  interrupts();
+
+  memset(&contadores, 0, sizeof(contadores));
+  vigilando = false;
+
+  twiHwIniciar(frecuencia);
+}
+
+void twiPreparar(TwiTransaccion* t,
+                 uint8_t direccion,
+                 uint8_t registro,
+                 uint8_t* datos,
+                 uint8_t bytes,
+                 bool escritura) {
+  t->direccion = direccion;
+  t->registro = registro;
+  t->datos = datos;
+  t->bytes = bytes;
+  t->escritura = escritura;
+  t->estado = TWI_PENDIENTE;
+}
+
+bool twiEncolar(TwiTransaccion* t) {
+  noInterrupts();
+  if (enCola >= TWI_MAX_COLA) {
+    interrupts();
+    return false;
+  }
+
+  t->estado = TWI_PENDIENTE;
+  cola[(primera + enCola) & (TWI_MAX_COLA - 1)] = t;
+  if (++enCola == 1)
+    comenzarSiguiente();
+
+  interrupts();
+  return true;
+}
+
+void twiVigilar() {
+  noInterrupts();
+  const uint8_t pendientes = enCola;
+  const uint8_t actual = comenzadas;
+  interrupts();
+
+  if (pendientes == 0) {
+    vigilando = false;
+    return;
+  }
+
+  // Empezar a contar el tiempo de la transaccion la primera vez que se ve
+  const uint32_t ahora = micros();
+  if (!vigilando || actual != vigilada) {
+    vigilando = true;
+    vigilada = actual;
+    inicioVigilada = ahora;
+    return;
+  }
+
+  if (ahora - inicioVigilada < TWI_TIMEOUT_US)
+    return;
+
+  // Abortar la transaccion, a menos que haya terminado mientras tanto
+  noInterrupts();
+  if (enCola == 0 || comenzadas != vigilada) {
+    interrupts();
+    return;
+  }
+
+  twiHwDetener();
+  interrupts();
+
+  // Liberar el bus antes de continuar con la cola
+  twiHwRecuperar();
+  ++contadores.recuperaciones;
+  vigilando = false;
+
+  noInterrupts();
+  twiTerminar(TWI_TIMEOUT);
+  interrupts();
+}
+
+uint8_t twiEsperar(TwiTransaccion* t) {
+  while (!twiTerminada(t))
+    twiVigilar();
+
+  return t->estado;
+}
+
+bool twiLeer(uint8_t direccion,
+             uint8_t registro,
+             uint8_t* datos,
+             uint8_t bytes) {
+  TwiTransaccion t;
+  twiPreparar(&t, direccion, registro, datos, bytes, false);
+  while (!twiEncolar(&t))
+    twiVigilar();
+
+  return twiEsperar(&t) == TWI_COMPLETA;
+}
+
+bool twiEscribir(uint8_t direccion,
+                 uint8_t registro,
+                 const uint8_t* datos,
+                 uint8_t bytes) {
+  TwiTransaccion t;
+  twiPreparar(&t, direccion, registro, (uint8_t*) datos, bytes, true);
+  while (!twiEncolar(&t))
+    twiVigilar();
+
+  return twiEsperar(&t) == TWI_COMPLETA;
+}
+
+const TwiContadores& twiContadores() {
+  return contadores;
+}
+
+#if defined(__AVR__)
+
+//
+// Hardware TWI del ATmega328P
+//
+
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+//
+// Valores de TWCR: continuar con la interrupcion habilitada (mandando ACK
+// al recibir), generar un inicio y generar una parada
+//
+#define TWCR_CONTINUAR (_BV(TWINT) | _BV(TWEN) | _BV(TWIE))
+#define TWCR_ACK       (TWCR_CONTINUAR | _BV(TWEA))
+#define TWCR_INICIO    (TWCR_CONTINUAR | _BV(TWSTA))
+#define TWCR_PARADA    (_BV(TWINT) | _BV(TWEN) | _BV(TWSTO))
+
+//
+// Numero maximo de veces que se revisa si el hardware ya genero la
+// condicion de parada de la transaccion anterior
+//
+#define ESPERA_PARADA 1000
+
+static uint32_t frecuenciaBus = 100000;
+static TwiTransaccion* volatile actual = 0;
+static volatile uint8_t indice = 0;
+
+void twiHwIniciar(uint32_t frecuencia) {
+  frecuenciaBus = frecuencia;
+
+  // Pull-ups internos en SDA y SCL, prescaler de 1
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0;
+  TWBR = ((F_CPU / frecuencia) - 16) / 2;
+  TWCR = _BV(TWEN);
+}
+
+void twiHwComenzar(TwiTransaccion* t) {
+  for (uint16_t i = 0; (TWCR & _BV(TWSTO)) && i < ESPERA_PARADA; ++i)
+    continue;
+
+  actual = t;
+  indice = 0;
+  TWCR = TWCR_INICIO;
+}
+
+void twiHwDetener() {
+  TWCR = 0;
+  actual = 0;
+}
+
+void twiHwRecuperar() {
+  // Dar pulsos de reloj hasta que el esclavo suelte SDA
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, OUTPUT);
+  for (uint8_t i = 0; i < 9 && !digitalRead(SDA); ++i) {
+    digitalWrite(SCL, LOW);
+    delayMicroseconds(5);
+    digitalWrite(SCL, HIGH);
+    delayMicroseconds(5);
+  }
+
+  // Condicion de parada: SDA sube mientras SCL esta en alto
+  digitalWrite(SCL, LOW);
+  digitalWrite(SDA, LOW);
+  pinMode(SDA, OUTPUT);
+  delayMicroseconds(5);
+  digitalWrite(SCL, HIGH);
+  delayMicroseconds(5);
+  digitalWrite(SDA, HIGH);
+  delayMicroseconds(5);
+
+  pinMode(SDA, INPUT);
+  pinMode(SCL, INPUT);
+  twiHwIniciar(frecuenciaBus);
+}
+
+///
+/// Genera la condicion de parada y termina la transaccion en curso
+///
+static void terminar(uint8_t estado) {
+  TWCR = TWCR_PARADA;
+  actual = 0;
+  twiTerminar(estado);
+}
+
+///
+/// Maquina de estados del TWI, se ejecuta despues de cada evento del bus
+///
+ISR(TWI_vect) {
+  TwiTransaccion* t = actual;
+  if (!t) {
+    TWCR = _BV(TWINT) | _BV(TWEN);
+    return;
+  }
+
+  switch (TW_STATUS) {
+    // Inicio: mandar la direccion para escribir el registro
+    case TW_START:
+      TWDR = (t->direccion << 1) | TW_WRITE;
+      TWCR = TWCR_CONTINUAR;
+      break;
+
+    // Inicio repetido: mandar la direccion para leer los datos
+    case TW_REP_START:
+      TWDR = (t->direccion << 1) | TW_READ;
+      TWCR = TWCR_CONTINUAR;
+      break;
+
+    // El dispositivo respondio, mandar el registro
+    case TW_MT_SLA_ACK:
+      TWDR = t->registro;
+      TWCR = TWCR_CONTINUAR;
+      break;
+
+    // Mandar el siguiente dato, empezar la lectura o terminar
+    case TW_MT_DATA_ACK:
+      if (t->escritura && indice < t->bytes) {
+        TWDR = t->datos[indice++];
+        TWCR = TWCR_CONTINUAR;
+      }
+
+      else if (!t->escritura && t->bytes > 0)
+        TWCR = TWCR_INICIO;
+
+      else
+        terminar(TWI_COMPLETA);
+      break;
+
+    // Pedir el primer byte, el ultimo se recibe sin ACK
+    case TW_MR_SLA_ACK:
+      TWCR = t->bytes > 1 ? TWCR_ACK : TWCR_CONTINUAR;
+      break;
+
+    case TW_MR_DATA_ACK:
+      t->datos[indice++] = TWDR;
+      TWCR = indice + 1 < t->bytes ? TWCR_ACK : TWCR_CONTINUAR;
+      break;
+
+    case TW_MR_DATA_NACK:
+      t->datos[indice++] = TWDR;
+      terminar(TWI_COMPLETA);
+      break;
+
+    // Otro maestro gano el bus, soltarlo sin generar la parada
+    case TW_MT_ARB_LOST:
+      TWCR = _BV(TWINT) | _BV(TWEN);
+      actual = 0;
+      twiTerminar(TWI_ERROR);
+      break;
+
+    // El dispositivo no respondio o hubo un error en el bus
+    default:
+      terminar(TWI_ERROR);
+      break;
+  }
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TWI_H
+#define TWI_H
+
+#include <stdint.h>
+
+//
+// Motor de transacciones I2C asincrono. Las transacciones se encolan y el
+// hardware TWI las ejecuta en su interrupcion mientras el loop sigue
+// atendiendo al serial y al motor. Cada transaccion escribe el registro
+// inicial y despues lee o escribe los datos (con inicio repetido en las
+// lecturas), al terminar cambia su estado.
+//
+// Si una transaccion no termina en TWI_TIMEOUT_US se aborta, se libera el
+// bus (nueve pulsos de reloj y una condicion de parada) y se continua con
+// la siguiente transaccion de la cola.
+//
+
+//
+// Numero maximo de transacciones en la cola (potencia de 2)
+//
+#define TWI_MAX_COLA 4
+
+//
+// Tiempo maximo que puede tardar una transaccion (us)
+//
+#define TWI_TIMEOUT_US 5000
+
+//
+// Estados de una transaccion, a partir de TWI_COMPLETA ya termino
+//
+#define TWI_PENDIENTE (0)
+#define TWI_EN_CURSO  (1)
+#define TWI_COMPLETA  (2)
+#define TWI_ERROR     (3)
+#define TWI_TIMEOUT   (4)
+
+///
+/// Transaccion I2C: escribe @a registro en el dispositivo con la
+/// @a direccion especificada y despues escribe o lee @a bytes de @a datos.
+/// La memoria de la transaccion y de los datos pertenece a quien la encola
+/// y no se debe tocar hasta que termine.
+///
+struct TwiTransaccion {
+  uint8_t direccion;
+  uint8_t registro;
+  uint8_t* datos;
+  uint8_t bytes;
+  bool escritura;
+  volatile uint8_t estado;
+};
+
+///
+/// Contadores acumulados desde twiIniciar()
+///
+struct TwiContadores {
+  uint32_t completas;           ///< Transacciones completas
+  uint16_t errores;             ///< Transacciones sin ACK o con error del bus
+  uint16_t timeouts;            ///< Transacciones abortadas por timeout
+  uint16_t recuperaciones;      ///< Veces que se libero el bus
+};
+
+///
+/// Configura el hardware TWI con la @a frecuencia (Hz) especificada y
+/// vacia la cola
+///
+void twiIniciar(uint32_t frecuencia);
+
+///
+/// Prepara la transaccion @a t con los parametros especificados
+///
+void twiPreparar(TwiTransaccion* t,
+                 uint8_t direccion,
+                 uint8_t registro,
+                 uint8_t* datos,
+                 uint8_t bytes,
+                 bool escritura);
+
+///
+/// Agrega la transaccion @a t a la cola, regresa false si la cola esta
+/// llena
+///
+bool twiEncolar(TwiTransaccion* t);
+
+///
+/// Revisa si la transaccion en curso excedio el timeout, en ese caso la
+/// aborta y libera el bus. Se debe llamar desde el loop.
+///
+void twiVigilar();
+
+///
+/// Espera a que termine la transaccion @a t y regresa su estado final. No
+/// se debe llamar desde una interrupcion.
+///
+uint8_t twiEsperar(TwiTransaccion* t);
+
+///
+/// Lee @a bytes a partir del @a registro y espera a que termine la
+/// transaccion, regresa true si se leyeron todos los datos
+///
+bool twiLeer(uint8_t direccion,
+             uint8_t registro,
+             uint8_t* datos,
+             uint8_t bytes);
+
+///
+/// Escribe @a bytes a partir del @a registro y espera a que termine la
+/// transaccion, regresa true si el dispositivo recibio todos los datos
+///
+bool twiEscribir(uint8_t direccion,
+                 uint8_t registro,
+                 const uint8_t* datos,
+                 uint8_t bytes);
+
+///
+/// Regresa los contadores acumulados
+///
+const TwiContadores& twiContadores();
+
+///
+/// Regresa true si la transaccion @a t ya termino (bien o mal)
+///
+static inline bool twiTerminada(const TwiTransaccion* t) {
+  return t->estado >= TWI_COMPLETA;
+}
+
+//
+// Interfaz con el hardware, implementada para el TWI del ATmega328P en
+// Twi.cpp y para el bus simulado en host/TwiSimulado.cpp. Las funciones
+// twiHwComenzar() y twiHwDetener() se llaman con las interrupciones
+// deshabilitadas. La interrupcion del hardware llama a twiTerminar()
+// cuando la transaccion en curso termina.
+//
+void twiHwIniciar(uint32_t frecuencia);
+void twiHwComenzar(TwiTransaccion* t);
+void twiHwDetener();
+void twiHwRecuperar();
+void twiTerminar(uint8_t estado);
+
+#endif
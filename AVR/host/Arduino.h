@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//
+// Implementacion para Linux de la parte de la API de Arduino que usa el
+// firmware, permite compilarlo como un ejecutable nativo (ver Hal.h)
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define F_CPU 16000000UL
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t modo);
+void digitalWrite(uint8_t pin, uint8_t valor);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int valor);
+
+void interrupts();
+void noInterrupts();
+void attachInterrupt(uint8_t interrupcion, void (*isr)(), int modo);
+void detachInterrupt(uint8_t interrupcion);
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+///
+/// Puerto serial con un buffer de transmision de 64 bytes que se vacia a
+/// la velocidad configurada con begin(), igual que el HardwareSerial de AVR
+///
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baudios);
+    void end();
+
+    int available();
+    int availableForWrite();
+    int peek();
+    int read();
+    void flush();
+
+    size_t write(uint8_t byte);
+    size_t write(const uint8_t* datos, size_t bytes);
+    size_t write(const char* texto);
+
+    size_t print(const char* texto);
+    size_t print(char c);
+    size_t print(unsigned char valor, int base = 10);
+    size_t print(int valor, int base = 10);
+    size_t print(unsigned int valor, int base = 10);
+    size_t print(long valor, int base = 10);
+    size_t print(unsigned long valor, int base = 10);
+    size_t print(double valor, int decimales = 2);
+
+    size_t println();
+    size_t println(const char* texto);
+    size_t println(int valor, int base = 10);
+    size_t println(long valor, int base = 10);
+    size_t println(double valor, int decimales = 2);
+
+    operator bool() const { return true; }
+
+private:
+    size_t imprimirEntero(unsigned long valor, bool negativo, int base);
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//
+// Banco de pruebas del firmware: ejecuta setup() y loop() con la HAL de
+// Linux durante un tiempo virtual y reporta el costo de cada iteracion del
+// loop, la frecuencia de muestreo maxima sostenible y los bytes que se
+// mandan por el serial por cada muestra.
+//
+
+#include "Arduino.h"
+#include "Hal.h"
+#include "MpuSimulado.h"
+#include "Protocolo.h"
+#include "Transmisor.h"
+#include "Twi.h"
+#include "TwiSimulado.h"
+
+#include <chrono>
+#include <getopt.h>
+#include <stdio.h>
+
+//
+// Funciones del firmware (AVR.ino)
+//
+void setup();
+void loop();
+
+//
+// Intervalo con el que se manda el comando de velocidad (ms), menor al
+// watchdog de comandos del firmware
+//
+#define INTERVALO_COMANDOS 250
+
+//
+// Archivo en el que se guarda lo que manda el firmware
+//
+static FILE* archivoSalida = 0;
+
+///
+/// Guarda los bytes que manda el firmware en el archivo de salida
+///
+static void guardarSalida(const uint8_t* datos, size_t bytes) {
+  fwrite(datos, 1, bytes, archivoSalida);
+}
+
+///
+/// Manda al firmware un comando de velocidad binario
+///
+static void mandarVelocidad(uint16_t secuencia, double velocidad) {
+  uint8_t trama[PROTOCOLO_ENCABEZADO + PROTOCOLO_DATOS_VELOCIDAD +
+                PROTOCOLO_CRC];
+  uint8_t* datos = trama + PROTOCOLO_ENCABEZADO;
+  datos[0] = velocidad > 0;
+  protocoloEscribir16(datos + 1, (uint16_t) (velocidad * 100 + 0.5));
+
+  uint8_t bytes = protocoloFinalizar(trama, PROTOCOLO_TIPO_VELOCIDAD,
+                                     secuencia, PROTOCOLO_DATOS_VELOCIDAD);
+  halRecibir(trama, bytes);
+}
+
+///
+/// Manda al firmware un comando para cambiar el @a modo de telemetria y la
+/// @a decimacion
+///
+static void mandarModo(uint16_t secuencia, uint8_t modo, uint8_t decimacion) {
+  uint8_t trama[PROTOCOLO_ENCABEZADO + PROTOCOLO_DATOS_MODO + PROTOCOLO_CRC];
+  trama[PROTOCOLO_ENCABEZADO] = modo;
+  trama[PROTOCOLO_ENCABEZADO + 1] = decimacion;
+
+  uint8_t bytes = protocoloFinalizar(trama, PROTOCOLO_TIPO_MODO, secuencia,
+                                     PROTOCOLO_DATOS_MODO);
+  halRecibir(trama, bytes);
+}
+
+///
+/// Muestra las opciones del programa
+///
+static void mostrarAyuda(const char* programa) {
+  printf("Uso: %s [opciones]\n\n"
+         "  -t, --segundos S         tiempo virtual a simular (10)\n"
+         "  -f, --frecuencia HZ      frecuencia de oscilacion (5)\n"
+         "  -a, --amplitud MM        amplitud de oscilacion (20)\n"
+         "  -z, --amortiguamiento Z  factor de amortiguamiento (0)\n"
+         "  -r, --ruido MS2          ruido del acelerometro (0.05)\n"
+         "  -v, --velocidad PCT      velocidad que se manda al motor (50)\n"
+         "  -o, --salida ARCHIVO     guardar lo que manda el firmware\n"
+         "  -e, --fallas N           trabar el bus I2C cada N transacciones\n"
+         "  -m, --eeprom ARCHIVO     cargar y guardar la EEPROM del MCU\n"
+         "  -b, --baudios N          limitar la velocidad del serial\n"
+         "  -s, --modo M             modo de telemetria: crudo, filtrado o\n"
+         "                           resumen (filtrado)\n"
+         "  -d, --decimacion N       muestras por trama, potencia de 2 (2)\n"
+         "  -h, --help               mostrar esta ayuda\n",
+         programa);
+}
+
+int main(int argc, char** argv) {
+  double segundos = 10;
+  double velocidad = 50;
+  const char* nombreSalida = 0;
+  uint32_t fallas = 0;
+  const char* nombreEeprom = 0;
+  unsigned long baudios = 0;
+  int modo = PROTOCOLO_MODO_FILTRADO;
+  int decimacion = 2;
+
+  Oscilacion oscilacion;
+  oscilacion.frecuencia = 5;
+  oscilacion.amplitud = 0.02;
+  oscilacion.amortiguamiento = 0;
+  oscilacion.ruidoAccel = 0.05;
+  oscilacion.ruidoGiro = 0.1;
+  oscilacion.sesgoAccel[0] = 0.25;
+  oscilacion.sesgoAccel[1] = -0.15;
+  oscilacion.sesgoAccel[2] = 0.4;
+  oscilacion.sesgoGiro[0] = 1.2;
+  oscilacion.sesgoGiro[1] = -0.8;
+  oscilacion.sesgoGiro[2] = 0.5;
+
+  static const option opciones[] = {
+    { "segundos", required_argument, 0, 't' },
+    { "frecuencia", required_argument, 0, 'f' },
+    { "amplitud", required_argument, 0, 'a' },
+    { "amortiguamiento", required_argument, 0, 'z' },
+    { "ruido", required_argument, 0, 'r' },
+    { "velocidad", required_argument, 0, 'v' },
+    { "salida", required_argument, 0, 'o' },
+    { "fallas", required_argument, 0, 'e' },
+    { "eeprom", required_argument, 0, 'm' },
+    { "baudios", required_argument, 0, 'b' },
+    { "modo", required_argument, 0, 's' },
+    { "decimacion", required_argument, 0, 'd' },
+    { "help", no_argument, 0, 'h' },
+    { 0, 0, 0, 0 }
+  };
+
+  int opcion;
+  while ((opcion = getopt_long(argc, argv, "t:f:a:z:r:v:o:e:m:b:s:d:h",
+                               opciones, 0)) != -1) {
+    switch (opcion) {
+      case 't': segundos = atof(optarg); break;
+      case 'f': oscilacion.frecuencia = atof(optarg); break;
+      case 'a': oscilacion.amplitud = atof(optarg) / 1000; break;
+      case 'z': oscilacion.amortiguamiento = atof(optarg); break;
+      case 'r': oscilacion.ruidoAccel = atof(optarg); break;
+      case 'v': velocidad = atof(optarg); break;
+      case 'o': nombreSalida = optarg; break;
+      case 'e': fallas = atoi(optarg); break;
+      case 'm': nombreEeprom = optarg; break;
+      case 'b': baudios = strtoul(optarg, 0, 10); break;
+      case 'd': decimacion = atoi(optarg); break;
+      case 's':
+        if (!strcmp(optarg, "crudo"))
+          modo = PROTOCOLO_MODO_CRUDO;
+        else if (!strcmp(optarg, "filtrado"))
+          modo = PROTOCOLO_MODO_FILTRADO;
+        else if (!strcmp(optarg, "resumen"))
+          modo = PROTOCOLO_MODO_RESUMEN;
+        else {
+          mostrarAyuda(argv[0]);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'h': mostrarAyuda(argv[0]); return EXIT_SUCCESS;
+      default: mostrarAyuda(argv[0]); return EXIT_FAILURE;
+    }
+  }
+
+  if (nombreSalida) {
+    archivoSalida = fopen(nombreSalida, "wb");
+    if (!archivoSalida) {
+      perror(nombreSalida);
+      return EXIT_FAILURE;
+    }
+
+    halCambiarSalida(guardarSalida);
+  }
+
+  // Un archivo que no existe equivale a una EEPROM borrada
+  if (nombreEeprom) {
+    FILE* archivo = fopen(nombreEeprom, "rb");
+    if (archivo) {
+      fread(halEeprom(), 1, HAL_BYTES_EEPROM, archivo);
+      fclose(archivo);
+    }
+  }
+
+  halReiniciar();
+  mpuSimulado.cambiarOscilacion(oscilacion);
+  twiSimularFallas(fallas);
+  halLimitarSerial(baudios);
+
+  // Ejecutar setup(), su costo no se cuenta en las estadisticas del loop
+  setup();
+  const double duracionSetup = (double) halCiclos() / F_CPU;
+  const HalContadores inicio = halContadores();
+  const uint64_t cicloInicio = halCiclos();
+  const uint32_t muestrasInicio = mpuSimulado.muestras();
+  const uint32_t leidasInicio = mpuSimulado.muestrasLeidas();
+  const TransmisorContadores txInicio = transmisorContadores();
+
+  // Estadisticas del loop
+  uint64_t iteraciones = 0;
+  uint64_t ciclosMaximos = 0;
+  uint64_t ciclosConMuestras = 0;
+  uint64_t nsHost = 0;
+
+  // Ejecutar el loop durante el tiempo especificado
+  uint16_t secuencia = 0;
+  uint64_t siguienteComando = 0;
+  mandarModo(secuencia++, (uint8_t) modo, (uint8_t) decimacion);
+  const uint64_t fin = cicloInicio + (uint64_t) (segundos * F_CPU);
+  while (halCiclos() < fin) {
+    if (halMicros() / 1000 >= siguienteComando) {
+      mandarVelocidad(secuencia++, velocidad);
+      siguienteComando += INTERVALO_COMANDOS;
+    }
+
+    const uint64_t ciclos = halCiclos();
+    const uint32_t leidas = mpuSimulado.muestrasLeidas();
+    const auto t = std::chrono::steady_clock::now();
+
+    loop();
+    halCpu(HAL_CICLOS_LOOP);
+
+    nsHost += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t).count();
+
+    const uint64_t costo = halCiclos() - ciclos;
+    if (costo > ciclosMaximos)
+      ciclosMaximos = costo;
+    if (mpuSimulado.muestrasLeidas() != leidas)
+      ciclosConMuestras += costo;
+
+    ++iteraciones;
+  }
+
+  if (archivoSalida)
+    fclose(archivoSalida);
+
+  if (nombreEeprom) {
+    FILE* archivo = fopen(nombreEeprom, "wb");
+    if (!archivo || fwrite(halEeprom(), 1, HAL_BYTES_EEPROM, archivo) !=
+                    HAL_BYTES_EEPROM)
+      perror(nombreEeprom);
+
+    if (archivo)
+      fclose(archivo);
+  }
+
+  // Calcular resultados
+  const HalContadores& c = halContadores();
+  const double cpuMhz = F_CPU / 1e6;
+  const double duracion = (double) (halCiclos() - cicloInicio) / F_CPU;
+  const uint32_t muestras = mpuSimulado.muestras() - muestrasInicio;
+  const uint32_t leidas = mpuSimulado.muestrasLeidas() - leidasInicio;
+  const uint64_t bytesTx = c.bytesSerialTx - inicio.bytesSerialTx;
+  const uint64_t ciclosBus = c.ciclosBus - inicio.ciclosBus;
+  const uint64_t ciclosSerial = c.ciclosSerial - inicio.ciclosSerial;
+  const double totalCiclos = (double) (halCiclos() - cicloInicio);
+  const double costoMuestra = leidas > 0 ?
+                              ciclosConMuestras / cpuMhz / leidas : 0;
+
+  printf("Tiempo del setup:             %.1f ms\n", duracionSetup * 1000);
+  printf("Tiempo simulado:              %.3f s\n", duracion);
+  printf("Frecuencia de muestreo:       %.1f Hz\n",
+         mpuSimulado.frecuenciaMuestreo());
+  printf("Muestras tomadas / leidas:    %u / %u\n", muestras, leidas);
+  printf("Desbordes del FIFO:           %u\n", mpuSimulado.desbordes());
+  printf("Iteraciones del loop:         %llu\n",
+         (unsigned long long) iteraciones);
+  printf("Costo por iteracion:          %.2f us (max %.2f us)\n",
+         totalCiclos / cpuMhz / iteraciones, ciclosMaximos / cpuMhz);
+  printf("Costo en la PC:               %.1f ns por iteracion\n",
+         (double) nsHost / iteraciones);
+  printf("Costo por muestra:            %.2f us\n", costoMuestra);
+  printf("Frecuencia maxima sostenible: %.1f Hz\n",
+         costoMuestra > 0 ? 1e6 / costoMuestra : 0);
+  printf("Bytes seriales por muestra:   %.2f\n",
+         leidas > 0 ? (double) bytesTx / leidas : 0);
+  printf("Tramas por segundo:           %.1f (%.0f bytes/s)\n",
+         (transmisorContadores().tramas - txInicio.tramas) / duracion,
+         bytesTx / duracion);
+  printf("Bus I2C:                      %llu bytes, %u transacciones, "
+         "%.1f %% ocupado\n",
+         (unsigned long long) (c.bytesBus - inicio.bytesBus),
+         c.transaccionesBus - inicio.transaccionesBus,
+         100 * ciclosBus / totalCiclos);
+  printf("Errores del bus I2C:          %u sin respuesta, %u timeouts, "
+         "%u recuperaciones\n",
+         twiContadores().errores, twiContadores().timeouts,
+         twiContadores().recuperaciones);
+  printf("Espera del serial:            %.1f %%\n",
+         100 * ciclosSerial / totalCiclos);
+  printf("Tramas encoladas/descartadas: %u / %u (cola max %u/%u bytes)\n",
+         transmisorContadores().tramas - txInicio.tramas,
+         transmisorContadores().descartadas - txInicio.descartadas,
+         transmisorContadores().maximo, TRANSMISOR_BYTES - 1);
+  printf("Interrupciones:               %u\n",
+         c.interrupciones - inicio.interrupciones);
+  printf("PWM del motor:                %d\n", halPwm(6));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+
+///
+/// EEPROM simulada con la API de la biblioteca EEPROM de Arduino, su
+/// contenido se conserva entre llamadas a halReiniciar() (ver halEeprom())
+///
+class EEPROMClass
+{
+public:
+    uint8_t read(int direccion);
+    void write(int direccion, uint8_t valor);
+    void update(int direccion, uint8_t valor);
+    uint16_t length();
+
+    template <typename T>
+    T& get(int direccion, T& dato) {
+        uint8_t* bytes = (uint8_t*) &dato;
+        for (unsigned i = 0; i < sizeof(T); ++i)
+            bytes[i] = read(direccion + i);
+
+        return dato;
+    }
+
+    template <typename T>
+    const T& put(int direccion, const T& dato) {
+        const uint8_t* bytes = (const uint8_t*) &dato;
+        for (unsigned i = 0; i < sizeof(T); ++i)
+            update(direccion + i, bytes[i]);
+
+        return dato;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Hal.h"
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "MpuSimulado.h"
+
+#include <deque>
+#include <stdio.h>
+
+//
+// Numero de interrupciones externas (INT0 en el pin 2, INT1 en el pin 3)
+//
+#define NUM_INTERRUPCIONES 2
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+//
+// Tiempo virtual y contadores
+//
+static uint64_t ciclo = 0;
+static bool avanzando = false;
+static HalContadores contadores;
+
+//
+// Interrupciones externas
+//
+static bool habilitadas = true;
+static bool enInterrupcion = false;
+static void (*rutinas[NUM_INTERRUPCIONES])() = { 0, 0 };
+static int modos[NUM_INTERRUPCIONES] = { 0, 0 };
+static bool pendientes[NUM_INTERRUPCIONES] = { false, false };
+
+//
+// Interrupcion del TWI y ciclo en el que se genera
+//
+static void (*rutinaTwi)() = 0;
+static uint64_t cicloTwi = 0;
+
+//
+// Pines
+//
+static int pwm[20];
+static uint8_t pines[20];
+
+//
+// Serial: bytes en el buffer de transmision y ciclo en el que termina de
+// salir el byte que se esta transmitiendo
+//
+static uint64_t ciclosPorByte = 0;
+static unsigned long limiteBaudios = 0;
+static uint8_t bytesTx = 0;
+static uint64_t finByteTx = 0;
+static std::deque<uint8_t> rx;
+static HalSalida salida = 0;
+
+//
+// EEPROM, empieza borrada (todos los bits en 1)
+//
+static struct MemoriaEeprom {
+  uint8_t bytes[HAL_BYTES_EEPROM];
+  MemoriaEeprom() { memset(bytes, 0xFF, sizeof(bytes)); }
+} eeprom;
+
+///
+/// Ejecuta la rutina de la @a interrupcion especificada
+///
+static void ejecutarInterrupcion(int interrupcion) {
+  pendientes[interrupcion] = false;
+  if (!rutinas[interrupcion])
+    return;
+
+  enInterrupcion = true;
+  ++contadores.interrupciones;
+  halCpu(HAL_CICLOS_INTERRUPCION);
+  rutinas[interrupcion]();
+  enInterrupcion = false;
+}
+
+static void ejecutarPendientes();
+
+///
+/// Ejecuta la interrupcion del TWI, que puede programar la siguiente, y
+/// despues las interrupciones que llegaron mientras se ejecutaba
+///
+static void ejecutarTwi() {
+  void (*rutina)() = rutinaTwi;
+  rutinaTwi = 0;
+
+  enInterrupcion = true;
+  halCpu(HAL_CICLOS_INTERRUPCION);
+  rutina();
+  enInterrupcion = false;
+
+  ejecutarPendientes();
+}
+
+///
+/// Ejecuta las interrupciones que llegaron mientras estaban deshabilitadas
+///
+static void ejecutarPendientes() {
+  for (int i = 0; i < NUM_INTERRUPCIONES; ++i) {
+    if (pendientes[i] && habilitadas && !enInterrupcion)
+      ejecutarInterrupcion(i);
+  }
+
+  if (rutinaTwi && cicloTwi <= ciclo && habilitadas && !enInterrupcion)
+    ejecutarTwi();
+}
+
+uint64_t halCiclos() {
+  return ciclo;
+}
+
+uint64_t halMicros() {
+  return ciclo / (F_CPU / 1000000UL);
+}
+
+void halAvanzar(uint64_t ciclos) {
+  ciclo += ciclos;
+
+  // Sacar los bytes que ya se transmitieron del buffer del serial
+  while (bytesTx > 0 && finByteTx <= ciclo) {
+    --bytesTx;
+    if (bytesTx > 0)
+      finByteTx += ciclosPorByte;
+  }
+
+  // Las interrupciones que genera el MPU pueden volver a avanzar el tiempo
+  if (!avanzando) {
+    avanzando = true;
+    mpuSimulado.avanzar(ciclo);
+    avanzando = false;
+  }
+
+  ejecutarPendientes();
+}
+
+void halCpu(uint32_t ciclos) {
+  contadores.ciclosCpu += ciclos;
+  halAvanzar(ciclos);
+}
+
+void halOcuparBus(uint64_t ciclos, uint32_t bytes) {
+  contadores.ciclosBus += ciclos;
+  contadores.bytesBus += bytes;
+  ++contadores.transaccionesBus;
+}
+
+void halProgramarTwi(void (*rutina)(), uint64_t cicloInterrupcion) {
+  rutinaTwi = rutina;
+  cicloTwi = cicloInterrupcion;
+}
+
+void halFlanco(uint8_t pin, bool subida) {
+  const int interrupcion = digitalPinToInterrupt(pin);
+  if (interrupcion < 0 || !rutinas[interrupcion])
+    return;
+
+  const int modo = modos[interrupcion];
+  if (modo != CHANGE && (modo == RISING) != subida)
+    return;
+
+  pendientes[interrupcion] = true;
+  ejecutarPendientes();
+}
+
+void halRecibir(const uint8_t* datos, size_t bytes) {
+  rx.insert(rx.end(), datos, datos + bytes);
+}
+
+void halCambiarSalida(HalSalida funcion) {
+  salida = funcion;
+}
+
+void halLimitarSerial(unsigned long baudios) {
+  limiteBaudios = baudios;
+}
+
+uint8_t* halEeprom() {
+  return eeprom.bytes;
+}
+
+int halPwm(uint8_t pin) {
+  return pin < 20 ? pwm[pin] : 0;
+}
+
+void halReiniciar() {
+  ciclo = 0;
+  avanzando = false;
+  memset(&contadores, 0, sizeof(contadores));
+
+  habilitadas = true;
+  enInterrupcion = false;
+  for (int i = 0; i < NUM_INTERRUPCIONES; ++i) {
+    rutinas[i] = 0;
+    modos[i] = 0;
+    pendientes[i] = false;
+  }
+
+  rutinaTwi = 0;
+  cicloTwi = 0;
+
+  memset(pwm, 0, sizeof(pwm));
+  memset(pines, 0, sizeof(pines));
+
+  ciclosPorByte = 0;
+  bytesTx = 0;
+  finByteTx = 0;
+  rx.clear();
+
+  mpuSimulado.reiniciar();
+}
+
+const HalContadores& halContadores() {
+  return contadores;
+}
+
+//
+// API de Arduino
+//
+
+uint32_t millis() {
+  halCpu(HAL_CICLOS_MILLIS);
+  return (uint32_t) (halMicros() / 1000);
+}
+
+uint32_t micros() {
+  halCpu(HAL_CICLOS_MILLIS);
+  return (uint32_t) halMicros();
+}
+
+void delay(uint32_t ms) {
+  halCpu(ms * (F_CPU / 1000UL));
+}
+
+void delayMicroseconds(uint32_t us) {
+  halCpu(us * (F_CPU / 1000000UL));
+}
+
+void pinMode(uint8_t pin, uint8_t modo) {
+  (void) pin;
+  (void) modo;
+  halCpu(HAL_CICLOS_PIN);
+}
+
+void digitalWrite(uint8_t pin, uint8_t valor) {
+  if (pin < 20)
+    pines[pin] = valor;
+
+  halCpu(HAL_CICLOS_PIN);
+}
+
+int digitalRead(uint8_t pin) {
+  halCpu(HAL_CICLOS_PIN);
+  return pin < 20 ? pines[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int valor) {
+  if (pin < 20)
+    pwm[pin] = valor < 0 ? 0 : (valor > 255 ? 255 : valor);
+
+  halCpu(HAL_CICLOS_PIN);
+}
+
+void interrupts() {
+  habilitadas = true;
+  ejecutarPendientes();
+}
+
+void noInterrupts() {
+  habilitadas = false;
+}
+
+void attachInterrupt(uint8_t interrupcion, void (*isr)(), int modo) {
+  if (interrupcion >= NUM_INTERRUPCIONES)
+    return;
+
+  rutinas[interrupcion] = isr;
+  modos[interrupcion] = modo;
+  pendientes[interrupcion] = false;
+}
+
+void detachInterrupt(uint8_t interrupcion) {
+  if (interrupcion < NUM_INTERRUPCIONES)
+    rutinas[interrupcion] = 0;
+}
+
+//
+// Serial
+//
+
+void HardwareSerial::begin(unsigned long baudios) {
+  if (limiteBaudios > 0 && baudios > limiteBaudios)
+    baudios = limiteBaudios;
+
+  // 1 bit de inicio, 8 de datos y 1 de parada
+  ciclosPorByte = (uint64_t) F_CPU * 10 / baudios;
+  bytesTx = 0;
+}
+
+void HardwareSerial::end() {
+  flush();
+  ciclosPorByte = 0;
+}
+
+int HardwareSerial::available() {
+  halCpu(HAL_CICLOS_SERIAL_LEER);
+  return (int) rx.size();
+}
+
+int HardwareSerial::availableForWrite() {
+  halCpu(HAL_CICLOS_SERIAL_LEER);
+  return HAL_BUFFER_SERIAL - bytesTx;
+}
+
+int HardwareSerial::peek() {
+  halCpu(HAL_CICLOS_SERIAL_LEER);
+  return rx.empty() ? -1 : rx.front();
+}
+
+int HardwareSerial::read() {
+  halCpu(HAL_CICLOS_SERIAL_LEER);
+  if (rx.empty())
+    return -1;
+
+  uint8_t byte = rx.front();
+  rx.pop_front();
+  ++contadores.bytesSerialRx;
+  return byte;
+}
+
+void HardwareSerial::flush() {
+  if (bytesTx > 0) {
+    const uint64_t espera = finByteTx - ciclo +
+                            (uint64_t) (bytesTx - 1) * ciclosPorByte;
+    contadores.ciclosSerial += espera;
+    halAvanzar(espera);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t byte) {
+  if (ciclosPorByte == 0)
+    return 0;
+
+  halCpu(HAL_CICLOS_SERIAL_BYTE);
+
+  // Esperar a que haya espacio en el buffer de transmision
+  if (bytesTx >= HAL_BUFFER_SERIAL) {
+    const uint64_t espera = finByteTx - ciclo;
+    contadores.ciclosSerial += espera;
+    halAvanzar(espera);
+  }
+
+  if (bytesTx == 0)
+    finByteTx = ciclo + ciclosPorByte;
+
+  ++bytesTx;
+  ++contadores.bytesSerialTx;
+
+  if (salida)
+    salida(&byte, 1);
+
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* datos, size_t bytes) {
+  size_t escritos = 0;
+  for (size_t i = 0; i < bytes; ++i)
+    escritos += write(datos[i]);
+
+  return escritos;
+}
+
+size_t HardwareSerial::write(const char* texto) {
+  return write((const uint8_t*) texto, strlen(texto));
+}
+
+size_t HardwareSerial::print(const char* texto) {
+  halCpu(HAL_CICLOS_SERIAL_IMPRIMIR);
+  return write(texto);
+}
+
+size_t HardwareSerial::print(char c) {
+  halCpu(HAL_CICLOS_SERIAL_IMPRIMIR);
+  return write((uint8_t) c);
+}
+
+size_t HardwareSerial::print(unsigned char valor, int base) {
+  return imprimirEntero(valor, false, base);
+}
+
+size_t HardwareSerial::print(int valor, int base) {
+  return print((long) valor, base);
+}
+
+size_t HardwareSerial::print(unsigned int valor, int base) {
+  return imprimirEntero(valor, false, base);
+}
+
+size_t HardwareSerial::print(long valor, int base) {
+  if (base == 10 && valor < 0)
+    return imprimirEntero(-(unsigned long) valor, true, base);
+
+  return imprimirEntero((unsigned long) valor, false, base);
+}
+
+size_t HardwareSerial::print(unsigned long valor, int base) {
+  return imprimirEntero(valor, false, base);
+}
+
+size_t HardwareSerial::print(double valor, int decimales) {
+  char texto[48];
+  snprintf(texto, sizeof(texto), "%.*f", decimales, valor);
+
+  // La parte entera se imprime como un entero, cada decimal requiere una
+  // multiplicacion y una conversion de punto flotante
+  halCpu(HAL_CICLOS_SERIAL_IMPRIMIR + decimales * HAL_CICLOS_FLOTANTE);
+  const char* punto = strchr(texto, '.');
+  const size_t enteros = punto ? (size_t) (punto - texto) : strlen(texto);
+  halCpu(enteros * HAL_CICLOS_DIGITO);
+
+  return write(texto);
+}
+
+size_t HardwareSerial::println() {
+  return print("\r\n");
+}
+
+size_t HardwareSerial::println(const char* texto) {
+  return print(texto) + println();
+}
+
+size_t HardwareSerial::println(int valor, int base) {
+  return print(valor, base) + println();
+}
+
+size_t HardwareSerial::println(long valor, int base) {
+  return print(valor, base) + println();
+}
+
+size_t HardwareSerial::println(double valor, int decimales) {
+  return print(valor, decimales) + println();
+}
+
+///
+/// Imprime el @a valor en la @a base especificada, con el costo de una
+/// division de 32 bits por digito
+///
+size_t HardwareSerial::imprimirEntero(unsigned long valor,
+                                      bool negativo,
+                                      int base) {
+  if (base < 2)
+    base = 10;
+
+  char texto[34];
+  char* c = texto + sizeof(texto) - 1;
+  *c = '\0';
+
+  do {
+    const unsigned long digito = valor % base;
+    *--c = (char) (digito < 10 ? '0' + digito : 'A' + digito - 10);
+    valor /= base;
+    halCpu(HAL_CICLOS_DIGITO);
+  } while (valor > 0);
+
+  if (negativo)
+    *--c = '-';
+
+  halCpu(HAL_CICLOS_SERIAL_IMPRIMIR);
+  return write(c);
+}
+
+//
+// EEPROM
+//
+
+uint8_t EEPROMClass::read(int direccion) {
+  halCpu(HAL_CICLOS_EEPROM_LEER);
+  if (direccion < 0 || direccion >= HAL_BYTES_EEPROM)
+    return 0xFF;
+
+  return eeprom.bytes[direccion];
+}
+
+void EEPROMClass::write(int direccion, uint8_t valor) {
+  halCpu(HAL_CICLOS_EEPROM_ESCRIBIR);
+  if (direccion >= 0 && direccion < HAL_BYTES_EEPROM)
+    eeprom.bytes[direccion] = valor;
+}
+
+void EEPROMClass::update(int direccion, uint8_t valor) {
+  if (read(direccion) != valor)
+    write(direccion, valor);
+}
+
+uint16_t EEPROMClass::length() {
+  return HAL_BYTES_EEPROM;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Capa de abstraccion de hardware para compilar el firmware en Linux.
+//
+// El tiempo es virtual y se mide en ciclos de CPU (F_CPU). Avanza con el
+// costo modelado de cada llamada a la API de Arduino y de cada interrupcion
+// y con el tiempo que el firmware espera a que haya espacio en el buffer de
+// transmision del serial. Las transacciones I2C ocupan el bus sin detener
+// al CPU, al terminar generan la interrupcion del TWI (ver TwiSimulado.cpp).
+// Con el tiempo avanza tambien el MPU 6050 simulado (ver MpuSimulado.h).
+//
+
+//
+// Costo aproximado (en ciclos) de las funciones de Arduino en un ATmega328P.
+// Imprimir un numero cuesta una division de 32 bits por digito, y los
+// numeros de punto flotante ademas una multiplicacion por decimal. Escribir
+// un byte de la EEPROM tarda 3.4 ms.
+//
+#define HAL_CICLOS_MILLIS          (30)
+#define HAL_CICLOS_PIN             (60)
+#define HAL_CICLOS_INTERRUPCION    (80)
+#define HAL_CICLOS_SERIAL_BYTE     (40)
+#define HAL_CICLOS_SERIAL_LEER     (30)
+#define HAL_CICLOS_SERIAL_IMPRIMIR (150)
+#define HAL_CICLOS_DIGITO          (650)
+#define HAL_CICLOS_FLOTANTE        (1000)
+#define HAL_CICLOS_TWI_BYTE        (60)
+#define HAL_CICLOS_TWI_TRANSACCION (120)
+#define HAL_CICLOS_LOOP            (40)
+#define HAL_CICLOS_EEPROM_LEER     (20)
+#define HAL_CICLOS_EEPROM_ESCRIBIR (54400)
+
+//
+// Tamano del buffer de transmision del HardwareSerial de AVR
+//
+#define HAL_BUFFER_SERIAL (64)
+
+//
+// Tamano de la EEPROM del ATmega328P
+//
+#define HAL_BYTES_EEPROM (1024)
+
+///
+/// Contadores acumulados desde halReiniciar()
+///
+struct HalContadores {
+  uint64_t ciclosCpu;           ///< Ciclos de CPU modelados
+  uint64_t ciclosBus;           ///< Ciclos con el bus I2C ocupado
+  uint64_t ciclosSerial;        ///< Ciclos esperando al buffer del serial
+  uint64_t bytesBus;            ///< Bytes en el bus I2C (con direcciones)
+  uint32_t transaccionesBus;    ///< Transacciones I2C
+  uint64_t bytesSerialTx;       ///< Bytes mandados por el serial
+  uint64_t bytesSerialRx;       ///< Bytes recibidos por el serial
+  uint32_t interrupciones;      ///< Interrupciones externas atendidas
+};
+
+///
+/// Recibe los bytes que el firmware manda por el serial
+///
+typedef void (*HalSalida)(const uint8_t* datos, size_t bytes);
+
+///
+/// Regresa el tiempo virtual en ciclos de CPU
+///
+uint64_t halCiclos();
+
+///
+/// Regresa el tiempo virtual en microsegundos
+///
+uint64_t halMicros();
+
+///
+/// Avanza el tiempo virtual el numero de @a ciclos especificado, haciendo
+/// avanzar al MPU simulado y al buffer de transmision del serial
+///
+void halAvanzar(uint64_t ciclos);
+
+///
+/// Igual que halAvanzar(), pero los ciclos se registran como ciclos de CPU
+///
+void halCpu(uint32_t ciclos);
+
+///
+/// Registra una transaccion I2C de @a bytes que ocupa el bus durante
+/// @a ciclos, el tiempo no avanza porque el CPU no espera al bus
+///
+void halOcuparBus(uint64_t ciclos, uint32_t bytes);
+
+///
+/// Programa la interrupcion del TWI para el @a ciclo especificado, se
+/// ejecuta igual que las interrupciones externas (se retrasa mientras las
+/// interrupciones esten deshabilitadas). Con @a rutina nula se cancela.
+///
+void halProgramarTwi(void (*rutina)(), uint64_t ciclo);
+
+///
+/// Genera un flanco en el @a pin especificado, ejecuta la interrupcion
+/// asignada al pin si las interrupciones estan habilitadas o la deja
+/// pendiente si no lo estan
+///
+void halFlanco(uint8_t pin, bool subida);
+
+///
+/// Agrega @a bytes al buffer de recepcion del serial
+///
+void halRecibir(const uint8_t* datos, size_t bytes);
+
+///
+/// Cambia la funcion que recibe los bytes que manda el firmware
+///
+void halCambiarSalida(HalSalida salida);
+
+///
+/// Limita la velocidad del serial a @a baudios aunque el firmware pida una
+/// mayor en Serial.begin(), con 0 se usa la que pida el firmware. No cambia
+/// con halReiniciar().
+///
+void halLimitarSerial(unsigned long baudios);
+
+///
+/// Regresa el contenido de la EEPROM (HAL_BYTES_EEPROM bytes, 0xFF si no se
+/// ha escrito), que no cambia con halReiniciar()
+///
+uint8_t* halEeprom();
+
+///
+/// Regresa el ultimo valor escrito con analogWrite() en el @a pin
+///
+int halPwm(uint8_t pin);
+
+///
+/// Reinicia el tiempo virtual, los contadores y el estado de los pines
+///
+void halReiniciar();
+
+///
+/// Regresa los contadores acumulados
+///
+const HalContadores& halContadores();
+
+#endif
@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "MpuSimulado.h"
+
+#include "Arduino.h"
+#include "Hal.h"
+#include "MPU6050.h"
+
+//
+// Instancia conectada al bus I2C y al pin 2 de la HAL
+//
+MpuSimulado mpuSimulado;
+
+//
+// Bits de los registros que modela el simulador
+//
+#define PWR_MGMT_1_RESET    (7)
+#define PWR_MGMT_1_SLEEP    (6)
+#define USER_CTRL_FIFO_EN   (6)
+#define USER_CTRL_FIFO_RST  (2)
+#define INT_PIN_CFG_LATCH   (5)
+#define INT_PIN_CFG_RD_CLR  (4)
+#define INT_FIFO_OFLOW      (4)
+#define INT_DATA_RDY        (0)
+#define FIFO_EN_TEMP        (7)
+#define FIFO_EN_XG          (6)
+#define FIFO_EN_YG          (5)
+#define FIFO_EN_ZG          (4)
+#define FIFO_EN_ACCEL       (3)
+
+static const double GRAVEDAD = 9.80665;
+static const double TEMPERATURA = 25;
+
+//
+// Offsets de fabrica del acelerometro, compensan el sesgo que tenia el
+// sensor al fabricarse
+//
+static const int16_t OFFSETS_FABRICA[3] = { -2480, 1136, 1554 };
+
+static inline bool bit(uint8_t valor, uint8_t pos) {
+  return (valor >> pos) & 1;
+}
+
+static inline int16_t saturar(double valor) {
+  if (valor > 32767)
+    return 32767;
+  if (valor < -32768)
+    return -32768;
+
+  return (int16_t) lround(valor);
+}
+
+void evaluarOscilacion(const Oscilacion& oscilacion,
+                       double t,
+                       double accel[3],
+                       double gyro[3]) {
+  // z(t) = A e^(-s t) cos(w t), la aceleracion medida es z'' + g
+  const double w = 2 * M_PI * oscilacion.frecuencia;
+  const double s = oscilacion.amortiguamiento * w;
+  const double e = oscilacion.amplitud * exp(-s * t);
+  const double c = cos(w * t);
+  const double d = sin(w * t);
+
+  accel[0] = 0;
+  accel[1] = 0;
+  accel[2] = e * ((s * s - w * w) * c + 2 * s * w * d) + GRAVEDAD;
+
+  gyro[0] = 0;
+  gyro[1] = 0;
+  gyro[2] = 0;
+}
+
+MpuSimulado::MpuSimulado() : m_generador(2019) {
+  m_oscilacion.frecuencia = 5;
+  m_oscilacion.amplitud = 0.02;
+  m_oscilacion.amortiguamiento = 0;
+  m_oscilacion.ruidoAccel = 0.05;
+  m_oscilacion.ruidoGiro = 0.1;
+  m_oscilacion.sesgoAccel[0] = 0.25;
+  m_oscilacion.sesgoAccel[1] = -0.15;
+  m_oscilacion.sesgoAccel[2] = 0.4;
+  m_oscilacion.sesgoGiro[0] = 1.2;
+  m_oscilacion.sesgoGiro[1] = -0.8;
+  m_oscilacion.sesgoGiro[2] = 0.5;
+
+  reiniciar();
+}
+
+///
+/// Regresa los registros a sus valores de encendido
+///
+void MpuSimulado::reiniciar() {
+  memset(m_registros, 0, sizeof(m_registros));
+  m_registros[MPU6050_REG_PWR_MGMT_1] = 1 << PWR_MGMT_1_SLEEP;
+  m_registros[MPU6050_REG_WHO_AM_I] = MPU6050_ADDRESS;
+  for (int i = 0; i < 3; ++i) {
+    m_registros[MPU6050_REG_ACCEL_XOFFS_H + 2 * i] = OFFSETS_FABRICA[i] >> 8;
+    m_registros[MPU6050_REG_ACCEL_XOFFS_L + 2 * i] = OFFSETS_FABRICA[i] & 0xFF;
+  }
+
+  m_puntero = 0;
+  m_inicioFifo = 0;
+  m_bytesFifo = 0;
+  m_bytesFifoLeidos = 0;
+  m_lineaInt = false;
+  m_ciclo = 0;
+  m_siguienteMuestra = 0;
+  m_muestras = 0;
+  m_desbordes = 0;
+}
+
+///
+/// Cambia el movimiento que mide el sensor
+///
+void MpuSimulado::cambiarOscilacion(const Oscilacion& oscilacion) {
+  m_oscilacion = oscilacion;
+}
+
+///
+/// Regresa la direccion I2C del sensor
+///
+uint8_t MpuSimulado::direccion() const {
+  return MPU6050_ADDRESS;
+}
+
+///
+/// Regresa la frecuencia de muestreo configurada (Hz)
+///
+double MpuSimulado::frecuenciaMuestreo() const {
+  return (double) F_CPU / periodo();
+}
+
+///
+/// Genera todas las muestras que el sensor tomaria hasta el @a ciclo
+/// especificado
+///
+void MpuSimulado::avanzar(uint64_t ciclo) {
+  m_ciclo = ciclo;
+  if (bit(m_registros[MPU6050_REG_PWR_MGMT_1], PWR_MGMT_1_SLEEP)) {
+    m_siguienteMuestra = ciclo + periodo();
+    return;
+  }
+
+  while (m_siguienteMuestra <= ciclo) {
+    muestrear((double) m_siguienteMuestra / F_CPU);
+    m_siguienteMuestra += periodo();
+  }
+}
+
+///
+/// Procesa una escritura I2C: el primer byte es el registro, los demas se
+/// escriben a partir de ese registro
+///
+void MpuSimulado::escribir(const uint8_t* datos, uint8_t bytes) {
+  if (bytes == 0)
+    return;
+
+  m_puntero = datos[0] & 0x7F;
+  for (uint8_t i = 1; i < bytes; ++i) {
+    escribirRegistro(m_puntero, datos[i]);
+    if (m_puntero != MPU6050_REG_FIFO_R_W)
+      m_puntero = (m_puntero + 1) & 0x7F;
+  }
+}
+
+///
+/// Procesa una lectura I2C de @a bytes a partir del registro actual
+///
+uint8_t MpuSimulado::leer(uint8_t* datos, uint8_t bytes) {
+  for (uint8_t i = 0; i < bytes; ++i) {
+    datos[i] = leerRegistro(m_puntero);
+    if (m_puntero != MPU6050_REG_FIFO_R_W)
+      m_puntero = (m_puntero + 1) & 0x7F;
+  }
+
+  // Limpiar la interrupcion si se configuro para limpiarse con cualquier
+  // lectura
+  if (bit(m_registros[MPU6050_REG_INT_PIN_CFG], INT_PIN_CFG_RD_CLR)) {
+    m_registros[MPU6050_REG_INT_STATUS] = 0;
+    m_lineaInt = false;
+  }
+
+  return bytes;
+}
+
+///
+/// Regresa el numero de muestras tomadas por el sensor
+///
+uint32_t MpuSimulado::muestras() const {
+  return m_muestras;
+}
+
+///
+/// Regresa el numero de muestras completas que el firmware leyo del FIFO
+///
+uint32_t MpuSimulado::muestrasLeidas() const {
+  const uint8_t bytes = bytesPorMuestraFifo();
+  return bytes > 0 ? m_bytesFifoLeidos / bytes : 0;
+}
+
+///
+/// Regresa el numero de muestras que no cupieron completas en el FIFO
+///
+uint32_t MpuSimulado::desbordes() const {
+  return m_desbordes;
+}
+
+///
+/// Actualiza los registros de datos con el movimiento en el tiempo @a t,
+/// guarda la muestra en el FIFO y genera la interrupcion de datos listos
+///
+void MpuSimulado::muestrear(double t) {
+  double accel[3];
+  double gyro[3];
+  evaluarOscilacion(m_oscilacion, t, accel, gyro);
+
+  // Escalas configuradas en ACCEL_CONFIG y GYRO_CONFIG
+  const uint8_t rango = (m_registros[MPU6050_REG_ACCEL_CONFIG] >> 3) & 0x03;
+  const uint8_t escala = (m_registros[MPU6050_REG_GYRO_CONFIG] >> 3) & 0x03;
+  const double lsbAccel = (16384 >> rango) / GRAVEDAD;
+  const double lsbGiro = 131.0 / (1 << escala);
+
+  // Los offsets del acelerometro se suman relativos a los de fabrica en
+  // unidades de +-16 g, los del giroscopio en unidades de +-1000 grados/s
+  int16_t valores[7];
+  for (int i = 0; i < 3; ++i) {
+    const int16_t offsetAccel = leerRegistro16(MPU6050_REG_ACCEL_XOFFS_H + 2 * i);
+    const int16_t offsetGiro = leerRegistro16(MPU6050_REG_GYRO_XOFFS_H + 2 * i);
+
+    double a = accel[i] + m_oscilacion.sesgoAccel[i] +
+               m_oscilacion.ruidoAccel * m_normal(m_generador);
+    double g = gyro[i] + m_oscilacion.sesgoGiro[i] +
+               m_oscilacion.ruidoGiro * m_normal(m_generador);
+    a += (offsetAccel - OFFSETS_FABRICA[i]) * GRAVEDAD / 2048;
+    g += offsetGiro / 32.8;
+    valores[i] = saturar(a * lsbAccel);
+    valores[i + 4] = saturar(g * lsbGiro);
+  }
+
+  valores[3] = saturar((TEMPERATURA - 36.53) * 340);
+
+  // Registros de datos (big-endian)
+  uint8_t datos[14];
+  for (int i = 0; i < 7; ++i) {
+    datos[i * 2] = (uint8_t) (valores[i] >> 8);
+    datos[i * 2 + 1] = (uint8_t) valores[i];
+  }
+
+  memcpy(m_registros + MPU6050_REG_ACCEL_XOUT_H, datos, sizeof(datos));
+  ++m_muestras;
+
+  // Guardar en el FIFO los registros habilitados en FIFO_EN
+  if (bit(m_registros[MPU6050_REG_USER_CTRL], USER_CTRL_FIFO_EN)) {
+    const uint8_t fifoEn = m_registros[MPU6050_REG_FIFO_EN];
+    if (bit(fifoEn, FIFO_EN_ACCEL))
+      agregarFifo(datos, 6);
+    if (bit(fifoEn, FIFO_EN_TEMP))
+      agregarFifo(datos + 6, 2);
+    if (bit(fifoEn, FIFO_EN_XG))
+      agregarFifo(datos + 8, 2);
+    if (bit(fifoEn, FIFO_EN_YG))
+      agregarFifo(datos + 10, 2);
+    if (bit(fifoEn, FIFO_EN_ZG))
+      agregarFifo(datos + 12, 2);
+  }
+
+  // Generar la interrupcion de datos listos, si la interrupcion se queda
+  // activa hasta que se limpia no se genera un nuevo flanco
+  m_registros[MPU6050_REG_INT_STATUS] |= 1 << INT_DATA_RDY;
+  const uint8_t habilitadas = m_registros[MPU6050_REG_INT_ENABLE];
+  if (m_registros[MPU6050_REG_INT_STATUS] & habilitadas) {
+    const bool latch = bit(m_registros[MPU6050_REG_INT_PIN_CFG],
+                           INT_PIN_CFG_LATCH);
+    if (!latch || !m_lineaInt)
+      halFlanco(2, true);
+
+    m_lineaInt = latch;
+  }
+}
+
+///
+/// Escribe el @a valor en el @a registro, aplicando los efectos de los
+/// bits de reinicio
+///
+void MpuSimulado::escribirRegistro(uint8_t registro, uint8_t valor) {
+  switch (registro) {
+    case MPU6050_REG_PWR_MGMT_1:
+      if (bit(valor, PWR_MGMT_1_RESET)) {
+        reiniciar();
+        return;
+      }
+
+      // Al despertar, la primera muestra se toma un periodo despues
+      if (bit(m_registros[registro], PWR_MGMT_1_SLEEP) &&
+          !bit(valor, PWR_MGMT_1_SLEEP))
+        m_siguienteMuestra = m_ciclo + periodo();
+      break;
+
+    case MPU6050_REG_USER_CTRL:
+      if (bit(valor, USER_CTRL_FIFO_RST)) {
+        m_inicioFifo = 0;
+        m_bytesFifo = 0;
+        valor &= ~(1 << USER_CTRL_FIFO_RST);
+      }
+      break;
+
+    case MPU6050_REG_INT_STATUS:
+    case MPU6050_REG_WHO_AM_I:
+    case MPU6050_REG_FIFO_COUNT_H:
+    case MPU6050_REG_FIFO_COUNT_L:
+    case MPU6050_REG_FIFO_R_W:
+      return;
+
+    default:
+      if (registro >= MPU6050_REG_ACCEL_XOUT_H &&
+          registro <= MPU6050_REG_GYRO_ZOUT_L)
+        return;
+      break;
+  }
+
+  m_registros[registro] = valor;
+}
+
+///
+/// Lee el @a registro, el FIFO se vacia con cada lectura de FIFO_R_W y
+/// INT_STATUS se limpia al leerlo
+///
+uint8_t MpuSimulado::leerRegistro(uint8_t registro) {
+  uint8_t valor = m_registros[registro];
+
+  switch (registro) {
+    case MPU6050_REG_FIFO_COUNT_H:
+      valor = (uint8_t) (m_bytesFifo >> 8);
+      break;
+
+    case MPU6050_REG_FIFO_COUNT_L:
+      valor = (uint8_t) m_bytesFifo;
+      break;
+
+    case MPU6050_REG_FIFO_R_W:
+      if (m_bytesFifo > 0) {
+        valor = m_fifo[m_inicioFifo];
+        m_inicioFifo = (m_inicioFifo + 1) % sizeof(m_fifo);
+        --m_bytesFifo;
+        ++m_bytesFifoLeidos;
+      }
+      break;
+
+    case MPU6050_REG_INT_STATUS:
+      m_registros[registro] = 0;
+      m_lineaInt = false;
+      break;
+
+    default:
+      break;
+  }
+
+  return valor;
+}
+
+///
+/// Agrega @a bytes al FIFO, si esta lleno se descartan los bytes mas
+/// viejos y se marca la interrupcion de desborde
+///
+void MpuSimulado::agregarFifo(const uint8_t* datos, uint8_t bytes) {
+  if (m_bytesFifo + bytes > sizeof(m_fifo)) {
+    m_registros[MPU6050_REG_INT_STATUS] |= 1 << INT_FIFO_OFLOW;
+    ++m_desbordes;
+  }
+
+  for (uint8_t i = 0; i < bytes; ++i) {
+    if (m_bytesFifo == sizeof(m_fifo)) {
+      m_inicioFifo = (m_inicioFifo + 1) % sizeof(m_fifo);
+      --m_bytesFifo;
+    }
+
+    m_fifo[(m_inicioFifo + m_bytesFifo) % sizeof(m_fifo)] = datos[i];
+    ++m_bytesFifo;
+  }
+}
+
+///
+/// Regresa el numero de bytes que se guardan en el FIFO por muestra
+///
+uint8_t MpuSimulado::bytesPorMuestraFifo() const {
+  const uint8_t fifoEn = m_registros[MPU6050_REG_FIFO_EN];
+  uint8_t bytes = bit(fifoEn, FIFO_EN_ACCEL) ? 6 : 0;
+  bytes += bit(fifoEn, FIFO_EN_TEMP) ? 2 : 0;
+  bytes += bit(fifoEn, FIFO_EN_XG) ? 2 : 0;
+  bytes += bit(fifoEn, FIFO_EN_YG) ? 2 : 0;
+  bytes += bit(fifoEn, FIFO_EN_ZG) ? 2 : 0;
+  return bytes;
+}
+
+///
+/// Regresa el periodo de muestreo en ciclos: la frecuencia de salida del
+/// giroscopio es 8 kHz con el DLPF deshabilitado y 1 kHz si esta habilitado
+///
+uint64_t MpuSimulado::periodo() const {
+  const uint8_t dlpf = m_registros[MPU6050_REG_CONFIG] & 0x07;
+  const uint32_t base = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+  return (uint64_t) F_CPU * (1 + m_registros[MPU6050_REG_SMPLRT_DIV]) / base;
+}
+
+///
+/// Regresa el valor de 16 bits (big-endian) a partir del @a registro
+///
+int16_t MpuSimulado::leerRegistro16(uint8_t registro) const {
+  return (int16_t) ((m_registros[registro] << 8) | m_registros[registro + 1]);
+}
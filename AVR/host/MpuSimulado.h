@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MPU_SIMULADO_H
+#define MPU_SIMULADO_H
+
+#include <stdint.h>
+#include <random>
+
+///
+/// Movimiento del sensor: oscilacion vertical amortiguada mas ruido blanco
+/// y el sesgo que los offsets de fabrica no corrigen
+///
+struct Oscilacion {
+  double frecuencia;        ///< Frecuencia de oscilacion (Hz)
+  double amplitud;          ///< Amplitud inicial (m)
+  double amortiguamiento;   ///< Factor de amortiguamiento (0 = constante)
+  double ruidoAccel;        ///< Desviacion estandar del ruido (m/s^2)
+  double ruidoGiro;         ///< Desviacion estandar del ruido (grados/s)
+  double sesgoAccel[3];     ///< Sesgo del acelerometro (m/s^2)
+  double sesgoGiro[3];      ///< Sesgo del giroscopio (grados/s)
+};
+
+///
+/// Calcula la aceleracion medida (m/s^2, incluye la gravedad) y la
+/// velocidad angular (grados/s) sin ruido en el tiempo @a t (s)
+///
+void evaluarOscilacion(const Oscilacion& oscilacion,
+                       double t,
+                       double accel[3],
+                       double gyro[3]);
+
+///
+/// Modelo del mapa de registros del MPU 6050: WHO_AM_I, registros de
+/// configuracion, registros de offset, registros de datos, FIFO e
+/// interrupcion de datos listos. Los registros de datos se actualizan a la
+/// frecuencia de muestreo que indican CONFIG y SMPLRT_DIV con los valores
+/// de una Oscilacion.
+///
+class MpuSimulado {
+public:
+  MpuSimulado();
+
+  void reiniciar();
+  void cambiarOscilacion(const Oscilacion& oscilacion);
+
+  uint8_t direccion() const;
+  double frecuenciaMuestreo() const;
+
+  void avanzar(uint64_t ciclo);
+  void escribir(const uint8_t* datos, uint8_t bytes);
+  uint8_t leer(uint8_t* datos, uint8_t bytes);
+
+  uint32_t muestras() const;
+  uint32_t muestrasLeidas() const;
+  uint32_t desbordes() const;
+
+private:
+  void muestrear(double t);
+  void escribirRegistro(uint8_t registro, uint8_t valor);
+  uint8_t leerRegistro(uint8_t registro);
+  int16_t leerRegistro16(uint8_t registro) const;
+  void agregarFifo(const uint8_t* datos, uint8_t bytes);
+  uint8_t bytesPorMuestraFifo() const;
+  uint64_t periodo() const;
+
+private:
+  Oscilacion m_oscilacion;
+  std::mt19937 m_generador;
+  std::normal_distribution<double> m_normal;
+
+  uint8_t m_puntero;
+  uint8_t m_registros[128];
+
+  uint16_t m_inicioFifo;
+  uint16_t m_bytesFifo;
+  uint8_t m_fifo[1024];
+  uint32_t m_bytesFifoLeidos;
+
+  bool m_lineaInt;
+  uint64_t m_ciclo;
+  uint64_t m_siguienteMuestra;
+  uint32_t m_muestras;
+  uint32_t m_desbordes;
+};
+
+extern MpuSimulado mpuSimulado;
+
+#endif
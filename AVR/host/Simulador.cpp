@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//
+// Simulador del GMAS: abre una terminal virtual (pty) y manda telemetria de
+// una oscilacion amortiguada en el formato de texto {ax,ay,az,gx,gy,gz}; o
+// en tramas binarias (ver Protocolo.h), a la frecuencia de muestreo y la
+// velocidad de linea especificadas. Las muestras pasan por la misma etapa
+// de filtrado y decimacion que el firmware (ver Filtro.h), por lo que se
+// manda una trama de telemetria o de resumen por cada ventana. Acepta los
+// comandos de velocidad de texto y los binarios (velocidad, calibracion y
+// modo de telemetria) y los confirma igual que el firmware, de modo que el
+// software de control se puede conectar a la terminal virtual para medir
+// su rendimiento y latencia sin hardware.
+//
+
+#include "Filtro.h"
+#include "Protocolo.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <random>
+#include <vector>
+
+//
+// Configuracion del MPU que se reporta en las tramas binarias (16 g y
+// 2000 grados/s, igual que el firmware)
+//
+#define RANGO_ACCEL   (3)
+#define ESCALA_GIRO   (3)
+#define LSB_ACCEL     (2048 / 9.80665)
+#define LSB_GIRO      (131.0 / 8)
+
+//
+// Tiempo sin comandos (ms) despues del cual se apaga el motor
+//
+#define WATCHDOG_COMANDOS 1000
+
+//
+// Maximo de bytes pendientes por escribir en la terminal (cuando nadie
+// lee la terminal se descartan las muestras nuevas)
+//
+#define MAX_PENDIENTES (64 * 1024)
+
+static const double GRAVEDAD = 9.80665;
+
+///
+/// Opciones del simulador
+///
+struct Opciones {
+  bool binario;
+  double muestreo;          ///< Muestras por segundo
+  long baudios;             ///< Velocidad de la linea
+  double frecuencia;        ///< Frecuencia de oscilacion (Hz)
+  double amplitud;          ///< Amplitud (m)
+  double amortiguamiento;   ///< Factor de amortiguamiento
+  double golpe;             ///< Periodo con el que se excita el sistema (s)
+  double ruido;             ///< Ruido del acelerometro (m/s^2)
+  double perdidas;          ///< Probabilidad de perder cada byte
+  double corrupcion;        ///< Probabilidad de corromper cada muestra
+  const char* enlace;       ///< Enlace simbolico a la terminal
+};
+
+///
+/// Contadores que se reportan cada segundo
+///
+struct Estadisticas {
+  unsigned long muestras;
+  unsigned long tramas;
+  unsigned long bytes;
+  unsigned long saturadas;
+  unsigned long corruptas;
+  unsigned long bytesPerdidos;
+  unsigned long comandos;
+};
+
+static volatile sig_atomic_t terminar = 0;
+
+static void onSenal(int) {
+  terminar = 1;
+}
+
+///
+/// Regresa el tiempo monotonico en segundos
+///
+static double ahora() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static inline int16_t saturar(double valor) {
+  if (valor > 32767)
+    return 32767;
+  if (valor < -32768)
+    return -32768;
+
+  return (int16_t) lround(valor);
+}
+
+///
+/// Oscilacion vertical cuya amplitud sigue al motor: con el motor
+/// encendido la amplitud tiende a amplitud * velocidad / 100, con el motor
+/// apagado la oscilacion se amortigua. Si no hay amortiguamiento y nunca
+/// se ha recibido un comando la amplitud es constante.
+///
+class Oscilador {
+public:
+  Oscilador(const Opciones& opciones)
+    : m_opciones(opciones)
+    , m_fase(0)
+    , m_envolvente(opciones.amplitud)
+    , m_tiempoGolpe(0)
+    , m_generador(2019) {}
+
+  void avanzar(double dt, double velocidad, bool motor, double accel[3],
+               double gyro[3]) {
+    const double w = 2 * M_PI * m_opciones.frecuencia;
+    const double s = m_opciones.amortiguamiento * w;
+
+    // Amplitud hacia la que tiende la oscilacion
+    double objetivo = s > 0 ? 0 : m_opciones.amplitud;
+    if (motor)
+      objetivo = m_opciones.amplitud * velocidad / 100;
+
+    // Volver a excitar el sistema periodicamente
+    m_tiempoGolpe += dt;
+    if (!motor && m_opciones.golpe > 0 && m_tiempoGolpe >= m_opciones.golpe) {
+      m_tiempoGolpe = 0;
+      m_envolvente = m_opciones.amplitud;
+    }
+
+    // La envolvente sigue al objetivo con la constante de tiempo del
+    // amortiguamiento (o 0.5 s sin amortiguamiento)
+    const double tasa = s > 0 ? s : 2;
+    const double derivada = tasa * (objetivo - m_envolvente);
+    m_envolvente += derivada * dt;
+    m_fase = fmod(m_fase + w * dt, 2 * M_PI);
+
+    // z = E cos(fase), z'' = -w^2 E cos(fase) - 2 w E' sin(fase)
+    const double z = -w * w * m_envolvente * cos(m_fase) -
+                     2 * w * derivada * sin(m_fase);
+
+    accel[0] = ruido();
+    accel[1] = ruido();
+    accel[2] = z + GRAVEDAD + ruido();
+
+    gyro[0] = 0.1 * m_normal(m_generador);
+    gyro[1] = 0.1 * m_normal(m_generador);
+    gyro[2] = 0.1 * m_normal(m_generador);
+  }
+
+  std::mt19937& generador() {
+    return m_generador;
+  }
+
+private:
+  double ruido() {
+    return m_opciones.ruido * m_normal(m_generador);
+  }
+
+private:
+  const Opciones& m_opciones;
+  double m_fase;
+  double m_envolvente;
+  double m_tiempoGolpe;
+  std::mt19937 m_generador;
+  std::normal_distribution<double> m_normal;
+};
+
+///
+/// Lee los comandos del software de control con el mismo formato que
+/// acepta el firmware y genera las confirmaciones de los binarios
+///
+class Comandos {
+public:
+  Comandos() : m_velocidad(0), m_ultimoComando(-1), m_bytesComando(0),
+    m_bytesTexto(0) {}
+
+  void leer(const uint8_t* datos, size_t bytes, double tiempo,
+            std::vector<uint8_t>& respuesta, Estadisticas& estadisticas) {
+    for (size_t i = 0; i < bytes; ++i) {
+      const uint8_t c = datos[i];
+
+      // Comandos binarios
+      if (m_bytesComando > 0 || c == PROTOCOLO_SYNC_0) {
+        if (agregar(c)) {
+          ejecutar(respuesta);
+          m_ultimoComando = tiempo;
+          ++estadisticas.comandos;
+        }
+
+        continue;
+      }
+
+      // Comandos de texto "velocidad;"
+      if (c == ';') {
+        m_texto[m_bytesTexto] = '\0';
+        m_velocidad = strtod(m_texto, NULL);
+        m_bytesTexto = 0;
+        m_ultimoComando = tiempo;
+        ++estadisticas.comandos;
+      }
+
+      else if (m_bytesTexto < sizeof(m_texto) - 1)
+        m_texto[m_bytesTexto++] = (char) c;
+
+      else
+        m_bytesTexto = 0;
+    }
+  }
+
+  bool motor(double tiempo) const {
+    return m_ultimoComando >= 0 &&
+           (tiempo - m_ultimoComando) * 1000 <= WATCHDOG_COMANDOS;
+  }
+
+  double velocidad(double tiempo) const {
+    return motor(tiempo) ? m_velocidad : 0;
+  }
+
+private:
+  ///
+  /// Agrega @a c al comando binario actual, regresa true si se completo un
+  /// comando valido
+  ///
+  bool agregar(uint8_t c) {
+    m_comando[m_bytesComando++] = c;
+
+    if ((m_bytesComando == 2 && c != PROTOCOLO_SYNC_1) ||
+        (m_bytesComando == 3 && c != PROTOCOLO_VERSION) ||
+        (m_bytesComando == 5 && c > PROTOCOLO_MAX_DATOS_COMANDO)) {
+      m_bytesComando = 0;
+      return false;
+    }
+
+    if (m_bytesComando < PROTOCOLO_ENCABEZADO ||
+        m_bytesComando < PROTOCOLO_ENCABEZADO + m_comando[4] + PROTOCOLO_CRC)
+      return false;
+
+    m_bytesComando = 0;
+    return protocoloValidar(m_comando);
+  }
+
+  void ejecutar(std::vector<uint8_t>& respuesta) {
+    const uint8_t tipo = m_comando[3];
+    const uint8_t longitud = m_comando[4];
+    const uint8_t* datos = m_comando + PROTOCOLO_ENCABEZADO;
+
+    uint8_t estado = PROTOCOLO_ACK_OK;
+    if (tipo == PROTOCOLO_TIPO_VELOCIDAD) {
+      if (longitud == PROTOCOLO_DATOS_VELOCIDAD)
+        m_velocidad = datos[0] ? protocoloLeer16(datos + 1) * 0.01 : 0;
+      else
+        estado = PROTOCOLO_ACK_INVALIDO;
+    }
+
+    // El sensor simulado no tiene sesgo, calibrar solo detiene el motor y
+    // reinicia el filtro
+    else if (tipo == PROTOCOLO_TIPO_CALIBRAR) {
+      if (longitud == PROTOCOLO_DATOS_CALIBRAR) {
+        m_velocidad = 0;
+        filtroReiniciar();
+      } else
+        estado = PROTOCOLO_ACK_INVALIDO;
+    }
+
+    else if (tipo == PROTOCOLO_TIPO_MODO) {
+      if (longitud != PROTOCOLO_DATOS_MODO ||
+          !filtroConfigurar(datos[0], datos[1]))
+        estado = PROTOCOLO_ACK_INVALIDO;
+    }
+
+    else if (tipo != PROTOCOLO_TIPO_KEEPALIVE)
+      estado = PROTOCOLO_ACK_DESCONOCIDO;
+
+    uint8_t ack[PROTOCOLO_TRAMA_ACK];
+    uint8_t bytes = protocoloAck(ack, protocoloLeer16(m_comando + 5), tipo,
+                                 estado);
+    respuesta.insert(respuesta.end(), ack, ack + bytes);
+  }
+
+private:
+  double m_velocidad;
+  double m_ultimoComando;
+
+  uint8_t m_bytesComando;
+  uint8_t m_comando[PROTOCOLO_ENCABEZADO + PROTOCOLO_MAX_DATOS_COMANDO +
+                    PROTOCOLO_CRC];
+
+  size_t m_bytesTexto;
+  char m_texto[255];
+};
+
+///
+/// Genera la trama de la ventana en el formato seleccionado: la @a salida
+/// del filtro (lecturas crudas) o su @a resumen en el modo resumen
+///
+static void codificar(const Opciones& opciones, uint16_t secuencia,
+                      uint32_t tiempo, const int16_t salida[FILTRO_EJES],
+                      const FiltroResumen& resumen,
+                      std::vector<uint8_t>& trama) {
+  const uint8_t config = RANGO_ACCEL | (ESCALA_GIRO << 2);
+
+  if (opciones.binario) {
+    trama.resize(PROTOCOLO_TRAMA_RESUMEN);
+    if (filtroModo() == FILTRO_RESUMEN)
+      trama.resize(protocoloResumen(trama.data(), secuencia, tiempo, config,
+                                    filtroDecimacion(), resumen.minimo,
+                                    resumen.maximo, resumen.media,
+                                    resumen.rms));
+    else
+      trama.resize(protocoloTelemetria(trama.data(), secuencia, tiempo,
+                                       config, salida, salida + 3));
+  }
+
+  // El formato de texto no tiene resumen, se manda la media de la ventana
+  else {
+    const int16_t* valores = (filtroModo() == FILTRO_RESUMEN) ? resumen.media :
+                                                                salida;
+    char texto[128];
+    int bytes = snprintf(texto, sizeof(texto),
+                         "{%.3f,%.3f,%.3f,%.2f,%.2f,%.2f};",
+                         valores[0] / LSB_ACCEL, valores[1] / LSB_ACCEL,
+                         valores[2] / LSB_ACCEL, valores[3] / LSB_GIRO,
+                         valores[4] / LSB_GIRO, valores[5] / LSB_GIRO);
+    trama.assign(texto, texto + bytes);
+  }
+}
+
+///
+/// Abre la terminal virtual en modo crudo, regresa el descriptor del lado
+/// maestro y deja abierto el lado esclavo en @a esclavo para que las
+/// lecturas no fallen mientras no haya ningun programa conectado
+///
+static int abrirTerminal(int* esclavo, const char** nombre) {
+  int maestro = posix_openpt(O_RDWR | O_NOCTTY);
+  if (maestro < 0 || grantpt(maestro) < 0 || unlockpt(maestro) < 0)
+    return -1;
+
+  *nombre = ptsname(maestro);
+  *esclavo = open(*nombre, O_RDWR | O_NOCTTY);
+  if (*esclavo < 0)
+    return -1;
+
+  termios config;
+  tcgetattr(*esclavo, &config);
+  cfmakeraw(&config);
+  tcsetattr(*esclavo, TCSANOW, &config);
+
+  fcntl(maestro, F_SETFL, fcntl(maestro, F_GETFL) | O_NONBLOCK);
+  return maestro;
+}
+
+///
+/// Muestra las opciones del programa
+///
+static void mostrarAyuda(const char* programa) {
+  printf("Uso: %s [opciones]\n\n"
+         "  -m, --muestreo HZ        muestras del sensor por segundo, antes "
+         "de decimar (1000)\n"
+         "  -b, --baudios BAUD       velocidad de la linea (1000000)\n"
+         "  -x, --texto              usar el formato de texto\n"
+         "  -f, --frecuencia HZ      frecuencia de oscilacion (5)\n"
+         "  -a, --amplitud MM        amplitud de oscilacion (20)\n"
+         "  -z, --amortiguamiento Z  factor de amortiguamiento (0)\n"
+         "  -g, --golpe S            excitar el sistema cada S segundos (0)\n"
+         "  -r, --ruido MS2          ruido del acelerometro (0.05)\n"
+         "  -p, --perdidas P         probabilidad de perder cada byte (0)\n"
+         "  -c, --corrupcion P       probabilidad de corromper cada "
+         "muestra (0)\n"
+         "  -l, --enlace RUTA        crear un enlace simbolico a la "
+         "terminal\n"
+         "  -h, --help               mostrar esta ayuda\n",
+         programa);
+}
+
+int main(int argc, char** argv) {
+  Opciones opciones;
+  opciones.binario = true;
+  opciones.muestreo = 1000;
+  opciones.baudios = 1000000;
+  opciones.frecuencia = 5;
+  opciones.amplitud = 0.02;
+  opciones.amortiguamiento = 0;
+  opciones.golpe = 0;
+  opciones.ruido = 0.05;
+  opciones.perdidas = 0;
+  opciones.corrupcion = 0;
+  opciones.enlace = 0;
+
+  static const option lista[] = {
+    { "muestreo", required_argument, 0, 'm' },
+    { "baudios", required_argument, 0, 'b' },
+    { "texto", no_argument, 0, 'x' },
+    { "frecuencia", required_argument, 0, 'f' },
+    { "amplitud", required_argument, 0, 'a' },
+    { "amortiguamiento", required_argument, 0, 'z' },
+    { "golpe", required_argument, 0, 'g' },
+    { "ruido", required_argument, 0, 'r' },
+    { "perdidas", required_argument, 0, 'p' },
+    { "corrupcion", required_argument, 0, 'c' },
+    { "enlace", required_argument, 0, 'l' },
+    { "help", no_argument, 0, 'h' },
+    { 0, 0, 0, 0 }
+  };
+
+  int opcion;
+  while ((opcion = getopt_long(argc, argv, "m:b:xf:a:z:g:r:p:c:l:h",
+                               lista, 0)) != -1) {
+    switch (opcion) {
+      case 'm': opciones.muestreo = atof(optarg); break;
+      case 'b': opciones.baudios = atol(optarg); break;
+      case 'x': opciones.binario = false; break;
+      case 'f': opciones.frecuencia = atof(optarg); break;
+      case 'a': opciones.amplitud = atof(optarg) / 1000; break;
+      case 'z': opciones.amortiguamiento = atof(optarg); break;
+      case 'g': opciones.golpe = atof(optarg); break;
+      case 'r': opciones.ruido = atof(optarg); break;
+      case 'p': opciones.perdidas = atof(optarg); break;
+      case 'c': opciones.corrupcion = atof(optarg); break;
+      case 'l': opciones.enlace = optarg; break;
+      case 'h': mostrarAyuda(argv[0]); return EXIT_SUCCESS;
+      default: mostrarAyuda(argv[0]); return EXIT_FAILURE;
+    }
+  }
+
+  if (opciones.muestreo <= 0 || opciones.baudios <= 0) {
+    mostrarAyuda(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Abrir la terminal virtual
+  int esclavo = -1;
+  const char* nombre = 0;
+  const int maestro = abrirTerminal(&esclavo, &nombre);
+  if (maestro < 0) {
+    perror("pty");
+    return EXIT_FAILURE;
+  }
+
+  if (opciones.enlace) {
+    unlink(opciones.enlace);
+    if (symlink(nombre, opciones.enlace) < 0) {
+      perror(opciones.enlace);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("Terminal virtual: %s\n", opciones.enlace ? opciones.enlace : nombre);
+  printf("Conectar con: GMAS_DISPOSITIVOS=%s\n",
+         opciones.enlace ? opciones.enlace : nombre);
+  fflush(stdout);
+
+  signal(SIGINT, onSenal);
+  signal(SIGTERM, onSenal);
+
+  Oscilador oscilador(opciones);
+  Comandos comandos;
+  Estadisticas estadisticas;
+  memset(&estadisticas, 0, sizeof(estadisticas));
+
+  std::uniform_real_distribution<double> uniforme(0, 1);
+  std::mt19937& generador = oscilador.generador();
+
+  std::vector<uint8_t> trama;
+  std::vector<uint8_t> pendientes;
+  uint16_t secuencia = 0;
+
+  // La linea transmite un byte cada 10 bits, se permite una rafaga del
+  // tamano del buffer de transmision del MCU
+  const double bytesPorSegundo = opciones.baudios / 10.0;
+  const double periodo = 1 / opciones.muestreo;
+  const double inicio = ahora();
+  double siguienteMuestra = 0;
+  double siguienteReporte = 1;
+  double credito = 64;
+  double tiempoAnterior = 0;
+
+  while (!terminar) {
+    // Esperar comandos hasta la siguiente muestra
+    double t = ahora() - inicio;
+    double espera = siguienteMuestra - t;
+    if (espera < 0)
+      espera = 0;
+
+    timespec limite;
+    limite.tv_sec = (time_t) espera;
+    limite.tv_nsec = (long) ((espera - limite.tv_sec) * 1e9);
+
+    pollfd fd = { maestro, POLLIN, 0 };
+    if (!pendientes.empty())
+      fd.events |= POLLOUT;
+
+    ppoll(&fd, 1, &limite, NULL);
+    t = ahora() - inicio;
+
+    // Leer comandos
+    uint8_t entrada[256];
+    ssize_t leidos;
+    while ((leidos = read(maestro, entrada, sizeof(entrada))) > 0)
+      comandos.leer(entrada, leidos, t, pendientes, estadisticas);
+
+    // Generar las muestras que ya se debieron tomar
+    while (siguienteMuestra <= t) {
+      credito += (siguienteMuestra - tiempoAnterior) * bytesPorSegundo;
+      if (credito > 64)
+        credito = 64;
+
+      tiempoAnterior = siguienteMuestra;
+
+      double accel[3];
+      double gyro[3];
+      oscilador.avanzar(periodo, comandos.velocidad(siguienteMuestra),
+                        comandos.motor(siguienteMuestra), accel, gyro);
+
+      int16_t a[3];
+      int16_t g[3];
+      for (int i = 0; i < 3; ++i) {
+        a[i] = saturar(accel[i] * LSB_ACCEL);
+        g[i] = saturar(gyro[i] * LSB_GIRO);
+      }
+
+      // Filtrar y decimar igual que el firmware, solo se manda una trama
+      // por ventana
+      int16_t salida[FILTRO_EJES];
+      FiltroResumen resumen;
+      const bool lista = filtroAgregar(a, g, salida, &resumen);
+      const double tiempoMuestra = siguienteMuestra;
+      siguienteMuestra += periodo;
+      ++estadisticas.muestras;
+      if (!lista)
+        continue;
+
+      // Compensar el retraso del filtro
+      const double retraso = filtroRetraso() * periodo / 2;
+      const uint32_t us = (uint32_t) ((tiempoMuestra - retraso) * 1e6);
+      codificar(opciones, secuencia++, us, salida, resumen, trama);
+      ++estadisticas.tramas;
+
+      // Descartar la muestra si la linea o la terminal estan saturadas
+      if (credito < trama.size() || pendientes.size() > MAX_PENDIENTES) {
+        ++estadisticas.saturadas;
+        continue;
+      }
+
+      credito -= trama.size();
+
+      // Corromper un byte de la muestra
+      if (uniforme(generador) < opciones.corrupcion) {
+        trama[generador() % trama.size()] ^= (uint8_t) (1 + generador() % 255);
+        ++estadisticas.corruptas;
+      }
+
+      // Perder bytes de la muestra
+      for (size_t i = 0; i < trama.size(); ++i) {
+        if (opciones.perdidas > 0 && uniforme(generador) < opciones.perdidas)
+          ++estadisticas.bytesPerdidos;
+        else
+          pendientes.push_back(trama[i]);
+      }
+    }
+
+    // Escribir lo que acepte la terminal
+    if (!pendientes.empty()) {
+      ssize_t escritos = write(maestro, pendientes.data(), pendientes.size());
+      if (escritos > 0) {
+        pendientes.erase(pendientes.begin(), pendientes.begin() + escritos);
+        estadisticas.bytes += escritos;
+      }
+    }
+
+    // Reportar estadisticas cada segundo
+    if (t >= siguienteReporte) {
+      fprintf(stderr,
+              "%.0f s: %lu muestras, %lu tramas, %lu bytes/s, "
+              "%lu saturadas, %lu corruptas, %lu bytes perdidos, "
+              "%lu comandos, velocidad %.2f %%\n",
+              siguienteReporte, estadisticas.muestras, estadisticas.tramas,
+              estadisticas.bytes,
+              estadisticas.saturadas, estadisticas.corruptas,
+              estadisticas.bytesPerdidos, estadisticas.comandos,
+              comandos.velocidad(t));
+      memset(&estadisticas, 0, sizeof(estadisticas));
+      siguienteReporte += 1;
+    }
+  }
+
+  if (opciones.enlace)
+    unlink(opciones.enlace);
+
+  close(esclavo);
+  close(maestro);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//
+// Hardware TWI simulado (ver Twi.h). Las transacciones con la direccion
+// del MPU 6050 se ejecutan con el modelo al comenzar, ocupan el bus el
+// tiempo que tardarian a la frecuencia configurada y al terminar generan
+// la interrupcion del TWI. El costo de las interrupciones de cada byte se
+// cobra junto con la interrupcion final.
+//
+
+#include "TwiSimulado.h"
+#include "Twi.h"
+#include "Arduino.h"
+#include "Hal.h"
+#include "MpuSimulado.h"
+
+//
+// Frecuencia del bus, resultado y bytes de la transaccion en curso
+//
+static uint32_t frecuencia = 100000;
+static uint8_t resultado = TWI_COMPLETA;
+static uint32_t bytesActual = 0;
+
+//
+// Cada cuantas transacciones se traba el bus
+//
+static uint32_t periodoFallas = 0;
+static uint32_t transacciones = 0;
+
+///
+/// Interrupcion del TWI al terminar la transaccion en curso
+///
+static void interrupcionTwi() {
+  halCpu(bytesActual * HAL_CICLOS_TWI_BYTE);
+  twiTerminar(resultado);
+}
+
+void twiSimularFallas(uint32_t periodo) {
+  periodoFallas = periodo;
+  transacciones = 0;
+}
+
+void twiHwIniciar(uint32_t frecuenciaBus) {
+  if (frecuenciaBus > 0)
+    frecuencia = frecuenciaBus;
+
+  halProgramarTwi(0, 0);
+}
+
+void twiHwComenzar(TwiTransaccion* t) {
+  halCpu(HAL_CICLOS_TWI_TRANSACCION);
+
+  // Bus trabado, la transaccion nunca termina
+  ++transacciones;
+  if (periodoFallas > 0 && transacciones % periodoFallas == 0)
+    return;
+
+  // Direccion y registro, las lecturas llevan un inicio repetido y otra
+  // vez la direccion
+  uint32_t bits = 2;
+  uint32_t bytes = 2 + t->bytes;
+  if (t->direccion != mpuSimulado.direccion()) {
+    bytes = 1;
+    resultado = TWI_ERROR;
+  }
+
+  else if (t->escritura) {
+    uint8_t buffer[256];
+    buffer[0] = t->registro;
+    memcpy(buffer + 1, t->datos, t->bytes);
+    mpuSimulado.escribir(buffer, (uint8_t) (1 + t->bytes));
+    resultado = TWI_COMPLETA;
+  }
+
+  else {
+    ++bits;
+    ++bytes;
+    mpuSimulado.escribir(&t->registro, 1);
+    const uint8_t leidos = mpuSimulado.leer(t->datos, t->bytes);
+    resultado = leidos == t->bytes ? TWI_COMPLETA : TWI_ERROR;
+  }
+
+  // Inicio, 8 bits y ACK por byte y parada
+  const uint64_t ciclos = (bits + 9 * (uint64_t) bytes) * F_CPU / frecuencia;
+  bytesActual = bytes;
+  halOcuparBus(ciclos, bytes);
+  halProgramarTwi(interrupcionTwi, halCiclos() + ciclos);
+}
+
+void twiHwDetener() {
+  halProgramarTwi(0, 0);
+}
+
+void twiHwRecuperar() {
+  // Nueve pulsos de reloj y la condicion de parada
+  delayMicroseconds(10 * 9 + 15);
+}
@@ -32,11 +32,44 @@ QTPLUGIN += qsvg
 #-------------------------------------------------------------------------------
 
 HEADERS += \
-    src/Serial.h
+    src/Adquisicion.h \
+    src/BufferCircular.h \
+    src/CadenaFiltros.h \
+    src/Cinematica.h \
+    src/ColaSPSC.h \
+    src/Consola.h \
+    src/ControladorPid.h \
+    src/Decimador.h \
+    src/Decodificador.h \
+    src/Diagnostico.h \
+    src/Dispositivo.h \
+    src/Espectro.h \
+    src/Grabador.h \
+    src/Instrumentacion.h \
+    src/Muestra.h \
+    src/Osciloscopio.h \
+    src/Protocolo.h \
+    src/Reproductor.h \
+    src/Serial.h \
+    src/Sumidero.h
 
 SOURCES += \
+    src/Adquisicion.cpp \
+    src/CadenaFiltros.cpp \
+    src/Cinematica.cpp \
+    src/Consola.cpp \
+    src/ControladorPid.cpp \
+    src/Decodificador.cpp \
+    src/Diagnostico.cpp \
+    src/Dispositivo.cpp \
+    src/Espectro.cpp \
+    src/Grabador.cpp \
     src/main.cpp \
-    src/Serial.cpp
+    src/Osciloscopio.cpp \
+    src/Protocolo.cpp \
+    src/Reproductor.cpp \
+    src/Serial.cpp \
+    src/Sumidero.cpp
 
 RESOURCES += \
     assets/assets.qrc
@@ -22,6 +22,7 @@
 
 import QtQuick 2.0
 import QtQuick.Layouts 1.0
+import QtQuick.Dialogs 1.2
 import QtQuick.Controls 2.0
 
 Item {
@@ -51,17 +52,52 @@ Item {
             height: app.spacing
         }
 
+        //
+        // Modo de control del motor
+        //
+        ComboBox {
+            id: modoControl
+            Layout.fillWidth: true
+            currentIndex: CSerial.modoControl
+            onCurrentIndexChanged: CSerial.modoControl = currentIndex
+            model: [
+                qsTr("Manual"),
+                qsTr("Frecuencia"),
+                qsTr("Amplitud")
+            ]
+        }
+
         //
         // Controles de velocidad
         //
         GlowingLabel {
             color: "white"
-            text: qsTr("Vel. Motor")
             font.pixelSize: fontSizeMedium
             Layout.alignment: Qt.AlignHCenter
             horizontalAlignment: Text.AlignHCenter
+            text: CSerial.modoControl === 0 ? qsTr("Vel. Motor") :
+                                              qsTr("Consigna")
+        } Dial {
+            id: consignaDial
+            to: CSerial.consignaMax
+            from: 0
+            value: CSerial.consigna
+            implicitHeight: implicitWidth
+            Layout.alignment: Qt.AlignHCenter
+            implicitWidth: main.implicitWidth
+            visible: CSerial.modoControl !== 0
+            onValueChanged: CSerial.consigna = value
+
+            Label {
+                color: "white"
+                anchors.centerIn: parent
+                text: parent.value.toFixed(1) +
+                      (CSerial.modoControl === 1 ? " Hz" : "")
+                font.pixelSize: Qt.application.font.pixelSize * 2
+            }
         } Dial {
             id: velocidadDial
+            visible: CSerial.modoControl === 0
             to: CSerial.velocidadMax
             from: CSerial.velocidadMin
             value: CSerial.velocidadMin
@@ -88,22 +124,123 @@ Item {
             Layout.alignment: Qt.AlignHCenter
             horizontalAlignment: Text.AlignHCenter
         } Dial {
-            to: CSerial.escalaMax
-            from: CSerial.escalaMin
-            value: CSerial.escalaMin * 2
+            //
+            // La escala abarca varios ordenes de magnitud, el dial es
+            // logaritmico
+            //
+            to: Math.log(CSerial.escalaMax)
+            from: Math.log(CSerial.escalaMin)
+            value: Math.log(CSerial.escalaMin * 2)
             implicitHeight: implicitWidth
             Layout.alignment: Qt.AlignHCenter
             implicitWidth: main.implicitWidth
-           onValueChanged: CSerial.escala = value
+           onValueChanged: CSerial.escala = Math.round(Math.exp(value))
 
             Label {
                 color: "white"
                 anchors.centerIn: parent
-                text: parent.value.toFixed(2)
+                text: Math.round(Math.exp(parent.value))
                 font.pixelSize: Qt.application.font.pixelSize * 2
             }
         }
 
+        //
+        // Modo de telemetria del MCU y frecuencia de las tramas (el MCU
+        // muestrea a 1 kHz y decima)
+        //
+        RowLayout {
+            spacing: app.spacing
+            Layout.fillWidth: true
+
+            ComboBox {
+                id: modoTelemetria
+                Layout.fillWidth: true
+                currentIndex: CSerial.modoTelemetria
+                onActivated: CSerial.modoTelemetria = index
+                model: [
+                    qsTr("Crudo"),
+                    qsTr("Filtrado"),
+                    qsTr("Resumen")
+                ]
+            }
+
+            ComboBox {
+                id: decimacion
+                Layout.fillWidth: true
+                readonly property var decimaciones: {
+                    var lista = []
+                    for (var d = 1; d <= CSerial.maxDecimacion; d *= 2)
+                        lista.push(d)
+                    return lista
+                }
+
+                model: decimaciones.map(function(d) {
+                    var hz = CSerial.frecuenciaMuestreo / d
+                    return (hz >= 100 ? hz.toFixed(0) : hz.toFixed(1)) + " Hz"
+                })
+
+                currentIndex: decimaciones.indexOf(CSerial.decimacion)
+                onActivated: CSerial.decimacion = decimaciones[index]
+            }
+        }
+
+        //
+        // Resumen de la ultima ventana en el modo resumen
+        //
+        GridLayout {
+            columns: 5
+            rowSpacing: 0
+            Layout.fillWidth: true
+            visible: CSerial.modoTelemetria === 2
+
+            Label { text: "" }
+            Label { text: qsTr("mín") }
+            Label { text: qsTr("máx") }
+            Label { text: qsTr("media") }
+            Label { text: "RMS" }
+
+            Repeater {
+                model: CSerial.resumen.length * 5
+                delegate: Label {
+                    readonly property int eje: Math.floor(index / 5)
+                    readonly property int campo: index % 5
+                    readonly property var valores: CSerial.resumen[eje]
+                    font.pixelSize: 11
+                    text: {
+                        if (campo === 0)
+                            return ["aX", "aY", "aZ", "gX", "gY", "gZ"][eje]
+
+                        var nombre = ["minimo", "maximo", "media", "rms"][campo - 1]
+                        return valores[nombre].toFixed(2)
+                    }
+                }
+            }
+        }
+
+        //
+        // Cadena de filtros de las lecturas (tambien con Ctrl+F)
+        //
+        Button {
+            Layout.fillWidth: true
+            text: qsTr("Filtros")
+            checkable: true
+            checked: filtros.visible
+            onClicked: filtros.visible = checked
+        }
+
+        //
+        // Calibracion del sensor, el GMAS se detiene mientras se calibra
+        //
+        Button {
+            Layout.fillWidth: true
+            text: qsTr("Recalibrar sensor")
+            enabled: CSerial.conexionConDispositivo
+            onClicked: {
+                habilitar.checked = false
+                CSerial.recalibrar()
+            }
+        }
+
         //
         // Espaciador
         //
@@ -139,24 +276,99 @@ Item {
                     text: qsTr("No hay ningún dispositivo conectado")
                 }
 
+                //
+                // Se pueden abrir varios puertos a la vez
+                //
                 Repeater {
                     model: CSerial.dispositivosSerial
-                    delegate: RadioButton {
+                    delegate: CheckBox {
                         text: modelData
                         Layout.alignment: Qt.AlignHCenter
                         Layout.fillWidth: true
                         width: parent.width - 2 * app.spacing
-                        onCheckedChanged: {
-                            if (checked) {
-                                if (!CSerial.conectarADispositivo(index))
-                                    checked = false
-                            }
+                        checked: CSerial.puertosAbiertos.indexOf(modelData) !== -1
+                        onClicked: {
+                            if (checked)
+                                CSerial.conectarADispositivo(index)
+                            else
+                                CSerial.desconectarDispositivo(index)
+
+                            checked = Qt.binding(function() {
+                                return CSerial.puertosAbiertos.indexOf(modelData) !== -1
+                            })
+                        }
+                    }
+                }
+            }
+        }
+
+        //
+        // Dispositivos abiertos: el dispositivo actual es el que se controla
+        // y se analiza, los demas se pueden superponer en la grafica
+        //
+        Frame {
+            Layout.fillWidth: true
+            Layout.fillHeight: false
+            visible: CSerial.dispositivos.length > 1
+
+            ColumnLayout {
+                spacing: app.spacing
+                anchors.fill: parent
+
+                Repeater {
+                    model: CSerial.dispositivos
+                    delegate: RowLayout {
+                        Layout.fillWidth: true
+
+                        RadioButton {
+                            Layout.fillWidth: true
+                            checked: index === CSerial.dispositivoActual
+                            onClicked: CSerial.dispositivoActual = index
+                            opacity: modelData.conectado ? 1 : 0.5
+                            text: modelData.nombre + "\n" +
+                                  modelData.frecuencia.toFixed(2) + " Hz"
+                        }
+
+                        CheckBox {
+                            text: qsTr("Comparar")
+                            checked: modelData.superpuesto
+                            enabled: index !== CSerial.dispositivoActual
+                            onClicked: modelData.superpuesto = checked
                         }
                     }
                 }
             }
         }
 
+        //
+        // Reproduccion de archivos de lecturas
+        //
+        RowLayout {
+            spacing: app.spacing
+            Layout.fillWidth: true
+
+            ComboBox {
+                id: velocidadReproduccion
+                Layout.fillWidth: true
+                model: ["1×", "2×", "5×", "10×", qsTr("Máxima")]
+                readonly property var velocidades: [1, 2, 5, 10, 0]
+            }
+
+            Button {
+                text: qsTr("Reproducir")
+                onClicked: dialogoReproduccion.open()
+            }
+        }
+
+        FileDialog {
+            id: dialogoReproduccion
+            selectMultiple: false
+            folder: shortcuts.home + "/GMAS"
+            title: qsTr("Reproducir lecturas")
+            nameFilters: [qsTr("Lecturas") + " (*.csv *.gmas)"]
+            onAccepted: CSerial.reproducirArchivo(fileUrl, velocidadReproduccion.velocidades[velocidadReproduccion.currentIndex])
+        }
+
         //
         // Espaciador
         //
@@ -168,6 +380,7 @@ Item {
         // Boton de habilitado
         //
         Button {
+            id: habilitar
             icon.width: 36
             icon.height: 36
             checkable: true
@@ -190,4 +403,21 @@ Item {
             visible: CSerial.dispositivosSerial.length > 0
         }
     }
+
+    //
+    // Mostrar el estado de control del dispositivo seleccionado
+    //
+    Connections {
+        target: CSerial
+        onDispositivoActualCambiado: {
+            var velocidad = CSerial.velocidad
+            var consigna = CSerial.consigna
+            modoControl.currentIndex = CSerial.modoControl
+            modoTelemetria.currentIndex = CSerial.modoTelemetria
+            decimacion.currentIndex = decimacion.decimaciones.indexOf(CSerial.decimacion)
+            habilitar.checked = CSerial.gmasHabilitado
+            velocidadDial.value = velocidad
+            consignaDial.value = consigna
+        }
+    }
 }
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+import QtQuick 2.0
+import QtQuick.Layouts 1.0
+import QtQuick.Controls 2.0
+
+//
+// Resumen de las etapas de la ruta de datos (ver Diagnostico.h), se
+// muestra encima de la grafica con Ctrl+D
+//
+Rectangle {
+    id: diagnostico
+
+    readonly property var d: CSerial.diagnostico
+
+    radius: 4
+    color: "#cc12121a"
+    border.color: "#33ffffff"
+    implicitWidth: layout.implicitWidth + 4 * app.spacing
+    implicitHeight: layout.implicitHeight + 4 * app.spacing
+
+    ColumnLayout {
+        id: layout
+        anchors.centerIn: parent
+        spacing: app.spacing
+
+        GridLayout {
+            columns: 2
+            rowSpacing: 2
+            columnSpacing: app.spacing * 2
+
+            Label { text: qsTr("Puerto") } Label {
+                text: (d.bytesPorSegundo / 1024).toFixed(1) + " KB/s, " +
+                      d.bytesPorLectura.toFixed(0) + " B/lectura"
+            }
+
+            Label { text: qsTr("Muestras") } Label {
+                text: d.muestrasPorSegundo.toFixed(0) + " /s"
+            }
+
+            Label { text: qsTr("Decodificación (p99)") } Label {
+                text: d.decodificacion.toFixed(1) + " µs"
+            }
+
+            Label { text: qsTr("Procesamiento (p99)") } Label {
+                text: d.procesamiento.toFixed(1) + " µs"
+            }
+
+            Label { text: qsTr("Gráfica (p99)") } Label {
+                text: d.dibujo.toFixed(1) + " µs"
+            }
+
+            Label { text: qsTr("Latencia (p50/p99/máx)") } Label {
+                text: d.latenciaP50.toFixed(1) + " / " +
+                      d.latenciaP99.toFixed(1) + " / " +
+                      d.latenciaMaxima.toFixed(1) + " ms"
+            }
+
+            Label { text: qsTr("Cola") } Label {
+                text: d.profundidadCola + " / " + d.capacidadCola
+            }
+
+            Label { text: qsTr("Tramas inválidas") } Label {
+                text: d.tramasInvalidas + " (" + d.bytesDescartados + " B " +
+                      qsTr("descartados") + ")"
+            }
+
+            Label { text: qsTr("Tramas perdidas (MCU)") } Label {
+                text: d.tramasPerdidas
+                color: d.tramasPerdidas > 0 ? "#bf593e" : "#ffffff"
+            }
+
+            Label { text: qsTr("Lecturas perdidas") } Label {
+                text: d.lecturasPerdidas
+                color: d.lecturasPerdidas > 0 ? "#bf593e" : "#ffffff"
+            }
+
+            Label { text: qsTr("Grabador") } Label {
+                text: d.pendientesGrabador + " " + qsTr("pendientes") + ", " +
+                      d.descartadasGrabador + " " + qsTr("descartadas")
+                color: d.descartadasGrabador > 0 ? "#bf593e" : "#ffffff"
+            }
+        }
+
+        Switch {
+            Layout.fillWidth: true
+            text: qsTr("Registrar en archivo")
+            checked: d.archivoRegistro.length > 0
+            onClicked: {
+                if (checked)
+                    d.iniciarRegistro("")
+                else
+                    d.detenerRegistro()
+            }
+        }
+    }
+}
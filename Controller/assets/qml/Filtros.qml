@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+import QtQuick 2.0
+import QtQuick.Layouts 1.0
+import QtQuick.Controls 2.0
+
+//
+// Cadena de filtros del dispositivo actual (ver CadenaFiltros.h), las
+// etapas habilitadas se aplican en el orden de la lista. Se muestra
+// encima de la grafica con Ctrl+F.
+//
+Rectangle {
+    id: filtros
+
+    radius: 4
+    color: "#cc12121a"
+    border.color: "#33ffffff"
+    implicitWidth: layout.implicitWidth + 4 * app.spacing
+    implicitHeight: layout.implicitHeight + 4 * app.spacing
+
+    //
+    // Etapas disponibles y el parametro que se ajusta de cada una
+    //
+    ListModel {
+        id: etapas
+
+        ListElement {
+            tipo: "mediana"; nombre: qsTr("Mediana"); habilitada: false
+            parametro: "orden"; valor: 5; minimo: 3; maximo: 5; paso: 2; unidad: ""
+        }
+
+        ListElement {
+            tipo: "dc"; nombre: qsTr("Bloqueo de DC"); habilitada: false
+            parametro: "frecuencia"; valor: 1; minimo: 1; maximo: 10; paso: 1; unidad: "Hz"
+        }
+
+        ListElement {
+            tipo: "notch"; nombre: qsTr("Notch"); habilitada: false
+            parametro: "frecuencia"; valor: 50; minimo: 1; maximo: 250; paso: 1; unidad: "Hz"
+        }
+
+        ListElement {
+            tipo: "pasaaltas"; nombre: qsTr("Pasa-altas"); habilitada: false
+            parametro: "frecuencia"; valor: 1; minimo: 1; maximo: 250; paso: 1; unidad: "Hz"
+        }
+
+        ListElement {
+            tipo: "pasabajas"; nombre: qsTr("Pasa-bajas"); habilitada: false
+            parametro: "frecuencia"; valor: 20; minimo: 1; maximo: 250; paso: 1; unidad: "Hz"
+        }
+
+        ListElement {
+            tipo: "fir"; nombre: qsTr("FIR pasa-bajas"); habilitada: false
+            parametro: "frecuencia"; valor: 20; minimo: 1; maximo: 250; paso: 1; unidad: "Hz"
+        }
+    }
+
+    //
+    // Manda las etapas habilitadas al dispositivo actual
+    //
+    function aplicar() {
+        var lista = []
+        for (var i = 0; i < etapas.count; ++i) {
+            var etapa = etapas.get(i)
+            if (!etapa.habilitada)
+                continue
+
+            var config = { "tipo": etapa.tipo }
+            config[etapa.parametro] = etapa.valor
+            lista.push(config)
+        }
+
+        CSerial.filtros = lista
+    }
+
+    //
+    // Muestra la cadena del dispositivo actual
+    //
+    function cargar() {
+        var lista = CSerial.filtros
+        for (var i = 0; i < etapas.count; ++i) {
+            var etapa = etapas.get(i)
+            etapas.setProperty(i, "habilitada", false)
+            for (var j = 0; j < lista.length; ++j) {
+                if (lista[j].tipo === etapa.tipo) {
+                    etapas.setProperty(i, "habilitada", true)
+                    if (lista[j][etapa.parametro] !== undefined)
+                        etapas.setProperty(i, "valor", lista[j][etapa.parametro])
+                }
+            }
+        }
+    }
+
+    ColumnLayout {
+        id: layout
+        anchors.centerIn: parent
+        spacing: app.spacing
+
+        Label {
+            font.bold: true
+            text: qsTr("Filtros")
+        }
+
+        GridLayout {
+            columns: 3
+            rowSpacing: 2
+            columnSpacing: app.spacing * 2
+
+            Repeater {
+                model: etapas
+                delegate: CheckBox {
+                    Layout.row: index
+                    Layout.column: 0
+                    text: nombre
+                    checked: habilitada
+                    onClicked: {
+                        etapas.setProperty(index, "habilitada", checked)
+                        filtros.aplicar()
+                    }
+                }
+            }
+
+            Repeater {
+                model: etapas
+                delegate: SpinBox {
+                    Layout.row: index
+                    Layout.column: 1
+                    from: minimo
+                    to: maximo
+                    value: valor
+                    stepSize: paso
+                    editable: true
+                    enabled: habilitada
+                    onValueChanged: {
+                        if (value !== valor) {
+                            etapas.setProperty(index, "valor", value)
+                            filtros.aplicar()
+                        }
+                    }
+                }
+            }
+
+            Repeater {
+                model: etapas
+                delegate: Label {
+                    Layout.row: index
+                    Layout.column: 2
+                    text: unidad
+                }
+            }
+        }
+    }
+
+    Connections {
+        target: CSerial
+        onDispositivoActualCambiado: filtros.cargar()
+    }
+}
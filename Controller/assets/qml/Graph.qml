@@ -20,105 +20,357 @@
  * THE SOFTWARE.
  */
 
-import QtQuick 2.0
+import QtQuick 2.8
 import QtCharts 2.0
 import QtQuick.Layouts 1.0
 import QtQuick.Controls 2.0
 
-ChartView {
-    property alias xAxisEnabled: xSeries.visible
-    property alias yAxisEnabled: ySeries.visible
-    property alias zAxisEnabled: zSeries.visible
-    property alias pAxisEnabled: pSeries.visible
+import GMAS 1.0
 
-    //
-    // Opciones de visualizacion
-    //
-    antialiasing: false
-    backgroundRoundness: 0
-    theme: ChartView.ChartThemeDark
+Item {
+    id: graph
 
-    //
-    // Definir limites del eje del tiempo
-    //
-    ValueAxis {
-        id: timeAxis
-        min: 1
-        max: 1
-    }
+    property bool xAxisEnabled: false
+    property bool yAxisEnabled: false
+    property bool zAxisEnabled: false
+    property bool pAxisEnabled: true
+    property bool posicionEnabled: false
+    property bool velocidadEnabled: false
 
     //
-    // Definir limites para ejes de posicion
+    // Limites del eje de posicion
     //
-    ValueAxis {
-        id: positionAxis
-        max: 60
-        min: -40
-    }
+    readonly property real minimo: -40
+    readonly property real maximo: 60
 
     //
-    // Señal para el eje promedio
+    // Nombre y color de cada señal (ver Serial::actualizarGrafica())
     //
-    LineSeries {
-        id: pSeries
-        useOpenGL: true
-        axisX: timeAxis
-        axisY: positionAxis
-        name: qsTr("Aceleración Promedio")
+    readonly property var nombres: [
+        qsTr("Aceleración en X"),
+        qsTr("Aceleración en Y"),
+        qsTr("Aceleración en Z"),
+        qsTr("Aceleración Promedio"),
+        qsTr("Posición en Z (mm)"),
+        qsTr("Velocidad en Z (cm/s)")
+    ]
+    readonly property var colores: [
+        "#eb8817", "#7b7f8c", "#3c84a7", "#38ad6b", "#bf593e", "#b5b55f"
+    ]
+    readonly property var coloresSuperpuestos: {
+        var lista = []
+        for (var i = 0; i < colores.length; ++i)
+            lista.push(Qt.darker(colores[i], 1.8))
+
+        return lista
     }
+    readonly property var senales: {
+        var lista = []
+        var habilitadas = [xAxisEnabled, yAxisEnabled, zAxisEnabled,
+                           pAxisEnabled, posicionEnabled, velocidadEnabled]
+        for (var i = 0; i < habilitadas.length; ++i)
+            if (habilitadas[i])
+                lista.push(i)
 
-    //
-    // Señal para el eje Z
-    //
-    LineSeries {
-        id: zSeries
-        visible: false
-        useOpenGL: true
-        axisX: timeAxis
-        axisY: positionAxis
-        name: qsTr("Aceleración en Z")
+        return lista
     }
 
     //
-    // Señal para el eje X
+    // Con OpenGL las señales se dibujan directamente en la tarjeta de video,
+    // con otros backends se usa QtCharts
     //
-    LineSeries {
-        id: xSeries
-        visible: false
-        useOpenGL: true
-        axisX: timeAxis
-        axisY: positionAxis
-        name: qsTr("Aceleración en X")
+    Loader {
+        anchors.fill: parent
+        sourceComponent: GraphicsInfo.api === GraphicsInfo.OpenGL ? osciloscopio : chartView
     }
 
     //
-    // Señal para el eje Y
+    // Grafica con el elemento Osciloscopio
     //
-    LineSeries {
-        id: ySeries
-        visible: false
-        useOpenGL: true
-        axisX: timeAxis
-        axisY: positionAxis
-        name: qsTr("Aceleración en Y")
+    Component {
+        id: osciloscopio
+
+        Rectangle {
+            color: "#2e303a"
+
+            //
+            // Leyenda de las señales visibles
+            //
+            Row {
+                id: leyenda
+                spacing: 16
+                anchors.top: parent.top
+                anchors.topMargin: 24
+                anchors.horizontalCenter: parent.horizontalCenter
+
+                Repeater {
+                    model: graph.senales
+                    delegate: Row {
+                        spacing: 6
+
+                        Rectangle {
+                            width: 12
+                            height: 12
+                            color: graph.colores[modelData]
+                            anchors.verticalCenter: parent.verticalCenter
+                        }
+
+                        Label {
+                            color: "#ffffff"
+                            text: graph.nombres[modelData]
+                        }
+                    }
+                }
+
+                //
+                // Dispositivos que se dibujan con colores oscuros
+                //
+                Repeater {
+                    model: CSerial.dispositivos
+                    delegate: Label {
+                        color: "#86878c"
+                        text: qsTr("vs. %1").arg(modelData.nombre)
+                        visible: modelData.superpuesto && index !== CSerial.dispositivoActual
+                    }
+                }
+            }
+
+            //
+            // Area de la grafica
+            //
+            Item {
+                id: area
+                anchors {
+                    fill: parent
+                    leftMargin: 64
+                    rightMargin: 32
+                    bottomMargin: 48
+                    topMargin: leyenda.height + 40
+                }
+
+                //
+                // Lineas y etiquetas del eje de posicion
+                //
+                Repeater {
+                    model: (graph.maximo - graph.minimo) / 20 + 1
+                    delegate: Item {
+                        width: area.width
+                        y: area.height * index / ((graph.maximo - graph.minimo) / 20)
+
+                        Rectangle {
+                            height: 1
+                            width: parent.width
+                            color: "#86878c"
+                            opacity: 0.5
+                        }
+
+                        Label {
+                            color: "#ffffff"
+                            anchors.right: parent.left
+                            anchors.rightMargin: 8
+                            anchors.verticalCenter: parent.top
+                            text: graph.maximo - index * 20
+                        }
+                    }
+                }
+
+                //
+                // Etiquetas del eje del tiempo
+                //
+                Label {
+                    color: "#ffffff"
+                    anchors.top: parent.bottom
+                    anchors.topMargin: 8
+                    anchors.left: parent.left
+                    text: Math.max(0, CSerial.numLecturas - CSerial.escala)
+                }
+
+                Label {
+                    color: "#ffffff"
+                    anchors.top: parent.bottom
+                    anchors.topMargin: 8
+                    anchors.right: parent.right
+                    text: Math.max(CSerial.numLecturas, CSerial.escala)
+                }
+
+                //
+                // Señales de los otros dispositivos que se comparan con el
+                // dispositivo actual, con colores mas oscuros
+                //
+                Repeater {
+                    id: superpuestos
+                    model: CSerial.dispositivos
+                    delegate: Osciloscopio {
+                        clip: true
+                        anchors.fill: parent
+                        visible: modelData.superpuesto && index !== CSerial.dispositivoActual
+
+                        fuente: modelData
+                        minimo: graph.minimo
+                        maximo: graph.maximo
+                        ventana: CSerial.escala
+                        senales: graph.senales
+                        colores: graph.coloresSuperpuestos
+                    }
+                }
+
+                //
+                // Señales del dispositivo actual
+                //
+                Osciloscopio {
+                    id: plot
+                    clip: true
+                    anchors.fill: parent
+
+                    fuente: CSerial.actual
+                    minimo: graph.minimo
+                    maximo: graph.maximo
+                    ventana: CSerial.escala
+                    senales: graph.senales
+                    colores: graph.colores
+                }
+
+                //
+                // Redibujar a la misma frecuencia que la pantalla
+                //
+                Timer {
+                    interval: 1000 / 60
+                    repeat: true
+                    running: true
+                    onTriggered: {
+                        plot.update()
+                        for (var i = 0; i < superpuestos.count; ++i)
+                            if (superpuestos.itemAt(i).visible)
+                                superpuestos.itemAt(i).update()
+                    }
+                }
+            }
+        }
     }
 
     //
-    // Actualizar la gráfica cuando la ultima posicion
-    // del GMAS es calculada
+    // Grafica con QtCharts
     //
-    Timer {
-        interval: 1000 / 60
-        repeat: true
-        running: true
-        onTriggered: {
-            timeAxis.max = Math.max(CSerial.numLecturas, CSerial.escala)
-            timeAxis.min = Math.max(0, CSerial.numLecturas - CSerial.escala)
-
-            CSerial.actualizarGrafica(xSeries, 0)
-            CSerial.actualizarGrafica(ySeries, 1)
-            CSerial.actualizarGrafica(zSeries, 2)
-            CSerial.actualizarGrafica(pSeries, 3)
+    Component {
+        id: chartView
+
+        ChartView {
+            //
+            // Opciones de visualizacion
+            //
+            antialiasing: false
+            backgroundRoundness: 0
+            theme: ChartView.ChartThemeDark
+
+            //
+            // Las lecturas se reducen a un minimo y un maximo por pixel
+            //
+            onPlotAreaChanged: CSerial.cambiarAnchoGrafica(plotArea.width)
+
+            //
+            // Definir limites del eje del tiempo
+            //
+            ValueAxis {
+                id: timeAxis
+                min: 1
+                max: 1
+            }
+
+            //
+            // Definir limites para ejes de posicion
+            //
+            ValueAxis {
+                id: positionAxis
+                max: graph.maximo
+                min: graph.minimo
+            }
+
+            //
+            // Señal para el eje promedio
+            //
+            LineSeries {
+                id: pSeries
+                visible: graph.pAxisEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Aceleración Promedio")
+            }
+
+            //
+            // Señal para el eje Z
+            //
+            LineSeries {
+                id: zSeries
+                visible: graph.zAxisEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Aceleración en Z")
+            }
+
+            //
+            // Señal para el eje X
+            //
+            LineSeries {
+                id: xSeries
+                visible: graph.xAxisEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Aceleración en X")
+            }
+
+            //
+            // Señal para el eje Y
+            //
+            LineSeries {
+                id: ySeries
+                visible: graph.yAxisEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Aceleración en Y")
+            }
+
+            //
+            // Posicion vertical estimada del sensor (mm)
+            //
+            LineSeries {
+                id: posicionSeries
+                visible: graph.posicionEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Posición en Z (mm)")
+            }
+
+            //
+            // Velocidad vertical estimada del sensor (cm/s)
+            //
+            LineSeries {
+                id: velocidadSeries
+                visible: graph.velocidadEnabled
+                axisX: timeAxis
+                axisY: positionAxis
+                name: qsTr("Velocidad en Z (cm/s)")
+            }
+
+            //
+            // Actualizar la gráfica cuando la ultima posicion
+            // del GMAS es calculada
+            //
+            Timer {
+                interval: 1000 / 60
+                repeat: true
+                running: true
+                onTriggered: {
+                    timeAxis.max = Math.max(CSerial.numLecturas, CSerial.escala)
+                    timeAxis.min = Math.max(0, CSerial.numLecturas - CSerial.escala)
+
+                    CSerial.actualizarGrafica(xSeries, 0)
+                    CSerial.actualizarGrafica(ySeries, 1)
+                    CSerial.actualizarGrafica(zSeries, 2)
+                    CSerial.actualizarGrafica(pSeries, 3)
+                    CSerial.actualizarGrafica(posicionSeries, 4)
+                    CSerial.actualizarGrafica(velocidadSeries, 5)
+                }
+            }
         }
     }
 }
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+import QtQuick 2.0
+import QtCharts 2.0
+import QtQuick.Layouts 1.0
+import QtQuick.Controls 2.0
+
+ChartView {
+    id: chart
+
+    //
+    // Opciones de visualizacion
+    //
+    antialiasing: false
+    legend.visible: false
+    backgroundRoundness: 0
+    theme: ChartView.ChartThemeDark
+
+    //
+    // Eje de frecuencias, desde 0 Hz hasta la frecuencia de Nyquist
+    //
+    ValueAxis {
+        id: frequencyAxis
+        min: 0
+        max: CSerial.frecuenciaMaxima > 0 ? CSerial.frecuenciaMaxima : 50
+        titleText: qsTr("Frecuencia (Hz)")
+    }
+
+    //
+    // Eje de amplitudes, se ajusta a la amplitud del pico dominante
+    //
+    ValueAxis {
+        id: amplitudeAxis
+        min: 0
+        max: Math.max(0.1, CSerial.amplitud * 1.5)
+    }
+
+    //
+    // Espectro de la señal seleccionada
+    //
+    LineSeries {
+        id: spectrumSeries
+        useOpenGL: true
+        axisX: frequencyAxis
+        axisY: amplitudeAxis
+    }
+
+    //
+    // Actualizar el espectro cuando el hilo de adquisicion calcula uno nuevo
+    //
+    Connections {
+        target: CSerial
+        onEspectroCambiado: CSerial.actualizarEspectro(spectrumSeries)
+    }
+
+    //
+    // Selector de señal y resultados del analisis
+    //
+    RowLayout {
+        spacing: app.spacing
+        anchors {
+            top: parent.top
+            right: parent.right
+            margins: app.spacing * 2
+        }
+
+        Label {
+            color: app.colorMain
+            font.family: "Monospace"
+            text: qsTr("f = %1 Hz   A = %2   φ = %3°   ζ = %4")
+                    .arg(CSerial.frecuencia.toFixed(2))
+                    .arg(CSerial.amplitud.toFixed(3))
+                    .arg(CSerial.fase.toFixed(0))
+                    .arg(CSerial.amortiguamiento.toFixed(3))
+        }
+
+        ComboBox {
+            currentIndex: CSerial.canalEspectro
+            onCurrentIndexChanged: CSerial.canalEspectro = currentIndex
+            model: [
+                qsTr("Aceleración en X"),
+                qsTr("Aceleración en Y"),
+                qsTr("Aceleración en Z"),
+                qsTr("Aceleración Promedio"),
+                qsTr("Posición en Z (mm)"),
+                qsTr("Velocidad en Z (cm/s)")
+            ]
+        }
+    }
+}
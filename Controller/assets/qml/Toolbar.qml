@@ -32,6 +32,8 @@ Container {
     signal ySignalChanged(var enabled)
     signal zSignalChanged(var enabled)
     signal pSignalChanged(var enabled)
+    signal posicionSignalChanged(var enabled)
+    signal velocidadSignalChanged(var enabled)
 
     background: Rectangle {
         anchors.fill: parent
@@ -122,6 +124,30 @@ Container {
             onCheckedChanged: pSignalChanged(checked)
         }
 
+        SwitchDelegate {
+            checked: false
+            Layout.fillWidth: true
+            Layout.alignment: Qt.AlignHCenter
+            text: qsTr("Posición en Z")
+            onCheckedChanged: posicionSignalChanged(checked)
+        }
+
+        SwitchDelegate {
+            checked: false
+            Layout.fillWidth: true
+            Layout.alignment: Qt.AlignHCenter
+            text: qsTr("Velocidad en Z")
+            onCheckedChanged: velocidadSignalChanged(checked)
+        }
+
+        Label {
+            Layout.alignment: Qt.AlignHCenter
+            visible: CSerial.latenciaComandos >= 0
+            font.pixelSize: app.fontSizeExtraSmall
+            text: qsTr("Latencia de comandos: %1 ms")
+                    .arg(CSerial.latenciaComandos.toFixed(1))
+        }
+
         Item {
             Layout.fillHeight: true
         }
@@ -75,6 +75,22 @@ ApplicationWindow {
         onActivated: Qt.quit()
     }
 
+    //
+    // Mostrar u ocultar el diagnostico de la ruta de datos con Ctrl+D
+    //
+    Shortcut {
+        sequence: "Ctrl+D"
+        onActivated: diagnostico.visible = !diagnostico.visible
+    }
+
+    //
+    // Mostrar u ocultar la cadena de filtros con Ctrl+F
+    //
+    Shortcut {
+        sequence: "Ctrl+F"
+        onActivated: filtros.visible = !filtros.visible
+    }
+
     //
     // Definir fondo
     //
@@ -108,16 +124,48 @@ ApplicationWindow {
         }
 
         //
-        // Grafica
+        // Grafica y espectro
         //
-        Frame {
+        ColumnLayout {
+            spacing: app.spacing * 2
             Layout.fillWidth: true
             Layout.fillHeight: true
 
-            Graph {
-                id: graph
-                anchors.fill: parent
-                anchors.margins: -18
+            Frame {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+
+                Graph {
+                    id: graph
+                    anchors.fill: parent
+                    anchors.margins: -18
+                }
+
+                Diagnostico {
+                    id: diagnostico
+                    visible: false
+                    anchors.top: parent.top
+                    anchors.right: parent.right
+                    anchors.margins: app.spacing
+                }
+
+                Filtros {
+                    id: filtros
+                    visible: false
+                    anchors.top: parent.top
+                    anchors.left: parent.left
+                    anchors.margins: app.spacing
+                }
+            }
+
+            Frame {
+                Layout.fillWidth: true
+                Layout.preferredHeight: app.height / 3
+
+                Spectrum {
+                    anchors.fill: parent
+                    anchors.margins: -18
+                }
             }
         }
 
@@ -139,6 +187,8 @@ ApplicationWindow {
                 onXSignalChanged: graph.xAxisEnabled = enabled
                 onYSignalChanged: graph.yAxisEnabled = enabled
                 onZSignalChanged: graph.zAxisEnabled = enabled
+                onPosicionSignalChanged: graph.posicionEnabled = enabled
+                onVelocidadSignalChanged: graph.velocidadEnabled = enabled
             }
         }
     }
@@ -0,0 +1,544 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+//
+// Banco de pruebas de la ruta de datos del Controller: decodificacion de
+// tramas y paquetes de texto con distintos tamaños de bloque, procesamiento
+// de cada muestra, cadena de filtros (FIR, mediana y biquad) con distintos
+// tamaños de bloque, mantenimiento del historial de la grafica con distintas
+// escalas, generacion de los archivos de lecturas y actualizacion de las
+// series de la grafica.
+//
+// Las entradas son flujos sinteticos generados al inicio del programa. Los
+// resultados (muestras por segundo, ns por muestra y reservas de memoria
+// por muestra) se escriben en formato JSON para comparar el antes y el
+// despues de cada optimizacion.
+//
+
+#include <QFile>
+#include <QtMath>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLineSeries>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <new>
+#include <atomic>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Muestra.h"
+#include "Sumidero.h"
+#include "Espectro.h"
+#include "Decimador.h"
+#include "Protocolo.h"
+#include "Cinematica.h"
+#include "CadenaFiltros.h"
+#include "Decodificador.h"
+#include "BufferCircular.h"
+
+QT_CHARTS_USE_NAMESPACE
+
+//
+// Contador de reservas de memoria. Con glibc se reemplaza malloc(), de modo
+// que tambien se cuentan las reservas de los contenedores de Qt; en otros
+// sistemas solo se cuentan las reservas con new.
+//
+static std::atomic<unsigned long long> reservas(0);
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t bytes);
+void* __libc_calloc(size_t n, size_t bytes);
+void* __libc_realloc(void* p, size_t bytes);
+
+void* malloc(size_t bytes) __THROW {
+    reservas.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(bytes);
+}
+
+void* calloc(size_t n, size_t bytes) __THROW {
+    reservas.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, bytes);
+}
+
+void* realloc(void* p, size_t bytes) __THROW {
+    reservas.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, bytes);
+}
+}
+#else
+void* operator new(size_t bytes) {
+    reservas.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(bytes ? bytes : 1);
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+#endif
+
+/**
+ * Numero de muestras de los flujos sinteticos
+ */
+static const int NUM_MUESTRAS = 20000;
+
+/**
+ * Numero de lecturas que el hilo de adquisicion publica a la vez
+ */
+static const int LECTURAS_POR_BLOQUE = 256;
+
+/**
+ * Ancho (en pixeles) de la grafica para el decimador
+ */
+static const int ANCHO_GRAFICA = 800;
+
+/**
+ * Frecuencia de muestreo (Hz) y de oscilacion de los flujos sinteticos
+ */
+static const float FRECUENCIA_MUESTREO = 500;
+static const float FRECUENCIA_OSCILACION = 5;
+
+//
+// Opciones y resultados del banco de pruebas
+//
+static qint64 duracionMinima = 300;
+static QString filtro;
+static QJsonArray resultados;
+
+/**
+ * Ejecuta la @a iteracion (que procesa @a muestras muestras) hasta que
+ * transcurren al menos @c duracionMinima ms y agrega el resultado con el
+ * @a nombre y los @a parametros especificados
+ */
+static void Medir(const QString& nombre,
+                  const QJsonObject& parametros,
+                  const qint64 muestras,
+                  const std::function<void()>& iteracion) {
+    if (!filtro.isEmpty() && !nombre.contains(filtro))
+        return;
+
+    // Calentar caches y reservar la memoria de los contenedores
+    iteracion();
+
+    // Medir
+    qint64 iteraciones = 0;
+    QElapsedTimer reloj;
+    const unsigned long long reservasIniciales = reservas.load();
+    reloj.start();
+    do {
+        iteracion();
+        ++iteraciones;
+    } while (reloj.elapsed() < duracionMinima || iteraciones < 3);
+
+    const qint64 ns = reloj.nsecsElapsed();
+    const double total = static_cast<double>(iteraciones * muestras);
+    const double reservasMedidas = static_cast<double>(reservas.load() - reservasIniciales);
+
+    QJsonObject resultado;
+    resultado["nombre"] = nombre;
+    resultado["parametros"] = parametros;
+    resultado["iteraciones"] = iteraciones;
+    resultado["muestras"] = total;
+    resultado["muestras_por_segundo"] = total * 1e9 / ns;
+    resultado["ns_por_muestra"] = ns / total;
+    resultado["reservas_por_muestra"] = reservasMedidas / total;
+    resultados.append(resultado);
+
+    fprintf(stderr, "%-24s %-16s %12.0f muestras/s %10.1f ns/muestra %8.3f reservas/muestra\n",
+            qPrintable(nombre),
+            qPrintable(QJsonDocument(parametros).toJson(QJsonDocument::Compact)),
+            total * 1e9 / ns, ns / total, reservasMedidas / total);
+}
+
+/**
+ * Genera @a n muestras de un sensor que oscila verticalmente
+ */
+static QVector<Muestra> GenerarMuestras(const int n) {
+    QVector<Muestra> muestras(n);
+    for (int i = 0; i < n; ++i) {
+        const float t = i / FRECUENCIA_MUESTREO;
+        const float w = 2 * static_cast<float>(M_PI) * FRECUENCIA_OSCILACION;
+
+        Muestra& m = muestras[i];
+        m.formato = Muestra::FormatoBinario;
+        m.secuencia = static_cast<quint16>(i);
+        m.tiempo = static_cast<quint32>(i * 1e6f / FRECUENCIA_MUESTREO);
+        m.accel[0] = 0.2f * sinf(w * t * 0.5f);
+        m.accel[1] = 0.1f * cosf(w * t * 0.7f);
+        m.accel[2] = 9.80665f + 4 * sinf(w * t);
+        m.gyro[0] = 3 * sinf(w * t);
+        m.gyro[1] = 2 * cosf(w * t);
+        m.gyro[2] = 0.5f;
+    }
+
+    return muestras;
+}
+
+/**
+ * Codifica las @a muestras como tramas binarias (ver Protocolo.h)
+ */
+static QByteArray FlujoBinario(const QVector<Muestra>& muestras) {
+    QByteArray flujo;
+    flujo.reserve(muestras.count() * Protocolo::TramaTelemetria);
+
+    const quint8 config = 0x01;
+    const float fa = Protocolo::factorAcelerometro(config);
+    const float fg = Protocolo::factorGiroscopio(config);
+    quint8 trama[Protocolo::TramaTelemetria];
+    foreach (const Muestra& m, muestras) {
+        Protocolo::Telemetria telemetria;
+        telemetria.secuencia = m.secuencia;
+        telemetria.tiempo = m.tiempo;
+        telemetria.config = config;
+        for (int i = 0; i < 3; ++i) {
+            telemetria.accel[i] = static_cast<qint16>(qRound(m.accel[i] / fa));
+            telemetria.gyro[i] = static_cast<qint16>(qRound(m.gyro[i] / fg));
+        }
+
+        const int bytes = Protocolo::codificarTelemetria(telemetria, trama);
+        flujo.append(reinterpret_cast<const char*>(trama), bytes);
+    }
+
+    return flujo;
+}
+
+/**
+ * Codifica las @a muestras como paquetes de texto, igual que el firmware
+ */
+static QByteArray FlujoTexto(const QVector<Muestra>& muestras) {
+    QByteArray flujo;
+    char paquete[128];
+    foreach (const Muestra& m, muestras) {
+        const int bytes = snprintf(paquete, sizeof(paquete),
+                                   "{%.3f,%.3f,%.3f,%.2f,%.2f,%.2f};",
+                                   m.accel[0], m.accel[1], m.accel[2],
+                                   m.gyro[0], m.gyro[1], m.gyro[2]);
+        flujo.append(paquete, bytes);
+    }
+
+    return flujo;
+}
+
+/**
+ * Convierte las @a muestras en lecturas procesadas
+ */
+static QVector<Lectura> GenerarLecturas(const QVector<Muestra>& muestras) {
+    Cinematica cinematica;
+    QVector<Lectura> lecturas(muestras.count());
+    for (int i = 0; i < muestras.count(); ++i) {
+        const Muestra& m = muestras.at(i);
+        cinematica.actualizar(m);
+
+        Lectura& l = lecturas[i];
+        l.tiempo = i + 1;
+        l.llegada = 0;
+        for (int j = 0; j < 3; ++j) {
+            l.valores[CanalAccelX + j] = m.accel[j];
+            l.valores[CanalGyroX + j] = m.gyro[j];
+            l.valores[CanalVelX + j] = cinematica.velocidad()[j];
+            l.valores[CanalPosX + j] = cinematica.posicion()[j];
+        }
+
+        l.valores[CanalAccelP] = sqrtf(m.accel[0] * m.accel[0] +
+                                       m.accel[1] * m.accel[1] +
+                                       m.accel[2] * m.accel[2]);
+    }
+
+    return lecturas;
+}
+
+/**
+ * Decodifica el @a flujo en bloques de @a bloque bytes, igual que
+ * Adquisicion::onDatosRecibidos(), y regresa el numero de muestras
+ */
+static int Decodificar(Decodificador* decodificador, const QByteArray& flujo,
+                       const int bloque, Muestra* muestras, const int capacidad,
+                       const std::function<void(const Muestra&)>& procesar) {
+    int total = 0;
+    const char* datos = flujo.constData();
+    for (int inicio = 0; inicio < flujo.size(); inicio += bloque) {
+        const int bytes = qMin(bloque, flujo.size() - inicio);
+
+        int offset = 0;
+        while (offset < bytes) {
+            int leidos = 0;
+            const int n = decodificador->decodificar(datos + inicio + offset,
+                                                     bytes - offset,
+                                                     muestras, capacidad,
+                                                     &leidos);
+            if (procesar) {
+                for (int i = 0; i < n; ++i)
+                    procesar(muestras[i]);
+            }
+
+            total += n;
+            offset += leidos;
+        }
+    }
+
+    return total;
+}
+
+/**
+ * Ejecuta las pruebas y escribe los resultados en formato JSON
+ */
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("banco");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Banco de pruebas de la ruta de datos del Controller");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption(QStringList() << "o" << "salida",
+                                        "Archivo JSON de resultados (salida estandar si se omite)",
+                                        "archivo"));
+    parser.addOption(QCommandLineOption(QStringList() << "t" << "duracion",
+                                        "Duracion minima de cada prueba en ms (300)",
+                                        "ms"));
+    parser.addOption(QCommandLineOption(QStringList() << "f" << "filtro",
+                                        "Ejecutar solo las pruebas cuyo nombre contiene el texto",
+                                        "texto"));
+    parser.process(app);
+
+    if (parser.isSet("duracion"))
+        duracionMinima = qMax(1, parser.value("duracion").toInt());
+    filtro = parser.value("filtro");
+
+    // Generar entradas
+    const QVector<Muestra> muestras = GenerarMuestras(NUM_MUESTRAS);
+    const QVector<Lectura> lecturas = GenerarLecturas(muestras);
+    const QByteArray binario = FlujoBinario(muestras);
+    const QByteArray texto = FlujoTexto(muestras);
+
+    Muestra bloque[LECTURAS_POR_BLOQUE];
+    const int bloques[] = { 1, 16, 64, 512, 4096 };
+    const int escalas[] = { 100, 1000, 10000, 100000, 300000 };
+
+    //
+    // Decodificacion de tramas binarias y paquetes de texto
+    //
+    for (int b : bloques) {
+        Decodificador decodificador;
+        QJsonObject parametros;
+        parametros["bloque"] = b;
+
+        Medir("decodificar_binario", parametros, NUM_MUESTRAS, [&]() {
+            Decodificar(&decodificador, binario, b, bloque, LECTURAS_POR_BLOQUE, Q_NULLPTR);
+        });
+
+        Medir("decodificar_texto", parametros, NUM_MUESTRAS, [&]() {
+            Decodificar(&decodificador, texto, b, bloque, LECTURAS_POR_BLOQUE, Q_NULLPTR);
+        });
+    }
+
+    //
+    // Decodificacion y procesamiento de cada muestra, como en el hilo de
+    // adquisicion (sin el grabador ni la cola de la interfaz grafica)
+    //
+    {
+        Espectro espectro;
+        Cinematica cinematica;
+        Decodificador decodificador;
+        QJsonObject parametros;
+        parametros["bloque"] = 4096;
+
+        Medir("adquisicion", parametros, NUM_MUESTRAS, [&]() {
+            Decodificar(&decodificador, binario, 4096, bloque, LECTURAS_POR_BLOQUE,
+                        [&](const Muestra& m) {
+                cinematica.actualizar(m);
+                const float p = sqrtf(m.accel[0] * m.accel[0] +
+                                      m.accel[1] * m.accel[1] +
+                                      m.accel[2] * m.accel[2]);
+                espectro.agregar(p, cinematica.periodo());
+            });
+        });
+    }
+
+    //
+    // Estimacion de la orientacion, velocidad y posicion
+    //
+    {
+        Cinematica cinematica;
+        Medir("cinematica", QJsonObject(), NUM_MUESTRAS, [&]() {
+            foreach (const Muestra& m, muestras)
+                cinematica.actualizar(m);
+        });
+    }
+
+    //
+    // Cadena de filtros con distintos tamaños de bloque. Los ejes se copian
+    // al bloque de trabajo antes de filtrarlos en su lugar, de lo contrario
+    // las etapas volverian a filtrar su propia salida hasta que los valores
+    // decaen a numeros subnormales y la medicion deja de ser representativa.
+    //
+    {
+        QVector<float> ejes[CadenaFiltros::NUM_EJES];
+        for (int e = 0; e < CadenaFiltros::NUM_EJES; ++e) {
+            ejes[e].resize(NUM_MUESTRAS);
+            for (int i = 0; i < NUM_MUESTRAS; ++i) {
+                const Muestra& m = muestras.at(i);
+                ejes[e][i] = e < 3 ? m.accel[e] : m.gyro[e - 3];
+            }
+        }
+
+        const EtapaFiltro fir = { EtapaFiltro::Fir, 20, 0, 31 };
+        const EtapaFiltro mediana = { EtapaFiltro::Mediana, 0, 0, 5 };
+        const EtapaFiltro pasaBajas = { EtapaFiltro::PasaBajas, 20, 0.707f, 0 };
+        const EtapaFiltro notch = { EtapaFiltro::Notch, 50, 5, 0 };
+        const EtapaFiltro bloqueoDc = { EtapaFiltro::BloqueoDc, 0.5f, 0.707f, 0 };
+
+        typedef QPair<QString, QVector<EtapaFiltro>> Cadena;
+        QVector<Cadena> cadenas;
+        cadenas.append(qMakePair(QStringLiteral("fir"),
+                                 QVector<EtapaFiltro>() << fir));
+        cadenas.append(qMakePair(QStringLiteral("mediana"),
+                                 QVector<EtapaFiltro>() << mediana));
+        cadenas.append(qMakePair(QStringLiteral("biquad"),
+                                 QVector<EtapaFiltro>() << pasaBajas << notch << bloqueoDc));
+        cadenas.append(qMakePair(QStringLiteral("completa"),
+                                 QVector<EtapaFiltro>() << mediana << fir << pasaBajas
+                                                        << notch << bloqueoDc));
+
+        const int bloquesFiltros[] = { 1, 16, 64, CadenaFiltros::MAX_BLOQUE };
+
+        float trabajo[CadenaFiltros::NUM_EJES][CadenaFiltros::MAX_BLOQUE];
+        float* const bloqueFiltros[CadenaFiltros::NUM_EJES] = {
+            trabajo[0], trabajo[1], trabajo[2], trabajo[3], trabajo[4], trabajo[5]
+        };
+
+        foreach (const Cadena& cadena, cadenas) {
+            for (int b : bloquesFiltros) {
+                CadenaFiltros filtros;
+                filtros.cambiarFrecuenciaMuestreo(FRECUENCIA_MUESTREO);
+                filtros.configurar(cadena.second);
+
+                QJsonObject parametros;
+                parametros["cadena"] = cadena.first;
+                parametros["bloque"] = b;
+
+                Medir("cadena_filtros", parametros, NUM_MUESTRAS, [&]() {
+                    for (int i = 0; i < NUM_MUESTRAS; i += b) {
+                        const int n = qMin(b, NUM_MUESTRAS - i);
+                        for (int e = 0; e < CadenaFiltros::NUM_EJES; ++e)
+                            memcpy(trabajo[e], ejes[e].constData() + i, n * sizeof(float));
+
+                        filtros.procesar(bloqueFiltros, n);
+                    }
+                });
+            }
+        }
+    }
+
+    //
+    // Historial de la grafica y decimador con distintas escalas
+    //
+    for (int escala : escalas) {
+        BufferCircular<NumCanales> historial(escala);
+        Decimador<NumCanales> decimador;
+        decimador.configurar(ANCHO_GRAFICA, escala);
+
+        QJsonObject parametros;
+        parametros["escala"] = escala;
+
+        qreal tiempo = 0;
+        Medir("historial", parametros, NUM_MUESTRAS, [&]() {
+            foreach (const Lectura& l, lecturas) {
+                tiempo += 1;
+                historial.agregar(tiempo, l.valores);
+                decimador.agregar(tiempo, l.valores);
+            }
+        });
+
+        // Generar los puntos de una serie y reemplazar los de la serie con
+        // el historial lleno, una muestra es una lectura de la grafica
+        while (historial.count() < escala) {
+            const Lectura& l = lecturas.at(static_cast<int>(tiempo) % NUM_MUESTRAS);
+            tiempo += 1;
+            historial.agregar(tiempo, l.valores);
+            decimador.agregar(tiempo, l.valores);
+        }
+
+        QLineSeries serie;
+        QVector<QPointF> puntos;
+        Medir("grafica", parametros, escala, [&]() {
+            decimador.puntos(CanalAccelP, historial.tiempos()[0], 1, &puntos);
+            serie.replace(puntos);
+        });
+    }
+
+    //
+    // Archivos de lecturas
+    //
+    QTemporaryDir carpeta;
+    if (carpeta.isValid()) {
+        SumideroCsv csv;
+        SumideroBinario binarios;
+        csv.abrir(carpeta.filePath("lecturas"));
+        binarios.abrir(carpeta.filePath("lecturas"));
+
+        Medir("grabar_csv", QJsonObject(), NUM_MUESTRAS, [&]() {
+            for (int i = 0; i < NUM_MUESTRAS; i += LECTURAS_POR_BLOQUE)
+                csv.escribir(lecturas.constData() + i, qMin(LECTURAS_POR_BLOQUE, NUM_MUESTRAS - i));
+        });
+
+        Medir("grabar_binario", QJsonObject(), NUM_MUESTRAS, [&]() {
+            for (int i = 0; i < NUM_MUESTRAS; i += LECTURAS_POR_BLOQUE)
+                binarios.escribir(lecturas.constData() + i, qMin(LECTURAS_POR_BLOQUE, NUM_MUESTRAS - i));
+        });
+    }
+
+    // Escribir resultados
+    QJsonObject documento;
+    documento["banco"] = QStringLiteral("Controller");
+    documento["fecha"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    documento["qt"] = QString(qVersion());
+    documento["resultados"] = resultados;
+
+    const QByteArray json = QJsonDocument(documento).toJson();
+    if (parser.isSet("salida")) {
+        QFile archivo(parser.value("salida"));
+        if (!archivo.open(QFile::WriteOnly)) {
+            fprintf(stderr, "No se puede escribir %s\n", qPrintable(archivo.fileName()));
+            return EXIT_FAILURE;
+        }
+
+        archivo.write(json);
+    }
+
+    else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
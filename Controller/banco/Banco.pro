@@ -0,0 +1,50 @@
+#-------------------------------------------------------------------------------
+# Banco de pruebas de la ruta de datos del Controller
+#
+#   qmake banco/Banco.pro && make && ./banco -o resultados.json
+#-------------------------------------------------------------------------------
+
+UI_DIR = uic
+MOC_DIR = moc
+RCC_DIR = qrc
+OBJECTS_DIR = obj
+
+CONFIG += c++11
+CONFIG += console
+CONFIG -= app_bundle
+
+#-------------------------------------------------------------------------------
+# Configuracion de Qt
+#-------------------------------------------------------------------------------
+
+TEMPLATE = app
+TARGET = banco
+
+QT += core
+QT += charts
+
+#-------------------------------------------------------------------------------
+# Importar codigo fuente
+#-------------------------------------------------------------------------------
+
+INCLUDEPATH += ../src
+
+HEADERS += \
+    ../src/BufferCircular.h \
+    ../src/CadenaFiltros.h \
+    ../src/Cinematica.h \
+    ../src/Decimador.h \
+    ../src/Decodificador.h \
+    ../src/Espectro.h \
+    ../src/Muestra.h \
+    ../src/Protocolo.h \
+    ../src/Sumidero.h
+
+SOURCES += \
+    ../src/CadenaFiltros.cpp \
+    ../src/Cinematica.cpp \
+    ../src/Decodificador.cpp \
+    ../src/Espectro.cpp \
+    ../src/Protocolo.cpp \
+    ../src/Sumidero.cpp \
+    Banco.cpp
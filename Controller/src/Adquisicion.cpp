@@ -0,0 +1,929 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Adquisicion.h"
+#include "Reproductor.h"
+
+#include <QDir>
+#include <QtMath>
+#include <QTimer>
+#include <QDebug>
+#include <QDateTime>
+#include <QSerialPort>
+#include <QCoreApplication>
+
+#include <string.h>
+
+/**
+ * Velocidad maxima (en %) que el lazo de control puede mandar al motor
+ */
+static const float VELOCIDAD_MAXIMA = 97;
+
+/**
+ * Si la velocidad no cambia, se manda un keepalive con este periodo (ms)
+ * para que el MCU sepa que el software de control sigue activo
+ */
+static const int INTERVALO_KEEPALIVE = 250;
+
+/**
+ * Tiempo minimo (ms) entre dos comandos, los cambios que llegan dentro de
+ * este intervalo se combinan en un solo comando
+ */
+static const int INTERVALO_COMANDOS = 2;
+
+/**
+ * Periodo (en segundos) con el que se actualiza el lazo de control
+ */
+static const float PERIODO_CONTROL = 0.02f;
+
+/**
+ * Tiempo (en segundos) que el error debe mantenerse debajo del 5% de la
+ * consigna para ajustar la prealimentacion
+ */
+static const float TIEMPO_ESTABLE = 2.0f;
+
+/**
+ * Cambio relativo de la frecuencia de muestreo medida a partir del cual se
+ * vuelven a calcular los coeficientes de la cadena de filtros
+ */
+static const float CAMBIO_FRECUENCIA_FILTROS = 0.05f;
+
+/**
+ * Intervalo (ns) en el que se cuentan las lecturas de texto, las cuales no
+ * incluyen el tiempo del MCU, para medir su frecuencia
+ */
+static const qint64 INTERVALO_MEDICION_TEXTO = 1000000000;
+
+/**
+ * Ganancias iniciales del PID y de la prealimentacion para cada modo de
+ * control, en % de velocidad por Hz (frecuencia) o por unidad de la señal
+ * analizada (amplitud)
+ */
+static const struct {
+    float kp;
+    float ki;
+    float kd;
+    float prealimentacion;
+} GANANCIAS[] = {
+    { 0,    0,    0,    0    },
+    { 1.0f, 1.5f, 0.1f, 4.0f },
+    { 2.0f, 2.0f, 0,    3.0f },
+};
+
+/**
+ * Inicializa los miembros de la clase, las lecturas procesadas se
+ * publican en la @a cola para que la interfaz grafica las lea.
+ *
+ * El objeto debe moverse a su propio hilo con @c moveToThread(), los
+ * objetos hijos (como el temporizador) se mueven junto con el.
+ */
+Adquisicion::Adquisicion(ColaSPSC<Lectura>* cola) {
+    Q_ASSERT(cola != Q_NULLPTR);
+
+    // Inicializar valores
+    m_cola = cola;
+    m_latencia = -1;
+    m_velocidad = 0;
+    m_consigna = 0;
+    m_ultimoEnvio = 0;
+    m_habilitado = false;
+    m_secuenciaComando = 0;
+    m_comandosBinarios = false;
+    m_modoTelemetria = Protocolo::ModoFiltrado;
+    m_decimacion = 2;
+    m_pendientes = 0;
+    m_llegada = 0;
+    m_tiempoControl = 0;
+    m_tiempoEstable = 0;
+    m_velocidadManual = 0;
+    m_modoControl = ControlManual;
+    m_numLecturas = 0;
+    m_puerto = Q_NULLPTR;
+    m_lecturasPerdidas = 0;
+    m_versionEspectro = 0;
+    m_versionResumen = 0;
+    m_hayTiempoFiltros = false;
+    m_secuenciaFiltros = 0;
+    m_tiempoFiltros = 0;
+    m_periodoFiltros = 0;
+    m_muestrasTexto = 0;
+    m_inicioTexto = -1;
+    m_analisis = Analisis();
+    m_canalEspectro = CanalAccelP;
+    m_intervaloSincronizacion = 0;
+    m_formatosGrabacion = Grabador::FormatoCsv;
+
+    // El controlador no puede apagar el motor en reversa
+    m_pid.cambiarLimites(0, VELOCIDAD_MAXIMA);
+
+    // Mandar un keepalive si no hay cambios en la velocidad
+    m_temporizador = new QTimer(this);
+    m_temporizador->setInterval(INTERVALO_KEEPALIVE);
+    connect(m_temporizador, &QTimer::timeout,
+            this,           &Adquisicion::mandarKeepalive);
+
+    // Combinar los cambios de velocidad que llegan en rafagas
+    m_temporizadorComando = new QTimer(this);
+    m_temporizadorComando->setSingleShot(true);
+    connect(m_temporizadorComando, &QTimer::timeout,
+            this,                  &Adquisicion::mandarDatos);
+
+    // Marcar los comandos como no enviados
+    for (int i = 0; i < MAX_COMANDOS; ++i)
+        m_envios[i].tiempo = -1;
+
+    m_reloj.start();
+}
+
+/**
+ * Cierra la conexión con el dispositivo serial
+ */
+Adquisicion::~Adquisicion() {
+    desconectar();
+}
+
+/**
+ * Regresa el tiempo (en us) entre el envio del ultimo comando confirmado
+ * y la recepcion de su confirmacion, o -1 si no se ha confirmado ningun
+ * comando. Este metodo puede llamarse desde cualquier hilo.
+ */
+qint32 Adquisicion::latencia() const {
+    return m_latencia.load();
+}
+
+/**
+ * Regresa el numero de lecturas que no se pudieron publicar porque la
+ * interfaz grafica no vacio la cola a tiempo
+ */
+quint64 Adquisicion::lecturasPerdidas() const {
+    return m_lecturasPerdidas.load();
+}
+
+/**
+ * Regresa el grabador de lecturas, el cual reporta el numero de lecturas
+ * pendientes por escribir y el numero de bytes escritos
+ */
+const Grabador& Adquisicion::grabador() const {
+    return m_grabador;
+}
+
+/**
+ * Regresa los contadores y histogramas de las etapas de adquisicion
+ * (lectura del puerto, decodificacion y procesamiento), los cuales se
+ * pueden leer desde cualquier hilo
+ */
+const EtapasAdquisicion& Adquisicion::etapas() const {
+    return m_etapas;
+}
+
+/**
+ * Copia el ultimo analisis espectral en @a analisis y @a magnitudes si
+ * cambio desde la @a version especificada, la cual se actualiza. Este
+ * metodo puede llamarse desde cualquier hilo.
+ *
+ * @return @a true si habia un analisis nuevo
+ */
+bool Adquisicion::leerEspectro(Analisis* analisis, QVector<float>* magnitudes,
+                               quint32* version) const {
+    Q_ASSERT(analisis != Q_NULLPTR);
+    Q_ASSERT(magnitudes != Q_NULLPTR);
+    Q_ASSERT(version != Q_NULLPTR);
+
+    QMutexLocker locker(&m_mutexEspectro);
+    if (*version == m_versionEspectro)
+        return false;
+
+    *analisis = m_analisis;
+    *magnitudes = m_magnitudes;
+    *version = m_versionEspectro;
+    return true;
+}
+
+/**
+ * Copia el ultimo resumen de ventana que mando el MCU en @a resumen si
+ * cambio desde la @a version especificada, la cual se actualiza. Este
+ * metodo puede llamarse desde cualquier hilo.
+ *
+ * @return @a true si habia un resumen nuevo
+ */
+bool Adquisicion::leerResumen(ResumenVentana* resumen, quint32* version) const {
+    Q_ASSERT(resumen != Q_NULLPTR);
+    Q_ASSERT(version != Q_NULLPTR);
+
+    QMutexLocker locker(&m_mutexResumen);
+    if (*version == m_versionResumen)
+        return false;
+
+    *resumen = m_resumen;
+    *version = m_versionResumen;
+    return true;
+}
+
+/**
+ * Intenta establecer una conexión con el @a puerto especificado a los
+ * @a baudios especificados (1 Mbaud por defecto), este metodo debe
+ * ejecutarse en el hilo de adquisicion.
+ *
+ * @return @a true si la conexión se establecio con éxito,
+ *         @a false si hubo algún error
+ */
+bool Adquisicion::conectar(const QString& puerto, const qint32 baudios) {
+    QSerialPort* serial = new QSerialPort(puerto, this);
+    serial->setBaudRate(baudios);
+    return abrir(serial, serial->portName());
+}
+
+/**
+ * Reproduce el archivo de lecturas en la @a ruta especificada como si
+ * fuera un dispositivo conectado (ver Reproductor). Una @a velocidad de 1
+ * reproduce las lecturas en tiempo real y una de 0 a la velocidad maxima.
+ * Este metodo debe ejecutarse en el hilo de adquisicion.
+ *
+ * @return @a true si el archivo se pudo abrir
+ */
+bool Adquisicion::reproducir(const QString& ruta, const qreal velocidad) {
+    Reproductor* reproductor = new Reproductor(ruta, this);
+    reproductor->cambiarVelocidad(velocidad);
+    return abrir(reproductor, "Reproduccion");
+}
+
+/**
+ * Comienza a leer los datos del @a dispositivo (puerto serial o
+ * reproductor) y a grabar sus lecturas en un archivo que incluye el
+ * @a nombre del dispositivo. El objeto toma posesion del dispositivo.
+ *
+ * @return @a true si el dispositivo se pudo abrir
+ */
+bool Adquisicion::abrir(QIODevice* dispositivo, const QString& nombre) {
+    // Disconectar el dispositivo actual
+    desconectar();
+    m_puerto = dispositivo;
+
+    // Descartar cualquier paquete incompleto del dispositivo anterior
+    m_decodificador.reiniciar();
+
+    // Olvidar la orientacion, posicion y espectro del dispositivo anterior
+    m_cinematica.reiniciar();
+    m_espectro.reiniciar();
+    m_filtros.reiniciar();
+    m_pid.reiniciar();
+
+    // Volver a medir la frecuencia de las lecturas para la cadena de
+    // filtros, el nuevo dispositivo puede muestrear a otra frecuencia
+    m_hayTiempoFiltros = false;
+    m_periodoFiltros = 0;
+    m_muestrasTexto = 0;
+    m_inicioTexto = -1;
+
+    // Usar comandos de texto hasta saber que el MCU habla el protocolo
+    // binario, y olvidar los comandos del dispositivo anterior
+    m_latencia = -1;
+    m_comandosBinarios = false;
+    for (int i = 0; i < MAX_COMANDOS; ++i)
+        m_envios[i].tiempo = -1;
+
+    // Conectar señales para poder leer datos del dispositivo
+    connect(m_puerto, SIGNAL(readyRead()),
+            this,       SLOT(onDatosRecibidos()));
+    connect(m_puerto, SIGNAL(aboutToClose()),
+            this,       SLOT(desconectar()));
+    connect(m_puerto, SIGNAL(readChannelFinished()),
+            this,       SLOT(desconectar()));
+
+    // Intentar abrir una conexion con el dispositivo
+    if (m_puerto->open(QIODevice::ReadWrite)) {
+        // Mandar la velocidad actual y comenzar a mandar keepalives
+        mandarDatos();
+
+        // Actualizar UI
+        emit conexionCambiada(true);
+
+        // Obtener tiempo actual
+        QDateTime tiempo = QDateTime::currentDateTime();
+
+        // Crear carpeta para guardar archivo de lecturas
+        QDir dir = QDir::homePath() + "/" + QCoreApplication::applicationName() + "/";
+        if (!dir.exists())
+            dir.mkpath(".");
+
+        // Obtener nombre para archivo de lecturas (el grabador agrega la
+        // extension de cada formato)
+        QString filename = QString("Lecturas-%1-%2")
+                .arg(nombre)
+                .arg(tiempo.toString("hh_mm_ss - dd_MMM_yyyy"));
+
+        // Intentar abrir archivo de lecturas
+        if (!m_grabador.iniciar(dir.filePath(filename),
+                                m_formatosGrabacion,
+                                m_intervaloSincronizacion))
+            qWarning() << "No se puede generar el archivo de lecturas";
+
+        // Regresar verdadero para notificar resultado
+        return true;
+    }
+
+    // Hubo un error al abrir la conexión
+    desconectar();
+    return false;
+}
+
+/**
+ * Termina la conexión con el dispositivo serial actual (si hay alguno conectado)
+ */
+void Adquisicion::desconectar() {
+    // Verificar si el puerto serial es valido
+    if (m_puerto != Q_NULLPTR) {
+        // Dejar de mandar datos de control
+        m_temporizador->stop();
+        m_temporizadorComando->stop();
+
+        // Apagar motor
+        if (m_puerto->isOpen()) {
+            for (int i = 0; i < 255; ++i)
+                m_puerto->write("0;");
+        }
+
+        // Escribir lecturas pendientes y cerrar archivos de salida
+        publicar();
+        m_grabador.detener();
+
+        // Disconectar señales del puerto serial
+        m_puerto->disconnect(this, SLOT(onDatosRecibidos()));
+        m_puerto->disconnect(this, SLOT(desconectar()));
+
+        // Cerrar y eliminar conexion
+        m_puerto->close();
+        m_puerto->deleteLater();
+
+        // Reset apuntador
+        m_puerto = Q_NULLPTR;
+
+        // Actualizar UI
+        emit conexionCambiada(false);
+    }
+}
+
+/**
+ * Cambia la velocidad que se manda al GMAS en cada ciclo de control
+ * cuando el control es manual
+ */
+void Adquisicion::cambiarVelocidad(const qreal velocidad) {
+    m_velocidadManual = velocidad;
+    if (m_modoControl == ControlManual && m_velocidad != velocidad) {
+        m_velocidad = velocidad;
+        solicitarEnvio();
+    }
+}
+
+/**
+ * Habilita o deshabilita el motor del GMAS, el cambio se manda de
+ * inmediato
+ */
+void Adquisicion::habilitar(const bool habilitado) {
+    if (m_habilitado != habilitado) {
+        m_habilitado = habilitado;
+        solicitarEnvio();
+    }
+}
+
+/**
+ * Cambia el @a modo de control (ver ModoControl) y la @a consigna de
+ * frecuencia (Hz) o amplitud. En los modos de lazo cerrado la velocidad
+ * del motor se calcula con un PID a partir de la oscilacion medida.
+ */
+void Adquisicion::cambiarControl(const int modo, const qreal consigna) {
+    Q_ASSERT(modo >= ControlManual && modo <= ControlAmplitud);
+
+    // Cargar las ganancias del nuevo modo y cerrar el lazo desde cero
+    if (modo != m_modoControl) {
+        m_pid.reiniciar();
+        m_pid.cambiarGanancias(GANANCIAS[modo].kp,
+                               GANANCIAS[modo].ki,
+                               GANANCIAS[modo].kd);
+        m_pid.cambiarPrealimentacion(GANANCIAS[modo].prealimentacion);
+
+        m_tiempoControl = 0;
+        m_tiempoEstable = 0;
+    }
+
+    m_consigna = consigna;
+    m_modoControl = modo;
+
+    if (m_modoControl == ControlManual && m_velocidad != m_velocidadManual) {
+        m_velocidad = m_velocidadManual;
+        solicitarEnvio();
+    }
+}
+
+/**
+ * Cambia las ganancias del PID del modo de control actual
+ */
+void Adquisicion::configurarPid(const qreal kp, const qreal ki, const qreal kd) {
+    m_pid.cambiarGanancias(static_cast<float>(kp),
+                           static_cast<float>(ki),
+                           static_cast<float>(kd));
+}
+
+/**
+ * Selecciona los @a formatos de los archivos de lecturas (ver
+ * Grabador::Formato) y cada cuantos ms se sincronizan con el disco
+ * (0 para dejar que el sistema operativo decida), los cambios se aplican
+ * en la siguiente conexion
+ */
+void Adquisicion::configurarGrabacion(const int formatos,
+                                      const int intervaloSincronizacion) {
+    m_formatosGrabacion = formatos;
+    m_intervaloSincronizacion = intervaloSincronizacion;
+}
+
+/**
+ * Manda la velocidad actual al GMAS. Si el MCU manda tramas binarias la
+ * velocidad se manda como un comando con numero de secuencia, el cual el
+ * MCU confirma; de lo contrario se manda como texto.
+ */
+void Adquisicion::mandarDatos() {
+    if (m_puerto == Q_NULLPTR || !m_puerto->isOpen())
+        return;
+
+    const qreal velocidad = m_habilitado ? m_velocidad : 0;
+    if (m_comandosBinarios) {
+        quint8 trama[Protocolo::TramaVelocidad];
+        const quint16 secuencia = m_secuenciaComando++;
+        const int bytes = Protocolo::codificarVelocidad(secuencia, m_habilitado,
+                                                        velocidad, trama);
+        registrarEnvio(secuencia);
+        m_puerto->write(reinterpret_cast<const char*>(trama), bytes);
+    }
+
+    else {
+        QString datos = QString("%1;").arg(velocidad);
+        m_puerto->write(datos.toUtf8());
+    }
+
+    // Reiniciar el periodo del keepalive
+    m_ultimoEnvio = m_reloj.elapsed();
+    m_temporizador->start();
+}
+
+/**
+ * Avisa al MCU que el software de control sigue activo, el MCU apaga el
+ * motor si deja de recibir comandos
+ */
+void Adquisicion::mandarKeepalive() {
+    if (m_puerto == Q_NULLPTR || !m_puerto->isOpen())
+        return;
+
+    // Los MCUs con el protocolo de texto no distinguen keepalives
+    if (!m_comandosBinarios) {
+        mandarDatos();
+        return;
+    }
+
+    quint8 trama[Protocolo::TramaKeepalive];
+    const quint16 secuencia = m_secuenciaComando++;
+    const int bytes = Protocolo::codificarKeepalive(secuencia, trama);
+    registrarEnvio(secuencia);
+    m_puerto->write(reinterpret_cast<const char*>(trama), bytes);
+
+    m_ultimoEnvio = m_reloj.elapsed();
+}
+
+/**
+ * Pide al MCU que vuelva a calibrar el sensor. El MCU no manda lecturas
+ * mientras calibra (alrededor de un segundo), por lo que el comando no se
+ * registra para medir la latencia. Los MCUs con el protocolo de texto no
+ * se pueden calibrar.
+ */
+void Adquisicion::recalibrar() {
+    if (m_puerto == Q_NULLPTR || !m_puerto->isOpen() || !m_comandosBinarios)
+        return;
+
+    quint8 trama[Protocolo::TramaCalibrar];
+    const int bytes = Protocolo::codificarCalibrar(m_secuenciaComando++, trama);
+    m_puerto->write(reinterpret_cast<const char*>(trama), bytes);
+}
+
+/**
+ * Cambia el @a modo de telemetria del MCU (ver Protocolo::ModoTelemetria)
+ * y su @a decimacion, la cual determina la frecuencia de las tramas. El
+ * modo se vuelve a mandar cada vez que se conecta un MCU binario.
+ */
+void Adquisicion::cambiarTelemetria(const int modo, const int decimacion) {
+    m_modoTelemetria = modo;
+    m_decimacion = decimacion;
+    mandarModo();
+}
+
+/**
+ * Remplaza la cadena de filtros que se aplica a las lecturas del
+ * acelerometro y giroscopio (ver CadenaFiltros::leerEtapas()). Si alguna
+ * etapa no es valida se conserva la cadena actual.
+ */
+void Adquisicion::configurarFiltros(const QVariantList& etapas) {
+    QVector<EtapaFiltro> cadena;
+    if (!CadenaFiltros::leerEtapas(etapas, &cadena)) {
+        qWarning() << "Configuracion de filtros invalida" << etapas;
+        return;
+    }
+
+    m_filtros.configurar(cadena);
+}
+
+/**
+ * Mide la frecuencia con la que llegan las @a n @a muestras y ajusta los
+ * coeficientes de la cadena de filtros si cambio significativamente. Con
+ * el protocolo binario se promedia el tiempo del MCU entre tramas
+ * (dividido entre los saltos de la secuencia, para no contar las tramas
+ * perdidas), con el de texto se cuentan las lecturas que llegan por
+ * segundo.
+ */
+void Adquisicion::medirFrecuencia(const Muestra* muestras, const int n) {
+    Q_ASSERT(muestras != Q_NULLPTR);
+
+    for (int i = 0; i < n; ++i) {
+        const Muestra& muestra = muestras[i];
+        if (muestra.formato != Muestra::FormatoBinario)
+            continue;
+
+        if (m_hayTiempoFiltros) {
+            const quint16 saltos = static_cast<quint16>(muestra.secuencia - m_secuenciaFiltros);
+            const quint32 delta = muestra.tiempo - m_tiempoFiltros;
+            if (saltos > 0 && saltos < 0x8000 && delta > 0 && delta < 500000u * saltos) {
+                const float periodo = static_cast<float>(delta) * 1e-6f / saltos;
+                if (m_periodoFiltros <= 0)
+                    m_periodoFiltros = periodo;
+                else
+                    m_periodoFiltros += 0.01f * (periodo - m_periodoFiltros);
+            }
+        }
+
+        m_hayTiempoFiltros = true;
+        m_secuenciaFiltros = muestra.secuencia;
+        m_tiempoFiltros = muestra.tiempo;
+    }
+
+    if (muestras[0].formato == Muestra::FormatoTexto) {
+        if (m_inicioTexto < 0) {
+            m_inicioTexto = m_llegada;
+        } else {
+            m_muestrasTexto += n;
+            const qint64 transcurrido = m_llegada - m_inicioTexto;
+            if (transcurrido >= INTERVALO_MEDICION_TEXTO) {
+                m_periodoFiltros = static_cast<float>(transcurrido) * 1e-9f / m_muestrasTexto;
+                m_inicioTexto = m_llegada;
+                m_muestrasTexto = 0;
+            }
+        }
+    }
+
+    // Volver a disenar los filtros solo si la frecuencia cambio
+    if (m_periodoFiltros > 0) {
+        const float frecuencia = 1 / m_periodoFiltros;
+        const float actual = m_filtros.frecuenciaMuestreo();
+        if (qAbs(frecuencia - actual) > CAMBIO_FRECUENCIA_FILTROS * actual)
+            m_filtros.cambiarFrecuenciaMuestreo(frecuencia);
+    }
+}
+
+/**
+ * Manda el modo de telemetria actual al MCU, los MCUs con el protocolo de
+ * texto siempre mandan todas las muestras
+ */
+void Adquisicion::mandarModo() {
+    if (m_puerto == Q_NULLPTR || !m_puerto->isOpen() || !m_comandosBinarios)
+        return;
+
+    quint8 trama[Protocolo::TramaModo];
+    const quint16 secuencia = m_secuenciaComando++;
+    const int bytes = Protocolo::codificarModo(secuencia, m_modoTelemetria,
+                                               m_decimacion, trama);
+    registrarEnvio(secuencia);
+    m_puerto->write(reinterpret_cast<const char*>(trama), bytes);
+}
+
+/**
+ * Programa el envio de la velocidad actual. Los cambios que llegan antes
+ * de que se mande el comando (o menos de INTERVALO_COMANDOS ms despues
+ * del ultimo comando) se combinan en un solo comando con el estado mas
+ * reciente.
+ */
+void Adquisicion::solicitarEnvio() {
+    if (m_temporizadorComando->isActive())
+        return;
+
+    const qint64 transcurrido = m_reloj.elapsed() - m_ultimoEnvio;
+    const qint64 espera = qMax<qint64>(0, INTERVALO_COMANDOS - transcurrido);
+    m_temporizadorComando->start(static_cast<int>(espera));
+}
+
+/**
+ * Registra el momento en el que se mando el comando con la @a secuencia
+ * especificada para medir la latencia cuando el MCU lo confirme
+ */
+void Adquisicion::registrarEnvio(const quint16 secuencia) {
+    const int i = secuencia % MAX_COMANDOS;
+    m_envios[i].secuencia = secuencia;
+    m_envios[i].tiempo = m_reloj.nsecsElapsed();
+}
+
+/**
+ * Lee las confirmaciones de comandos que recibio el decodificador y
+ * actualiza la latencia de ida y vuelta
+ */
+void Adquisicion::leerAcks() {
+    Protocolo::Ack acks[16];
+    const int n = m_decodificador.leerAcks(acks, 16);
+    if (n <= 0)
+        return;
+
+    const qint64 ahora = m_reloj.nsecsElapsed();
+    for (int i = 0; i < n; ++i) {
+        const int j = acks[i].secuencia % MAX_COMANDOS;
+        if (m_envios[j].secuencia != acks[i].secuencia || m_envios[j].tiempo < 0)
+            continue;
+
+        if (acks[i].estado != Protocolo::AckOk)
+            qWarning() << "El MCU rechazo el comando" << acks[i].secuencia
+                       << "con estado" << acks[i].estado;
+
+        m_latencia = static_cast<qint32>((ahora - m_envios[j].tiempo) / 1000);
+        m_envios[j].tiempo = -1;
+    }
+}
+
+/**
+ * Llamado cuando recibimos cualquier número de bytes del dispositivo
+ * serial, los datos se leen en bloques y se pasan directamente al
+ * decodificador, el cual interpreta las tramas y paquetes sin copiarlos
+ */
+void Adquisicion::onDatosRecibidos() {
+    // Verificar apuntador del puerto serial
+    if (!m_puerto)
+        return;
+
+    // Tiempo de llegada de las lecturas de este bloque
+    m_llegada = RelojMonotonico();
+    qint64 total = 0;
+    qint64 nsDecodificacion = 0;
+    qint64 nsProcesamiento = 0;
+
+    // Leer todos los bloques disponibles
+    qint64 bytes;
+    while ((bytes = m_puerto->read(m_bloque, sizeof(m_bloque))) > 0) {
+        total += bytes;
+
+        // Decodificar el bloque, puede contener mas muestras de las que
+        // caben en el buffer de muestras
+        int offset = 0;
+        while (offset < bytes) {
+            int leidos = 0;
+            const qint64 inicio = RelojMonotonico();
+            const int n = m_decodificador.decodificar(m_bloque + offset,
+                                                      static_cast<int>(bytes) - offset,
+                                                      m_muestras, MAX_MUESTRAS,
+                                                      &leidos);
+            const qint64 decodificado = RelojMonotonico();
+
+            // Procesar lecturas
+            procesar(m_muestras, n);
+
+            nsDecodificacion += decodificado - inicio;
+            nsProcesamiento += RelojMonotonico() - decodificado;
+            offset += leidos;
+        }
+    }
+
+    // Medir la latencia de los comandos confirmados
+    leerAcks();
+
+    // Publicar el ultimo resumen de ventana
+    Protocolo::Resumen resumen;
+    if (m_decodificador.leerResumen(&resumen))
+        publicarResumen(resumen);
+
+    // Publicar el bloque de lecturas procesadas
+    publicar();
+
+    // Actualizar los contadores de cada etapa
+    m_etapas.bytesLeidos.store(m_etapas.bytesLeidos.load() + static_cast<quint64>(total));
+    m_etapas.lecturasPuerto.store(m_etapas.lecturasPuerto.load() + 1);
+    m_etapas.muestras.store(m_decodificador.muestras());
+    m_etapas.tramasInvalidas.store(m_decodificador.tramasInvalidas());
+    m_etapas.bytesDescartados.store(m_decodificador.bytesDescartados());
+    m_etapas.tramasPerdidas.store(m_decodificador.tramasPerdidas());
+    m_etapas.bytesPorLectura.registrar(static_cast<quint64>(total));
+    m_etapas.decodificacion.registrar(static_cast<quint64>(nsDecodificacion));
+    m_etapas.procesamiento.registrar(static_cast<quint64>(nsProcesamiento));
+}
+
+/**
+ * Cambia el @a canal de las lecturas cuyo espectro se analiza
+ */
+void Adquisicion::cambiarCanalEspectro(const int canal) {
+    Q_ASSERT(canal >= 0 && canal < NumCanales);
+
+    if (m_canalEspectro != canal) {
+        m_canalEspectro = canal;
+        m_espectro.reiniciar();
+    }
+}
+
+/**
+ * Entrega las lecturas procesadas al grabador y las publica en la cola
+ * de la interfaz grafica, si la cola esta llena las lecturas se descartan
+ * para no detener la adquisicion de datos
+ */
+void Adquisicion::publicar() {
+    if (m_pendientes <= 0)
+        return;
+
+    m_grabador.agregar(m_lecturas, m_pendientes);
+
+    const int escritas = m_cola->escribir(m_lecturas, m_pendientes);
+    if (escritas < m_pendientes)
+        m_lecturasPerdidas.fetchAndAddRelaxed(static_cast<quint64>(m_pendientes - escritas));
+
+    m_pendientes = 0;
+}
+
+/**
+ * Copia el ultimo espectro calculado para que la interfaz grafica lo lea
+ * con @c leerEspectro()
+ */
+void Adquisicion::publicarEspectro() {
+    QMutexLocker locker(&m_mutexEspectro);
+
+    m_analisis = m_espectro.analisis();
+    m_magnitudes.resize(Espectro::NUM_BINS);
+    memcpy(m_magnitudes.data(), m_espectro.magnitudes(),
+           Espectro::NUM_BINS * sizeof(float));
+
+    ++m_versionEspectro;
+}
+
+/**
+ * Normaliza el @a resumen que mando el MCU para que la interfaz grafica lo
+ * lea con @c leerResumen()
+ */
+void Adquisicion::publicarResumen(const Protocolo::Resumen& resumen) {
+    const float fa = Protocolo::factorAcelerometro(resumen.config);
+    const float fg = Protocolo::factorGiroscopio(resumen.config);
+
+    QMutexLocker locker(&m_mutexResumen);
+    m_resumen.muestras = resumen.muestras;
+    for (int i = 0; i < 6; ++i) {
+        const float factor = i < 3 ? fa : fg;
+        m_resumen.minimo[i] = resumen.minimo[i] * factor;
+        m_resumen.maximo[i] = resumen.maximo[i] * factor;
+        m_resumen.media[i] = resumen.media[i] * factor;
+        m_resumen.rms[i] = resumen.rms[i] * factor;
+    }
+
+    ++m_versionResumen;
+}
+
+/**
+ * Actualiza el lazo de control con la ultima oscilacion medida, @a dt es
+ * el tiempo desde la ultima actualizacion. La nueva velocidad se manda
+ * inmediatamente al GMAS.
+ */
+void Adquisicion::controlar(const float dt) {
+    const float consigna = static_cast<float>(m_consigna);
+
+    // Mientras no haya una estimacion de la oscilacion solo se usa la
+    // prealimentacion
+    float salida;
+    if (m_espectro.frecuencia() <= 0) {
+        m_pid.reiniciar();
+        salida = qBound(0.0f, m_pid.prealimentacion() * consigna, VELOCIDAD_MAXIMA);
+    }
+
+    // Cerrar el lazo con la frecuencia o amplitud medida
+    else {
+        const float medicion = (m_modoControl == ControlFrecuencia) ?
+                    m_espectro.frecuencia() : m_espectro.amplitud();
+        salida = m_pid.actualizar(consigna, medicion, dt);
+
+        // Aprender la relacion entre la consigna y la velocidad cuando el
+        // lazo esta estable, asi los cambios de consigna son mas rapidos
+        if (qAbs(consigna - medicion) < 0.05f * consigna)
+            m_tiempoEstable += dt;
+        else
+            m_tiempoEstable = 0;
+
+        if (m_tiempoEstable >= TIEMPO_ESTABLE)
+            m_pid.ajustarPrealimentacion(consigna, 0.02f);
+    }
+
+    // Mandar la velocidad solo si cambio
+    if (qAbs(static_cast<qreal>(salida) - m_velocidad) >= 0.1) {
+        m_velocidad = static_cast<qreal>(salida);
+        solicitarEnvio();
+    }
+}
+
+/**
+ * Filtra el bloque de @a n @a muestras, calcula la magnitud de la
+ * aceleracion, la velocidad y la posicion de cada muestra y las agrega al
+ * bloque de lecturas por publicar. Los filtros y la magnitud se aplican a
+ * todo el bloque a la vez (ver CadenaFiltros), el resto del procesamiento
+ * es muestra por muestra.
+ */
+void Adquisicion::procesar(const Muestra* muestras, const int n) {
+    Q_ASSERT(muestras != Q_NULLPTR);
+    Q_ASSERT(n <= MAX_MUESTRAS);
+
+    if (n <= 0)
+        return;
+
+    // El MCU entiende comandos binarios si manda tramas binarias, a partir
+    // de entonces se le puede mandar el modo de telemetria
+    if (muestras[0].formato == Muestra::FormatoBinario && !m_comandosBinarios) {
+        m_comandosBinarios = true;
+        mandarModo();
+    }
+
+    // Ajustar la cadena de filtros a la frecuencia de las lecturas
+    medirFrecuencia(muestras, n);
+
+    // Separar los ejes de las muestras en arreglos contiguos
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            m_ejes[j][i] = muestras[i].accel[j];
+            m_ejes[j + 3][i] = muestras[i].gyro[j];
+        }
+    }
+
+    // Aplicar la cadena de filtros y obtener la distancia entre el origen
+    // y el punto tri-dimensional de cada lectura del acelerometro
+    float* ejes[CadenaFiltros::NUM_EJES];
+    for (int j = 0; j < CadenaFiltros::NUM_EJES; ++j)
+        ejes[j] = m_ejes[j];
+
+    m_filtros.procesar(ejes, n);
+    CadenaFiltros::magnitud(m_ejes[0], m_ejes[1], m_ejes[2], m_magnitud, n);
+
+    for (int i = 0; i < n; ++i) {
+        // Incrementar contador
+        ++m_numLecturas;
+
+        // Agregar lectura al bloque por publicar
+        Lectura* lectura = &m_lecturas[m_pendientes];
+        lectura->tiempo = m_numLecturas;
+        lectura->llegada = m_llegada;
+        lectura->valores[CanalAccelX] = m_ejes[0][i];
+        lectura->valores[CanalAccelY] = m_ejes[1][i];
+        lectura->valores[CanalAccelZ] = m_ejes[2][i];
+        lectura->valores[CanalAccelP] = m_magnitud[i];
+        lectura->valores[CanalGyroX] = m_ejes[3][i];
+        lectura->valores[CanalGyroY] = m_ejes[4][i];
+        lectura->valores[CanalGyroZ] = m_ejes[5][i];
+
+        // Estimar la velocidad y posicion del sensor, la cinematica usa
+        // las lecturas sin filtrar porque tiene sus propios filtros (un
+        // bloqueo de DC en la cadena eliminaria la gravedad)
+        m_cinematica.actualizar(muestras[i]);
+        const float* vel = m_cinematica.velocidad();
+        const float* pos = m_cinematica.posicion();
+        for (int j = 0; j < 3; ++j) {
+            lectura->valores[CanalVelX + j] = vel[j];
+            lectura->valores[CanalPosX + j] = pos[j];
+        }
+
+        // Actualizar el analisis espectral del canal seleccionado
+        if (m_espectro.agregar(lectura->valores[m_canalEspectro], m_cinematica.periodo()))
+            publicarEspectro();
+
+        // Actualizar el lazo de control
+        if (m_modoControl != ControlManual) {
+            m_tiempoControl += m_cinematica.periodo();
+            if (m_tiempoControl >= PERIODO_CONTROL) {
+                controlar(m_tiempoControl);
+                m_tiempoControl = 0;
+            }
+        }
+
+        // Publicar el bloque si ya esta lleno
+        if (++m_pendientes >= MAX_MUESTRAS)
+            publicar();
+    }
+}
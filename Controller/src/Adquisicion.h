@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ADQUISICION_H
+#define ADQUISICION_H
+
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QVariantList>
+#include <QAtomicInteger>
+
+#include "Muestra.h"
+#include "Grabador.h"
+#include "ColaSPSC.h"
+#include "Espectro.h"
+#include "Cinematica.h"
+#include "CadenaFiltros.h"
+#include "ControladorPid.h"
+#include "Decodificador.h"
+#include "Instrumentacion.h"
+
+class QTimer;
+class QIODevice;
+class Adquisicion : public QObject {
+    Q_OBJECT
+
+signals:
+    void conexionCambiada(const bool conectado);
+
+public:
+    enum ModoControl {
+        ControlManual,
+        ControlFrecuencia,
+        ControlAmplitud,
+    };
+
+    explicit Adquisicion(ColaSPSC<Lectura>* cola);
+    ~Adquisicion();
+
+    qint32 latencia() const;
+    quint64 lecturasPerdidas() const;
+    const Grabador& grabador() const;
+    const EtapasAdquisicion& etapas() const;
+    bool leerEspectro(Analisis* analisis, QVector<float>* magnitudes,
+                      quint32* version) const;
+    bool leerResumen(ResumenVentana* resumen, quint32* version) const;
+
+public slots:
+    bool conectar(const QString& puerto, const qint32 baudios = 1000000);
+    bool reproducir(const QString& ruta, const qreal velocidad);
+    void desconectar();
+    void habilitar(const bool habilitado);
+    void cambiarVelocidad(const qreal velocidad);
+    void cambiarCanalEspectro(const int canal);
+    void cambiarControl(const int modo, const qreal consigna);
+    void configurarPid(const qreal kp, const qreal ki, const qreal kd);
+    void configurarGrabacion(const int formatos,
+                             const int intervaloSincronizacion);
+    void recalibrar();
+    void cambiarTelemetria(const int modo, const int decimacion);
+    void configurarFiltros(const QVariantList& etapas);
+
+private slots:
+    void mandarDatos();
+    void mandarKeepalive();
+    void onDatosRecibidos();
+
+private:
+    bool abrir(QIODevice* dispositivo, const QString& nombre);
+    void leerAcks();
+    void mandarModo();
+    void medirFrecuencia(const Muestra* muestras, const int n);
+    void publicarResumen(const Protocolo::Resumen& resumen);
+    void solicitarEnvio();
+    void registrarEnvio(const quint16 secuencia);
+    void publicar();
+    void publicarEspectro();
+    void controlar(const float dt);
+    void procesar(const Muestra* muestras, const int n);
+
+private:
+    static const int MAX_MUESTRAS = 256;
+    static const int MAX_COMANDOS = 64;
+
+    bool m_habilitado;
+    qreal m_velocidad;
+    qreal m_velocidadManual;
+    quint64 m_numLecturas;
+
+    int m_modoControl;
+    qreal m_consigna;
+    float m_tiempoControl;
+    float m_tiempoEstable;
+    ControladorPid m_pid;
+
+    QTimer* m_temporizador;
+    QTimer* m_temporizadorComando;
+    QIODevice* m_puerto;
+
+    bool m_comandosBinarios;
+    int m_modoTelemetria;
+    int m_decimacion;
+    quint16 m_secuenciaComando;
+    qint64 m_ultimoEnvio;
+    QElapsedTimer m_reloj;
+    QAtomicInteger<qint32> m_latencia;
+    struct {
+        quint16 secuencia;
+        qint64 tiempo;
+    } m_envios[MAX_COMANDOS];
+
+    int m_formatosGrabacion;
+    int m_intervaloSincronizacion;
+    Grabador m_grabador;
+
+    qint64 m_llegada;
+    EtapasAdquisicion m_etapas;
+
+    char m_bloque[4096];
+    Muestra m_muestras[MAX_MUESTRAS];
+    Decodificador m_decodificador;
+    Cinematica m_cinematica;
+
+    CadenaFiltros m_filtros;
+    bool m_hayTiempoFiltros;
+    quint16 m_secuenciaFiltros;
+    quint32 m_tiempoFiltros;
+    float m_periodoFiltros;
+    int m_muestrasTexto;
+    qint64 m_inicioTexto;
+    float m_ejes[CadenaFiltros::NUM_EJES][MAX_MUESTRAS];
+    float m_magnitud[MAX_MUESTRAS];
+
+    int m_canalEspectro;
+    Espectro m_espectro;
+    mutable QMutex m_mutexEspectro;
+    Analisis m_analisis;
+    quint32 m_versionEspectro;
+    QVector<float> m_magnitudes;
+
+    mutable QMutex m_mutexResumen;
+    ResumenVentana m_resumen;
+    quint32 m_versionResumen;
+
+    int m_pendientes;
+    Lectura m_lecturas[MAX_MUESTRAS];
+    ColaSPSC<Lectura>* m_cola;
+    QAtomicInteger<quint64> m_lecturasPerdidas;
+};
+
+#endif
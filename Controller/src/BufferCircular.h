@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BUFFER_CIRCULAR_H
+#define BUFFER_CIRCULAR_H
+
+#include <QVector>
+
+//
+// Buffer circular de capacidad fija con una columna de tiempos y una
+// columna de valores por canal (estructura de arreglos).
+//
+// Cada valor se escribe dos veces (en la posicion i y en i + capacidad),
+// de esta manera las lecturas guardadas siempre forman un arreglo contiguo,
+// ordenado de la lectura mas vieja a la mas reciente, sin importar en que
+// posicion del buffer se encuentre la lectura mas vieja. Agregar una
+// lectura y eliminar la mas vieja son operaciones O(1).
+//
+template <int Canales>
+class BufferCircular {
+public:
+    explicit BufferCircular(const int capacidad = 0) :
+        m_cabeza(0),
+        m_cuenta(0),
+        m_capacidad(0) {
+        cambiarCapacidad(capacidad);
+    }
+
+    int capacidad() const {
+        return m_capacidad;
+    }
+
+    int count() const {
+        return m_cuenta;
+    }
+
+    bool isEmpty() const {
+        return m_cuenta == 0;
+    }
+
+    //
+    // Tiempos de las lecturas guardadas, de la mas vieja a la mas reciente
+    //
+    const qreal* tiempos() const {
+        return m_tiempos.constData() + inicio();
+    }
+
+    //
+    // Valores de las lecturas guardadas para el @a canal especificado, de
+    // la mas vieja a la mas reciente
+    //
+    const float* canal(const int canal) const {
+        Q_ASSERT(canal >= 0 && canal < Canales);
+        return m_valores[canal].constData() + inicio();
+    }
+
+    qreal ultimoTiempo() const {
+        Q_ASSERT(m_cuenta > 0);
+        return m_tiempos.at(ultimo());
+    }
+
+    float ultimoValor(const int canal) const {
+        Q_ASSERT(canal >= 0 && canal < Canales);
+        Q_ASSERT(m_cuenta > 0);
+        return m_valores[canal].at(ultimo());
+    }
+
+    void limpiar() {
+        m_cabeza = 0;
+        m_cuenta = 0;
+    }
+
+    //
+    // Agrega una lectura con el @a tiempo y los @a valores de cada canal,
+    // si el buffer esta lleno se elimina la lectura mas vieja
+    //
+    void agregar(const qreal tiempo, const float* valores) {
+        Q_ASSERT(valores != Q_NULLPTR);
+        Q_ASSERT(m_capacidad > 0);
+
+        const int espejo = m_cabeza + m_capacidad;
+
+        qreal* t = m_tiempos.data();
+        t[m_cabeza] = tiempo;
+        t[espejo] = tiempo;
+
+        for (int i = 0; i < Canales; ++i) {
+            float* v = m_valores[i].data();
+            v[m_cabeza] = valores[i];
+            v[espejo] = valores[i];
+        }
+
+        m_cabeza = (m_cabeza + 1) % m_capacidad;
+        if (m_cuenta < m_capacidad)
+            ++m_cuenta;
+    }
+
+    //
+    // Cambia la capacidad del buffer, conservando las lecturas mas recientes
+    //
+    void cambiarCapacidad(const int capacidad) {
+        Q_ASSERT(capacidad >= 0);
+
+        if (capacidad == m_capacidad)
+            return;
+
+        // Copiar las lecturas que caben en el nuevo buffer
+        const int cuenta = qMin(m_cuenta, capacidad);
+        const int desde = inicio() + m_cuenta - cuenta;
+
+        QVector<qreal> tiempos(capacidad * 2);
+        for (int j = 0; j < cuenta; ++j) {
+            tiempos[j] = m_tiempos.at(desde + j);
+            tiempos[j + capacidad] = tiempos[j];
+        }
+
+        m_tiempos.swap(tiempos);
+
+        for (int i = 0; i < Canales; ++i) {
+            QVector<float> valores(capacidad * 2);
+            for (int j = 0; j < cuenta; ++j) {
+                valores[j] = m_valores[i].at(desde + j);
+                valores[j + capacidad] = valores[j];
+            }
+
+            m_valores[i].swap(valores);
+        }
+
+        // Actualizar indices
+        m_cuenta = cuenta;
+        m_capacidad = capacidad;
+        m_cabeza = capacidad > 0 ? cuenta % capacidad : 0;
+    }
+
+private:
+    int inicio() const {
+        const int i = m_cabeza - m_cuenta;
+        return i < 0 ? i + m_capacidad : i;
+    }
+
+    int ultimo() const {
+        return m_cabeza > 0 ? m_cabeza - 1 : m_capacidad - 1;
+    }
+
+private:
+    int m_cabeza;
+    int m_cuenta;
+    int m_capacidad;
+
+    QVector<qreal> m_tiempos;
+    QVector<float> m_valores[Canales];
+};
+
+#endif
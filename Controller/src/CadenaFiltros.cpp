@@ -0,0 +1,515 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "CadenaFiltros.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#    include <immintrin.h>
+#    define FILTROS_AVX
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#    include <xmmintrin.h>
+#    define FILTROS_SSE
+#endif
+
+/**
+ * Valor de pi en precision doble
+ */
+static const double PI = 3.14159265358979323846;
+
+/**
+ * Factor de calidad de un filtro Butterworth de segundo orden, se usa
+ * cuando una etapa biquad no especifica su calidad
+ */
+static const double Q_BUTTERWORTH = 0.70710678118654752440;
+
+/**
+ * Nombres de los tipos de etapa que se usan en la configuracion que
+ * manda la interfaz grafica, en el orden de EtapaFiltro::Tipo
+ */
+static const char* const NOMBRES_TIPOS[] = {
+    "pasabajas",
+    "pasaaltas",
+    "notch",
+    "fir",
+    "mediana",
+    "dc",
+};
+
+/**
+ * Ordena el par @a a, @a b sin saltos condicionales
+ */
+static inline void ordenar(float& a, float& b) {
+    const float menor = qMin(a, b);
+    b = qMax(a, b);
+    a = menor;
+}
+
+#ifdef FILTROS_SSE
+static inline void ordenar(__m128& a, __m128& b) {
+    const __m128 menor = _mm_min_ps(a, b);
+    b = _mm_max_ps(a, b);
+    a = menor;
+}
+#endif
+
+/**
+ * Regresa la mediana de tres valores con una red de comparaciones, de
+ * modo que funciona igual con un valor que con un vector de valores
+ */
+template <typename T>
+static inline T mediana3(T a, T b, T c) {
+    ordenar(a, b);
+    ordenar(b, c);
+    ordenar(a, b);
+    return b;
+}
+
+/**
+ * Regresa la mediana de cinco valores con una red de siete comparaciones
+ */
+template <typename T>
+static inline T mediana5(T a, T b, T c, T d, T e) {
+    ordenar(a, b);
+    ordenar(d, e);
+    ordenar(a, d);
+    ordenar(b, e);
+    ordenar(b, c);
+    ordenar(c, d);
+    ordenar(b, c);
+    return c;
+}
+
+/**
+ * Calcula las @a n salidas de un FIR con los @a coeficientes de @a h.
+ * La @a entrada tiene las (coeficientes - 1) muestras anteriores seguidas
+ * de las @a n muestras del bloque. Los coeficientes son simetricos, por lo
+ * que no hace falta invertirlos.
+ */
+static void convolucionar(const float* __restrict entrada,
+                          const float* __restrict h,
+                          const int coeficientes,
+                          float* __restrict salida,
+                          const int n) {
+    int i = 0;
+
+#ifdef FILTROS_AVX
+    for (; i + 8 <= n; i += 8) {
+        __m256 suma = _mm256_setzero_ps();
+        for (int k = 0; k < coeficientes; ++k) {
+            const __m256 x = _mm256_loadu_ps(entrada + i + k);
+            suma = _mm256_add_ps(suma, _mm256_mul_ps(_mm256_set1_ps(h[k]), x));
+        }
+
+        _mm256_storeu_ps(salida + i, suma);
+    }
+#endif
+
+#ifdef FILTROS_SSE
+    for (; i + 4 <= n; i += 4) {
+        __m128 suma = _mm_setzero_ps();
+        for (int k = 0; k < coeficientes; ++k) {
+            const __m128 x = _mm_loadu_ps(entrada + i + k);
+            suma = _mm_add_ps(suma, _mm_mul_ps(_mm_set1_ps(h[k]), x));
+        }
+
+        _mm_storeu_ps(salida + i, suma);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        float suma = 0;
+        for (int k = 0; k < coeficientes; ++k)
+            suma += h[k] * entrada[i + k];
+
+        salida[i] = suma;
+    }
+}
+
+/**
+ * Calcula las @a n salidas de un filtro de mediana con una @a ventana de
+ * 3 o 5 muestras, la @a entrada tiene el mismo formato que en
+ * convolucionar()
+ */
+static void filtrarMediana(const float* __restrict entrada,
+                           const int ventana,
+                           float* __restrict salida,
+                           const int n) {
+    int i = 0;
+    const float* x = entrada;
+
+    if (ventana == 3) {
+#ifdef FILTROS_SSE
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(salida + i, mediana3(_mm_loadu_ps(x + i),
+                                               _mm_loadu_ps(x + i + 1),
+                                               _mm_loadu_ps(x + i + 2)));
+#endif
+
+        for (; i < n; ++i)
+            salida[i] = mediana3(x[i], x[i + 1], x[i + 2]);
+    }
+
+    else {
+#ifdef FILTROS_SSE
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(salida + i, mediana5(_mm_loadu_ps(x + i),
+                                               _mm_loadu_ps(x + i + 1),
+                                               _mm_loadu_ps(x + i + 2),
+                                               _mm_loadu_ps(x + i + 3),
+                                               _mm_loadu_ps(x + i + 4)));
+#endif
+
+        for (; i < n; ++i)
+            salida[i] = mediana5(x[i], x[i + 1], x[i + 2], x[i + 3], x[i + 4]);
+    }
+}
+
+/**
+ * Crea una cadena vacia, la cual no modifica las muestras
+ */
+CadenaFiltros::CadenaFiltros() {
+    m_numEtapas = 0;
+    m_frecuenciaMuestreo = 50;
+    memset(m_trabajo, 0, sizeof(m_trabajo));
+}
+
+/**
+ * Olvida el estado de todas las etapas, la siguiente muestra vuelve a
+ * inicializarlas
+ */
+void CadenaFiltros::reiniciar() {
+    for (int i = 0; i < m_numEtapas; ++i)
+        m_etapas[i].inicializada = false;
+}
+
+/**
+ * Remplaza las etapas de la cadena por las @a etapas especificadas, las
+ * cuales se aplican en orden. Solo se usan las primeras MAX_ETAPAS.
+ */
+void CadenaFiltros::configurar(const QVector<EtapaFiltro>& etapas) {
+    m_numEtapas = qMin(etapas.count(), static_cast<int>(MAX_ETAPAS));
+    for (int i = 0; i < m_numEtapas; ++i) {
+        m_etapas[i].config = etapas.at(i);
+        disenar(&m_etapas[i]);
+    }
+}
+
+/**
+ * Cambia la @a frecuencia (Hz) a la que llegan las muestras y vuelve a
+ * calcular los coeficientes de cada etapa si cambio
+ */
+void CadenaFiltros::cambiarFrecuenciaMuestreo(const float frecuencia) {
+    Q_ASSERT(frecuencia > 0);
+
+    if (qFuzzyCompare(frecuencia, m_frecuenciaMuestreo))
+        return;
+
+    m_frecuenciaMuestreo = frecuencia;
+    for (int i = 0; i < m_numEtapas; ++i)
+        disenar(&m_etapas[i]);
+}
+
+/**
+ * Regresa el numero de etapas de la cadena
+ */
+int CadenaFiltros::numEtapas() const {
+    return m_numEtapas;
+}
+
+/**
+ * Regresa la frecuencia de muestreo (Hz) con la que se calcularon los
+ * coeficientes de las etapas
+ */
+float CadenaFiltros::frecuenciaMuestreo() const {
+    return m_frecuenciaMuestreo;
+}
+
+/**
+ * Regresa la configuracion de las etapas de la cadena
+ */
+QVector<EtapaFiltro> CadenaFiltros::etapas() const {
+    QVector<EtapaFiltro> etapas(m_numEtapas);
+    for (int i = 0; i < m_numEtapas; ++i)
+        etapas[i] = m_etapas[i].config;
+
+    return etapas;
+}
+
+/**
+ * Filtra en su lugar las @a n muestras de cada eje, @a ejes tiene un
+ * arreglo por eje (acelerometro X, Y, Z y giroscopio X, Y, Z). Los bloques
+ * de mas de MAX_BLOQUE muestras se procesan por partes.
+ */
+void CadenaFiltros::procesar(float* const ejes[NUM_EJES], const int n) {
+    Q_ASSERT(ejes != Q_NULLPTR);
+
+    for (int inicio = 0; inicio < n; inicio += MAX_BLOQUE) {
+        const int m = qMin(n - inicio, static_cast<int>(MAX_BLOQUE));
+
+        float* bloque[NUM_EJES];
+        for (int e = 0; e < NUM_EJES; ++e)
+            bloque[e] = ejes[e] + inicio;
+
+        for (int i = 0; i < m_numEtapas; ++i) {
+            Etapa* etapa = &m_etapas[i];
+            if (!etapa->inicializada)
+                inicializar(etapa, bloque);
+
+            procesarBloque(etapa, bloque, m);
+        }
+    }
+}
+
+/**
+ * Escribe en @a salida la magnitud del vector (@a x, @a y, @a z) de cada
+ * una de las @a n muestras
+ */
+void CadenaFiltros::magnitud(const float* x, const float* y, const float* z,
+                             float* salida, const int n) {
+    int i = 0;
+
+#ifdef FILTROS_SSE
+    for (; i + 4 <= n; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 vy = _mm_loadu_ps(y + i);
+        const __m128 vz = _mm_loadu_ps(z + i);
+        const __m128 suma = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx),
+                                                  _mm_mul_ps(vy, vy)),
+                                       _mm_mul_ps(vz, vz));
+        _mm_storeu_ps(salida + i, _mm_sqrt_ps(suma));
+    }
+#endif
+
+    for (; i < n; ++i)
+        salida[i] = sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+}
+
+/**
+ * Interpreta la configuracion de la cadena que manda la interfaz grafica:
+ * una @a lista de mapas con el "tipo" de cada etapa ("pasabajas",
+ * "pasaaltas", "notch", "fir", "mediana" o "dc"), su "frecuencia" en Hz,
+ * su calidad "q" y su "orden". Solo el tipo es obligatorio.
+ *
+ * @return @a false si alguna etapa no es valida o hay demasiadas etapas
+ */
+bool CadenaFiltros::leerEtapas(const QVariantList& lista,
+                               QVector<EtapaFiltro>* etapas) {
+    Q_ASSERT(etapas != Q_NULLPTR);
+
+    etapas->clear();
+    if (lista.count() > MAX_ETAPAS)
+        return false;
+
+    foreach (QVariant elemento, lista) {
+        const QVariantMap mapa = elemento.toMap();
+        const QString tipo = mapa.value("tipo").toString();
+
+        EtapaFiltro etapa;
+        etapa.tipo = -1;
+        for (int i = 0; i <= EtapaFiltro::BloqueoDc; ++i)
+            if (tipo == QLatin1String(NOMBRES_TIPOS[i]))
+                etapa.tipo = i;
+
+        if (etapa.tipo < 0)
+            return false;
+
+        const bool notch = etapa.tipo == EtapaFiltro::Notch;
+        const bool dc = etapa.tipo == EtapaFiltro::BloqueoDc;
+        etapa.frecuencia = mapa.value("frecuencia", dc ? 0.5 : 20).toFloat();
+        etapa.calidad = mapa.value("q", notch ? 10 : Q_BUTTERWORTH).toFloat();
+        etapa.orden = mapa.value("orden", etapa.tipo == EtapaFiltro::Mediana ? 5 : 31).toInt();
+        if (etapa.frecuencia <= 0 || etapa.calidad <= 0)
+            return false;
+
+        etapas->append(etapa);
+    }
+
+    return true;
+}
+
+/**
+ * Calcula los coeficientes de la @a etapa para la frecuencia de muestreo
+ * actual. Los filtros biquad usan las formulas de R. Bristow-Johnson, el
+ * FIR es un pasa-bajas de fase lineal (sinc con ventana de Hamming) y el
+ * bloqueo de DC es y[n] = x[n] - x[n-1] + R y[n-1]. La frecuencia se
+ * limita a 0.45 veces la frecuencia de muestreo.
+ */
+void CadenaFiltros::disenar(Etapa* etapa) {
+    Q_ASSERT(etapa != Q_NULLPTR);
+
+    const EtapaFiltro& config = etapa->config;
+    const double fs = static_cast<double>(m_frecuenciaMuestreo);
+    const double f = qBound(1e-3 * fs, static_cast<double>(config.frecuencia), 0.45 * fs);
+    const double w0 = 2 * PI * f / fs;
+    const double alfa = sin(w0) / (2 * static_cast<double>(config.calidad));
+    const double coseno = cos(w0);
+
+    double b0 = 1, b1 = 0, b2 = 0;
+    double a0 = 1, a1 = 0, a2 = 0;
+    etapa->coeficientes = 0;
+
+    switch (config.tipo) {
+    case EtapaFiltro::PasaBajas:
+        b0 = (1 - coseno) / 2;
+        b1 = 1 - coseno;
+        b2 = (1 - coseno) / 2;
+        a0 = 1 + alfa;
+        a1 = -2 * coseno;
+        a2 = 1 - alfa;
+        break;
+    case EtapaFiltro::PasaAltas:
+        b0 = (1 + coseno) / 2;
+        b1 = -(1 + coseno);
+        b2 = (1 + coseno) / 2;
+        a0 = 1 + alfa;
+        a1 = -2 * coseno;
+        a2 = 1 - alfa;
+        break;
+    case EtapaFiltro::Notch:
+        b1 = -2 * coseno;
+        b2 = 1;
+        a0 = 1 + alfa;
+        a1 = -2 * coseno;
+        a2 = 1 - alfa;
+        break;
+    case EtapaFiltro::BloqueoDc:
+        b1 = -1;
+        a1 = -exp(-w0);
+        break;
+    case EtapaFiltro::Fir: {
+        // Numero impar de coeficientes para que el retraso sea entero
+        const int taps = qBound(3, config.orden | 1, static_cast<int>(MAX_COEFICIENTES));
+        const double fc = f / fs;
+        const double centro = (taps - 1) / 2.0;
+
+        double suma = 0;
+        double h[MAX_COEFICIENTES];
+        for (int k = 0; k < taps; ++k) {
+            const double m = k - centro;
+            const double sinc = (k == taps / 2) ? 2 * fc : sin(2 * PI * fc * m) / (PI * m);
+            h[k] = sinc * (0.54 - 0.46 * cos(2 * PI * k / (taps - 1)));
+            suma += h[k];
+        }
+
+        // Ganancia unitaria en DC
+        for (int k = 0; k < taps; ++k)
+            etapa->h[k] = static_cast<float>(h[k] / suma);
+
+        etapa->coeficientes = taps;
+        break;
+    }
+    case EtapaFiltro::Mediana:
+        etapa->coeficientes = config.orden <= 3 ? 3 : 5;
+        break;
+    }
+
+    etapa->b0 = static_cast<float>(b0 / a0);
+    etapa->b1 = static_cast<float>(b1 / a0);
+    etapa->b2 = static_cast<float>(b2 / a0);
+    etapa->a1 = static_cast<float>(a1 / a0);
+    etapa->a2 = static_cast<float>(a2 / a0);
+    etapa->inicializada = false;
+}
+
+/**
+ * Inicializa el estado de la @a etapa como si la primera muestra de cada
+ * eje se hubiera repetido desde siempre, es decir, con la salida en estado
+ * estable
+ */
+void CadenaFiltros::inicializar(Etapa* etapa, float* const ejes[NUM_EJES]) {
+    Q_ASSERT(etapa != Q_NULLPTR);
+
+    for (int e = 0; e < NUM_EJES; ++e) {
+        const float x = ejes[e][0];
+
+        // Estado del FIR y la mediana: muestras anteriores
+        for (int k = 0; k < etapa->coeficientes - 1; ++k)
+            etapa->historia[e][k] = x;
+
+        // Estado de los biquad (forma directa II transpuesta) con la
+        // salida igual a la ganancia en DC por la entrada
+        const float ganancia = (etapa->b0 + etapa->b1 + etapa->b2) /
+                (1 + etapa->a1 + etapa->a2);
+        const float y = ganancia * x;
+        etapa->z1[e] = y - etapa->b0 * x;
+        etapa->z2[e] = etapa->b2 * x - etapa->a2 * y;
+    }
+
+    etapa->inicializada = true;
+}
+
+/**
+ * Aplica la @a etapa a las @a n muestras de cada eje
+ */
+void CadenaFiltros::procesarBloque(Etapa* etapa, float* const ejes[NUM_EJES],
+                                   const int n) {
+    Q_ASSERT(etapa != Q_NULLPTR);
+    Q_ASSERT(n <= MAX_BLOQUE);
+
+    // FIR y mediana: se copian las muestras anteriores y el bloque a un
+    // arreglo contiguo para que los nucleos no tengan casos especiales
+    if (etapa->coeficientes > 0) {
+        const int anteriores = etapa->coeficientes - 1;
+        const size_t bytesAnteriores = static_cast<size_t>(anteriores) * sizeof(float);
+
+        for (int e = 0; e < NUM_EJES; ++e) {
+            float* x = ejes[e];
+            memcpy(m_trabajo, etapa->historia[e], bytesAnteriores);
+            memcpy(m_trabajo + anteriores, x, static_cast<size_t>(n) * sizeof(float));
+            memcpy(etapa->historia[e], m_trabajo + n, bytesAnteriores);
+
+            if (etapa->config.tipo == EtapaFiltro::Fir)
+                convolucionar(m_trabajo, etapa->h, etapa->coeficientes, x, n);
+            else
+                filtrarMediana(m_trabajo, etapa->coeficientes, x, n);
+        }
+
+        return;
+    }
+
+    // Biquad en forma directa II transpuesta
+    const float b0 = etapa->b0;
+    const float b1 = etapa->b1;
+    const float b2 = etapa->b2;
+    const float a1 = etapa->a1;
+    const float a2 = etapa->a2;
+    for (int e = 0; e < NUM_EJES; ++e) {
+        float* x = ejes[e];
+        float z1 = etapa->z1[e];
+        float z2 = etapa->z2[e];
+        for (int i = 0; i < n; ++i) {
+            const float entrada = x[i];
+            const float salida = b0 * entrada + z1;
+            z1 = b1 * entrada - a1 * salida + z2;
+            z2 = b2 * entrada - a2 * salida;
+            x[i] = salida;
+        }
+
+        etapa->z1[e] = z1;
+        etapa->z2[e] = z2;
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CADENA_FILTROS_H
+#define CADENA_FILTROS_H
+
+#include <QVector>
+#include <QVariantList>
+
+//
+// Configuracion de una etapa de la cadena de filtros. La frecuencia (Hz)
+// es la de corte de los filtros pasa-bajas, pasa-altas, FIR y de bloqueo
+// de DC, o la del centro del notch. La calidad es el factor Q de los
+// filtros biquad y el orden es el numero de coeficientes del FIR o el
+// tamano de la ventana de la mediana.
+//
+struct EtapaFiltro {
+    enum Tipo {
+        PasaBajas,
+        PasaAltas,
+        Notch,
+        Fir,
+        Mediana,
+        BloqueoDc,
+    };
+
+    int tipo;
+    float frecuencia;
+    float calidad;
+    int orden;
+};
+
+//
+// Cadena configurable de filtros que se aplica a los ejes del acelerometro
+// y giroscopio antes de graficar, grabar y analizar las lecturas.
+//
+// Las muestras se procesan en bloques: cada eje es un arreglo contiguo
+// (estructura de arreglos) y cada etapa recorre el bloque completo de un
+// eje antes de pasar al siguiente. El FIR, la mediana y la magnitud no
+// dependen de la salida anterior, por lo que sus nucleos procesan varias
+// muestras a la vez con SSE/AVX cuando el compilador los habilita (o se
+// vectorizan automaticamente en otras arquitecturas). Los filtros biquad
+// (pasa-bajas, pasa-altas, notch y bloqueo de DC) son recursivos y se
+// calculan muestra por muestra, con los coeficientes y el estado de cada
+// eje en registros durante todo el bloque.
+//
+// El estado de cada etapa se inicializa con la primera muestra que recibe,
+// como si la señal hubiera sido constante hasta entonces, para evitar el
+// transitorio que causaria la gravedad en los ejes del acelerometro.
+//
+class CadenaFiltros {
+public:
+    static const int NUM_EJES = 6;
+    static const int MAX_ETAPAS = 8;
+    static const int MAX_BLOQUE = 256;
+    static const int MAX_COEFICIENTES = 63;
+
+    CadenaFiltros();
+
+    void reiniciar();
+    void configurar(const QVector<EtapaFiltro>& etapas);
+    void cambiarFrecuenciaMuestreo(const float frecuencia);
+
+    int numEtapas() const;
+    float frecuenciaMuestreo() const;
+    QVector<EtapaFiltro> etapas() const;
+
+    void procesar(float* const ejes[NUM_EJES], const int n);
+
+    static void magnitud(const float* x, const float* y, const float* z,
+                         float* salida, const int n);
+    static bool leerEtapas(const QVariantList& lista,
+                           QVector<EtapaFiltro>* etapas);
+
+private:
+    struct Etapa {
+        EtapaFiltro config;
+        bool inicializada;
+
+        float b0, b1, b2;
+        float a1, a2;
+        float z1[NUM_EJES];
+        float z2[NUM_EJES];
+
+        int coeficientes;
+        float h[MAX_COEFICIENTES];
+        float historia[NUM_EJES][MAX_COEFICIENTES];
+    };
+
+    void disenar(Etapa* etapa);
+    void inicializar(Etapa* etapa, float* const ejes[NUM_EJES]);
+    void procesarBloque(Etapa* etapa, float* const ejes[NUM_EJES],
+                        const int n);
+
+private:
+    float m_frecuenciaMuestreo;
+
+    int m_numEtapas;
+    Etapa m_etapas[MAX_ETAPAS];
+
+    float m_trabajo[MAX_COEFICIENTES + MAX_BLOQUE];
+};
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Cinematica.h"
+
+#include <math.h>
+
+/**
+ * Aceleracion de la gravedad en m/s^2
+ */
+static const float GRAVEDAD = 9.80665f;
+
+/**
+ * Factor para convertir grados a radianes
+ */
+static const float GRADOS_A_RADIANES = 3.14159265f / 180.0f;
+
+/**
+ * Calcula la norma de un vector de tres elementos
+ */
+static inline float Norma(const float* v) {
+    return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+/**
+ * Inicializa los parametros de los filtros con valores adecuados para
+ * las frecuencias de oscilacion del GMAS (entre 0.5 y 10 Hz)
+ */
+Cinematica::Cinematica() {
+    m_ganancia = 0.5f;
+    m_periodoNominal = 0.02f;
+    m_frecuenciaCorte = 0.1f;
+
+    m_umbralAccel = 0.25f;
+    m_umbralGyro = 3.0f;
+    m_tiempoReposo = 0.25f;
+
+    reiniciar();
+}
+
+/**
+ * Olvida la orientacion y reinicia la velocidad y posicion a cero, la
+ * siguiente muestra se usa para estimar la orientacion inicial
+ */
+void Cinematica::reiniciar() {
+    m_inicializado = false;
+    m_tiempoAnterior = 0;
+    m_periodo = m_periodoNominal;
+    m_tiempoQuieto = 0;
+
+    m_q[0] = 1;
+    m_q[1] = 0;
+    m_q[2] = 0;
+    m_q[3] = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        m_posicion[i] = 0;
+        m_velocidad[i] = 0;
+        m_aceleracion[i] = 0;
+        m_linealAnterior[i] = 0;
+        m_aceleracionAnterior[i] = 0;
+    }
+}
+
+/**
+ * Actualiza la orientacion, aceleracion, velocidad y posicion con la
+ * siguiente @a muestra. Si la muestra no incluye el tiempo del MCU (formato
+ * de texto) se usa el periodo nominal de muestreo.
+ */
+void Cinematica::actualizar(const Muestra& muestra) {
+    // Calcular tiempo transcurrido desde la muestra anterior
+    float dt = m_periodoNominal;
+    if (m_inicializado && muestra.formato == Muestra::FormatoBinario) {
+        const quint32 delta = muestra.tiempo - m_tiempoAnterior;
+        const float segundos = static_cast<float>(delta) * 1e-6f;
+        if (segundos > 0 && segundos < 0.5f)
+            dt = segundos;
+    }
+
+    m_tiempoAnterior = muestra.tiempo;
+    m_periodo = dt;
+
+    // La primera muestra solo sirve para obtener la orientacion inicial
+    if (!m_inicializado) {
+        inicializarOrientacion(muestra.accel);
+        m_inicializado = true;
+        return;
+    }
+
+    // Actualizar orientacion
+    const float gyro[3] = {
+        muestra.gyro[0] * GRADOS_A_RADIANES,
+        muestra.gyro[1] * GRADOS_A_RADIANES,
+        muestra.gyro[2] * GRADOS_A_RADIANES
+    };
+
+    actualizarOrientacion(muestra.accel, gyro, dt);
+
+    // Rotar la aceleracion al marco del laboratorio y restar la gravedad
+    const float w = m_q[0], x = m_q[1], y = m_q[2], z = m_q[3];
+    const float* a = muestra.accel;
+    float lineal[3];
+    lineal[0] = (1 - 2 * (y * y + z * z)) * a[0]
+                + 2 * (x * y - w * z) * a[1]
+                + 2 * (x * z + w * y) * a[2];
+    lineal[1] = 2 * (x * y + w * z) * a[0]
+                + (1 - 2 * (x * x + z * z)) * a[1]
+                + 2 * (y * z - w * x) * a[2];
+    lineal[2] = 2 * (x * z - w * y) * a[0]
+                + 2 * (y * z + w * x) * a[1]
+                + (1 - 2 * (x * x + y * y)) * a[2]
+                - GRAVEDAD;
+
+    // Detectar si el sensor esta en reposo
+    const float errorGravedad = fabsf(Norma(a) - GRAVEDAD);
+    if (errorGravedad < m_umbralAccel && Norma(muestra.gyro) < m_umbralGyro)
+        m_tiempoQuieto += dt;
+    else
+        m_tiempoQuieto = 0;
+
+    // Coeficiente del filtro pasa-altas para el periodo actual
+    const float alfa = 1.0f / (1.0f + 2.0f * 3.14159265f * m_frecuenciaCorte * dt);
+
+    // Eliminar el componente de DC de la aceleracion e integrar
+    for (int i = 0; i < 3; ++i) {
+        m_aceleracion[i] = alfa * (m_aceleracion[i] + lineal[i] - m_linealAnterior[i]);
+        m_linealAnterior[i] = lineal[i];
+
+        float v = alfa * (m_velocidad[i] + 0.5f * (m_aceleracionAnterior[i] + m_aceleracion[i]) * dt);
+        if (enReposo())
+            v = 0;
+
+        m_posicion[i] = alfa * (m_posicion[i] + 0.5f * (m_velocidad[i] + v) * dt);
+        m_aceleracionAnterior[i] = m_aceleracion[i];
+        m_velocidad[i] = v;
+    }
+}
+
+/**
+ * Regresa @a true si el sensor ha estado quieto el tiempo suficiente para
+ * considerar que su velocidad es cero
+ */
+bool Cinematica::enReposo() const {
+    return m_tiempoQuieto >= m_tiempoReposo;
+}
+
+/**
+ * Regresa el tiempo (en segundos) entre las dos ultimas muestras
+ */
+float Cinematica::periodo() const {
+    return m_periodo;
+}
+
+/**
+ * Regresa la posicion [x,y,z] en metros, relativa a la posicion promedio
+ */
+const float* Cinematica::posicion() const {
+    return m_posicion;
+}
+
+/**
+ * Regresa la velocidad [x,y,z] en m/s
+ */
+const float* Cinematica::velocidad() const {
+    return m_velocidad;
+}
+
+/**
+ * Regresa la aceleracion lineal [x,y,z] en m/s^2 (sin gravedad), en el
+ * marco de referencia del laboratorio
+ */
+const float* Cinematica::aceleracion() const {
+    return m_aceleracion;
+}
+
+/**
+ * Cambia la ganancia con la que el acelerometro corrige la inclinacion
+ * estimada por el giroscopio
+ */
+void Cinematica::cambiarGanancia(const float ganancia) {
+    m_ganancia = ganancia;
+}
+
+/**
+ * Cambia el periodo de muestreo (en segundos) que se usa cuando las
+ * muestras no incluyen el tiempo del MCU
+ */
+void Cinematica::cambiarPeriodoNominal(const float periodo) {
+    Q_ASSERT(periodo > 0);
+    m_periodoNominal = periodo;
+}
+
+/**
+ * Cambia la frecuencia de corte (en Hz) de los filtros pasa-altas, debe
+ * ser menor a la frecuencia de oscilacion que se quiere medir
+ */
+void Cinematica::cambiarFrecuenciaCorte(const float frecuencia) {
+    Q_ASSERT(frecuencia > 0);
+    m_frecuenciaCorte = frecuencia;
+}
+
+/**
+ * Cambia los umbrales para detectar que el sensor esta en reposo: error
+ * maximo en la magnitud de la gravedad (m/s^2), velocidad angular maxima
+ * (grados/s) y tiempo minimo (s)
+ */
+void Cinematica::cambiarUmbralesReposo(const float accel, const float gyro,
+                                       const float tiempo) {
+    m_umbralAccel = accel;
+    m_umbralGyro = gyro;
+    m_tiempoReposo = tiempo;
+}
+
+/**
+ * Calcula la orientacion que alinea la aceleracion medida en reposo con
+ * el eje Z del laboratorio
+ */
+void Cinematica::inicializarOrientacion(const float* accel) {
+    const float norma = Norma(accel);
+    if (norma <= 0)
+        return;
+
+    // Cuaternion que rota el vector a = accel / |accel| hacia (0, 0, 1)
+    const float ax = accel[0] / norma;
+    const float ay = accel[1] / norma;
+    const float az = accel[2] / norma;
+
+    // El sensor esta de cabeza, rotar 180 grados sobre X
+    if (az < -0.9999f) {
+        m_q[0] = 0;
+        m_q[1] = 1;
+        m_q[2] = 0;
+        m_q[3] = 0;
+        return;
+    }
+
+    m_q[0] = 1 + az;
+    m_q[1] = ay;
+    m_q[2] = -ax;
+    m_q[3] = 0;
+
+    const float n = Norma(m_q + 1) * Norma(m_q + 1) + m_q[0] * m_q[0];
+    const float k = 1.0f / sqrtf(n);
+    for (int i = 0; i < 4; ++i)
+        m_q[i] *= k;
+}
+
+/**
+ * Integra la velocidad angular del @a gyro (rad/s) durante @a dt segundos
+ * y corrige la inclinacion con la direccion de la gravedad medida por el
+ * @a accel, siempre y cuando la magnitud de la aceleracion sea cercana a
+ * la gravedad
+ */
+void Cinematica::actualizarOrientacion(const float* accel, const float* gyro,
+                                       const float dt) {
+    float gx = gyro[0];
+    float gy = gyro[1];
+    float gz = gyro[2];
+
+    float q0 = m_q[0], q1 = m_q[1], q2 = m_q[2], q3 = m_q[3];
+
+    // Corregir con el acelerometro
+    const float norma = Norma(accel);
+    if (norma > 0.5f * GRAVEDAD && norma < 1.5f * GRAVEDAD) {
+        const float ax = accel[0] / norma;
+        const float ay = accel[1] / norma;
+        const float az = accel[2] / norma;
+
+        // Direccion estimada de la gravedad en el marco del sensor
+        const float vx = 2 * (q1 * q3 - q0 * q2);
+        const float vy = 2 * (q0 * q1 + q2 * q3);
+        const float vz = q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3;
+
+        // El error es el producto cruz entre la direccion medida y estimada
+        gx += m_ganancia * (ay * vz - az * vy);
+        gy += m_ganancia * (az * vx - ax * vz);
+        gz += m_ganancia * (ax * vy - ay * vx);
+    }
+
+    // Integrar la derivada del cuaternion
+    const float h = 0.5f * dt;
+    m_q[0] = q0 + (-q1 * gx - q2 * gy - q3 * gz) * h;
+    m_q[1] = q1 + (q0 * gx + q2 * gz - q3 * gy) * h;
+    m_q[2] = q2 + (q0 * gy - q1 * gz + q3 * gx) * h;
+    m_q[3] = q3 + (q0 * gz + q1 * gy - q2 * gx) * h;
+
+    // Normalizar
+    const float n = m_q[0] * m_q[0] + m_q[1] * m_q[1]
+                    + m_q[2] * m_q[2] + m_q[3] * m_q[3];
+    const float k = 1.0f / sqrtf(n);
+    for (int i = 0; i < 4; ++i)
+        m_q[i] *= k;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CINEMATICA_H
+#define CINEMATICA_H
+
+#include "Muestra.h"
+
+//
+// Calcula la orientacion, velocidad y posicion del sensor a partir de las
+// lecturas del acelerometro y giroscopio.
+//
+// La orientacion se obtiene con un filtro complementario (Mahony) que
+// integra el giroscopio y corrige la inclinacion con la direccion de la
+// gravedad medida por el acelerometro. La aceleracion se rota al marco
+// de referencia del laboratorio, se le resta la gravedad y se integra dos
+// veces con la regla del trapecio. Cada etapa pasa por un filtro pasa-altas
+// de primer orden para eliminar el error que se acumula al integrar, y la
+// velocidad se reinicia cuando el sensor esta en reposo. Cada muestra se
+// procesa en O(1).
+//
+class Cinematica {
+public:
+    Cinematica();
+
+    void reiniciar();
+    void actualizar(const Muestra& muestra);
+
+    bool enReposo() const;
+    float periodo() const;
+    const float* posicion() const;
+    const float* velocidad() const;
+    const float* aceleracion() const;
+
+    void cambiarGanancia(const float ganancia);
+    void cambiarPeriodoNominal(const float periodo);
+    void cambiarFrecuenciaCorte(const float frecuencia);
+    void cambiarUmbralesReposo(const float accel, const float gyro,
+                               const float tiempo);
+
+private:
+    void inicializarOrientacion(const float* accel);
+    void actualizarOrientacion(const float* accel, const float* gyro,
+                               const float dt);
+
+private:
+    bool m_inicializado;
+    quint32 m_tiempoAnterior;
+    float m_periodo;
+
+    float m_ganancia;
+    float m_periodoNominal;
+    float m_frecuenciaCorte;
+
+    float m_umbralAccel;
+    float m_umbralGyro;
+    float m_tiempoReposo;
+    float m_tiempoQuieto;
+
+    float m_q[4];
+    float m_aceleracion[3];
+    float m_velocidad[3];
+    float m_posicion[3];
+
+    float m_linealAnterior[3];
+    float m_aceleracionAnterior[3];
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef COLA_SPSC_H
+#define COLA_SPSC_H
+
+#include <QVector>
+#include <QAtomicInteger>
+
+//
+// Cola circular sin bloqueos para un solo productor y un solo consumidor.
+//
+// El productor y el consumidor pueden estar en hilos diferentes, cada uno
+// es el unico que modifica su indice. Los elementos se escriben y se leen
+// en bloques, de manera que cada bloque se publica con una sola operacion
+// atomica.
+//
+template <typename T>
+class ColaSPSC {
+public:
+    explicit ColaSPSC(const int capacidad) :
+        m_escritura(0),
+        m_lectura(0) {
+        // Redondear la capacidad a una potencia de 2
+        int tamano = 1;
+        while (tamano < capacidad)
+            tamano *= 2;
+
+        m_datos.resize(tamano);
+        m_mascara = static_cast<quint32>(tamano - 1);
+    }
+
+    int capacidad() const {
+        return m_datos.count();
+    }
+
+    //
+    // Numero de elementos pendientes por leer (aproximado si se llama
+    // mientras el otro hilo modifica la cola)
+    //
+    int count() const {
+        return static_cast<int>(m_escritura.loadAcquire() - m_lectura.loadAcquire());
+    }
+
+    //
+    // Escribe hasta @a n elementos (solo debe llamarse desde el productor),
+    // regresa el numero de elementos que se escribieron
+    //
+    int escribir(const T* datos, const int n) {
+        const quint32 escritura = m_escritura.load();
+        const quint32 libres = static_cast<quint32>(capacidad())
+                               - (escritura - m_lectura.loadAcquire());
+        const quint32 total = qMin(static_cast<quint32>(n), libres);
+
+        T* destino = m_datos.data();
+        for (quint32 i = 0; i < total; ++i)
+            destino[(escritura + i) & m_mascara] = datos[i];
+
+        m_escritura.storeRelease(escritura + total);
+        return static_cast<int>(total);
+    }
+
+    //
+    // Lee hasta @a n elementos (solo debe llamarse desde el consumidor),
+    // regresa el numero de elementos que se leyeron
+    //
+    int leer(T* datos, const int n) {
+        const quint32 lectura = m_lectura.load();
+        const quint32 pendientes = m_escritura.loadAcquire() - lectura;
+        const quint32 total = qMin(static_cast<quint32>(n), pendientes);
+
+        const T* origen = m_datos.constData();
+        for (quint32 i = 0; i < total; ++i)
+            datos[i] = origen[(lectura + i) & m_mascara];
+
+        m_lectura.storeRelease(lectura + total);
+        return static_cast<int>(total);
+    }
+
+private:
+    Q_DISABLE_COPY(ColaSPSC)
+
+    QVector<T> m_datos;
+    quint32 m_mascara;
+
+    alignas(64) QAtomicInteger<quint32> m_escritura;
+    alignas(64) QAtomicInteger<quint32> m_lectura;
+};
+
+#endif
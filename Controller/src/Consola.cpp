@@ -0,0 +1,547 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Consola.h"
+#include "Adquisicion.h"
+#include "Diagnostico.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+/**
+ * Velocidad maxima del motor (en %), igual que en la interfaz grafica
+ */
+static const qreal VELOCIDAD_MAXIMA = 97;
+
+/**
+ * Periodo (ms) con el que se vacia la cola de lecturas y se revisa el
+ * perfil de velocidad y la duracion
+ */
+static const int INTERVALO_REVISION = 50;
+
+/**
+ * Se activa cuando el usuario interrumpe el programa (Ctrl+C) o el
+ * sistema lo termina, las lecturas pendientes se escriben antes de salir
+ */
+static volatile sig_atomic_t INTERRUMPIDO = 0;
+
+static void interrumpir(int senal) {
+    Q_UNUSED(senal);
+    INTERRUMPIDO = 1;
+}
+
+/**
+ * Crea la adquisicion y el resumen de la ruta de datos, la adquisicion se
+ * mueve a su hilo en @c ejecutar() despues de configurarla
+ */
+Consola::Consola(QObject* parent) : QObject(parent), m_cola(16384) {
+    m_paso = 0;
+    m_codigo = SalidaExito;
+    m_terminado = false;
+    m_duracion = 0;
+    m_muestras = 0;
+
+    m_adquisicion = new Adquisicion(&m_cola);
+    connect(m_adquisicion, &Adquisicion::conexionCambiada,
+            this,          &Consola::onConexionCambiada);
+
+    m_diagnostico = new Diagnostico(m_adquisicion, &m_cola, this);
+    connect(m_diagnostico, &Diagnostico::actualizado,
+            this,          &Consola::imprimirResumen);
+
+    m_temporizador.setInterval(INTERVALO_REVISION);
+    connect(&m_temporizador, &QTimer::timeout,
+            this,            &Consola::revisar);
+}
+
+/**
+ * Cierra la conexion y detiene el hilo de adquisicion
+ */
+Consola::~Consola() {
+    if (m_hilo.isRunning()) {
+        QMetaObject::invokeMethod(m_adquisicion, "desconectar",
+                                  Qt::BlockingQueuedConnection);
+        m_hilo.quit();
+        m_hilo.wait();
+    }
+
+    delete m_diagnostico;
+    delete m_adquisicion;
+}
+
+/**
+ * Regresa @a true si los argumentos del programa piden el modo sin
+ * interfaz grafica. Se revisa antes de crear la aplicacion porque el modo
+ * sin interfaz usa un @c QCoreApplication.
+ */
+bool Consola::solicitada(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sin-interfaz") == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Lee los argumentos de la @a app, abre el dispositivo y ejecuta el ciclo
+ * de eventos hasta que termina la adquisicion.
+ *
+ * @return el codigo de salida del programa (ver Salida)
+ */
+int Consola::ejecutar(QCoreApplication& app) {
+    // Definir argumentos
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Adquisicion del GMAS sin interfaz grafica");
+    const QCommandLineOption ayuda = parser.addHelpOption();
+    const QCommandLineOption version = parser.addVersionOption();
+    parser.addOption(QCommandLineOption("sin-interfaz",
+                                        "Ejecutar sin interfaz grafica"));
+    parser.addOption(QCommandLineOption(QStringList() << "p" << "puerto",
+                                        "Puerto serial del GMAS", "puerto"));
+    parser.addOption(QCommandLineOption(QStringList() << "r" << "reproducir",
+                                        "Reproducir un archivo de lecturas en vez de abrir un puerto",
+                                        "archivo"));
+    parser.addOption(QCommandLineOption("rapidez",
+                                        "Rapidez de la reproduccion (1 = tiempo real, 0 = maxima)",
+                                        "factor", "1"));
+    parser.addOption(QCommandLineOption(QStringList() << "b" << "baudios",
+                                        "Velocidad del puerto serial",
+                                        "baudios", "1000000"));
+    parser.addOption(QCommandLineOption(QStringList() << "v" << "velocidad",
+                                        "Perfil de velocidad del motor (%): un valor fijo o pasos "
+                                        "segundos:velocidad separados por comas, p. ej. 0:20,600:40,1200:0",
+                                        "perfil", "0"));
+    parser.addOption(QCommandLineOption(QStringList() << "t" << "duracion",
+                                        "Duracion de la adquisicion en segundos (0 = hasta que el "
+                                        "dispositivo se desconecte)",
+                                        "segundos", "0"));
+    parser.addOption(QCommandLineOption(QStringList() << "f" << "formato",
+                                        "Formato de los archivos de lecturas: csv, binario o ambos",
+                                        "formato", "csv"));
+    parser.addOption(QCommandLineOption(QStringList() << "s" << "sincronizar",
+                                        "Cada cuantos ms se sincronizan los archivos con el disco "
+                                        "(0 = el sistema operativo decide)",
+                                        "ms", "0"));
+    parser.addOption(QCommandLineOption(QStringList() << "i" << "intervalo",
+                                        "Periodo del resumen en segundos",
+                                        "segundos", "1"));
+    parser.addOption(QCommandLineOption(QStringList() << "d" << "diagnostico",
+                                        "Registrar el resumen en un archivo CSV o JSON",
+                                        "archivo"));
+    parser.addOption(QCommandLineOption(QStringList() << "m" << "modo",
+                                        "Modo de telemetria del MCU: crudo, filtrado o resumen",
+                                        "modo", "filtrado"));
+    parser.addOption(QCommandLineOption(QStringList() << "n" << "decimacion",
+                                        "Muestras del MCU (1 kHz) por trama, potencia de 2 hasta 128",
+                                        "muestras", "2"));
+    parser.addOption(QCommandLineOption(QStringList() << "c" << "filtros",
+                                        "Cadena de filtros de las lecturas: etapas tipo:parametros separadas por comas "
+                                        "(pasabajas, pasaaltas o notch:Hz[:Q], fir:Hz[:coeficientes], dc[:Hz], "
+                                        "mediana[:3|5]), p. ej. mediana:5,notch:50:10,pasabajas:20",
+                                        "etapas"));
+
+    // Leer argumentos
+    if (!parser.parse(app.arguments())) {
+        fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return SalidaArgumentos;
+    }
+
+    if (parser.isSet(ayuda))
+        parser.showHelp(SalidaExito);
+
+    if (parser.isSet(version))
+        parser.showVersion();
+
+    bool ok = true;
+    bool valido;
+    const QString puerto = parser.value("puerto");
+    const QString archivo = parser.value("reproducir");
+    if (puerto.isEmpty() == archivo.isEmpty()) {
+        fprintf(stderr, "Se debe especificar un puerto (-p) o un archivo (-r)\n");
+        ok = false;
+    }
+
+    const qint32 baudios = parser.value("baudios").toInt(&valido);
+    if (!valido || baudios <= 0) {
+        fprintf(stderr, "Velocidad del puerto invalida: %s\n", qPrintable(parser.value("baudios")));
+        ok = false;
+    }
+
+    const qreal rapidez = parser.value("rapidez").toDouble(&valido);
+    if (!valido || rapidez < 0) {
+        fprintf(stderr, "Rapidez de reproduccion invalida: %s\n", qPrintable(parser.value("rapidez")));
+        ok = false;
+    }
+
+    const qreal duracion = parser.value("duracion").toDouble(&valido);
+    if (!valido || duracion < 0) {
+        fprintf(stderr, "Duracion invalida: %s\n", qPrintable(parser.value("duracion")));
+        ok = false;
+    }
+
+    const qreal intervalo = parser.value("intervalo").toDouble(&valido);
+    if (!valido || intervalo <= 0) {
+        fprintf(stderr, "Periodo del resumen invalido: %s\n", qPrintable(parser.value("intervalo")));
+        ok = false;
+    }
+
+    const int sincronizacion = parser.value("sincronizar").toInt(&valido);
+    if (!valido || sincronizacion < 0) {
+        fprintf(stderr, "Intervalo de sincronizacion invalido: %s\n", qPrintable(parser.value("sincronizar")));
+        ok = false;
+    }
+
+    int formatos = 0;
+    const QString formato = parser.value("formato").toLower();
+    if (formato == "csv")
+        formatos = Grabador::FormatoCsv;
+    else if (formato == "binario")
+        formatos = Grabador::FormatoBinario;
+    else if (formato == "ambos")
+        formatos = Grabador::FormatoCsv | Grabador::FormatoBinario;
+    else {
+        fprintf(stderr, "Formato de lecturas invalido: %s\n", qPrintable(formato));
+        ok = false;
+    }
+
+    int modo = Protocolo::ModoFiltrado;
+    const QString nombreModo = parser.value("modo").toLower();
+    if (nombreModo == "crudo")
+        modo = Protocolo::ModoCrudo;
+    else if (nombreModo == "resumen")
+        modo = Protocolo::ModoResumen;
+    else if (nombreModo != "filtrado") {
+        fprintf(stderr, "Modo de telemetria invalido: %s\n", qPrintable(nombreModo));
+        ok = false;
+    }
+
+    const int decimacion = parser.value("decimacion").toInt(&valido);
+    if (!valido || decimacion < 1 || decimacion > Protocolo::MaxDecimacion ||
+        (decimacion & (decimacion - 1)) != 0) {
+        fprintf(stderr, "Decimacion invalida: %s\n", qPrintable(parser.value("decimacion")));
+        ok = false;
+    }
+
+    QVariantList filtros;
+    if (!leerFiltros(parser.value("filtros"), &filtros)) {
+        fprintf(stderr, "Cadena de filtros invalida: %s\n", qPrintable(parser.value("filtros")));
+        ok = false;
+    }
+
+    if (!leerPerfil(parser.value("velocidad"))) {
+        fprintf(stderr, "Perfil de velocidad invalido: %s\n", qPrintable(parser.value("velocidad")));
+        ok = false;
+    }
+
+    if (!ok)
+        return SalidaArgumentos;
+
+    // Registrar el resumen en un archivo
+    if (parser.isSet("diagnostico") && !m_diagnostico->iniciarRegistro(parser.value("diagnostico")))
+        return SalidaArgumentos;
+
+    m_duracion = qRound64(duracion * 1000);
+    m_diagnostico->cambiarIntervalo(qRound(intervalo * 1000));
+
+    // Iniciar el hilo de adquisicion, el modo de telemetria se manda al
+    // MCU cuando empiece a mandar tramas binarias
+    m_adquisicion->configurarGrabacion(formatos, sincronizacion);
+    m_adquisicion->cambiarTelemetria(modo, decimacion);
+    m_adquisicion->configurarFiltros(filtros);
+    m_adquisicion->moveToThread(&m_hilo);
+    m_hilo.setObjectName("Adquisicion");
+    m_hilo.start(QThread::TimeCriticalPriority);
+
+    // Abrir el dispositivo
+    bool abierto = false;
+    if (!puerto.isEmpty()) {
+        QMetaObject::invokeMethod(m_adquisicion, "conectar",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, abierto),
+                                  Q_ARG(QString, puerto),
+                                  Q_ARG(qint32, baudios));
+    } else {
+        QMetaObject::invokeMethod(m_adquisicion, "reproducir",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(bool, abierto),
+                                  Q_ARG(QString, archivo),
+                                  Q_ARG(qreal, rapidez));
+    }
+
+    if (!abierto) {
+        fprintf(stderr, "No se puede abrir %s\n", qPrintable(puerto.isEmpty() ? archivo : puerto));
+        return SalidaConexion;
+    }
+
+    fprintf(stderr, "Adquiriendo de %s, lecturas en %s\n",
+            qPrintable(puerto.isEmpty() ? QFileInfo(archivo).fileName() : puerto),
+            qPrintable(QDir::toNativeSeparators(QDir::homePath() + "/" +
+                                                QCoreApplication::applicationName())));
+
+    // Terminar limpiamente con Ctrl+C o cuando el sistema lo pida
+    signal(SIGINT, interrumpir);
+    signal(SIGTERM, interrumpir);
+
+    m_reloj.start();
+    aplicarPerfil(0);
+    m_temporizador.start();
+
+    app.exec();
+    return m_codigo;
+}
+
+/**
+ * Vacia la cola de lecturas, aplica el perfil de velocidad y termina la
+ * adquisicion cuando se cumple la duracion o el usuario la interrumpe
+ */
+void Consola::revisar() {
+    int n;
+    while ((n = m_cola.leer(m_bloque, MAX_LECTURAS)) > 0) {
+        m_muestras += static_cast<quint64>(n);
+        m_diagnostico->registrarLlegada(m_bloque[n - 1].llegada);
+    }
+
+    const qint64 tiempo = m_reloj.elapsed();
+    aplicarPerfil(tiempo);
+
+    if (INTERRUMPIDO) {
+        fprintf(stderr, "Adquisicion interrumpida\n");
+        terminar(SalidaExito);
+    }
+
+    else if (m_duracion > 0 && tiempo >= m_duracion)
+        terminar(SalidaExito);
+}
+
+/**
+ * Imprime una linea con el resumen del ultimo intervalo en la salida
+ * estandar
+ */
+void Consola::imprimirResumen() {
+    if (m_terminado || !m_reloj.isValid())
+        return;
+
+    printf("%9.1f s %9.0f muestras/s %10.0f B/s  dec %7.1f us  proc %7.1f us  "
+           "cola %6.2f ms  invalidas %llu  descartados %llu  mcu %llu  perdidas %llu  "
+           "grabador %lld/%llu\n",
+           m_reloj.elapsed() / 1000.0,
+           m_diagnostico->muestrasPorSegundo(),
+           m_diagnostico->bytesPorSegundo(),
+           m_diagnostico->decodificacion(),
+           m_diagnostico->procesamiento(),
+           m_diagnostico->latenciaP99(),
+           static_cast<unsigned long long>(m_diagnostico->tramasInvalidas()),
+           static_cast<unsigned long long>(m_diagnostico->bytesDescartados()),
+           static_cast<unsigned long long>(m_diagnostico->tramasPerdidas()),
+           static_cast<unsigned long long>(m_diagnostico->lecturasPerdidas()),
+           static_cast<long long>(m_diagnostico->pendientesGrabador()),
+           static_cast<unsigned long long>(m_diagnostico->descartadasGrabador()));
+    fflush(stdout);
+}
+
+/**
+ * Termina la adquisicion cuando el dispositivo se desconecta o se acaba
+ * el archivo que se reproduce. Si todavia no se cumple la duracion
+ * solicitada el programa termina con un error.
+ */
+void Consola::onConexionCambiada(const bool conectado) {
+    if (conectado || m_terminado || !m_reloj.isValid())
+        return;
+
+    if (m_duracion > 0 && m_reloj.elapsed() < m_duracion) {
+        fprintf(stderr, "El dispositivo se desconecto antes de terminar\n");
+        terminar(SalidaDesconexion);
+    }
+
+    else
+        terminar(SalidaExito);
+}
+
+/**
+ * Lee el perfil de velocidad del @a texto: una velocidad fija o una lista
+ * de pasos "segundos:velocidad" separados por comas en orden ascendente.
+ *
+ * @return @a false si el perfil no es valido
+ */
+bool Consola::leerPerfil(const QString& texto) {
+    m_perfil.clear();
+    m_paso = 0;
+
+    foreach (QString elemento, texto.split(',', QString::SkipEmptyParts)) {
+        const QStringList partes = elemento.split(':');
+        if (partes.count() > 2)
+            return false;
+
+        bool ok = true;
+        Paso paso;
+        paso.tiempo = 0;
+        if (partes.count() == 2)
+            paso.tiempo = qRound64(partes.first().trimmed().toDouble(&ok) * 1000);
+
+        bool valido;
+        paso.velocidad = partes.last().trimmed().toDouble(&valido);
+        if (!ok || !valido || paso.tiempo < 0)
+            return false;
+
+        if (paso.velocidad < 0 || paso.velocidad > VELOCIDAD_MAXIMA)
+            return false;
+
+        if (!m_perfil.isEmpty() && paso.tiempo <= m_perfil.last().tiempo)
+            return false;
+
+        m_perfil.append(paso);
+    }
+
+    return !m_perfil.isEmpty();
+}
+
+/**
+ * Lee la cadena de filtros del @a texto: una lista de etapas separadas por
+ * comas, cada una con su tipo y sus parametros separados por ':'
+ *
+ *   - pasabajas, pasaaltas, notch: frecuencia en Hz y calidad opcional
+ *   - fir: frecuencia de corte en Hz y numero de coeficientes opcional
+ *   - dc: frecuencia de corte opcional (0.5 Hz por defecto)
+ *   - mediana: tamano de la ventana opcional (3 o 5)
+ *
+ * El resultado se escribe en @a etapas con el formato que acepta
+ * CadenaFiltros::leerEtapas().
+ *
+ * @return @a false si alguna etapa no es valida
+ */
+bool Consola::leerFiltros(const QString& texto, QVariantList* etapas) {
+    Q_ASSERT(etapas != Q_NULLPTR);
+
+    etapas->clear();
+    foreach (QString elemento, texto.split(',', QString::SkipEmptyParts)) {
+        const QStringList partes = elemento.trimmed().split(':');
+        const QString tipo = partes.first().toLower();
+        if (partes.count() > 3)
+            return false;
+
+        QVector<qreal> valores;
+        for (int i = 1; i < partes.count(); ++i) {
+            bool valido;
+            valores.append(partes.at(i).trimmed().toDouble(&valido));
+            if (!valido)
+                return false;
+        }
+
+        QVariantMap etapa;
+        etapa["tipo"] = tipo;
+        if (tipo == "mediana") {
+            if (valores.count() > 1)
+                return false;
+            if (valores.count() == 1)
+                etapa["orden"] = qRound(valores.first());
+        } else {
+            if (valores.count() >= 1)
+                etapa["frecuencia"] = valores.at(0);
+            if (valores.count() == 2)
+                etapa[tipo == "fir" ? "orden" : "q"] = valores.at(1);
+            else if (valores.isEmpty() && tipo != "dc")
+                return false;
+        }
+
+        etapas->append(etapa);
+    }
+
+    QVector<EtapaFiltro> cadena;
+    return CadenaFiltros::leerEtapas(*etapas, &cadena);
+}
+
+/**
+ * Manda al hilo de adquisicion los pasos del perfil de velocidad que ya
+ * se cumplieron en el @a tiempo (ms) transcurrido
+ */
+void Consola::aplicarPerfil(const qint64 tiempo) {
+    bool cambio = false;
+    while (m_paso < m_perfil.count() && m_perfil.at(m_paso).tiempo <= tiempo) {
+        ++m_paso;
+        cambio = true;
+    }
+
+    if (!cambio)
+        return;
+
+    const qreal velocidad = m_perfil.at(m_paso - 1).velocidad;
+    QMetaObject::invokeMethod(m_adquisicion, "habilitar",
+                              Qt::QueuedConnection,
+                              Q_ARG(bool, velocidad > 0));
+    QMetaObject::invokeMethod(m_adquisicion, "cambiarVelocidad",
+                              Qt::QueuedConnection,
+                              Q_ARG(qreal, velocidad));
+
+    fprintf(stderr, "%9.1f s velocidad del motor: %.1f %%\n", tiempo / 1000.0, velocidad);
+}
+
+/**
+ * Apaga el motor, escribe las lecturas pendientes, imprime el resumen de
+ * toda la adquisicion y sale del ciclo de eventos con el @a codigo
+ * especificado. Si se perdieron lecturas el codigo de salida lo indica.
+ */
+void Consola::terminar(const int codigo) {
+    if (m_terminado)
+        return;
+
+    m_terminado = true;
+    m_temporizador.stop();
+
+    // Cerrar el dispositivo y los archivos de lecturas
+    QMetaObject::invokeMethod(m_adquisicion, "desconectar",
+                              Qt::BlockingQueuedConnection);
+
+    int n;
+    while ((n = m_cola.leer(m_bloque, MAX_LECTURAS)) > 0)
+        m_muestras += static_cast<quint64>(n);
+
+    // Resumen final
+    const quint64 perdidas = m_adquisicion->lecturasPerdidas();
+    const quint64 descartadas = m_adquisicion->grabador().lecturasDescartadas();
+    const quint64 invalidas = m_adquisicion->etapas().tramasInvalidas.load();
+    const quint64 tramasPerdidas = m_adquisicion->etapas().tramasPerdidas.load();
+    const qreal segundos = m_reloj.elapsed() / 1000.0;
+    printf("Total: %.1f s, %llu muestras (%.0f muestras/s), %llu tramas invalidas, "
+           "%llu tramas perdidas, %llu lecturas perdidas, "
+           "%llu descartadas por el grabador\n",
+           segundos,
+           static_cast<unsigned long long>(m_muestras),
+           segundos > 0 ? m_muestras / segundos : 0.0,
+           static_cast<unsigned long long>(invalidas),
+           static_cast<unsigned long long>(tramasPerdidas),
+           static_cast<unsigned long long>(perdidas),
+           static_cast<unsigned long long>(descartadas));
+    fflush(stdout);
+
+    m_codigo = codigo;
+    if (m_codigo == SalidaExito && (perdidas > 0 || descartadas > 0))
+        m_codigo = SalidaLecturasPerdidas;
+
+    QCoreApplication::exit(m_codigo);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CONSOLA_H
+#define CONSOLA_H
+
+#include <QTimer>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QVariantList>
+#include <QElapsedTimer>
+
+#include "Muestra.h"
+#include "ColaSPSC.h"
+
+//
+// Modo sin interfaz grafica: adquiere, procesa y graba las lecturas de un
+// dispositivo (o de un archivo) durante un tiempo determinado, aplicando
+// un perfil de velocidad del motor, e imprime un resumen periodico de la
+// ruta de datos en la salida estandar. No carga QML ni crea ventanas, por
+// lo que puede correr en servidores sin pantalla.
+//
+//   gmas --sin-interfaz -p ttyUSB0 -v 0:20,600:40,1200:0 -t 1800 -f ambos
+//
+class QCoreApplication;
+class Adquisicion;
+class Diagnostico;
+class Consola : public QObject {
+    Q_OBJECT
+
+public:
+    //
+    // Codigos de salida del programa
+    //
+    enum Salida {
+        SalidaExito = 0,
+        SalidaConexion = 1,
+        SalidaArgumentos = 2,
+        SalidaDesconexion = 3,
+        SalidaLecturasPerdidas = 4,
+    };
+
+    explicit Consola(QObject* parent = Q_NULLPTR);
+    ~Consola();
+
+    static bool solicitada(int argc, char** argv);
+    int ejecutar(QCoreApplication& app);
+
+private slots:
+    void revisar();
+    void imprimirResumen();
+    void onConexionCambiada(const bool conectado);
+
+private:
+    bool leerPerfil(const QString& texto);
+    bool leerFiltros(const QString& texto, QVariantList* etapas);
+    void aplicarPerfil(const qint64 tiempo);
+    void terminar(const int codigo);
+
+private:
+    //
+    // Velocidad (en %) del motor a partir de cierto tiempo (en ms)
+    //
+    struct Paso {
+        qint64 tiempo;
+        qreal velocidad;
+    };
+
+    static const int MAX_LECTURAS = 1024;
+
+    int m_paso;
+    int m_codigo;
+    bool m_terminado;
+    qint64 m_duracion;
+    quint64 m_muestras;
+    QVector<Paso> m_perfil;
+
+    QThread m_hilo;
+    QTimer m_temporizador;
+    QElapsedTimer m_reloj;
+    ColaSPSC<Lectura> m_cola;
+    Adquisicion* m_adquisicion;
+    Diagnostico* m_diagnostico;
+    Lectura m_bloque[MAX_LECTURAS];
+};
+
+#endif
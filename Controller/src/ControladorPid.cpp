@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ControladorPid.h"
+
+#include <math.h>
+
+/**
+ * El filtro del termino derivativo tiene una constante de tiempo de
+ * Td / N, donde Td = Kd / Kp
+ */
+static const float N_DERIVADA = 10;
+
+/**
+ * Inicializa el controlador sin ganancias, con la salida limitada
+ * entre 0 y 100
+ */
+ControladorPid::ControladorPid() {
+    m_kp = 0;
+    m_ki = 0;
+    m_kd = 0;
+    m_minimo = 0;
+    m_maximo = 100;
+    m_prealimentacion = 0;
+
+    reiniciar();
+}
+
+/**
+ * Descarga el integrador y el filtro derivativo, se debe llamar antes de
+ * cerrar el lazo
+ */
+void ControladorPid::reiniciar() {
+    m_primera = true;
+    m_salida = 0;
+    m_integral = 0;
+    m_derivada = 0;
+    m_medicionAnterior = 0;
+}
+
+/**
+ * Calcula la salida del controlador para llevar la @a medicion a la
+ * @a consigna, @a dt es el tiempo (en segundos) desde la ultima llamada
+ */
+float ControladorPid::actualizar(const float consigna, const float medicion,
+                                 const float dt) {
+    const float error = consigna - medicion;
+
+    // Termino derivativo sobre la medicion, filtrado
+    if (m_primera || dt <= 0 || m_kd <= 0) {
+        m_derivada = 0;
+    } else {
+        const float tf = (m_kp > 0) ? m_kd / (m_kp * N_DERIVADA) : dt;
+        const float cambio = medicion - m_medicionAnterior;
+        m_derivada = (tf * m_derivada - m_kd * cambio) / (tf + dt);
+    }
+
+    m_primera = false;
+    m_medicionAnterior = medicion;
+
+    // La prealimentacion se limita por separado para que el integrador no
+    // tenga que compensar consignas que la salida no puede alcanzar
+    float prealimentacion = m_prealimentacion * consigna;
+    if (prealimentacion < m_minimo)
+        prealimentacion = m_minimo;
+    else if (prealimentacion > m_maximo)
+        prealimentacion = m_maximo;
+
+    // Calcular salida y saturarla
+    const float calculada = prealimentacion
+                            + m_kp * error
+                            + m_integral
+                            + m_derivada;
+
+    m_salida = calculada;
+    if (m_salida < m_minimo)
+        m_salida = m_minimo;
+    else if (m_salida > m_maximo)
+        m_salida = m_maximo;
+
+    // Integrar el error y descargar el integrador mientras la salida este
+    // saturada, la ganancia de seguimiento es 1 / Ti = Ki / Kp
+    if (dt > 0) {
+        const float seguimiento = (m_kp > 0) ? m_ki / m_kp : 1;
+        m_integral += (m_ki * error + seguimiento * (m_salida - calculada)) * dt;
+    }
+
+    return m_salida;
+}
+
+/**
+ * Transfiere una fraccion (@a tasa) del integrador a la ganancia de
+ * prealimentacion, sin alterar la salida. Llamarlo periodicamente cuando
+ * el lazo esta estable permite que la prealimentacion aprenda la relacion
+ * entre la consigna y la salida, de modo que los cambios de consigna se
+ * alcancen sin esperar al integrador.
+ */
+void ControladorPid::ajustarPrealimentacion(const float consigna,
+                                            const float tasa) {
+    if (fabsf(consigna) < 1e-6f)
+        return;
+
+    const float cambio = tasa * m_integral / consigna;
+    m_prealimentacion += cambio;
+    m_integral -= cambio * consigna;
+}
+
+/**
+ * Regresa la ultima salida calculada
+ */
+float ControladorPid::salida() const {
+    return m_salida;
+}
+
+/**
+ * Regresa la ganancia de prealimentacion (salida por unidad de consigna)
+ */
+float ControladorPid::prealimentacion() const {
+    return m_prealimentacion;
+}
+
+/**
+ * Cambia las ganancias proporcional, integral y derivativa
+ */
+void ControladorPid::cambiarGanancias(const float kp, const float ki,
+                                      const float kd) {
+    m_kp = kp;
+    m_ki = ki;
+    m_kd = kd;
+}
+
+/**
+ * Limita la salida del controlador al rango [@a minimo, @a maximo]
+ */
+void ControladorPid::cambiarLimites(const float minimo, const float maximo) {
+    m_minimo = minimo;
+    m_maximo = maximo;
+}
+
+/**
+ * Cambia la ganancia de prealimentacion (salida por unidad de consigna)
+ */
+void ControladorPid::cambiarPrealimentacion(const float ganancia) {
+    m_prealimentacion = ganancia;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef CONTROLADOR_PID_H
+#define CONTROLADOR_PID_H
+
+//
+// Controlador PID con prealimentacion y anti-windup.
+//
+// La salida es la suma de la prealimentacion (proporcional a la consigna),
+// el termino proporcional, el integral y el derivativo. El termino
+// derivativo se calcula sobre la medicion (no sobre el error) y pasa por un
+// filtro de primer orden para que los cambios de consigna y el ruido no
+// generen picos en la salida. Cuando la salida se satura, el integrador se
+// descarga con la diferencia entre la salida saturada y la calculada
+// (back-calculation) para evitar el windup.
+//
+class ControladorPid {
+public:
+    ControladorPid();
+
+    void reiniciar();
+    float actualizar(const float consigna, const float medicion, const float dt);
+    void ajustarPrealimentacion(const float consigna, const float tasa);
+
+    float salida() const;
+    float prealimentacion() const;
+
+    void cambiarGanancias(const float kp, const float ki, const float kd);
+    void cambiarLimites(const float minimo, const float maximo);
+    void cambiarPrealimentacion(const float ganancia);
+
+private:
+    float m_kp;
+    float m_ki;
+    float m_kd;
+    float m_minimo;
+    float m_maximo;
+    float m_prealimentacion;
+
+    bool m_primera;
+    float m_salida;
+    float m_integral;
+    float m_derivada;
+    float m_medicionAnterior;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DECIMADOR_H
+#define DECIMADOR_H
+
+#include <QPointF>
+#include <QVector>
+
+//
+// Reduce el historial de cada canal a un par de puntos (minimo y maximo)
+// por columna de pixeles de la grafica.
+//
+// Las columnas se alinean al tiempo absoluto de las lecturas (tiempo /
+// lecturas por columna), de modo que una columna ya terminada no cambia al
+// desplazarse la ventana. Cada lectura solo actualiza la ultima columna,
+// por lo que mantener el decimador cuesta O(1) por lectura y generar los
+// puntos de un canal cuesta O(columnas) sin importar el tamano de la
+// ventana.
+//
+template <int Canales>
+class Decimador {
+public:
+    Decimador() :
+        m_primera(0),
+        m_cuenta(0),
+        m_lecturasPorColumna(1) {
+        configurar(1, 1);
+    }
+
+    int lecturasPorColumna() const {
+        return m_lecturasPorColumna;
+    }
+
+    void limpiar() {
+        m_primera = 0;
+        m_cuenta = 0;
+    }
+
+    //
+    // Ajusta el decimador para mostrar una ventana de @a lecturas en
+    // @a columnas pixeles. Regresa true si las columnas cambiaron, en cuyo
+    // caso el decimador se limpia y se deben volver a agregar las lecturas
+    // de la ventana.
+    //
+    bool configurar(const int columnas, const int lecturas) {
+        Q_ASSERT(columnas > 0);
+        Q_ASSERT(lecturas > 0);
+
+        const int porColumna = qMax(1, (lecturas + columnas - 1) / columnas);
+        const int capacidad = (lecturas + porColumna - 1) / porColumna + 2;
+        if (porColumna == m_lecturasPorColumna &&
+                capacidad == m_columnas.count())
+            return false;
+
+        m_lecturasPorColumna = porColumna;
+        m_columnas.resize(capacidad);
+        limpiar();
+        return true;
+    }
+
+    //
+    // Agrega una lectura con el @a tiempo y los @a valores de cada canal
+    //
+    void agregar(const qreal tiempo, const float* valores) {
+        Q_ASSERT(valores != Q_NULLPTR);
+
+        const qint64 indice = static_cast<qint64>(tiempo) / m_lecturasPorColumna;
+
+        // Actualizar la ultima columna
+        if (m_cuenta > 0) {
+            Columna& c = m_columnas[posicion(m_cuenta - 1)];
+            if (c.indice == indice) {
+                for (int i = 0; i < Canales; ++i) {
+                    if (valores[i] < c.minimos[i]) {
+                        c.minimos[i] = valores[i];
+                        c.tiemposMinimos[i] = tiempo;
+                    }
+
+                    if (valores[i] > c.maximos[i]) {
+                        c.maximos[i] = valores[i];
+                        c.tiemposMaximos[i] = tiempo;
+                    }
+                }
+
+                return;
+            }
+        }
+
+        // Empezar una nueva columna, eliminando la mas vieja si no cabe
+        if (m_cuenta == m_columnas.count()) {
+            m_primera = (m_primera + 1) % m_columnas.count();
+            --m_cuenta;
+        }
+
+        Columna& c = m_columnas[posicion(m_cuenta)];
+        c.indice = indice;
+        for (int i = 0; i < Canales; ++i) {
+            c.minimos[i] = valores[i];
+            c.maximos[i] = valores[i];
+            c.tiemposMinimos[i] = tiempo;
+            c.tiemposMaximos[i] = tiempo;
+        }
+
+        ++m_cuenta;
+    }
+
+    //
+    // Escribe en @a puntos el minimo y el maximo (en el orden en que
+    // ocurrieron) de cada columna del @a canal con lecturas desde el
+    // tiempo @a desde, multiplicados por el @a factor especificado
+    //
+    void puntos(const int canal,
+                const qreal desde,
+                const qreal factor,
+                QVector<QPointF>* puntos) const {
+        Q_ASSERT(canal >= 0 && canal < Canales);
+        Q_ASSERT(puntos != Q_NULLPTR);
+
+        puntos->resize(m_cuenta * 2);
+        QPointF* p = puntos->data();
+
+        int n = 0;
+        for (int j = 0; j < m_cuenta; ++j) {
+            const Columna& c = m_columnas.at(posicion(j));
+            if (c.tiemposMinimos[canal] < desde && c.tiemposMaximos[canal] < desde)
+                continue;
+
+            const QPointF minimo(c.tiemposMinimos[canal], c.minimos[canal] * factor);
+            const QPointF maximo(c.tiemposMaximos[canal], c.maximos[canal] * factor);
+
+            if (c.tiemposMinimos[canal] < c.tiemposMaximos[canal]) {
+                p[n++] = minimo;
+                p[n++] = maximo;
+            } else if (c.tiemposMinimos[canal] > c.tiemposMaximos[canal]) {
+                p[n++] = maximo;
+                p[n++] = minimo;
+            } else {
+                p[n++] = minimo;
+            }
+        }
+
+        puntos->resize(n);
+    }
+
+private:
+    struct Columna {
+        qint64 indice;
+        float minimos[Canales];
+        float maximos[Canales];
+        qreal tiemposMinimos[Canales];
+        qreal tiemposMaximos[Canales];
+    };
+
+    int posicion(const int j) const {
+        return (m_primera + j) % m_columnas.count();
+    }
+
+private:
+    int m_primera;
+    int m_cuenta;
+    int m_lecturasPorColumna;
+    QVector<Columna> m_columnas;
+};
+
+#endif
@@ -0,0 +1,477 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Decodificador.h"
+
+#include <string.h>
+
+/**
+ * Numero maximo de digitos significativos que leemos de cada campo
+ * de un paquete de texto
+ */
+static const int MAX_DIGITOS = 18;
+
+/**
+ * Longitud maxima de un paquete de texto, si el paquete es mas largo
+ * asumimos que perdimos la secuencia de terminacion
+ */
+static const int MAX_BYTES_PAQUETE = 128;
+
+/**
+ * Potencias de 10 para convertir la mantisa de cada campo a flotante
+ */
+static const double POTENCIAS_10[MAX_DIGITOS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+/**
+ * Inicializa el estado del decodificador y sus contadores
+ */
+Decodificador::Decodificador() {
+    reiniciar();
+}
+
+/**
+ * Descarta cualquier trama o paquete incompleto y reinicia los contadores
+ */
+void Decodificador::reiniciar() {
+    m_estado = Buscando;
+    m_numAcks = 0;
+    m_muestras = 0;
+    m_bytesTrama = 0;
+    m_tramasInvalidas = 0;
+    m_bytesDescartados = 0;
+    m_resincronizaciones = 0;
+    m_tramasPerdidas = 0;
+    m_haySecuencia = false;
+    m_siguienteSecuencia = 0;
+    m_hayResumen = false;
+
+    iniciarPaquete();
+}
+
+/**
+ * Interpreta los @a datos recibidos del dispositivo serial, los cuales
+ * pueden contener cualquier numero de tramas binarias (ver Protocolo.h)
+ * o paquetes de texto con el formato:
+ *
+ *          {ACCEL_X,ACCEL_Y,ACCEL_Z,GYRO_X,GYRO_Y,GYRO_Z};
+ *
+ * Las tramas y paquetes pueden estar divididos entre varias llamadas, el
+ * decodificador guarda su estado sin reservar memoria. Las lecturas se
+ * escriben en @a muestras hasta llenar su @a capacidad, en cuyo caso el
+ * numero de bytes interpretados se escribe en @a bytesLeidos para que los
+ * bytes restantes se puedan volver a procesar.
+ *
+ * @return el numero de muestras escritas
+ */
+int Decodificador::decodificar(const char* datos, const int longitud,
+                               Muestra* muestras, const int capacidad,
+                               int* bytesLeidos) {
+    // Verificaciones
+    Q_ASSERT(datos != Q_NULLPTR || longitud == 0);
+    Q_ASSERT(muestras != Q_NULLPTR || capacidad == 0);
+
+    int i = 0;
+    int n = 0;
+    const quint8* bytes = reinterpret_cast<const quint8*>(datos);
+    while (i < longitud && n < capacidad) {
+        const quint8 c = bytes[i];
+
+        switch (m_estado) {
+        // Buscar el inicio de una trama o paquete
+        case Buscando:
+            if (c == Protocolo::Sync0) {
+                // Intentar decodificar la trama directamente del bloque
+                Protocolo::Trama trama;
+                const int r = Protocolo::decodificarTrama(bytes + i, longitud - i, &trama);
+
+                // Trama completa
+                if (r > 0) {
+                    if (leerTrama(trama, &muestras[n]))
+                        ++n;
+
+                    i += r;
+                }
+
+                // Trama invalida, buscar la siguiente secuencia de inicio
+                else if (r == Protocolo::TramaInvalida) {
+                    if (longitud - i > 1 && bytes[i + 1] == Protocolo::Sync1) {
+                        ++m_tramasInvalidas;
+                        ++m_resincronizaciones;
+                    }
+
+                    descartar(1);
+                    ++i;
+                }
+
+                // Trama incompleta, guardar el resto del bloque
+                else {
+                    m_bytesTrama = longitud - i;
+                    memcpy(m_trama, bytes + i, static_cast<size_t>(m_bytesTrama));
+                    m_estado = Binario;
+                    i = longitud;
+                }
+            }
+
+            else if (c == '{') {
+                iniciarPaquete();
+                m_bytesPaquete = 1;
+                m_estado = Texto;
+                ++i;
+            }
+
+            else {
+                descartar(1);
+                ++i;
+            }
+
+            break;
+
+        // Completar una trama binaria que comenzo en un bloque anterior
+        case Binario: {
+            // Copiar solamente los bytes que le faltan a la trama
+            int total = Protocolo::Encabezado;
+            if (m_bytesTrama >= Protocolo::Encabezado)
+                total += m_trama[4] + Protocolo::BytesCrc;
+
+            const int copiar = qMin(total - m_bytesTrama, longitud - i);
+            memcpy(m_trama + m_bytesTrama, bytes + i, static_cast<size_t>(copiar));
+            m_bytesTrama += copiar;
+            i += copiar;
+
+            // Intentar decodificar la trama
+            Protocolo::Trama trama;
+            const int r = Protocolo::decodificarTrama(m_trama, m_bytesTrama, &trama);
+            if (r == Protocolo::TramaIncompleta)
+                break;
+
+            // Registrar lectura
+            if (r > 0) {
+                if (leerTrama(trama, &muestras[n]))
+                    ++n;
+
+                m_bytesTrama = 0;
+                m_estado = Buscando;
+                break;
+            }
+
+            // La trama es invalida, pero los bytes que guardamos pueden
+            // contener el inicio de otra trama o paquete. Descartar el
+            // primer byte y volver a interpretar el resto.
+            ++m_tramasInvalidas;
+            ++m_resincronizaciones;
+            descartar(1);
+
+            quint8 copia[sizeof(m_trama)];
+            const int bytesCopia = m_bytesTrama - 1;
+            memcpy(copia, m_trama + 1, static_cast<size_t>(bytesCopia));
+
+            m_bytesTrama = 0;
+            m_estado = Buscando;
+
+            int leidos = 0;
+            n += decodificar(reinterpret_cast<const char*>(copia), bytesCopia,
+                             muestras + n, capacidad - n, &leidos);
+
+            // Si se lleno el buffer de muestras, regresar al bloque actual
+            // los bytes que no se alcanzaron a interpretar
+            const int restantes = bytesCopia - leidos;
+            if (restantes > 0) {
+                const int regresar = qMin(restantes, copiar);
+                descartar(restantes - regresar);
+                i -= regresar;
+            }
+
+            break;
+        }
+
+        // Leer los campos de un paquete de texto
+        case Texto: {
+            bool valido = m_bytesPaquete < MAX_BYTES_PAQUETE;
+
+            if (valido) {
+                if (c >= '0' && c <= '9') {
+                    if (m_digitos < MAX_DIGITOS) {
+                        m_mantisa = m_mantisa * 10 + (c - '0');
+                        m_decimales += m_fraccion ? 1 : 0;
+                        ++m_digitos;
+                    } else
+                        valido = m_fraccion;
+                }
+
+                else if (c == '-')
+                    valido = !m_negativo && !m_fraccion && m_digitos == 0;
+
+                else if (c == '.')
+                    valido = !m_fraccion;
+
+                else if (c == ',')
+                    valido = terminarCampo() && m_campo < 6;
+
+                else if (c == '}') {
+                    valido = terminarCampo() && m_campo == 6;
+                    m_estado = FinTexto;
+                }
+
+                else if (c != ' ' && c != '\r' && c != '\n' && c != '\t')
+                    valido = false;
+
+                if (c == '-')
+                    m_negativo = true;
+                else if (c == '.')
+                    m_fraccion = true;
+            }
+
+            // Abandonar el paquete, el byte actual puede ser el inicio
+            // de otra trama o paquete
+            if (!valido) {
+                ++m_resincronizaciones;
+                descartar(m_bytesPaquete);
+                m_estado = Buscando;
+                if (c != Protocolo::Sync0 && c != '{') {
+                    descartar(1);
+                    ++i;
+                }
+            }
+
+            else {
+                ++m_bytesPaquete;
+                ++i;
+            }
+
+            break;
+        }
+
+        // Esperar la secuencia de terminacion del paquete de texto
+        case FinTexto:
+            if (c == ';') {
+                Muestra* muestra = &muestras[n];
+                muestra->formato = Muestra::FormatoTexto;
+                muestra->secuencia = 0;
+                muestra->tiempo = 0;
+                for (int j = 0; j < 3; ++j) {
+                    muestra->accel[j] = m_campos[j];
+                    muestra->gyro[j] = m_campos[j + 3];
+                }
+
+                ++m_muestras;
+                ++n;
+                ++i;
+            }
+
+            else {
+                ++m_resincronizaciones;
+                descartar(m_bytesPaquete);
+                if (c != Protocolo::Sync0 && c != '{') {
+                    descartar(1);
+                    ++i;
+                }
+            }
+
+            m_estado = Buscando;
+            break;
+        }
+    }
+
+    // Notificar el numero de bytes interpretados
+    if (bytesLeidos)
+        *bytesLeidos = i;
+
+    return n;
+}
+
+/**
+ * Copia hasta @a capacidad confirmaciones de comandos recibidas desde la
+ * ultima llamada en @a acks. Si se reciben mas de MAX_ACKS confirmaciones
+ * entre dos llamadas, las mas recientes se descartan.
+ *
+ * @return el numero de confirmaciones copiadas
+ */
+int Decodificador::leerAcks(Protocolo::Ack* acks, const int capacidad) {
+    const int n = qMin(capacidad, m_numAcks);
+    for (int i = 0; i < n; ++i)
+        acks[i] = m_acks[i];
+
+    for (int i = n; i < m_numAcks; ++i)
+        m_acks[i - n] = m_acks[i];
+
+    m_numAcks -= n;
+    return n;
+}
+
+/**
+ * Copia en @a resumen la ultima trama de resumen recibida, si llego una
+ * desde la ultima llamada
+ *
+ * @return @a true si habia un resumen nuevo
+ */
+bool Decodificador::leerResumen(Protocolo::Resumen* resumen) {
+    Q_ASSERT(resumen != Q_NULLPTR);
+
+    if (!m_hayResumen)
+        return false;
+
+    *resumen = m_resumen;
+    m_hayResumen = false;
+    return true;
+}
+
+/**
+ * Regresa el numero de muestras decodificadas
+ */
+quint64 Decodificador::muestras() const {
+    return m_muestras;
+}
+
+/**
+ * Regresa el numero de tramas binarias con un encabezado o CRC invalido
+ */
+quint64 Decodificador::tramasInvalidas() const {
+    return m_tramasInvalidas;
+}
+
+/**
+ * Regresa el numero de bytes que no formaron parte de ninguna muestra
+ */
+quint64 Decodificador::bytesDescartados() const {
+    return m_bytesDescartados;
+}
+
+/**
+ * Regresa el numero de veces que abandonamos una trama o paquete
+ * incompleto para buscar el inicio de la siguiente
+ */
+quint64 Decodificador::resincronizaciones() const {
+    return m_resincronizaciones;
+}
+
+/**
+ * Regresa el numero de tramas de telemetria que faltan en la secuencia,
+ * ya sea porque el MCU las descarto (el serial no alcanzaba a mandarlas)
+ * o porque llegaron corruptas
+ */
+quint64 Decodificador::tramasPerdidas() const {
+    return m_tramasPerdidas;
+}
+
+/**
+ * Registra el descarte de @a bytes
+ */
+void Decodificador::descartar(const int bytes) {
+    m_bytesDescartados += static_cast<quint64>(bytes);
+}
+
+/**
+ * Convierte el numero leido hasta el momento y lo registra como el
+ * siguiente campo del paquete de texto
+ *
+ * @return @a false si el campo esta vacio o el paquete ya tiene seis campos
+ */
+bool Decodificador::terminarCampo() {
+    if (m_digitos == 0 || m_campo >= 6)
+        return false;
+
+    double valor = m_mantisa / POTENCIAS_10[m_decimales];
+    m_campos[m_campo] = static_cast<float>(m_negativo ? -valor : valor);
+    ++m_campo;
+
+    m_mantisa = 0;
+    m_digitos = 0;
+    m_decimales = 0;
+    m_negativo = false;
+    m_fraccion = false;
+
+    return true;
+}
+
+/**
+ * Limpia los campos del paquete de texto actual
+ */
+void Decodificador::iniciarPaquete() {
+    m_campo = 0;
+    m_mantisa = 0;
+    m_digitos = 0;
+    m_decimales = 0;
+    m_bytesPaquete = 0;
+    m_negativo = false;
+    m_fraccion = false;
+}
+
+/**
+ * Convierte una trama de telemetria o de resumen a una @a muestra,
+ * normalizando las lecturas crudas con la configuracion reportada por el
+ * MCU. Las confirmaciones de comandos se guardan para leerlas con
+ * @c leerAcks().
+ *
+ * @return @a false si la @a trama no es de telemetria ni de resumen
+ */
+bool Decodificador::leerTrama(const Protocolo::Trama& trama, Muestra* muestra) {
+    Protocolo::Ack ack;
+    if (Protocolo::leerAck(trama, &ack)) {
+        if (m_numAcks < MAX_ACKS)
+            m_acks[m_numAcks++] = ack;
+
+        return false;
+    }
+
+    // En el modo resumen la muestra es la media de la ventana, el resto
+    // del resumen se guarda para leerResumen()
+    Protocolo::Telemetria telemetria;
+    if (Protocolo::leerResumen(trama, &m_resumen)) {
+        m_hayResumen = true;
+        telemetria.secuencia = m_resumen.secuencia;
+        telemetria.tiempo = m_resumen.tiempo;
+        telemetria.config = m_resumen.config;
+        for (int i = 0; i < 3; ++i) {
+            telemetria.accel[i] = m_resumen.media[i];
+            telemetria.gyro[i] = m_resumen.media[i + 3];
+        }
+    }
+
+    else if (!Protocolo::leerTelemetria(trama, &telemetria))
+        return false;
+
+    // Contar los saltos en la secuencia, un salto hacia atras indica que el
+    // MCU se reinicio
+    const quint16 salto = static_cast<quint16>(telemetria.secuencia - m_siguienteSecuencia);
+    if (m_haySecuencia && salto < 0x8000)
+        m_tramasPerdidas += salto;
+
+    m_haySecuencia = true;
+    m_siguienteSecuencia = static_cast<quint16>(telemetria.secuencia + 1);
+
+    const float fa = Protocolo::factorAcelerometro(telemetria.config);
+    const float fg = Protocolo::factorGiroscopio(telemetria.config);
+
+    muestra->formato = Muestra::FormatoBinario;
+    muestra->secuencia = telemetria.secuencia;
+    muestra->tiempo = telemetria.tiempo;
+    for (int i = 0; i < 3; ++i) {
+        muestra->accel[i] = telemetria.accel[i] * fa;
+        muestra->gyro[i] = telemetria.gyro[i] * fg;
+    }
+
+    ++m_muestras;
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DECODIFICADOR_H
+#define DECODIFICADOR_H
+
+#include "Muestra.h"
+#include "Protocolo.h"
+
+class Decodificador {
+public:
+    Decodificador();
+
+    void reiniciar();
+    int decodificar(const char* datos, const int longitud,
+                    Muestra* muestras, const int capacidad,
+                    int* bytesLeidos = Q_NULLPTR);
+
+    int leerAcks(Protocolo::Ack* acks, const int capacidad);
+    bool leerResumen(Protocolo::Resumen* resumen);
+
+    quint64 muestras() const;
+    quint64 tramasInvalidas() const;
+    quint64 bytesDescartados() const;
+    quint64 resincronizaciones() const;
+    quint64 tramasPerdidas() const;
+
+private:
+    enum Estado {
+        Buscando,
+        Binario,
+        Texto,
+        FinTexto,
+    };
+
+    void descartar(const int bytes);
+    bool terminarCampo();
+    void iniciarPaquete();
+    bool leerTrama(const Protocolo::Trama& trama, Muestra* muestra);
+
+private:
+    static const int MAX_ACKS = 16;
+
+    Estado m_estado;
+
+    int m_numAcks;
+    Protocolo::Ack m_acks[MAX_ACKS];
+
+    bool m_hayResumen;
+    Protocolo::Resumen m_resumen;
+
+    quint64 m_muestras;
+    quint64 m_tramasInvalidas;
+    quint64 m_bytesDescartados;
+    quint64 m_resincronizaciones;
+    quint64 m_tramasPerdidas;
+
+    bool m_haySecuencia;
+    quint16 m_siguienteSecuencia;
+
+    int m_bytesTrama;
+    quint8 m_trama[Protocolo::Encabezado + 255 + Protocolo::BytesCrc];
+
+    int m_campo;
+    int m_bytesPaquete;
+    int m_decimales;
+    int m_digitos;
+    bool m_negativo;
+    bool m_fraccion;
+    qint64 m_mantisa;
+    float m_campos[6];
+};
+
+#endif
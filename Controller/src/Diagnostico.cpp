@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Diagnostico.h"
+#include "Adquisicion.h"
+
+#include <QDir>
+#include <QDebug>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCoreApplication>
+
+/**
+ * Periodo predeterminado (ms) del resumen
+ */
+static const int INTERVALO_PREDETERMINADO = 500;
+
+/**
+ * Nombre de cada campo del resumen en los archivos de registro, en el
+ * orden de Diagnostico::Campo
+ */
+static const char* CAMPOS[] = {
+    "bytes_por_segundo",
+    "muestras_por_segundo",
+    "bytes_por_lectura",
+    "decodificacion_us",
+    "procesamiento_us",
+    "dibujo_us",
+    "latencia_p50_ms",
+    "latencia_p99_ms",
+    "latencia_maxima_ms",
+    "profundidad_cola",
+    "tramas_invalidas",
+    "bytes_descartados",
+    "tramas_perdidas",
+    "lecturas_perdidas",
+    "pendientes_grabador",
+    "descartadas_grabador",
+};
+
+/**
+ * Inicializa el resumen de la @a adquisicion y la @a cola de lecturas de
+ * la interfaz grafica
+ */
+Diagnostico::Diagnostico(const Adquisicion* adquisicion,
+                         const ColaSPSC<Lectura>* cola,
+                         QObject* parent) : QObject(parent) {
+    Q_ASSERT(adquisicion != Q_NULLPTR);
+    Q_ASSERT(cola != Q_NULLPTR);
+    Q_STATIC_ASSERT(sizeof(CAMPOS) / sizeof(CAMPOS[0]) == NumCampos);
+
+    m_adquisicion = adquisicion;
+    m_cola = cola;
+    m_llegada = 0;
+    m_csv = false;
+    m_bytesAnteriores = 0;
+    m_muestrasAnteriores = 0;
+
+    for (int i = 0; i < NumCampos; ++i)
+        m_valores[i] = 0;
+
+    Intervalo* intervalos[] = { &m_bytesPorLectura, &m_decodificacion, &m_procesamiento,
+                                &m_intervaloLatencia, &m_intervaloDibujo };
+    for (Intervalo* intervalo : intervalos) {
+        intervalo->anteriores.fill(0, Histograma::NUM_CUBETAS);
+        intervalo->actuales.fill(0, Histograma::NUM_CUBETAS);
+    }
+
+    m_reloj.start();
+    m_inicio.start();
+    m_temporizador.setInterval(INTERVALO_PREDETERMINADO);
+    connect(&m_temporizador, &QTimer::timeout,
+            this,            &Diagnostico::actualizar);
+    m_temporizador.start();
+}
+
+/**
+ * Cierra el archivo de registro
+ */
+Diagnostico::~Diagnostico() {
+    detenerRegistro();
+}
+
+/**
+ * Regresa los bytes por segundo leidos del puerto
+ */
+qreal Diagnostico::bytesPorSegundo() const {
+    return m_valores[CampoBytesPorSegundo];
+}
+
+/**
+ * Regresa las muestras por segundo decodificadas
+ */
+qreal Diagnostico::muestrasPorSegundo() const {
+    return m_valores[CampoMuestrasPorSegundo];
+}
+
+/**
+ * Regresa la mediana de los bytes que se leen del puerto cada vez que
+ * llegan datos
+ */
+qreal Diagnostico::bytesPorLectura() const {
+    return m_valores[CampoBytesPorLectura];
+}
+
+/**
+ * Regresa el percentil 99 del tiempo (en us) que toma decodificar los
+ * datos que llegan del puerto
+ */
+qreal Diagnostico::decodificacion() const {
+    return m_valores[CampoDecodificacion];
+}
+
+/**
+ * Regresa el percentil 99 del tiempo (en us) que toma procesar las
+ * muestras que llegan del puerto
+ */
+qreal Diagnostico::procesamiento() const {
+    return m_valores[CampoProcesamiento];
+}
+
+/**
+ * Regresa el percentil 99 del tiempo (en us) que toma preparar los datos
+ * de cada serie o cuadro de la grafica
+ */
+qreal Diagnostico::dibujo() const {
+    return m_valores[CampoDibujo];
+}
+
+/**
+ * Regresa la mediana del tiempo (en ms) entre la llegada de los datos y
+ * su dibujo en la grafica
+ */
+qreal Diagnostico::latenciaP50() const {
+    return m_valores[CampoLatenciaP50];
+}
+
+/**
+ * Regresa el percentil 99 del tiempo (en ms) entre la llegada de los
+ * datos y su dibujo en la grafica
+ */
+qreal Diagnostico::latenciaP99() const {
+    return m_valores[CampoLatenciaP99];
+}
+
+/**
+ * Regresa el maximo tiempo (en ms) entre la llegada de los datos y su
+ * dibujo en la grafica
+ */
+qreal Diagnostico::latenciaMaxima() const {
+    return m_valores[CampoLatenciaMaxima];
+}
+
+/**
+ * Regresa el numero de lecturas en la cola de la interfaz grafica
+ */
+int Diagnostico::profundidadCola() const {
+    return static_cast<int>(m_valores[CampoProfundidadCola]);
+}
+
+/**
+ * Regresa el numero de lecturas que caben en la cola de la interfaz
+ * grafica
+ */
+int Diagnostico::capacidadCola() const {
+    return m_cola->capacidad();
+}
+
+/**
+ * Regresa el numero de tramas con CRC invalido desde la conexion
+ */
+quint64 Diagnostico::tramasInvalidas() const {
+    return static_cast<quint64>(m_valores[CampoTramasInvalidas]);
+}
+
+/**
+ * Regresa el numero de bytes que el decodificador descarto desde la
+ * conexion
+ */
+quint64 Diagnostico::bytesDescartados() const {
+    return static_cast<quint64>(m_valores[CampoBytesDescartados]);
+}
+
+/**
+ * Regresa el numero de tramas de telemetria que faltan en la secuencia
+ * desde la conexion, incluye las que el MCU descarto porque el serial no
+ * alcanzaba a mandarlas
+ */
+quint64 Diagnostico::tramasPerdidas() const {
+    return static_cast<quint64>(m_valores[CampoTramasPerdidas]);
+}
+
+/**
+ * Regresa el numero de lecturas descartadas porque la cola de la interfaz
+ * grafica estaba llena
+ */
+quint64 Diagnostico::lecturasPerdidas() const {
+    return static_cast<quint64>(m_valores[CampoLecturasPerdidas]);
+}
+
+/**
+ * Regresa el numero de lecturas que el grabador aun no escribe
+ */
+qint64 Diagnostico::pendientesGrabador() const {
+    return static_cast<qint64>(m_valores[CampoPendientesGrabador]);
+}
+
+/**
+ * Regresa el numero de lecturas que el grabador descarto
+ */
+quint64 Diagnostico::descartadasGrabador() const {
+    return static_cast<quint64>(m_valores[CampoDescartadasGrabador]);
+}
+
+/**
+ * Regresa la ruta del archivo de registro, o una cadena vacia si el
+ * resumen no se esta registrando
+ */
+QString Diagnostico::archivoRegistro() const {
+    return m_registro.isOpen() ? m_registro.fileName() : QString();
+}
+
+/**
+ * Indica que las lecturas que llegaron en el momento @a llegada (ver
+ * RelojMonotonico()) ya estan en el historial de la grafica
+ */
+void Diagnostico::registrarLlegada(const qint64 llegada) {
+    m_llegada = qMax(m_llegada, llegada);
+}
+
+/**
+ * Indica que la grafica se actualizo en @a duracion ns, la latencia de las
+ * ultimas lecturas que llegaron se registra en este momento
+ */
+void Diagnostico::registrarDibujo(const qint64 duracion) {
+    m_dibujo.registrar(static_cast<quint64>(qMax<qint64>(0, duracion)));
+
+    if (m_llegada > 0) {
+        m_latencia.registrar(static_cast<quint64>(qMax<qint64>(0, RelojMonotonico() - m_llegada)));
+        m_llegada = 0;
+    }
+}
+
+/**
+ * Comienza a registrar el resumen en la @a ruta especificada, en formato
+ * CSV si la extension es ".csv" y en JSON (un objeto por linea) en caso
+ * contrario. Si la @a ruta esta vacia se usa un archivo CSV en la carpeta
+ * de lecturas con el nombre del objeto (el del dispositivo).
+ *
+ * @return @a false si no se pudo crear el archivo
+ */
+bool Diagnostico::iniciarRegistro(const QString& ruta) {
+    detenerRegistro();
+
+    QString archivo = ruta;
+    if (archivo.isEmpty()) {
+        QDir dir = QDir::homePath() + "/" + QCoreApplication::applicationName() + "/";
+        if (!dir.exists())
+            dir.mkpath(".");
+
+        // Cada dispositivo tiene su propio registro
+        QString nombre = "Diagnostico";
+        if (!objectName().isEmpty())
+            nombre.append("-" + objectName());
+
+        archivo = dir.filePath(QString("%1-%2.csv")
+                               .arg(nombre)
+                               .arg(QDateTime::currentDateTime().toString("hh_mm_ss - dd_MMM_yyyy")));
+    }
+
+    m_registro.setFileName(archivo);
+    if (!m_registro.open(QFile::WriteOnly | QFile::Text)) {
+        qWarning() << "No se puede crear el registro de diagnostico" << archivo;
+        return false;
+    }
+
+    m_csv = archivo.endsWith(".csv", Qt::CaseInsensitive);
+    if (m_csv) {
+        QByteArray encabezado = "tiempo_s";
+        for (int i = 0; i < NumCampos; ++i)
+            encabezado.append(',').append(CAMPOS[i]);
+
+        m_registro.write(encabezado.append('\n'));
+    }
+
+    emit registroCambiado();
+    return true;
+}
+
+/**
+ * Deja de registrar el resumen
+ */
+void Diagnostico::detenerRegistro() {
+    if (m_registro.isOpen()) {
+        m_registro.close();
+        emit registroCambiado();
+    }
+}
+
+/**
+ * Cambia el periodo (en ms) del resumen
+ */
+void Diagnostico::cambiarIntervalo(const int intervalo) {
+    m_temporizador.setInterval(qMax(10, intervalo));
+}
+
+/**
+ * Lee los contadores de cada etapa y calcula el resumen del ultimo
+ * intervalo
+ */
+void Diagnostico::actualizar() {
+    const qreal segundos = qMax<qreal>(1e-3, m_reloj.restart() / 1000.0);
+    const EtapasAdquisicion& etapas = m_adquisicion->etapas();
+
+    // Leer histogramas
+    leer(etapas.bytesPorLectura, &m_bytesPorLectura);
+    leer(etapas.decodificacion, &m_decodificacion);
+    leer(etapas.procesamiento, &m_procesamiento);
+    leer(m_latencia, &m_intervaloLatencia);
+    leer(m_dibujo, &m_intervaloDibujo);
+
+    // Los contadores del decodificador se reinician en cada conexion
+    const quint64 bytes = etapas.bytesLeidos.load();
+    const quint64 muestras = etapas.muestras.load();
+    const quint64 deltaMuestras = muestras >= m_muestrasAnteriores ? muestras - m_muestrasAnteriores : muestras;
+    m_valores[CampoBytesPorSegundo] = (bytes - m_bytesAnteriores) / segundos;
+    m_valores[CampoMuestrasPorSegundo] = deltaMuestras / segundos;
+    m_bytesAnteriores = bytes;
+    m_muestrasAnteriores = muestras;
+
+    // Tiempos de cada etapa
+    m_valores[CampoBytesPorLectura] = percentil(m_bytesPorLectura, 0.5);
+    m_valores[CampoDecodificacion] = percentil(m_decodificacion, 0.99) / 1e3;
+    m_valores[CampoProcesamiento] = percentil(m_procesamiento, 0.99) / 1e3;
+    m_valores[CampoDibujo] = percentil(m_intervaloDibujo, 0.99) / 1e3;
+    m_valores[CampoLatenciaP50] = percentil(m_intervaloLatencia, 0.5) / 1e6;
+    m_valores[CampoLatenciaP99] = percentil(m_intervaloLatencia, 0.99) / 1e6;
+    m_valores[CampoLatenciaMaxima] = percentil(m_intervaloLatencia, 1) / 1e6;
+
+    // Cola, lecturas perdidas y grabador
+    m_valores[CampoProfundidadCola] = m_cola->count();
+    m_valores[CampoTramasInvalidas] = etapas.tramasInvalidas.load();
+    m_valores[CampoBytesDescartados] = etapas.bytesDescartados.load();
+    m_valores[CampoTramasPerdidas] = etapas.tramasPerdidas.load();
+    m_valores[CampoLecturasPerdidas] = m_adquisicion->lecturasPerdidas();
+    m_valores[CampoPendientesGrabador] = m_adquisicion->grabador().pendientes();
+    m_valores[CampoDescartadasGrabador] = m_adquisicion->grabador().lecturasDescartadas();
+
+    escribirRegistro();
+    emit actualizado();
+}
+
+/**
+ * Guarda las cubetas del @a histograma como las cubetas actuales del
+ * @a intervalo
+ */
+void Diagnostico::leer(const Histograma& histograma, Intervalo* intervalo) {
+    intervalo->anteriores.swap(intervalo->actuales);
+    histograma.leer(intervalo->actuales.data());
+}
+
+/**
+ * Regresa el percentil @a p de los valores registrados en el @a intervalo
+ */
+quint64 Diagnostico::percentil(const Intervalo& intervalo, const qreal p) const {
+    return Histograma::percentil(intervalo.actuales.constData(),
+                                 intervalo.anteriores.constData(), p);
+}
+
+/**
+ * Agrega el resumen actual al archivo de registro
+ */
+void Diagnostico::escribirRegistro() {
+    if (!m_registro.isOpen())
+        return;
+
+    const double tiempo = m_inicio.elapsed() / 1000.0;
+
+    if (m_csv) {
+        QByteArray fila = QByteArray::number(tiempo, 'f', 3);
+        for (int i = 0; i < NumCampos; ++i)
+            fila.append(',').append(QByteArray::number(m_valores[i], 'g', 10));
+
+        m_registro.write(fila.append('\n'));
+    }
+
+    else {
+        QJsonObject objeto;
+        objeto["tiempo_s"] = tiempo;
+        for (int i = 0; i < NumCampos; ++i)
+            objeto[CAMPOS[i]] = m_valores[i];
+
+        m_registro.write(QJsonDocument(objeto).toJson(QJsonDocument::Compact).append('\n'));
+    }
+
+    m_registro.flush();
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DIAGNOSTICO_H
+#define DIAGNOSTICO_H
+
+#include <QFile>
+#include <QTimer>
+#include <QObject>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include "Muestra.h"
+#include "ColaSPSC.h"
+#include "Instrumentacion.h"
+
+//
+// Resumen periodico de las etapas de la ruta de datos: lectura del puerto,
+// decodificacion, procesamiento, cola de la interfaz grafica, grabador y
+// dibujo de la grafica.
+//
+// Los contadores de cada etapa se leen sin bloqueos cada intervalo, los
+// percentiles se calculan con los valores registrados durante el ultimo
+// intervalo. El resumen se expone como propiedades para la interfaz
+// grafica y se puede registrar en un archivo CSV o JSON (una linea por
+// intervalo).
+//
+class Adquisicion;
+class Diagnostico : public QObject {
+    Q_OBJECT
+
+    Q_PROPERTY(qreal bytesPorSegundo
+               READ bytesPorSegundo
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal muestrasPorSegundo
+               READ muestrasPorSegundo
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal bytesPorLectura
+               READ bytesPorLectura
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal decodificacion
+               READ decodificacion
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal procesamiento
+               READ procesamiento
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal dibujo
+               READ dibujo
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal latenciaP50
+               READ latenciaP50
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal latenciaP99
+               READ latenciaP99
+               NOTIFY actualizado)
+    Q_PROPERTY(qreal latenciaMaxima
+               READ latenciaMaxima
+               NOTIFY actualizado)
+    Q_PROPERTY(int profundidadCola
+               READ profundidadCola
+               NOTIFY actualizado)
+    Q_PROPERTY(int capacidadCola
+               READ capacidadCola
+               CONSTANT)
+    Q_PROPERTY(quint64 tramasInvalidas
+               READ tramasInvalidas
+               NOTIFY actualizado)
+    Q_PROPERTY(quint64 bytesDescartados
+               READ bytesDescartados
+               NOTIFY actualizado)
+    Q_PROPERTY(quint64 tramasPerdidas
+               READ tramasPerdidas
+               NOTIFY actualizado)
+    Q_PROPERTY(quint64 lecturasPerdidas
+               READ lecturasPerdidas
+               NOTIFY actualizado)
+    Q_PROPERTY(qint64 pendientesGrabador
+               READ pendientesGrabador
+               NOTIFY actualizado)
+    Q_PROPERTY(quint64 descartadasGrabador
+               READ descartadasGrabador
+               NOTIFY actualizado)
+    Q_PROPERTY(QString archivoRegistro
+               READ archivoRegistro
+               NOTIFY registroCambiado)
+
+signals:
+    void actualizado();
+    void registroCambiado();
+
+public:
+    Diagnostico(const Adquisicion* adquisicion,
+                const ColaSPSC<Lectura>* cola,
+                QObject* parent = Q_NULLPTR);
+    ~Diagnostico();
+
+    qreal bytesPorSegundo() const;
+    qreal muestrasPorSegundo() const;
+    qreal bytesPorLectura() const;
+    qreal decodificacion() const;
+    qreal procesamiento() const;
+    qreal dibujo() const;
+    qreal latenciaP50() const;
+    qreal latenciaP99() const;
+    qreal latenciaMaxima() const;
+    int profundidadCola() const;
+    int capacidadCola() const;
+    quint64 tramasInvalidas() const;
+    quint64 bytesDescartados() const;
+    quint64 tramasPerdidas() const;
+    quint64 lecturasPerdidas() const;
+    qint64 pendientesGrabador() const;
+    quint64 descartadasGrabador() const;
+    QString archivoRegistro() const;
+
+    void registrarLlegada(const qint64 llegada);
+    void registrarDibujo(const qint64 duracion);
+
+public slots:
+    bool iniciarRegistro(const QString& ruta = QString());
+    void detenerRegistro();
+    void cambiarIntervalo(const int intervalo);
+
+private slots:
+    void actualizar();
+
+private:
+    //
+    // Cubetas de un histograma al final del intervalo anterior y actual
+    //
+    struct Intervalo {
+        QVector<quint32> anteriores;
+        QVector<quint32> actuales;
+    };
+
+    void leer(const Histograma& histograma, Intervalo* intervalo);
+    quint64 percentil(const Intervalo& intervalo, const qreal p) const;
+    void escribirRegistro();
+
+private:
+    enum Campo {
+        CampoBytesPorSegundo,
+        CampoMuestrasPorSegundo,
+        CampoBytesPorLectura,
+        CampoDecodificacion,
+        CampoProcesamiento,
+        CampoDibujo,
+        CampoLatenciaP50,
+        CampoLatenciaP99,
+        CampoLatenciaMaxima,
+        CampoProfundidadCola,
+        CampoTramasInvalidas,
+        CampoBytesDescartados,
+        CampoTramasPerdidas,
+        CampoLecturasPerdidas,
+        CampoPendientesGrabador,
+        CampoDescartadasGrabador,
+        NumCampos,
+    };
+
+    const Adquisicion* m_adquisicion;
+    const ColaSPSC<Lectura>* m_cola;
+
+    QTimer m_temporizador;
+    QElapsedTimer m_reloj;
+    QElapsedTimer m_inicio;
+    quint64 m_bytesAnteriores;
+    quint64 m_muestrasAnteriores;
+
+    qint64 m_llegada;
+    Histograma m_latencia;
+    Histograma m_dibujo;
+
+    Intervalo m_bytesPorLectura;
+    Intervalo m_decodificacion;
+    Intervalo m_procesamiento;
+    Intervalo m_intervaloLatencia;
+    Intervalo m_intervaloDibujo;
+
+    double m_valores[NumCampos];
+
+    bool m_csv;
+    QFile m_registro;
+};
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Dispositivo.h"
+#include "Adquisicion.h"
+#include "Serial.h"
+
+#include <QFileInfo>
+
+/**
+ * Crea la adquisicion del dispositivo y la mueve al @a hilo de adquisicion
+ * especificado, el cual puede ser compartido con otros dispositivos
+ */
+Dispositivo::Dispositivo(QThread* hilo, QObject* parent) : QObject(parent), m_cola(16384) {
+    Q_ASSERT(hilo != Q_NULLPTR);
+
+    // Inicializar valores
+    m_hilo = hilo;
+    m_conectado = false;
+    m_superpuesto = false;
+    m_numLecturas = 0;
+    m_escala = 0;
+    m_anchoGrafica = 0;
+    m_gmasHabilitado = false;
+    m_velocidad = 0;
+    m_modoControl = Adquisicion::ControlManual;
+    m_consigna = 0;
+    m_latencia = -1;
+    m_canalEspectro = 3;
+    m_versionEspectro = 0;
+    m_analisis = Analisis();
+    m_modoTelemetria = Protocolo::ModoFiltrado;
+    m_decimacion = 2;
+    m_versionResumen = 0;
+    m_resumen = ResumenVentana();
+
+    // Mover el puerto y el procesamiento de datos al hilo de adquisicion
+    m_adquisicion = new Adquisicion(&m_cola);
+    m_adquisicion->moveToThread(m_hilo);
+    connect(m_adquisicion, &Adquisicion::conexionCambiada,
+            this,          &Dispositivo::onConexionCambiada);
+
+    // Resumen de las etapas de la ruta de datos
+    m_diagnostico = new Diagnostico(m_adquisicion, &m_cola, this);
+}
+
+/**
+ * Cierra la conexion con el dispositivo, la adquisicion se elimina en su
+ * propio hilo
+ */
+Dispositivo::~Dispositivo() {
+    desconectar();
+
+    delete m_diagnostico;
+    m_adquisicion->deleteLater();
+}
+
+/**
+ * Regresa el hilo de adquisicion del dispositivo
+ */
+QThread* Dispositivo::hilo() const {
+    return m_hilo;
+}
+
+/**
+ * Regresa el puerto serial o la ruta del archivo que se abrio por ultima
+ * vez, o una cadena vacia si el dispositivo nunca se ha conectado
+ */
+QString Dispositivo::puerto() const {
+    return m_puerto;
+}
+
+/**
+ * Regresa el nombre del dispositivo que se muestra en la interfaz grafica
+ */
+QString Dispositivo::nombre() const {
+    if (m_puerto.isEmpty())
+        return tr("Sin conexión");
+
+    return QFileInfo(m_puerto).fileName();
+}
+
+/**
+ * Regresa @a true si el dispositivo esta conectado
+ */
+bool Dispositivo::conectado() const {
+    return m_conectado;
+}
+
+/**
+ * Regresa @a true si las señales del dispositivo se dibujan sobre las del
+ * dispositivo actual
+ */
+bool Dispositivo::superpuesto() const {
+    return m_superpuesto;
+}
+
+/**
+ * Regresa el tiempo de la ultima lectura del historial
+ */
+quint64 Dispositivo::numLecturas() const {
+    return m_numLecturas;
+}
+
+/**
+ * Regresa @a true si el motor del dispositivo esta habilitado
+ */
+bool Dispositivo::gmasHabilitado() const {
+    return m_gmasHabilitado;
+}
+
+/**
+ * Regresa la velocidad manual del motor
+ */
+qreal Dispositivo::velocidad() const {
+    return m_velocidad;
+}
+
+/**
+ * Regresa el modo de control del motor (ver Adquisicion::ModoControl)
+ */
+int Dispositivo::modoControl() const {
+    return m_modoControl;
+}
+
+/**
+ * Regresa la consigna de los modos de lazo cerrado, en las unidades que se
+ * muestran en pantalla
+ */
+qreal Dispositivo::consigna() const {
+    return m_consigna;
+}
+
+/**
+ * Regresa la señal de la grafica cuyo espectro se analiza
+ */
+int Dispositivo::canalEspectro() const {
+    return m_canalEspectro;
+}
+
+/**
+ * Regresa la frecuencia (Hz) de la oscilacion dominante
+ */
+qreal Dispositivo::frecuencia() const {
+    return m_analisis.frecuencia;
+}
+
+/**
+ * Regresa la amplitud de la oscilacion dominante, en las unidades de la
+ * señal analizada
+ */
+qreal Dispositivo::amplitud() const {
+    qreal factor;
+    Serial::canalDeSenal(m_canalEspectro, &factor);
+    return m_analisis.amplitud * factor;
+}
+
+/**
+ * Regresa el tiempo de ida y vuelta (en ms) del ultimo comando confirmado,
+ * o -1 si el MCU no confirma comandos
+ */
+qreal Dispositivo::latenciaComandos() const {
+    if (m_latencia < 0)
+        return -1;
+
+    return m_latencia / 1000.0;
+}
+
+/**
+ * Regresa el modo de telemetria del MCU (ver Protocolo::ModoTelemetria)
+ */
+int Dispositivo::modoTelemetria() const {
+    return m_modoTelemetria;
+}
+
+/**
+ * Regresa el numero de muestras del MCU por cada trama que manda
+ */
+int Dispositivo::decimacion() const {
+    return m_decimacion;
+}
+
+/**
+ * Regresa el ultimo resumen de ventana que mando el MCU en el modo resumen
+ */
+const ResumenVentana& Dispositivo::resumen() const {
+    return m_resumen;
+}
+
+/**
+ * Regresa la configuracion de la cadena de filtros que se aplica a las
+ * lecturas (ver CadenaFiltros::leerEtapas())
+ */
+QVariantList Dispositivo::filtros() const {
+    return m_filtros;
+}
+
+/**
+ * Regresa el ultimo analisis del espectro de la señal seleccionada
+ */
+const Analisis& Dispositivo::analisis() const {
+    return m_analisis;
+}
+
+/**
+ * Regresa las magnitudes del ultimo espectro de la señal seleccionada
+ */
+const QVector<float>& Dispositivo::magnitudes() const {
+    return m_magnitudes;
+}
+
+/**
+ * Regresa el resumen de la ruta de datos del dispositivo
+ */
+Diagnostico* Dispositivo::diagnostico() const {
+    return m_diagnostico;
+}
+
+/**
+ * Regresa el historial de lecturas del dispositivo, solo se debe leer
+ * desde el hilo de la interfaz grafica o mientras esta bloqueado
+ */
+const BufferCircular<NumCanales>& Dispositivo::lecturas() const {
+    return m_lecturas;
+}
+
+/**
+ * Regresa el minimo y el maximo por pixel del historial
+ */
+const Decimador<NumCanales>& Dispositivo::decimador() const {
+    return m_decimador;
+}
+
+/**
+ * Abre el @a puerto serial en el hilo de adquisicion, este metodo espera a
+ * que el hilo termine de abrir el puerto.
+ *
+ * @return @a true si la conexion se establecio con exito
+ */
+bool Dispositivo::conectar(const QString& puerto) {
+    limpiar();
+    m_puerto = puerto;
+    m_diagnostico->setObjectName(nombre());
+
+    bool conectado = false;
+    QMetaObject::invokeMethod(m_adquisicion, "conectar",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, conectado),
+                              Q_ARG(QString, puerto));
+
+    emit conexionCambiada();
+    return conectado;
+}
+
+/**
+ * Reproduce el archivo en la @a ruta especificada como si fuera un
+ * dispositivo conectado (ver Adquisicion::reproducir())
+ *
+ * @return @a true si el archivo se pudo abrir
+ */
+bool Dispositivo::reproducir(const QString& ruta, const qreal velocidad) {
+    limpiar();
+    m_puerto = ruta;
+    m_diagnostico->setObjectName(nombre());
+
+    bool abierto = false;
+    QMetaObject::invokeMethod(m_adquisicion, "reproducir",
+                              Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(bool, abierto),
+                              Q_ARG(QString, ruta),
+                              Q_ARG(qreal, velocidad));
+
+    emit conexionCambiada();
+    return abierto;
+}
+
+/**
+ * Apaga el motor y cierra la conexion con el dispositivo, el historial se
+ * conserva para poder compararlo con otros dispositivos
+ */
+void Dispositivo::desconectar() {
+    QMetaObject::invokeMethod(m_adquisicion, "desconectar",
+                              Qt::BlockingQueuedConnection);
+    sincronizar();
+}
+
+/**
+ * Lee las lecturas que el hilo de adquisicion publico desde la ultima
+ * llamada y las agrega al historial que se usa para las graficas
+ */
+void Dispositivo::sincronizar() {
+    int n;
+    while ((n = m_cola.leer(m_bloque, MAX_LECTURAS)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            m_lecturas.agregar(m_bloque[i].tiempo, m_bloque[i].valores);
+            m_decimador.agregar(m_bloque[i].tiempo, m_bloque[i].valores);
+        }
+
+        m_diagnostico->registrarLlegada(m_bloque[n - 1].llegada);
+    }
+
+    if (!m_lecturas.isEmpty())
+        m_numLecturas = static_cast<quint64>(m_lecturas.ultimoTiempo());
+
+    if (m_adquisicion->leerEspectro(&m_analisis, &m_magnitudes, &m_versionEspectro))
+        emit espectroCambiado();
+
+    if (m_adquisicion->leerResumen(&m_resumen, &m_versionResumen))
+        emit resumenCambiado();
+
+    const qint32 latencia = m_adquisicion->latencia();
+    if (latencia != m_latencia) {
+        m_latencia = latencia;
+        emit latenciaCambiada();
+    }
+}
+
+/**
+ * Ajusta el historial a la @a escala de la grafica y las columnas del
+ * decimador a su ancho en @a pixeles, si las columnas cambiaron se vuelven
+ * a agregar las lecturas del historial
+ */
+void Dispositivo::cambiarVentana(const int escala, const int pixeles) {
+    if (escala != m_escala) {
+        m_escala = escala;
+        m_lecturas.cambiarCapacidad(escala);
+    }
+
+    m_anchoGrafica = pixeles;
+    if (!m_decimador.configurar(m_anchoGrafica, m_escala))
+        return;
+
+    const int count = m_lecturas.count();
+    const qreal* tiempos = m_lecturas.tiempos();
+    float valores[NumCanales];
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < NumCanales; ++j)
+            valores[j] = m_lecturas.canal(j)[i];
+
+        m_decimador.agregar(tiempos[i], valores);
+    }
+}
+
+/**
+ * Dibuja (o deja de dibujar) las señales del dispositivo sobre las del
+ * dispositivo actual
+ */
+void Dispositivo::cambiarSuperpuesto(const bool superpuesto) {
+    if (superpuesto != m_superpuesto) {
+        m_superpuesto = superpuesto;
+        emit superpuestoCambiado();
+    }
+}
+
+/**
+ * Habilita o des-habilita el motor del dispositivo
+ */
+void Dispositivo::habilitar(const bool habilitado) {
+    m_gmasHabilitado = habilitado && m_conectado;
+    actualizarVelocidad();
+    emit controlCambiado();
+}
+
+/**
+ * Cambia la velocidad manual del motor
+ */
+void Dispositivo::cambiarVelocidad(const qreal velocidad) {
+    m_velocidad = velocidad;
+    actualizarVelocidad();
+    emit controlCambiado();
+}
+
+/**
+ * Cambia el @a modo de control del motor y la @a consigna que se quiere
+ * mantener en los modos de lazo cerrado
+ */
+void Dispositivo::cambiarControl(const int modo, const qreal consigna) {
+    m_modoControl = modo;
+    m_consigna = consigna;
+    actualizarVelocidad();
+    emit controlCambiado();
+}
+
+/**
+ * Cambia la @a signal de la grafica (ver Serial::actualizarGrafica()) cuyo
+ * espectro se analiza
+ */
+void Dispositivo::cambiarCanalEspectro(const int signal) {
+    qreal factor;
+    m_canalEspectro = signal;
+    QMetaObject::invokeMethod(m_adquisicion, "cambiarCanalEspectro",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, Serial::canalDeSenal(signal, &factor)));
+
+    if (m_modoControl == Adquisicion::ControlAmplitud)
+        actualizarVelocidad();
+}
+
+/**
+ * Pide al GMAS que vuelva a calibrar su sensor, el GMAS debe estar en
+ * reposo
+ */
+void Dispositivo::recalibrar() {
+    QMetaObject::invokeMethod(m_adquisicion, "recalibrar",
+                              Qt::QueuedConnection);
+}
+
+/**
+ * Cambia el @a modo de telemetria del MCU y su @a decimacion, el MCU manda
+ * una trama por cada @a decimacion muestras (ver Protocolo::ModoTelemetria)
+ */
+void Dispositivo::cambiarTelemetria(const int modo, const int decimacion) {
+    m_modoTelemetria = modo;
+    m_decimacion = decimacion;
+    QMetaObject::invokeMethod(m_adquisicion, "cambiarTelemetria",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, modo),
+                              Q_ARG(int, decimacion));
+    emit telemetriaCambiada();
+}
+
+/**
+ * Remplaza la cadena de @a filtros que se aplica a las lecturas del
+ * acelerometro y giroscopio antes de graficarlas, grabarlas y analizarlas
+ */
+void Dispositivo::cambiarFiltros(const QVariantList& filtros) {
+    m_filtros = filtros;
+    QMetaObject::invokeMethod(m_adquisicion, "configurarFiltros",
+                              Qt::QueuedConnection,
+                              Q_ARG(QVariantList, filtros));
+    emit filtrosCambiados();
+}
+
+/**
+ * Actualiza el estado de la conexion reportado por el hilo de adquisicion,
+ * el motor se des-habilita cuando el dispositivo se desconecta
+ */
+void Dispositivo::onConexionCambiada(const bool conectado) {
+    m_conectado = conectado;
+    if (!conectado && m_gmasHabilitado) {
+        m_gmasHabilitado = false;
+        emit controlCambiado();
+    }
+
+    emit conexionCambiada();
+}
+
+/**
+ * Descarta las lecturas de la conexion anterior
+ */
+void Dispositivo::limpiar() {
+    sincronizar();
+    m_lecturas.limpiar();
+    m_decimador.limpiar();
+    m_numLecturas = 0;
+}
+
+/**
+ * Manda el estado del motor, la velocidad, el modo de control y la
+ * consigna actuales al hilo de adquisicion, el cual los combina en un
+ * solo comando para el GMAS
+ */
+void Dispositivo::actualizarVelocidad() {
+    QMetaObject::invokeMethod(m_adquisicion, "habilitar",
+                              Qt::QueuedConnection,
+                              Q_ARG(bool, m_gmasHabilitado));
+    QMetaObject::invokeMethod(m_adquisicion, "cambiarVelocidad",
+                              Qt::QueuedConnection,
+                              Q_ARG(qreal, m_gmasHabilitado ? m_velocidad : 0));
+
+    // La amplitud se muestra en otras unidades que las de la señal
+    qreal factor = 1;
+    if (m_modoControl == Adquisicion::ControlAmplitud)
+        Serial::canalDeSenal(m_canalEspectro, &factor);
+
+    // Solo cerrar el lazo de control si el GMAS esta habilitado
+    const int modo = m_gmasHabilitado ? m_modoControl : Adquisicion::ControlManual;
+    QMetaObject::invokeMethod(m_adquisicion, "cambiarControl",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, modo),
+                              Q_ARG(qreal, m_consigna / factor));
+}
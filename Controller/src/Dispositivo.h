@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef DISPOSITIVO_H
+#define DISPOSITIVO_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QVariantList>
+
+#include "Muestra.h"
+#include "ColaSPSC.h"
+#include "Espectro.h"
+#include "Decimador.h"
+#include "Diagnostico.h"
+#include "BufferCircular.h"
+
+//
+// Un GMAS conectado (o un archivo que se reproduce) con su propia ruta de
+// datos: la adquisicion corre en uno de los hilos de adquisicion y publica
+// sus lecturas en una cola exclusiva del dispositivo, del lado de la
+// interfaz grafica cada dispositivo tiene su historial, su decimador, su
+// espectro y su estado de control. Los dispositivos no comparten ningun
+// bloqueo entre si.
+//
+class Adquisicion;
+class Dispositivo : public QObject {
+    Q_OBJECT
+
+    Q_PROPERTY(QString nombre
+               READ nombre
+               NOTIFY conexionCambiada)
+    Q_PROPERTY(bool conectado
+               READ conectado
+               NOTIFY conexionCambiada)
+    Q_PROPERTY(bool superpuesto
+               READ superpuesto
+               WRITE cambiarSuperpuesto
+               NOTIFY superpuestoCambiado)
+    Q_PROPERTY(bool gmasHabilitado
+               READ gmasHabilitado
+               NOTIFY controlCambiado)
+    Q_PROPERTY(qreal velocidad
+               READ velocidad
+               NOTIFY controlCambiado)
+    Q_PROPERTY(qreal frecuencia
+               READ frecuencia
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal amplitud
+               READ amplitud
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal latenciaComandos
+               READ latenciaComandos
+               NOTIFY latenciaCambiada)
+    Q_PROPERTY(int modoTelemetria
+               READ modoTelemetria
+               NOTIFY telemetriaCambiada)
+    Q_PROPERTY(int decimacion
+               READ decimacion
+               NOTIFY telemetriaCambiada)
+    Q_PROPERTY(QVariantList filtros
+               READ filtros
+               NOTIFY filtrosCambiados)
+    Q_PROPERTY(Diagnostico* diagnostico
+               READ diagnostico
+               CONSTANT)
+
+signals:
+    void conexionCambiada();
+    void superpuestoCambiado();
+    void controlCambiado();
+    void espectroCambiado();
+    void latenciaCambiada();
+    void telemetriaCambiada();
+    void resumenCambiado();
+    void filtrosCambiados();
+
+public:
+    Dispositivo(QThread* hilo, QObject* parent = Q_NULLPTR);
+    ~Dispositivo();
+
+    QThread* hilo() const;
+    QString puerto() const;
+    QString nombre() const;
+    bool conectado() const;
+    bool superpuesto() const;
+    quint64 numLecturas() const;
+
+    bool gmasHabilitado() const;
+    qreal velocidad() const;
+    int modoControl() const;
+    qreal consigna() const;
+    int canalEspectro() const;
+
+    qreal frecuencia() const;
+    qreal amplitud() const;
+    qreal latenciaComandos() const;
+    int modoTelemetria() const;
+    int decimacion() const;
+    const ResumenVentana& resumen() const;
+    QVariantList filtros() const;
+    const Analisis& analisis() const;
+    const QVector<float>& magnitudes() const;
+
+    Diagnostico* diagnostico() const;
+    const BufferCircular<NumCanales>& lecturas() const;
+    const Decimador<NumCanales>& decimador() const;
+
+    bool conectar(const QString& puerto);
+    bool reproducir(const QString& ruta, const qreal velocidad);
+    void desconectar();
+
+public slots:
+    void sincronizar();
+    void cambiarVentana(const int escala, const int pixeles);
+    void cambiarSuperpuesto(const bool superpuesto);
+    void habilitar(const bool habilitado);
+    void cambiarVelocidad(const qreal velocidad);
+    void cambiarControl(const int modo, const qreal consigna);
+    void cambiarCanalEspectro(const int signal);
+    void recalibrar();
+    void cambiarTelemetria(const int modo, const int decimacion);
+    void cambiarFiltros(const QVariantList& filtros);
+
+private slots:
+    void onConexionCambiada(const bool conectado);
+
+private:
+    void limpiar();
+    void actualizarVelocidad();
+
+private:
+    static const int MAX_LECTURAS = 1024;
+
+    QThread* m_hilo;
+    QString m_puerto;
+    bool m_conectado;
+    bool m_superpuesto;
+    quint64 m_numLecturas;
+
+    int m_escala;
+    int m_anchoGrafica;
+    BufferCircular<NumCanales> m_lecturas;
+    Decimador<NumCanales> m_decimador;
+
+    ColaSPSC<Lectura> m_cola;
+    Adquisicion* m_adquisicion;
+    Diagnostico* m_diagnostico;
+    Lectura m_bloque[MAX_LECTURAS];
+
+    bool m_gmasHabilitado;
+    qreal m_velocidad;
+    int m_modoControl;
+    qreal m_consigna;
+    qint32 m_latencia;
+
+    int m_canalEspectro;
+    Analisis m_analisis;
+    quint32 m_versionEspectro;
+    QVector<float> m_magnitudes;
+
+    int m_modoTelemetria;
+    int m_decimacion;
+    ResumenVentana m_resumen;
+    quint32 m_versionResumen;
+
+    QVariantList m_filtros;
+};
+
+#endif
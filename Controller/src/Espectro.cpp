@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Espectro.h"
+
+#include <math.h>
+#include <string.h>
+
+/**
+ * Valor de pi en precision doble
+ */
+static const double PI = 3.14159265358979323846;
+
+/**
+ * Bin mas bajo que se considera al buscar el pico dominante, los bins
+ * inferiores contienen la fuga del componente de DC
+ */
+static const int BIN_MINIMO = 3;
+
+/**
+ * Genera las tablas de la FFT e inicializa el estado del analizador
+ */
+Espectro::Espectro() {
+    const int n = TAMANO_VENTANA;
+    const int m = TAMANO_VENTANA / 2;
+
+    // Ventana de Hann periodica
+    for (int i = 0; i < n; ++i)
+        m_hann[i] = static_cast<float>(0.5 - 0.5 * cos(2 * PI * i / n));
+
+    // Factores de giro para los angulos 2*pi*i/n con i < n/2
+    for (int i = 0; i < m; ++i) {
+        m_cos[i] = static_cast<float>(cos(2 * PI * i / n));
+        m_sin[i] = static_cast<float>(sin(2 * PI * i / n));
+    }
+
+    // Tabla de indices con bits invertidos para la FFT compleja de n/2
+    int bits = 0;
+    while ((1 << bits) < m)
+        ++bits;
+
+    for (int i = 0; i < m; ++i) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b)
+            if (i & (1 << b))
+                r |= 1 << (bits - 1 - b);
+
+        m_bitsInvertidos[i] = r;
+    }
+
+    reiniciar();
+}
+
+/**
+ * Descarta las muestras y resultados anteriores
+ */
+void Espectro::reiniciar() {
+    m_indice = 0;
+    m_muestras = 0;
+    m_desdeFft = 0;
+    m_periodo = 0;
+
+    m_binDominante = 0;
+    m_frecuencia = 0;
+    m_amplitud = 0;
+    m_fase = 0;
+    m_amortiguamiento = 0;
+    m_amplitudAnterior = 0;
+
+    m_periodograma = 0;
+    m_numPeriodogramas = 0;
+
+    memset(m_ventana, 0, sizeof(m_ventana));
+    memset(m_magnitudes, 0, sizeof(m_magnitudes));
+    memset(m_binRe, 0, sizeof(m_binRe));
+    memset(m_binIm, 0, sizeof(m_binIm));
+}
+
+/**
+ * Agrega el siguiente @a valor de la señal, tomado @a periodo segundos
+ * despues del valor anterior. Regresa @c true si se calculo un nuevo
+ * espectro con esta muestra.
+ */
+bool Espectro::agregar(const float valor, const float periodo) {
+    // Promediar el periodo de muestreo
+    if (m_muestras == 0)
+        m_periodo = periodo;
+    else
+        m_periodo += 0.01f * (periodo - m_periodo);
+
+    // Remplazar la muestra mas antigua de la ventana
+    const float anterior = m_ventana[m_indice];
+    m_ventana[m_indice] = valor;
+    m_indice = (m_indice + 1) % TAMANO_VENTANA;
+    if (m_muestras < TAMANO_VENTANA)
+        ++m_muestras;
+
+    // Actualizar la DFT deslizante alrededor del pico dominante
+    if (m_binDominante > 0) {
+        const double delta = static_cast<double>(valor) - anterior;
+        for (int b = 0; b < NUM_BINS_DESLIZANTES; ++b) {
+            const double re = m_binRe[b] + delta;
+            const double im = m_binIm[b];
+            m_binRe[b] = re * m_giroRe[b] - im * m_giroIm[b];
+            m_binIm[b] = re * m_giroIm[b] + im * m_giroRe[b];
+        }
+
+        estimarPico();
+    }
+
+    // Calcular el espectro completo cada SALTO muestras
+    if (++m_desdeFft >= SALTO && m_muestras >= TAMANO_VENTANA) {
+        m_desdeFft = 0;
+        calcularEspectro();
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Regresa la frecuencia de la oscilacion dominante en Hz
+ */
+float Espectro::frecuencia() const {
+    return m_frecuencia;
+}
+
+/**
+ * Regresa la amplitud de la oscilacion dominante, en las unidades de la
+ * señal analizada
+ */
+float Espectro::amplitud() const {
+    return m_amplitud;
+}
+
+/**
+ * Regresa la fase (en radianes) de la oscilacion dominante en la ultima
+ * muestra recibida
+ */
+float Espectro::fase() const {
+    return m_fase;
+}
+
+/**
+ * Regresa la razon de amortiguamiento estimada a partir del decremento
+ * logaritmico de la amplitud. Un valor negativo indica que la amplitud
+ * esta creciendo.
+ */
+float Espectro::amortiguamiento() const {
+    return m_amortiguamiento;
+}
+
+/**
+ * Regresa la separacion en Hz entre dos bins del espectro
+ */
+float Espectro::resolucion() const {
+    if (m_periodo <= 0)
+        return 0;
+
+    return 1.0f / (TAMANO_VENTANA * m_periodo);
+}
+
+/**
+ * Regresa la amplitud promedio de cada uno de los NUM_BINS bins del
+ * espectro, desde 0 Hz hasta la frecuencia de Nyquist
+ */
+const float* Espectro::magnitudes() const {
+    return m_magnitudes;
+}
+
+/**
+ * Regresa los resultados del analisis en una sola estructura
+ */
+Analisis Espectro::analisis() const {
+    Analisis analisis;
+    analisis.frecuencia = m_frecuencia;
+    analisis.amplitud = m_amplitud;
+    analisis.fase = m_fase;
+    analisis.amortiguamiento = m_amortiguamiento;
+    analisis.resolucion = resolucion();
+    return analisis;
+}
+
+/**
+ * Calcula la FFT de la ventana actual, la agrega al promedio de Welch y
+ * vuelve a sembrar la DFT deslizante en el pico dominante
+ */
+void Espectro::calcularEspectro() {
+    const int n = TAMANO_VENTANA;
+
+    // Ordenar la ventana (de la muestra mas antigua a la mas reciente)
+    // y calcular su promedio
+    double suma = 0;
+    for (int i = 0; i < n; ++i) {
+        m_entrada[i] = m_ventana[(m_indice + i) % n];
+        suma += m_entrada[i];
+    }
+
+    // Eliminar el componente de DC y aplicar la ventana de Hann
+    const float promedio = static_cast<float>(suma / n);
+    for (int i = 0; i < n; ++i)
+        m_entrada[i] = (m_entrada[i] - promedio) * m_hann[i];
+
+    fftReal(m_entrada, m_re, m_im);
+
+    // Guardar el periodograma y promediar con los anteriores
+    float* potencias = m_potencias[m_periodograma];
+    for (int k = 0; k < NUM_BINS; ++k)
+        potencias[k] = m_re[k] * m_re[k] + m_im[k] * m_im[k];
+
+    m_periodograma = (m_periodograma + 1) % NUM_PROMEDIOS;
+    if (m_numPeriodogramas < NUM_PROMEDIOS)
+        ++m_numPeriodogramas;
+
+    // La ganancia coherente de la ventana de Hann es 0.5, por lo que la
+    // amplitud de una senoidal es 4 * |X| / n
+    const float escala = 4.0f / n;
+    int dominante = BIN_MINIMO;
+    for (int k = 0; k < NUM_BINS; ++k) {
+        float total = 0;
+        for (int p = 0; p < m_numPeriodogramas; ++p)
+            total += m_potencias[p][k];
+
+        m_magnitudes[k] = escala * sqrtf(total / m_numPeriodogramas);
+
+        if (k >= BIN_MINIMO && k < NUM_BINS - BIN_MINIMO
+                && m_magnitudes[k] > m_magnitudes[dominante])
+            dominante = k;
+    }
+
+    // Sembrar la DFT deslizante, esto tambien elimina el error numerico
+    // acumulado desde la ultima FFT
+    const bool mismoPico = (dominante == m_binDominante);
+    sembrarBins(dominante);
+    estimarPico();
+
+    // Estimar el amortiguamiento con el decremento logaritmico entre dos
+    // ventanas consecutivas
+    if (mismoPico && m_amplitudAnterior > 0 && m_amplitud > 0
+            && m_frecuencia > 0 && m_periodo > 0) {
+        const double sigma = log(m_amplitudAnterior / m_amplitud)
+                             / (SALTO * m_periodo);
+        const double decremento = sigma / m_frecuencia;
+        const double zeta = decremento / sqrt(4 * PI * PI + decremento * decremento);
+        m_amortiguamiento += 0.25f * (static_cast<float>(zeta) - m_amortiguamiento);
+    }
+
+    m_amplitudAnterior = m_amplitud;
+}
+
+/**
+ * Calcula directamente los bins alrededor de @a centro sobre la ventana
+ * actual y los factores de giro de la DFT deslizante
+ */
+void Espectro::sembrarBins(const int centro) {
+    const int n = TAMANO_VENTANA;
+    const int m = TAMANO_VENTANA / 2;
+
+    m_binDominante = centro;
+    for (int b = 0; b < NUM_BINS_DESLIZANTES; ++b) {
+        const int k = centro - NUM_BINS_DESLIZANTES / 2 + b;
+
+        double re = 0;
+        double im = 0;
+        for (int i = 0; i < n; ++i) {
+            // Obtener cos y sin de 2*pi*k*i/n a partir de media tabla
+            const int angulo = (k * i) % n;
+            float c, s;
+            if (angulo < m) {
+                c = m_cos[angulo];
+                s = m_sin[angulo];
+            } else {
+                c = -m_cos[angulo - m];
+                s = -m_sin[angulo - m];
+            }
+
+            const float x = m_ventana[(m_indice + i) % n];
+            re += x * c;
+            im -= x * s;
+        }
+
+        m_binRe[b] = re;
+        m_binIm[b] = im;
+        m_giroRe[b] = cos(2 * PI * k / n);
+        m_giroIm[b] = sin(2 * PI * k / n);
+    }
+}
+
+/**
+ * Obtiene la frecuencia, amplitud y fase del pico dominante a partir de
+ * los bins de la DFT deslizante
+ */
+void Espectro::estimarPico() {
+    if (m_periodo <= 0)
+        return;
+
+    // Aplicar la ventana de Hann combinando bins vecinos:
+    // H[k] = 0.5 * X[k] - 0.25 * (X[k - 1] + X[k + 1])
+    double hRe[3];
+    double hIm[3];
+    double mag[3];
+    for (int j = 0; j < 3; ++j) {
+        hRe[j] = 0.5 * m_binRe[j + 1] - 0.25 * (m_binRe[j] + m_binRe[j + 2]);
+        hIm[j] = 0.5 * m_binIm[j + 1] - 0.25 * (m_binIm[j] + m_binIm[j + 2]);
+        mag[j] = sqrt(hRe[j] * hRe[j] + hIm[j] * hIm[j]);
+    }
+
+    // Estimar la posicion del pico entre bins con la razon entre el bin
+    // central y su vecino mas grande, exacta para la ventana de Hann
+    double d = 0;
+    if (mag[1] > 0) {
+        const bool derecha = mag[2] >= mag[0];
+        const double alfa = (derecha ? mag[2] : mag[0]) / mag[1];
+        d = qBound(0.0, (2 * alfa - 1) / (alfa + 1), 0.5);
+        if (!derecha)
+            d = -d;
+    }
+
+    // Corregir la perdida de amplitud por estar fuera del centro del bin
+    double correccion = 1;
+    if (fabs(d) > 1e-6)
+        correccion = PI * d * (1 - d * d) / sin(PI * d);
+
+    const int n = TAMANO_VENTANA;
+    const double bin = m_binDominante + d;
+    m_frecuencia = static_cast<float>(bin / (n * m_periodo));
+    m_amplitud = static_cast<float>(4 * mag[1] / n * correccion);
+
+    // Fase al inicio de la ventana, recorrida a la ultima muestra
+    double fase = atan2(hIm[1], hRe[1]) - PI * d + 2 * PI * bin * (n - 1) / n;
+    fase = fmod(fase + PI, 2 * PI);
+    if (fase < 0)
+        fase += 2 * PI;
+
+    m_fase = static_cast<float>(fase - PI);
+}
+
+/**
+ * Calcula la FFT de @a entrada (TAMANO_VENTANA valores reales) usando una
+ * FFT compleja de la mitad del tamaño. Escribe los NUM_BINS bins del
+ * resultado en @a re e @a im.
+ */
+void Espectro::fftReal(const float* entrada, float* re, float* im) {
+    const int n = TAMANO_VENTANA;
+    const int m = TAMANO_VENTANA / 2;
+
+    // Empacar las muestras pares e impares como numeros complejos
+    for (int i = 0; i < m; ++i) {
+        const int r = m_bitsInvertidos[i];
+        re[r] = entrada[2 * i];
+        im[r] = entrada[2 * i + 1];
+    }
+
+    // FFT compleja radix-2 de m puntos
+    for (int longitud = 2; longitud <= m; longitud <<= 1) {
+        const int mitad = longitud / 2;
+        const int paso = n / longitud;
+        for (int i = 0; i < m; i += longitud) {
+            for (int j = 0; j < mitad; ++j) {
+                const float wr = m_cos[j * paso];
+                const float wi = -m_sin[j * paso];
+                const int a = i + j;
+                const int b = a + mitad;
+                const float tr = wr * re[b] - wi * im[b];
+                const float ti = wr * im[b] + wi * re[b];
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+
+    // Separar el espectro de las muestras pares e impares
+    const float z0r = re[0];
+    const float z0i = im[0];
+    re[0] = z0r + z0i;
+    im[0] = 0;
+    re[m] = z0r - z0i;
+    im[m] = 0;
+
+    for (int k = 1; k <= m / 2; ++k) {
+        const float ar = re[k];
+        const float ai = im[k];
+        const float br = re[m - k];
+        const float bi = im[m - k];
+
+        const float par_r = 0.5f * (ar + br);
+        const float par_i = 0.5f * (ai - bi);
+        const float impar_r = 0.5f * (ai + bi);
+        const float impar_i = -0.5f * (ar - br);
+
+        const float wr = m_cos[k];
+        const float wi = -m_sin[k];
+        const float tr = wr * impar_r - wi * impar_i;
+        const float ti = wr * impar_i + wi * impar_r;
+
+        re[k] = par_r + tr;
+        im[k] = par_i + ti;
+        re[m - k] = par_r - tr;
+        im[m - k] = -(par_i - ti);
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ESPECTRO_H
+#define ESPECTRO_H
+
+#include <QtGlobal>
+
+//
+// Resultado del analisis espectral que se publica a la interfaz grafica
+//
+struct Analisis {
+    float frecuencia;
+    float amplitud;
+    float fase;
+    float amortiguamiento;
+    float resolucion;
+};
+
+//
+// Analiza el espectro de una señal muestreada para obtener la frecuencia,
+// amplitud, fase y amortiguamiento de la oscilacion dominante.
+//
+// Cada SALTO muestras (50% de traslape) se calcula la FFT real de la ultima
+// ventana con una ventana de Hann, y el espectro que se reporta es el
+// promedio de los ultimos NUM_PROMEDIOS periodogramas (metodo de Welch).
+// Entre cada FFT, los bins alrededor del pico dominante se actualizan
+// muestra por muestra con una DFT deslizante, de modo que la frecuencia,
+// amplitud y fase se obtienen en O(1) por muestra. La ventana de Hann se
+// aplica a la DFT deslizante combinando bins vecinos, y la frecuencia se
+// refina con la razon entre el pico y su vecino mas grande.
+//
+class Espectro {
+public:
+    static const int TAMANO_VENTANA = 512;
+    static const int SALTO = TAMANO_VENTANA / 2;
+    static const int NUM_BINS = TAMANO_VENTANA / 2 + 1;
+    static const int NUM_PROMEDIOS = 4;
+
+    Espectro();
+
+    void reiniciar();
+    bool agregar(const float valor, const float periodo);
+
+    float frecuencia() const;
+    float amplitud() const;
+    float fase() const;
+    float amortiguamiento() const;
+    float resolucion() const;
+    const float* magnitudes() const;
+    Analisis analisis() const;
+
+private:
+    void calcularEspectro();
+    void sembrarBins(const int centro);
+    void estimarPico();
+    void fftReal(const float* entrada, float* re, float* im);
+
+private:
+    static const int NUM_BINS_DESLIZANTES = 5;
+
+    int m_indice;
+    int m_muestras;
+    int m_desdeFft;
+    float m_periodo;
+
+    int m_binDominante;
+    float m_frecuencia;
+    float m_amplitud;
+    float m_fase;
+    float m_amortiguamiento;
+    float m_amplitudAnterior;
+
+    float m_ventana[TAMANO_VENTANA];
+    float m_hann[TAMANO_VENTANA];
+
+    double m_binRe[NUM_BINS_DESLIZANTES];
+    double m_binIm[NUM_BINS_DESLIZANTES];
+    double m_giroRe[NUM_BINS_DESLIZANTES];
+    double m_giroIm[NUM_BINS_DESLIZANTES];
+
+    int m_periodograma;
+    int m_numPeriodogramas;
+    float m_potencias[NUM_PROMEDIOS][NUM_BINS];
+    float m_magnitudes[NUM_BINS];
+
+    int m_bitsInvertidos[TAMANO_VENTANA / 2];
+    float m_cos[TAMANO_VENTANA / 2];
+    float m_sin[TAMANO_VENTANA / 2];
+    float m_re[TAMANO_VENTANA / 2 + 1];
+    float m_im[TAMANO_VENTANA / 2 + 1];
+    float m_entrada[TAMANO_VENTANA];
+};
+
+#endif
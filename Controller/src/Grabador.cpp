@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Grabador.h"
+#include "Sumidero.h"
+
+#include <string.h>
+
+/**
+ * Reserva las paginas de lecturas, las cuales se reutilizan durante
+ * toda la vida del grabador
+ */
+Grabador::Grabador(QObject* parent) : QThread(parent) {
+    m_detener = false;
+    m_grabando = false;
+    m_pendientes = 0;
+    m_bytesEscritos = 0;
+    m_lecturasDescartadas = 0;
+    m_intervaloSincronizacion = 0;
+
+    for (int i = 0; i < NUM_PAGINAS; ++i) {
+        Pagina* pagina = new Pagina;
+        pagina->cuenta = 0;
+        pagina->lecturas.resize(LECTURAS_POR_PAGINA);
+        m_libres.append(pagina);
+    }
+
+    m_actual = m_libres.takeFirst();
+}
+
+/**
+ * Termina de escribir las lecturas pendientes y libera las paginas
+ */
+Grabador::~Grabador() {
+    detener();
+
+    delete m_actual;
+    qDeleteAll(m_libres);
+    qDeleteAll(m_llenas);
+}
+
+/**
+ * Regresa @a true si el grabador esta registrando lecturas
+ */
+bool Grabador::grabando() const {
+    return m_grabando;
+}
+
+/**
+ * Regresa el numero de lecturas que se han agregado pero que aun no
+ * se escriben en los archivos de salida
+ */
+qint64 Grabador::pendientes() const {
+    return m_pendientes.load();
+}
+
+/**
+ * Regresa el numero total de bytes escritos en los archivos de salida
+ */
+quint64 Grabador::bytesEscritos() const {
+    return m_bytesEscritos.load();
+}
+
+/**
+ * Regresa el numero de lecturas que se descartaron porque el hilo de
+ * escritura no alcanzo a desocupar una pagina a tiempo
+ */
+quint64 Grabador::lecturasDescartadas() const {
+    return m_lecturasDescartadas.load();
+}
+
+/**
+ * Crea los archivos de salida en la @a ruta especificada (sin extension)
+ * para cada uno de los @a formatos seleccionados e inicia el hilo de
+ * escritura. Si el @a intervaloSincronizacion es mayor a 0, los archivos
+ * se sincronizan con el disco cada vez que transcurre ese numero de ms.
+ *
+ * @return @a false si no se pudo crear alguno de los archivos
+ */
+bool Grabador::iniciar(const QString& ruta, const int formatos,
+                       const int intervaloSincronizacion) {
+    // Terminar la grabacion anterior
+    detener();
+
+    // Crear sumideros
+    if (formatos & FormatoCsv)
+        m_sumideros.append(new SumideroCsv);
+    if (formatos & FormatoBinario)
+        m_sumideros.append(new SumideroBinario);
+
+    // Abrir archivos de salida
+    foreach (Sumidero* sumidero, m_sumideros) {
+        if (!sumidero->abrir(ruta)) {
+            qDeleteAll(m_sumideros);
+            m_sumideros.clear();
+            return false;
+        }
+    }
+
+    // Reiniciar contadores
+    m_pendientes = 0;
+    m_bytesEscritos = 0;
+    m_lecturasDescartadas = 0;
+    m_intervaloSincronizacion = intervaloSincronizacion;
+
+    // Iniciar hilo de escritura
+    m_detener = false;
+    m_grabando = true;
+    m_ultimaPublicacion.start();
+    start(QThread::LowPriority);
+
+    return true;
+}
+
+/**
+ * Escribe las lecturas pendientes, detiene el hilo de escritura y cierra
+ * los archivos de salida
+ */
+void Grabador::detener() {
+    if (!m_grabando)
+        return;
+
+    // Publicar la ultima pagina, esperando a que se libere una pagina
+    while (m_actual->cuenta > 0 && !publicarPagina())
+        msleep(1);
+
+    // Detener hilo de escritura
+    m_mutex.lock();
+    m_detener = true;
+    m_condicion.wakeOne();
+    m_mutex.unlock();
+    wait();
+
+    // Cerrar archivos
+    foreach (Sumidero* sumidero, m_sumideros)
+        sumidero->sincronizar();
+
+    qDeleteAll(m_sumideros);
+    m_sumideros.clear();
+    m_grabando = false;
+}
+
+/**
+ * Agrega @a n lecturas a la pagina actual. Esta funcion no escribe en
+ * disco ni formatea las lecturas, solo las copia, de manera que el hilo
+ * de adquisicion nunca espera al hilo de escritura.
+ */
+void Grabador::agregar(const Lectura* lecturas, const int n) {
+    if (!m_grabando)
+        return;
+
+    int i = 0;
+    while (i < n) {
+        // La pagina esta llena y no hay paginas libres, descartar lecturas
+        if (m_actual->cuenta >= LECTURAS_POR_PAGINA && !publicarPagina()) {
+            m_lecturasDescartadas.fetchAndAddRelaxed(static_cast<quint64>(n - i));
+            break;
+        }
+
+        // Copiar lecturas a la pagina actual
+        const int copiar = qMin(n - i, LECTURAS_POR_PAGINA - m_actual->cuenta);
+        memcpy(m_actual->lecturas.data() + m_actual->cuenta, lecturas + i,
+               static_cast<size_t>(copiar) * sizeof(Lectura));
+
+        m_actual->cuenta += copiar;
+        m_pendientes.fetchAndAddRelaxed(copiar);
+        i += copiar;
+    }
+
+    // Publicar paginas incompletas de vez en cuando para que los archivos
+    // no se atrasen cuando la frecuencia de muestreo es baja
+    if (m_actual->cuenta > 0 && m_ultimaPublicacion.elapsed() >= INTERVALO_PUBLICACION)
+        publicarPagina();
+}
+
+/**
+ * Entrega la pagina actual al hilo de escritura y toma una pagina libre
+ *
+ * @return @a false si no hay paginas libres
+ */
+bool Grabador::publicarPagina() {
+    QMutexLocker locker(&m_mutex);
+
+    if (m_libres.isEmpty())
+        return false;
+
+    m_llenas.append(m_actual);
+    m_actual = m_libres.takeFirst();
+    m_actual->cuenta = 0;
+    m_condicion.wakeOne();
+    m_ultimaPublicacion.restart();
+
+    return true;
+}
+
+/**
+ * Hilo de escritura, formatea y escribe cada pagina que se publica en
+ * todos los sumideros
+ */
+void Grabador::run() {
+    QElapsedTimer sincronizacion;
+    sincronizacion.start();
+
+    m_mutex.lock();
+    forever {
+        // Esperar a que se publique una pagina
+        if (m_llenas.isEmpty()) {
+            if (m_detener)
+                break;
+
+            m_condicion.wait(&m_mutex, INTERVALO_PUBLICACION);
+        }
+
+        // Tomar la siguiente pagina
+        Pagina* pagina = Q_NULLPTR;
+        if (!m_llenas.isEmpty())
+            pagina = m_llenas.takeFirst();
+
+        m_mutex.unlock();
+
+        // Escribir la pagina en cada sumidero
+        if (pagina != Q_NULLPTR) {
+            quint64 bytes = 0;
+            foreach (Sumidero* sumidero, m_sumideros) {
+                sumidero->escribir(pagina->lecturas.constData(), pagina->cuenta);
+                bytes += sumidero->bytesEscritos();
+            }
+
+            m_bytesEscritos.store(bytes);
+            m_pendientes.fetchAndAddRelaxed(-pagina->cuenta);
+        }
+
+        // Sincronizar archivos con el disco
+        if (m_intervaloSincronizacion > 0 &&
+                sincronizacion.elapsed() >= m_intervaloSincronizacion) {
+            foreach (Sumidero* sumidero, m_sumideros)
+                sumidero->sincronizar();
+
+            sincronizacion.restart();
+        }
+
+        // Regresar la pagina a la lista de paginas libres
+        m_mutex.lock();
+        if (pagina != Q_NULLPTR) {
+            pagina->cuenta = 0;
+            m_libres.append(pagina);
+        }
+    }
+
+    m_mutex.unlock();
+}
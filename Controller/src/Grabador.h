@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GRABADOR_H
+#define GRABADOR_H
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+
+#include "Muestra.h"
+
+class Sumidero;
+class Grabador : public QThread {
+public:
+    enum Formato {
+        FormatoCsv = 0x01,
+        FormatoBinario = 0x02,
+    };
+
+    explicit Grabador(QObject* parent = Q_NULLPTR);
+    ~Grabador();
+
+    bool grabando() const;
+    qint64 pendientes() const;
+    quint64 bytesEscritos() const;
+    quint64 lecturasDescartadas() const;
+
+    bool iniciar(const QString& ruta,
+                 const int formatos = FormatoCsv,
+                 const int intervaloSincronizacion = 0);
+    void detener();
+    void agregar(const Lectura* lecturas, const int n);
+
+protected:
+    void run();
+
+private:
+    struct Pagina {
+        int cuenta;
+        QVector<Lectura> lecturas;
+    };
+
+    bool publicarPagina();
+
+private:
+    static const int NUM_PAGINAS = 2;
+    static const int LECTURAS_POR_PAGINA = 4096;
+    static const int INTERVALO_PUBLICACION = 250;
+
+    bool m_detener;
+    bool m_grabando;
+    int m_intervaloSincronizacion;
+
+    QMutex m_mutex;
+    QWaitCondition m_condicion;
+
+    Pagina* m_actual;
+    QList<Pagina*> m_libres;
+    QList<Pagina*> m_llenas;
+    QElapsedTimer m_ultimaPublicacion;
+    QList<Sumidero*> m_sumideros;
+
+    QAtomicInteger<qint64> m_pendientes;
+    QAtomicInteger<quint64> m_bytesEscritos;
+    QAtomicInteger<quint64> m_lecturasDescartadas;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef INSTRUMENTACION_H
+#define INSTRUMENTACION_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QtAlgorithms>
+#include <QAtomicInteger>
+
+//
+// Histograma de valores enteros con precision relativa fija (al estilo
+// HDR): los valores menores a 2 * SUBCUBETAS se cuentan exactamente y cada
+// potencia de 2 arriba de ese valor se divide en SUBCUBETAS cubetas, por lo
+// que el error de cualquier percentil es menor a 1 / SUBCUBETAS (3%).
+//
+// Registrar un valor cuesta unas cuantas instrucciones y no reserva
+// memoria. Un solo hilo puede registrar valores, cualquier hilo puede leer
+// las cubetas sin bloqueos. Los percentiles de un intervalo se calculan
+// con la diferencia entre dos lecturas de las cubetas.
+//
+class Histograma {
+public:
+    static const int BITS_SUBCUBETA = 5;
+    static const int SUBCUBETAS = 1 << BITS_SUBCUBETA;
+    static const int NUM_CUBETAS = (64 - BITS_SUBCUBETA + 1) * SUBCUBETAS;
+
+    //
+    // Cuenta el @a valor (solo debe llamarse desde un hilo)
+    //
+    void registrar(const quint64 valor) {
+        QAtomicInteger<quint32>& cubeta = m_cubetas[indice(valor)];
+        cubeta.store(cubeta.load() + 1);
+    }
+
+    //
+    // Copia las cuentas de cada cubeta en @a cubetas (NUM_CUBETAS valores)
+    //
+    void leer(quint32* cubetas) const {
+        for (int i = 0; i < NUM_CUBETAS; ++i)
+            cubetas[i] = m_cubetas[i].load();
+    }
+
+    //
+    // Regresa la cubeta que le corresponde al @a valor
+    //
+    static int indice(const quint64 valor) {
+        if (valor < 2 * SUBCUBETAS)
+            return static_cast<int>(valor);
+
+        const int bit = 63 - qCountLeadingZeroBits(valor);
+        return (bit - BITS_SUBCUBETA + 1) * SUBCUBETAS
+               + static_cast<int>(valor >> (bit - BITS_SUBCUBETA)) - SUBCUBETAS;
+    }
+
+    //
+    // Regresa el valor central de la @a cubeta especificada
+    //
+    static quint64 valor(const int cubeta) {
+        if (cubeta < 2 * SUBCUBETAS)
+            return static_cast<quint64>(cubeta);
+
+        const int rango = cubeta / SUBCUBETAS;
+        const quint64 inicio = static_cast<quint64>(SUBCUBETAS + cubeta % SUBCUBETAS) << (rango - 1);
+        return inicio + (Q_UINT64_C(1) << (rango - 1)) / 2;
+    }
+
+    //
+    // Regresa el numero de valores registrados entre las lecturas
+    // @a anteriores y @a actuales de las cubetas
+    //
+    static quint64 cuenta(const quint32* actuales, const quint32* anteriores) {
+        quint64 total = 0;
+        for (int i = 0; i < NUM_CUBETAS; ++i)
+            total += actuales[i] - anteriores[i];
+
+        return total;
+    }
+
+    //
+    // Regresa el percentil @a p (entre 0 y 1) de los valores registrados
+    // entre las lecturas @a anteriores y @a actuales de las cubetas, o 0
+    // si no se registro ningun valor
+    //
+    static quint64 percentil(const quint32* actuales, const quint32* anteriores,
+                             const qreal p) {
+        const quint64 total = cuenta(actuales, anteriores);
+        if (total == 0)
+            return 0;
+
+        const quint64 objetivo = qMax<quint64>(1, static_cast<quint64>(p * total + 0.5));
+        quint64 acumulado = 0;
+        for (int i = 0; i < NUM_CUBETAS; ++i) {
+            acumulado += actuales[i] - anteriores[i];
+            if (acumulado >= objetivo)
+                return valor(i);
+        }
+
+        return 0;
+    }
+
+private:
+    QAtomicInteger<quint32> m_cubetas[NUM_CUBETAS];
+};
+
+//
+// Contadores de las etapas del hilo de adquisicion, los escribe el hilo de
+// adquisicion y los lee el diagnostico desde la interfaz grafica
+//
+struct EtapasAdquisicion {
+    QAtomicInteger<quint64> bytesLeidos;
+    QAtomicInteger<quint64> lecturasPuerto;
+    QAtomicInteger<quint64> muestras;
+    QAtomicInteger<quint64> tramasInvalidas;
+    QAtomicInteger<quint64> bytesDescartados;
+    QAtomicInteger<quint64> tramasPerdidas;
+
+    Histograma bytesPorLectura;
+    Histograma decodificacion;
+    Histograma procesamiento;
+};
+
+//
+// Regresa el tiempo (en ns) de un reloj monotonico compartido por todos
+// los hilos, se usa para medir la latencia entre la llegada de los datos y
+// su dibujo en pantalla
+//
+inline QElapsedTimer IniciarRelojMonotonico() {
+    QElapsedTimer reloj;
+    reloj.start();
+    return reloj;
+}
+
+inline qint64 RelojMonotonico() {
+    static const QElapsedTimer reloj = IniciarRelojMonotonico();
+    return reloj.nsecsElapsed();
+}
+
+#endif
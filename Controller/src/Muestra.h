@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MUESTRA_H
+#define MUESTRA_H
+
+#include <QtGlobal>
+
+//
+// Lectura del acelerometro (m/s^2) y giroscopio (grados/s) del GMAS
+//
+struct Muestra {
+    enum Formato {
+        FormatoTexto,
+        FormatoBinario,
+    };
+
+    quint8 formato;
+    quint16 secuencia;
+    quint32 tiempo;
+    float accel[3];
+    float gyro[3];
+};
+
+//
+// Resumen de una ventana de muestras calculado por el MCU en el modo
+// resumen (ver Protocolo::Resumen), en las mismas unidades que Muestra.
+// Los ejes son acelerometro X, Y, Z y giroscopio X, Y, Z.
+//
+struct ResumenVentana {
+    int muestras;
+    float minimo[6];
+    float maximo[6];
+    float media[6];
+    float rms[6];
+};
+
+//
+// Canales de una lectura procesada
+//
+enum Canal {
+    CanalAccelX,
+    CanalAccelY,
+    CanalAccelZ,
+    CanalAccelP,
+    CanalGyroX,
+    CanalGyroY,
+    CanalGyroZ,
+    CanalVelX,
+    CanalVelY,
+    CanalVelZ,
+    CanalPosX,
+    CanalPosY,
+    CanalPosZ,
+    NumCanales,
+};
+
+//
+// Lectura procesada por el hilo de adquisicion, lista para graficarse. La
+// llegada es el momento (ver RelojMonotonico()) en el que se leyeron del
+// puerto los datos de la lectura.
+//
+struct Lectura {
+    qreal tiempo;
+    qint64 llegada;
+    float valores[NumCanales];
+};
+
+#endif
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Osciloscopio.h"
+#include "Serial.h"
+#include "Dispositivo.h"
+
+#include <algorithm>
+#include <QDebug>
+#include <QVector4D>
+#include <QQuickWindow>
+#include <QSGRenderNode>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QSGRendererInterface>
+
+//
+// Las coordenadas x de los vertices son las posiciones del buffer
+// circular, el uniform "transformacion" contiene el desplazamiento que
+// lleva la lectura mas vieja al borde izquierdo, la escala horizontal y la
+// escala y el origen verticales
+//
+static const char* SHADER_VERTICES =
+    "attribute highp float x;\n"
+    "attribute highp float y;\n"
+    "uniform highp mat4 matriz;\n"
+    "uniform highp vec4 transformacion;\n"
+    "void main() {\n"
+    "    highp vec2 p = vec2((x + transformacion.x) * transformacion.y,\n"
+    "                        y * transformacion.z + transformacion.w);\n"
+    "    gl_Position = matriz * vec4(p, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* SHADER_FRAGMENTOS =
+    "uniform lowp vec4 color;\n"
+    "void main() {\n"
+    "    gl_FragColor = color;\n"
+    "}\n";
+
+//
+// Colores predeterminados de las señales (los del tema oscuro de QtCharts)
+//
+static const QRgb COLORES[Osciloscopio::NUM_SENALES] = {
+    0xeb8817, 0x7b7f8c, 0x3c84a7, 0x38ad6b, 0xbf593e, 0xb5b55f
+};
+
+//
+// Nodo que guarda un buffer circular de valores por señal, tanto en la
+// memoria del programa como en la tarjeta de video. Todos los metodos se
+// llaman desde el hilo de dibujo.
+//
+// Cada buffer tiene una posicion extra al final con una copia de la
+// posicion 0, de modo que cuando las lecturas dan la vuelta al buffer la
+// primera parte de la linea termina en el mismo punto en el que empieza la
+// segunda parte.
+//
+class NodoOsciloscopio : public QSGRenderNode {
+public:
+    NodoOsciloscopio() :
+        m_capacidad(0),
+        m_cabeza(0),
+        m_cuenta(0),
+        m_pendientes(0),
+        m_visibles(0),
+        m_ancho(0),
+        m_alto(0),
+        m_minimo(0),
+        m_maximo(1),
+        m_capacidadGl(0),
+        m_bufferX(0),
+        m_programa(Q_NULLPTR) {
+        for (int i = 0; i < Osciloscopio::NUM_SENALES; ++i) {
+            m_buffersY[i] = 0;
+            m_completo[i] = true;
+            m_colores[i] = QColor(COLORES[i]);
+        }
+    }
+
+    ~NodoOsciloscopio() {
+        releaseResources();
+    }
+
+    //
+    // Cambia el numero de lecturas que se muestran, regresa true si el
+    // buffer se vacio y se deben volver a agregar las lecturas
+    //
+    bool configurar(const int capacidad) {
+        if (capacidad == m_capacidad)
+            return false;
+
+        m_capacidad = capacidad;
+        for (int i = 0; i < Osciloscopio::NUM_SENALES; ++i)
+            m_valores[i].fill(0, capacidad + 1);
+
+        limpiar();
+        return true;
+    }
+
+    void limpiar() {
+        m_cabeza = 0;
+        m_cuenta = 0;
+        m_pendientes = 0;
+    }
+
+    //
+    // Agrega @a n lecturas de cada señal, multiplicadas por su factor
+    //
+    void agregar(const float* const* valores, const qreal* factores, const int n) {
+        for (int s = 0; s < Osciloscopio::NUM_SENALES; ++s) {
+            float* v = m_valores[s].data();
+            int cabeza = m_cabeza;
+            for (int i = qMax(0, n - m_capacidad); i < n; ++i) {
+                v[cabeza] = static_cast<float>(valores[s][i] * factores[s]);
+                if (cabeza == 0)
+                    v[m_capacidad] = v[0];
+
+                cabeza = (cabeza + 1) % m_capacidad;
+            }
+        }
+
+        const int agregadas = qMin(n, m_capacidad);
+        m_cabeza = (m_cabeza + agregadas) % qMax(1, m_capacidad);
+        m_cuenta = qMin(m_cuenta + agregadas, m_capacidad);
+        m_pendientes = qMin(m_pendientes + agregadas, m_capacidad);
+    }
+
+    void cambiarSenales(const int visibles, const QColor* colores) {
+        for (int i = 0; i < Osciloscopio::NUM_SENALES; ++i) {
+            // Las señales ocultas no se suben, al mostrarse se suben completas
+            if (!(m_visibles & (1 << i)))
+                m_completo[i] = true;
+
+            m_colores[i] = colores[i];
+        }
+
+        m_visibles = visibles;
+    }
+
+    void cambiarGeometria(const qreal ancho, const qreal alto,
+                          const qreal minimo, const qreal maximo) {
+        m_ancho = ancho;
+        m_alto = alto;
+        m_minimo = minimo;
+        m_maximo = maximo;
+    }
+
+    StateFlags changedStates() const {
+        return StateFlags();
+    }
+
+    RenderingFlags flags() const {
+        return BoundedRectRendering;
+    }
+
+    QRectF rect() const {
+        return QRectF(0, 0, m_ancho, m_alto);
+    }
+
+    void releaseResources() {
+        QOpenGLContext* contexto = QOpenGLContext::currentContext();
+        if (contexto && m_bufferX) {
+            QOpenGLFunctions* f = contexto->functions();
+            f->glDeleteBuffers(1, &m_bufferX);
+            f->glDeleteBuffers(Osciloscopio::NUM_SENALES, m_buffersY);
+        }
+
+        delete m_programa;
+        m_programa = Q_NULLPTR;
+        m_capacidadGl = 0;
+        m_bufferX = 0;
+        for (int i = 0; i < Osciloscopio::NUM_SENALES; ++i) {
+            m_buffersY[i] = 0;
+            m_completo[i] = true;
+        }
+    }
+
+    void render(const RenderState* estado) {
+        if (m_capacidad < 2 || m_cuenta < 2)
+            return;
+
+        QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+        if (!m_programa && !crearPrograma())
+            return;
+
+        subir(f);
+
+        // Transformacion de las lecturas a coordenadas del elemento
+        const float escalaX = m_ancho / (m_capacidad - 1);
+        const float escalaY = -m_alto / (m_maximo - m_minimo);
+        const float origenY = m_alto + m_minimo * m_alto / (m_maximo - m_minimo);
+
+        m_programa->bind();
+        m_programa->setUniformValue("matriz", *estado->projectionMatrix() * *matrix());
+
+        f->glBindBuffer(GL_ARRAY_BUFFER, m_bufferX);
+        m_programa->enableAttributeArray(0);
+        m_programa->setAttributeBuffer(0, GL_FLOAT, 0, 1);
+
+        // Tramos del buffer circular, de la lectura mas vieja a la mas nueva
+        const int inicio = (m_cabeza - m_cuenta + m_capacidad) % m_capacidad;
+        const bool envuelto = inicio + m_cuenta > m_capacidad;
+        const int n1 = qMin(m_cuenta, m_capacidad - inicio) + (envuelto ? 1 : 0);
+        const int n2 = envuelto ? inicio + m_cuenta - m_capacidad : 0;
+
+        for (int s = 0; s < Osciloscopio::NUM_SENALES; ++s) {
+            if (!(m_visibles & (1 << s)))
+                continue;
+
+            QColor color = m_colores[s];
+            color.setAlphaF(color.alphaF() * inheritedOpacity());
+            m_programa->setUniformValue("color", color);
+
+            f->glBindBuffer(GL_ARRAY_BUFFER, m_buffersY[s]);
+            m_programa->enableAttributeArray(1);
+            m_programa->setAttributeBuffer(1, GL_FLOAT, 0, 1);
+
+            m_programa->setUniformValue("transformacion",
+                                        QVector4D(-inicio, escalaX, escalaY, origenY));
+            f->glDrawArrays(GL_LINE_STRIP, inicio, n1);
+
+            if (n2 > 1) {
+                m_programa->setUniformValue("transformacion",
+                                            QVector4D(m_capacidad - inicio, escalaX,
+                                                      escalaY, origenY));
+                f->glDrawArrays(GL_LINE_STRIP, 0, n2);
+            }
+        }
+
+        m_programa->disableAttributeArray(0);
+        m_programa->disableAttributeArray(1);
+        m_programa->release();
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+private:
+    bool crearPrograma() {
+        m_programa = new QOpenGLShaderProgram;
+        m_programa->addShaderFromSourceCode(QOpenGLShader::Vertex, SHADER_VERTICES);
+        m_programa->addShaderFromSourceCode(QOpenGLShader::Fragment, SHADER_FRAGMENTOS);
+        m_programa->bindAttributeLocation("x", 0);
+        m_programa->bindAttributeLocation("y", 1);
+        if (m_programa->link())
+            return true;
+
+        qWarning() << "Osciloscopio:" << m_programa->log();
+        delete m_programa;
+        m_programa = Q_NULLPTR;
+        return false;
+    }
+
+    //
+    // Sube a la tarjeta de video las lecturas nuevas de las señales
+    // visibles, o el buffer completo si cambio su tamaño o la señal estaba
+    // oculta
+    //
+    void subir(QOpenGLFunctions* f) {
+        const int tamano = (m_capacidad + 1) * sizeof(float);
+
+        if (m_capacidadGl != m_capacidad) {
+            if (!m_bufferX) {
+                f->glGenBuffers(1, &m_bufferX);
+                f->glGenBuffers(Osciloscopio::NUM_SENALES, m_buffersY);
+            }
+
+            QVector<float> x(m_capacidad + 1);
+            for (int i = 0; i <= m_capacidad; ++i)
+                x[i] = i;
+
+            f->glBindBuffer(GL_ARRAY_BUFFER, m_bufferX);
+            f->glBufferData(GL_ARRAY_BUFFER, tamano, x.constData(), GL_STATIC_DRAW);
+
+            for (int s = 0; s < Osciloscopio::NUM_SENALES; ++s) {
+                f->glBindBuffer(GL_ARRAY_BUFFER, m_buffersY[s]);
+                f->glBufferData(GL_ARRAY_BUFFER, tamano, Q_NULLPTR, GL_DYNAMIC_DRAW);
+                m_completo[s] = true;
+            }
+
+            m_capacidadGl = m_capacidad;
+        }
+
+        // Rangos del buffer circular con lecturas nuevas
+        const int desde = (m_cabeza - m_pendientes + m_capacidad) % m_capacidad;
+        const bool envuelto = desde + m_pendientes > m_capacidad;
+        const bool incluyeCero = envuelto || desde == 0;
+
+        for (int s = 0; s < Osciloscopio::NUM_SENALES; ++s) {
+            if (!(m_visibles & (1 << s)))
+                continue;
+
+            const float* v = m_valores[s].constData();
+            f->glBindBuffer(GL_ARRAY_BUFFER, m_buffersY[s]);
+
+            if (m_completo[s] || m_pendientes >= m_capacidad) {
+                f->glBufferSubData(GL_ARRAY_BUFFER, 0, tamano, v);
+                m_completo[s] = false;
+                continue;
+            }
+
+            if (m_pendientes == 0)
+                continue;
+
+            if (envuelto) {
+                const int n = m_capacidad - desde;
+                f->glBufferSubData(GL_ARRAY_BUFFER, desde * sizeof(float), n * sizeof(float), v + desde);
+                f->glBufferSubData(GL_ARRAY_BUFFER, 0, (m_pendientes - n) * sizeof(float), v);
+            } else {
+                f->glBufferSubData(GL_ARRAY_BUFFER, desde * sizeof(float), m_pendientes * sizeof(float), v + desde);
+            }
+
+            if (incluyeCero)
+                f->glBufferSubData(GL_ARRAY_BUFFER, m_capacidad * sizeof(float), sizeof(float), v + m_capacidad);
+        }
+
+        m_pendientes = 0;
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+private:
+    int m_capacidad;
+    int m_cabeza;
+    int m_cuenta;
+    int m_pendientes;
+    int m_visibles;
+
+    qreal m_ancho;
+    qreal m_alto;
+    qreal m_minimo;
+    qreal m_maximo;
+
+    QVector<float> m_valores[Osciloscopio::NUM_SENALES];
+    QColor m_colores[Osciloscopio::NUM_SENALES];
+    bool m_completo[Osciloscopio::NUM_SENALES];
+
+    int m_capacidadGl;
+    GLuint m_bufferX;
+    GLuint m_buffersY[Osciloscopio::NUM_SENALES];
+    QOpenGLShaderProgram* m_programa;
+};
+
+/**
+ * Inicializa las propiedades de la grafica
+ */
+Osciloscopio::Osciloscopio(QQuickItem* parent) : QQuickItem(parent) {
+    m_fuente = Q_NULLPTR;
+    m_ventana = 1000;
+    m_minimo = -40;
+    m_maximo = 60;
+    m_ultimoTiempo = -1;
+
+    for (int i = 0; i < NUM_SENALES; ++i)
+        m_colores.append(QColor(COLORES[i]));
+
+    setFlag(ItemHasContents, true);
+}
+
+/**
+ * Regresa el @c Dispositivo del que se leen las lecturas
+ */
+QObject* Osciloscopio::fuente() const {
+    return m_fuente;
+}
+
+/**
+ * Regresa el numero de lecturas que abarca el eje del tiempo
+ */
+int Osciloscopio::ventana() const {
+    return m_ventana;
+}
+
+/**
+ * Regresa el valor del borde inferior de la grafica
+ */
+qreal Osciloscopio::minimo() const {
+    return m_minimo;
+}
+
+/**
+ * Regresa el valor del borde superior de la grafica
+ */
+qreal Osciloscopio::maximo() const {
+    return m_maximo;
+}
+
+/**
+ * Regresa las señales visibles (ver @c Serial::actualizarGrafica())
+ */
+QVariantList Osciloscopio::senales() const {
+    return m_senales;
+}
+
+/**
+ * Regresa el color de cada señal
+ */
+QVariantList Osciloscopio::colores() const {
+    return m_colores;
+}
+
+/**
+ * Cambia el @c Dispositivo del que se leen las lecturas
+ */
+void Osciloscopio::cambiarFuente(QObject* fuente) {
+    Dispositivo* dispositivo = qobject_cast<Dispositivo*>(fuente);
+    if (dispositivo != m_fuente) {
+        m_fuente = dispositivo;
+        m_ultimoTiempo = -1;
+        emit fuenteCambiada();
+        update();
+    }
+}
+
+/**
+ * Cambia el numero de lecturas que abarca el eje del tiempo
+ */
+void Osciloscopio::cambiarVentana(const int ventana) {
+    if (ventana > 1 && ventana != m_ventana) {
+        m_ventana = ventana;
+        emit ventanaCambiada();
+        update();
+    }
+}
+
+/**
+ * Cambia el valor del borde inferior de la grafica
+ */
+void Osciloscopio::cambiarMinimo(const qreal minimo) {
+    if (minimo != m_minimo && minimo < m_maximo) {
+        m_minimo = minimo;
+        emit rangoCambiado();
+        update();
+    }
+}
+
+/**
+ * Cambia el valor del borde superior de la grafica
+ */
+void Osciloscopio::cambiarMaximo(const qreal maximo) {
+    if (maximo != m_maximo && maximo > m_minimo) {
+        m_maximo = maximo;
+        emit rangoCambiado();
+        update();
+    }
+}
+
+/**
+ * Cambia las señales visibles
+ */
+void Osciloscopio::cambiarSenales(const QVariantList& senales) {
+    m_senales = senales;
+    emit senalesCambiadas();
+    update();
+}
+
+/**
+ * Cambia el color de cada señal
+ */
+void Osciloscopio::cambiarColores(const QVariantList& colores) {
+    m_colores = colores;
+    emit senalesCambiadas();
+    update();
+}
+
+/**
+ * Copia las lecturas que llegaron desde el ultimo cuadro al nodo de la
+ * grafica. Se llama desde el hilo de dibujo mientras el hilo de la
+ * interfaz grafica esta bloqueado, por lo que puede leer el historial del
+ * @c Dispositivo sin bloqueos.
+ */
+QSGNode* Osciloscopio::updatePaintNode(QSGNode* anterior, UpdatePaintNodeData* datos) {
+    Q_UNUSED(datos);
+
+    // La grafica solo se puede dibujar con OpenGL
+    QSGRendererInterface* interfaz = window()->rendererInterface();
+    if (!interfaz || interfaz->graphicsApi() != QSGRendererInterface::OpenGL) {
+        delete anterior;
+        return Q_NULLPTR;
+    }
+
+    const qint64 inicio = RelojMonotonico();
+    NodoOsciloscopio* nodo = static_cast<NodoOsciloscopio*>(anterior);
+    if (!nodo) {
+        nodo = new NodoOsciloscopio;
+        m_ultimoTiempo = -1;
+    }
+
+    // Actualizar señales y geometria
+    int visibles = 0;
+    foreach (QVariant senal, m_senales) {
+        const int s = senal.toInt();
+        if (s >= 0 && s < NUM_SENALES)
+            visibles |= 1 << s;
+    }
+
+    QColor colores[NUM_SENALES];
+    for (int i = 0; i < NUM_SENALES; ++i)
+        colores[i] = i < m_colores.count() ? m_colores.at(i).value<QColor>() : QColor(COLORES[i]);
+
+    nodo->cambiarSenales(visibles, colores);
+    nodo->cambiarGeometria(width(), height(), m_minimo, m_maximo);
+
+    if (nodo->configurar(m_ventana))
+        m_ultimoTiempo = -1;
+
+    // Sin lecturas no hay nada que dibujar
+    const BufferCircular<NumCanales>* lecturas = m_fuente ? &m_fuente->lecturas() : Q_NULLPTR;
+    if (!lecturas || lecturas->isEmpty()) {
+        nodo->limpiar();
+        m_ultimoTiempo = -1;
+        return nodo;
+    }
+
+    // Si el historial se reinicio volver a empezar
+    const int count = lecturas->count();
+    const qreal* tiempos = lecturas->tiempos();
+    if (tiempos[count - 1] < m_ultimoTiempo)
+        m_ultimoTiempo = -1;
+
+    if (m_ultimoTiempo < 0)
+        nodo->limpiar();
+
+    // Agregar las lecturas nuevas
+    int desde = std::upper_bound(tiempos, tiempos + count, m_ultimoTiempo) - tiempos;
+    desde = qMax(desde, count - m_ventana);
+
+    qreal factores[NUM_SENALES];
+    const float* valores[NUM_SENALES];
+    for (int s = 0; s < NUM_SENALES; ++s)
+        valores[s] = lecturas->canal(Serial::canalDeSenal(s, &factores[s])) + desde;
+
+    nodo->agregar(valores, factores, count - desde);
+    m_ultimoTiempo = tiempos[count - 1];
+    m_fuente->diagnostico()->registrarDibujo(RelojMonotonico() - inicio);
+
+    return nodo;
+}
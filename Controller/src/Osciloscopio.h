@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OSCILOSCOPIO_H
+#define OSCILOSCOPIO_H
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+#include <QVariantList>
+
+class Dispositivo;
+
+//
+// Grafica de tiras que dibuja las señales de la interfaz grafica (ver
+// Serial::actualizarGrafica()) directamente con OpenGL.
+//
+// Cada señal se guarda en un buffer de vertices circular en la tarjeta de
+// video, en cada cuadro solo se suben las lecturas nuevas y la grafica se
+// desplaza con un uniform, de modo que el costo de cada cuadro depende del
+// numero de lecturas nuevas y no del tamaño de la ventana. Todas las
+// señales comparten el eje del tiempo.
+//
+class Osciloscopio : public QQuickItem {
+    Q_OBJECT
+
+    Q_PROPERTY(QObject* fuente
+               READ fuente
+               WRITE cambiarFuente
+               NOTIFY fuenteCambiada)
+    Q_PROPERTY(int ventana
+               READ ventana
+               WRITE cambiarVentana
+               NOTIFY ventanaCambiada)
+    Q_PROPERTY(qreal minimo
+               READ minimo
+               WRITE cambiarMinimo
+               NOTIFY rangoCambiado)
+    Q_PROPERTY(qreal maximo
+               READ maximo
+               WRITE cambiarMaximo
+               NOTIFY rangoCambiado)
+    Q_PROPERTY(QVariantList senales
+               READ senales
+               WRITE cambiarSenales
+               NOTIFY senalesCambiadas)
+    Q_PROPERTY(QVariantList colores
+               READ colores
+               WRITE cambiarColores
+               NOTIFY senalesCambiadas)
+
+signals:
+    void fuenteCambiada();
+    void ventanaCambiada();
+    void rangoCambiado();
+    void senalesCambiadas();
+
+public:
+    static const int NUM_SENALES = 6;
+
+    explicit Osciloscopio(QQuickItem* parent = Q_NULLPTR);
+
+    QObject* fuente() const;
+    int ventana() const;
+    qreal minimo() const;
+    qreal maximo() const;
+    QVariantList senales() const;
+    QVariantList colores() const;
+
+public slots:
+    void cambiarFuente(QObject* fuente);
+    void cambiarVentana(const int ventana);
+    void cambiarMinimo(const qreal minimo);
+    void cambiarMaximo(const qreal maximo);
+    void cambiarSenales(const QVariantList& senales);
+    void cambiarColores(const QVariantList& colores);
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* nodo, UpdatePaintNodeData* datos);
+
+private:
+    QPointer<Dispositivo> m_fuente;
+    int m_ventana;
+    qreal m_minimo;
+    qreal m_maximo;
+    QVariantList m_senales;
+    QVariantList m_colores;
+    qreal m_ultimoTiempo;
+};
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Protocolo.h"
+
+/**
+ * Tabla para calcular el CRC-16/CCITT-FALSE (polinomio 0x1021) un byte
+ * a la vez
+ */
+static const quint16 TABLA_CRC[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+/**
+ * Lee un entero de 16 bits en formato little-endian
+ */
+static inline quint16 Leer16(const quint8* datos) {
+    return static_cast<quint16>(datos[0] | (datos[1] << 8));
+}
+
+/**
+ * Lee un entero de 32 bits en formato little-endian
+ */
+static inline quint32 Leer32(const quint8* datos) {
+    return static_cast<quint32>(datos[0])
+            | (static_cast<quint32>(datos[1]) << 8)
+            | (static_cast<quint32>(datos[2]) << 16)
+            | (static_cast<quint32>(datos[3]) << 24);
+}
+
+/**
+ * Escribe un entero de 16 bits en formato little-endian
+ */
+static inline void Escribir16(quint8* datos, const quint16 valor) {
+    datos[0] = static_cast<quint8>(valor);
+    datos[1] = static_cast<quint8>(valor >> 8);
+}
+
+/**
+ * Escribe un entero de 32 bits en formato little-endian
+ */
+static inline void Escribir32(quint8* datos, const quint32 valor) {
+    datos[0] = static_cast<quint8>(valor);
+    datos[1] = static_cast<quint8>(valor >> 8);
+    datos[2] = static_cast<quint8>(valor >> 16);
+    datos[3] = static_cast<quint8>(valor >> 24);
+}
+
+/**
+ * Calcula el CRC-16/CCITT-FALSE de los @a datos, comenzando con el
+ * valor @a crc (permite calcular el CRC de manera incremental)
+ */
+quint16 Protocolo::crc16(const quint8* datos, const int longitud, quint16 crc) {
+    for (int i = 0; i < longitud; ++i)
+        crc = static_cast<quint16>((crc << 8) ^ TABLA_CRC[((crc >> 8) ^ datos[i]) & 0xFF]);
+
+    return crc;
+}
+
+/**
+ * Intenta decodificar una trama binaria que comienza en @a datos, sin
+ * copiar ni reservar memoria. Los datos de la trama resultante apuntan
+ * al buffer de entrada.
+ *
+ * @return el numero de bytes que ocupa la trama,
+ *         @c TramaIncompleta si faltan bytes para completar la trama o
+ *         @c TramaInvalida si el encabezado o el CRC no son validos
+ */
+int Protocolo::decodificarTrama(const quint8* datos, const int longitud,
+                                Trama* trama) {
+    // Verificaciones
+    Q_ASSERT(datos != Q_NULLPTR);
+    Q_ASSERT(trama != Q_NULLPTR);
+
+    // Verificar secuencia de inicio
+    if (longitud >= 1 && datos[0] != Sync0)
+        return TramaInvalida;
+    if (longitud >= 2 && datos[1] != Sync1)
+        return TramaInvalida;
+    if (longitud >= 3 && datos[2] != Version)
+        return TramaInvalida;
+
+    // Esperar a tener el encabezado completo
+    if (longitud < Encabezado)
+        return TramaIncompleta;
+
+    // Esperar a tener la trama completa
+    const int bytesDatos = datos[4];
+    const int total = Encabezado + bytesDatos + BytesCrc;
+    if (longitud < total)
+        return TramaIncompleta;
+
+    // Verificar CRC
+    const int fin = total - BytesCrc;
+    if (crc16(datos + 2, fin - 2) != Leer16(datos + fin))
+        return TramaInvalida;
+
+    // Llenar trama
+    trama->tipo = datos[3];
+    trama->longitud = static_cast<quint8>(bytesDatos);
+    trama->secuencia = Leer16(datos + 5);
+    trama->datos = datos + Encabezado;
+
+    return total;
+}
+
+/**
+ * Obtiene las lecturas crudas de una trama de telemetria
+ *
+ * @return @a false si la @a trama no es de telemetria
+ */
+bool Protocolo::leerTelemetria(const Trama& trama, Telemetria* telemetria) {
+    Q_ASSERT(telemetria != Q_NULLPTR);
+
+    if (trama.tipo != TipoTelemetria || trama.longitud != DatosTelemetria)
+        return false;
+
+    telemetria->secuencia = trama.secuencia;
+    telemetria->tiempo = Leer32(trama.datos);
+    telemetria->config = trama.datos[4];
+    for (int i = 0; i < 3; ++i) {
+        telemetria->accel[i] = static_cast<qint16>(Leer16(trama.datos + 5 + i * 2));
+        telemetria->gyro[i] = static_cast<qint16>(Leer16(trama.datos + 11 + i * 2));
+    }
+
+    return true;
+}
+
+/**
+ * Interpreta la @a trama como una trama de resumen
+ *
+ * @return @a false si la trama no es de resumen o su longitud no coincide
+ */
+bool Protocolo::leerResumen(const Trama& trama, Resumen* resumen) {
+    Q_ASSERT(resumen != Q_NULLPTR);
+
+    if (trama.tipo != TipoResumen || trama.longitud != DatosResumen)
+        return false;
+
+    resumen->secuencia = trama.secuencia;
+    resumen->tiempo = Leer32(trama.datos);
+    resumen->config = trama.datos[4];
+    resumen->muestras = trama.datos[5];
+    for (int i = 0; i < 6; ++i) {
+        resumen->minimo[i] = static_cast<qint16>(Leer16(trama.datos + 6 + i * 2));
+        resumen->maximo[i] = static_cast<qint16>(Leer16(trama.datos + 18 + i * 2));
+        resumen->media[i] = static_cast<qint16>(Leer16(trama.datos + 30 + i * 2));
+        resumen->rms[i] = Leer16(trama.datos + 42 + i * 2);
+    }
+
+    return true;
+}
+
+/**
+ * Escribe el encabezado y el CRC de una trama cuyos @a longitud bytes de
+ * datos ya estan en @a trama + @c Encabezado
+ *
+ * @return el numero de bytes de la trama
+ */
+static int Finalizar(quint8* trama, const quint8 tipo, const quint16 secuencia,
+                     const int longitud) {
+    trama[0] = Protocolo::Sync0;
+    trama[1] = Protocolo::Sync1;
+    trama[2] = Protocolo::Version;
+    trama[3] = tipo;
+    trama[4] = static_cast<quint8>(longitud);
+    Escribir16(trama + 5, secuencia);
+
+    const int fin = Protocolo::Encabezado + longitud;
+    Escribir16(trama + fin, Protocolo::crc16(trama + 2, fin - 2));
+    return fin + Protocolo::BytesCrc;
+}
+
+/**
+ * Genera una trama de telemetria en @a trama (debe tener al menos
+ * @c TramaTelemetria bytes), igual a la que genera el MCU.
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarTelemetria(const Telemetria& telemetria, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+
+    quint8* datos = trama + Encabezado;
+    Escribir32(datos, telemetria.tiempo);
+    datos[4] = telemetria.config;
+    for (int i = 0; i < 3; ++i) {
+        Escribir16(datos + 5 + i * 2, static_cast<quint16>(telemetria.accel[i]));
+        Escribir16(datos + 11 + i * 2, static_cast<quint16>(telemetria.gyro[i]));
+    }
+
+    return Finalizar(trama, TipoTelemetria, telemetria.secuencia, DatosTelemetria);
+}
+
+/**
+ * Obtiene la secuencia, tipo y estado del comando que el MCU confirmo
+ *
+ * @return @a false si la @a trama no es una confirmacion
+ */
+bool Protocolo::leerAck(const Trama& trama, Ack* ack) {
+    Q_ASSERT(ack != Q_NULLPTR);
+
+    if (trama.tipo != TipoAck || trama.longitud != DatosAck)
+        return false;
+
+    ack->secuencia = trama.secuencia;
+    ack->tipo = trama.datos[0];
+    ack->estado = trama.datos[1];
+    return true;
+}
+
+/**
+ * Genera una confirmacion en @a trama (debe tener al menos @c TramaAck
+ * bytes), igual a la que genera el MCU.
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarAck(const Ack& ack, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+
+    trama[Encabezado] = ack.tipo;
+    trama[Encabezado + 1] = ack.estado;
+    return Finalizar(trama, TipoAck, ack.secuencia, DatosAck);
+}
+
+/**
+ * Genera un comando de velocidad en @a trama (debe tener al menos
+ * @c TramaVelocidad bytes). La @a velocidad (en %) se manda en centesimas.
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarVelocidad(const quint16 secuencia, const bool habilitado,
+                                  const qreal velocidad, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+
+    const qreal centesimas = qBound(0.0, velocidad * 100, 65535.0);
+    quint8* datos = trama + Encabezado;
+    datos[0] = habilitado ? 1 : 0;
+    Escribir16(datos + 1, static_cast<quint16>(qRound(centesimas)));
+
+    return Finalizar(trama, TipoVelocidad, secuencia, DatosVelocidad);
+}
+
+/**
+ * Genera un comando de keepalive en @a trama (debe tener al menos
+ * @c TramaKeepalive bytes), el MCU apaga el motor si deja de recibir
+ * comandos
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarKeepalive(const quint16 secuencia, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+    return Finalizar(trama, TipoKeepalive, secuencia, 0);
+}
+
+/**
+ * Genera un comando de calibracion en @a trama (debe tener al menos
+ * @c TramaCalibrar bytes), el MCU detiene el motor, vuelve a medir los
+ * offsets del sensor y los guarda en su EEPROM antes de confirmarlo
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarCalibrar(const quint16 secuencia, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+    return Finalizar(trama, TipoCalibrar, secuencia, 0);
+}
+
+/**
+ * Genera un comando de modo de telemetria en @a trama (debe tener al menos
+ * @c TramaModo bytes). El MCU rechaza el comando si la @a decimacion no es
+ * una potencia de 2 entre 1 y @c MaxDecimacion.
+ *
+ * @return el numero de bytes escritos
+ */
+int Protocolo::codificarModo(const quint16 secuencia, const int modo,
+                             const int decimacion, quint8* trama) {
+    Q_ASSERT(trama != Q_NULLPTR);
+
+    quint8* datos = trama + Encabezado;
+    datos[0] = static_cast<quint8>(modo);
+    datos[1] = static_cast<quint8>(decimacion);
+
+    return Finalizar(trama, TipoModo, secuencia, DatosModo);
+}
+
+/**
+ * Regresa el factor para convertir las lecturas crudas del acelerometro
+ * a m/s^2, de acuerdo al rango configurado en el MCU
+ */
+float Protocolo::factorAcelerometro(const quint8 config) {
+    static const float factores[4] = { .000061f, .000122f, .000244f, .0004882f };
+    return factores[config & 0x03] * 9.80665f;
+}
+
+/**
+ * Regresa el factor para convertir las lecturas crudas del giroscopio
+ * a grados/s, de acuerdo a la escala configurada en el MCU
+ */
+float Protocolo::factorGiroscopio(const quint8 config) {
+    static const float factores[4] = { .007633f, .015267f, .030487f, .060975f };
+    return factores[(config >> 2) & 0x03];
+}
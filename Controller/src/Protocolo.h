@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <QtGlobal>
+
+//
+// Formato de las tramas binarias (little-endian):
+//
+//   [0xA5][0x5A][VERSION][TIPO][LONGITUD][SECUENCIA x2][DATOS...][CRC x2]
+//
+// El CRC (CRC-16/CCITT-FALSE) se calcula desde VERSION hasta el ultimo byte
+// de DATOS. Esta definicion debe coincidir con AVR/Protocolo.h
+//
+namespace Protocolo {
+
+const quint8 Sync0 = 0xA5;
+const quint8 Sync1 = 0x5A;
+const quint8 Version = 0x01;
+const int Encabezado = 7;
+const int BytesCrc = 2;
+
+enum Tipo {
+    TipoTelemetria = 0x01,
+    TipoVelocidad = 0x02,
+    TipoKeepalive = 0x03,
+    TipoAck = 0x04,
+    TipoCalibrar = 0x05,
+    TipoModo = 0x06,
+    TipoResumen = 0x07,
+};
+
+const int DatosTelemetria = 17;
+const int TramaTelemetria = Encabezado + DatosTelemetria + BytesCrc;
+const int DatosResumen = 54;
+const int TramaResumen = Encabezado + DatosResumen + BytesCrc;
+
+//
+// Comandos del software de control al MCU, el MCU confirma cada comando
+// con una trama de tipo TipoAck
+//
+const int DatosVelocidad = 3;
+const int TramaVelocidad = Encabezado + DatosVelocidad + BytesCrc;
+const int TramaKeepalive = Encabezado + BytesCrc;
+const int TramaCalibrar = Encabezado + BytesCrc;
+const int DatosModo = 2;
+const int TramaModo = Encabezado + DatosModo + BytesCrc;
+
+//
+// Modos de telemetria del MCU, el cual muestrea a FrecuenciaMuestreo Hz y
+// manda una trama por cada ventana de "decimacion" muestras (potencia de 2
+// hasta MaxDecimacion): la ultima muestra, la salida de su filtro
+// pasabajas o el resumen de la ventana
+//
+enum ModoTelemetria {
+    ModoCrudo = 0x00,
+    ModoFiltrado = 0x01,
+    ModoResumen = 0x02,
+};
+
+const int FrecuenciaMuestreo = 1000;
+const int MaxDecimacion = 128;
+
+const int DatosAck = 2;
+const int TramaAck = Encabezado + DatosAck + BytesCrc;
+
+enum EstadoAck {
+    AckOk = 0x00,
+    AckDesconocido = 0x01,
+    AckInvalido = 0x02,
+    AckFallo = 0x03,
+};
+
+//
+// Resultados especiales de decodificarTrama()
+//
+enum Resultado {
+    TramaIncompleta = 0,
+    TramaInvalida = -1,
+};
+
+//
+// Trama decodificada, los datos apuntan al buffer de entrada (no se copian)
+//
+struct Trama {
+    quint8 tipo;
+    quint8 longitud;
+    quint16 secuencia;
+    const quint8* datos;
+};
+
+//
+// Confirmacion de un comando, la secuencia es la del comando confirmado
+//
+struct Ack {
+    quint16 secuencia;
+    quint8 tipo;
+    quint8 estado;
+};
+
+//
+// Contenido de una trama de telemetria, tal y como la manda el MCU
+//
+struct Telemetria {
+    quint16 secuencia;
+    quint32 tiempo;
+    quint8 config;
+    qint16 accel[3];
+    qint16 gyro[3];
+};
+
+//
+// Contenido de una trama de resumen: el minimo, maximo, media y RMS de
+// cada eje (acelerometro X, Y, Z y giroscopio X, Y, Z) en una ventana de
+// lecturas crudas, el tiempo corresponde al centro de la ventana
+//
+struct Resumen {
+    quint16 secuencia;
+    quint32 tiempo;
+    quint8 config;
+    quint8 muestras;
+    qint16 minimo[6];
+    qint16 maximo[6];
+    qint16 media[6];
+    quint16 rms[6];
+};
+
+quint16 crc16(const quint8* datos, const int longitud,
+              quint16 crc = 0xFFFF);
+
+int decodificarTrama(const quint8* datos, const int longitud, Trama* trama);
+bool leerTelemetria(const Trama& trama, Telemetria* telemetria);
+int codificarTelemetria(const Telemetria& telemetria, quint8* trama);
+bool leerResumen(const Trama& trama, Resumen* resumen);
+
+bool leerAck(const Trama& trama, Ack* ack);
+int codificarAck(const Ack& ack, quint8* trama);
+int codificarVelocidad(const quint16 secuencia, const bool habilitado,
+                       const qreal velocidad, quint8* trama);
+int codificarKeepalive(const quint16 secuencia, quint8* trama);
+int codificarCalibrar(const quint16 secuencia, quint8* trama);
+int codificarModo(const quint16 secuencia, const int modo, const int decimacion,
+                  quint8* trama);
+
+float factorAcelerometro(const quint8 config);
+float factorGiroscopio(const quint8 config);
+
+}
+
+#endif
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Reproductor.h"
+#include "Protocolo.h"
+
+#include <QTimer>
+#include <QDebug>
+#include <QtMath>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Frecuencia de muestreo (Hz) del firmware, los archivos de lecturas solo
+ * guardan el numero de cada lectura
+ */
+static const qreal FRECUENCIA_PREDETERMINADA = 500;
+
+/**
+ * Periodo (ms) con el que se entregan las lecturas cuando la reproduccion
+ * no es a velocidad maxima
+ */
+static const int PERIODO_ENTREGA = 10;
+
+/**
+ * Numero de filas del archivo CSV que se leen a la vez
+ */
+static const int FILAS_CSV = 1024;
+
+/**
+ * Regresa la configuracion del MCU (ver Protocolo::factorAcelerometro() y
+ * Protocolo::factorGiroscopio()) con el rango y la escala mas pequeños en
+ * los que caben los valores de la @a muestra, para perder la menor
+ * resolucion posible al convertirlos a enteros de 16 bits
+ */
+static quint8 Configuracion(const Muestra& muestra) {
+    float accel = 0;
+    float gyro = 0;
+    for (int i = 0; i < 3; ++i) {
+        accel = qMax(accel, qAbs(muestra.accel[i]));
+        gyro = qMax(gyro, qAbs(muestra.gyro[i]));
+    }
+
+    quint8 rango = 0;
+    while (rango < 3 && accel / Protocolo::factorAcelerometro(rango) > 32767)
+        ++rango;
+
+    quint8 escala = 0;
+    while (escala < 3 && gyro / Protocolo::factorGiroscopio(escala << 2) > 32767)
+        ++escala;
+
+    return rango | (escala << 2);
+}
+
+/**
+ * Convierte el @a valor a una lectura cruda del MCU con el @a factor
+ * especificado
+ */
+static qint16 Crudo(const float valor, const float factor) {
+    return static_cast<qint16>(qBound(-32768, qRound(valor / factor), 32767));
+}
+
+/**
+ * Prepara la reproduccion del archivo en la @a ruta especificada a
+ * velocidad normal, el archivo se abre con @c open()
+ */
+Reproductor::Reproductor(const QString& ruta, QObject* parent) : QIODevice(parent) {
+    m_binario = false;
+    m_terminado = false;
+    m_canales = 0;
+    m_velocidad = 1;
+    m_frecuencia = FRECUENCIA_PREDETERMINADA;
+    m_enviadas = 0;
+    m_base = 0;
+    m_siguiente = 0;
+    m_posicion = 0;
+
+    for (int i = 0; i < NumCanales; ++i)
+        m_escalas[i] = 1;
+
+    m_archivo.setFileName(ruta);
+
+    m_temporizador = new QTimer(this);
+    connect(m_temporizador, &QTimer::timeout,
+            this,           &Reproductor::avanzar);
+}
+
+/**
+ * Regresa la velocidad de reproduccion (1 es tiempo real, 0 es la
+ * velocidad maxima)
+ */
+qreal Reproductor::velocidad() const {
+    return m_velocidad;
+}
+
+/**
+ * Regresa la frecuencia de muestreo (Hz) con la que se grabo el archivo
+ */
+qreal Reproductor::frecuencia() const {
+    return m_frecuencia;
+}
+
+/**
+ * Regresa el numero de lecturas entregadas
+ */
+quint64 Reproductor::lecturas() const {
+    return m_enviadas;
+}
+
+/**
+ * Cambia la velocidad de reproduccion, 1 reproduce las lecturas en tiempo
+ * real, 2 al doble de velocidad, etc. y 0 (o un valor negativo) las
+ * entrega tan rapido como se puedan procesar
+ */
+void Reproductor::cambiarVelocidad(const qreal velocidad) {
+    m_velocidad = qMax<qreal>(0, velocidad);
+    reiniciarReloj();
+}
+
+/**
+ * Cambia la frecuencia de muestreo (Hz) con la que se grabo el archivo
+ */
+void Reproductor::cambiarFrecuencia(const qreal frecuencia) {
+    Q_ASSERT(frecuencia > 0);
+    m_frecuencia = frecuencia;
+    reiniciarReloj();
+}
+
+/**
+ * Las lecturas solo pueden leerse en orden
+ */
+bool Reproductor::isSequential() const {
+    return true;
+}
+
+/**
+ * Regresa el numero de bytes codificados que aun no se leen
+ */
+qint64 Reproductor::bytesAvailable() const {
+    return m_salida.size() - m_posicion + QIODevice::bytesAvailable();
+}
+
+/**
+ * Abre el archivo de lecturas y comienza la reproduccion
+ *
+ * @return @a false si el archivo no existe o no es un archivo de lecturas
+ */
+bool Reproductor::open(OpenMode modo) {
+    if (!m_archivo.open(QFile::ReadOnly)) {
+        setErrorString(m_archivo.errorString());
+        return false;
+    }
+
+    // Los archivos binarios comienzan con "GMAS", el resto se lee como CSV
+    m_binario = m_archivo.peek(4) == "GMAS";
+    if (m_binario && !leerEncabezado()) {
+        setErrorString(tr("Archivo de lecturas no soportado"));
+        m_archivo.close();
+        return false;
+    }
+
+    // Las lecturas se leen directamente de la salida, sin el buffer de
+    // QIODevice
+    if (!QIODevice::open(modo | QIODevice::Unbuffered)) {
+        m_archivo.close();
+        return false;
+    }
+
+    m_enviadas = 0;
+    m_terminado = false;
+    m_cronometro.start();
+    reiniciarReloj();
+    return true;
+}
+
+/**
+ * Detiene la reproduccion y cierra el archivo de lecturas
+ */
+void Reproductor::close() {
+    QIODevice::close();
+
+    m_temporizador->stop();
+    m_archivo.close();
+    m_muestras.clear();
+    m_salida.clear();
+    m_siguiente = 0;
+    m_posicion = 0;
+}
+
+/**
+ * Copia hasta @a maximo bytes de tramas codificadas en @a datos
+ */
+qint64 Reproductor::readData(char* datos, qint64 maximo) {
+    const int bytes = static_cast<int>(qMin<qint64>(maximo, m_salida.size() - m_posicion));
+    memcpy(datos, m_salida.constData() + m_posicion, bytes);
+
+    m_posicion += bytes;
+    if (m_posicion >= m_salida.size()) {
+        m_salida.resize(0);
+        m_posicion = 0;
+    }
+
+    return bytes;
+}
+
+/**
+ * Descarta los comandos para el MCU, no hay ningun motor que controlar
+ */
+qint64 Reproductor::writeData(const char* datos, qint64 bytes) {
+    Q_UNUSED(datos);
+    return bytes;
+}
+
+/**
+ * Codifica las lecturas que corresponden al tiempo transcurrido (o un
+ * bloque de lecturas si la velocidad es la maxima) y avisa que hay datos
+ * disponibles
+ */
+void Reproductor::avanzar() {
+    if (m_terminado)
+        return;
+
+    // Calcular cuantas lecturas se deben entregar en este ciclo
+    quint64 objetivo = m_enviadas + LECTURAS_POR_CICLO;
+    if (m_velocidad > 0) {
+        const qreal segundos = m_reloj.nsecsElapsed() * 1e-9;
+        const quint64 total = m_base + static_cast<quint64>(segundos * m_frecuencia * m_velocidad);
+        objetivo = qMin(objetivo, total);
+    }
+
+    // Codificar las lecturas
+    bool fin = false;
+    if (objetivo > m_enviadas)
+        m_salida.reserve(m_salida.size() + static_cast<int>(objetivo - m_enviadas) * Protocolo::TramaTelemetria);
+
+    while (m_enviadas < objetivo) {
+        if (m_siguiente >= m_muestras.count() && !cargar()) {
+            fin = true;
+            break;
+        }
+
+        codificar(m_muestras.at(m_siguiente++));
+        ++m_enviadas;
+    }
+
+    // Entregar las tramas, el receptor las lee dentro de esta señal
+    if (bytesAvailable() > 0)
+        emit readyRead();
+
+    // Avisar que termino el archivo
+    if (fin) {
+        m_terminado = true;
+        m_temporizador->stop();
+
+        const qreal segundos = qMax<qreal>(1e-9, m_cronometro.nsecsElapsed() * 1e-9);
+        qInfo() << "Reproduccion terminada:" << m_enviadas << "lecturas en"
+                << segundos << "s (" << m_enviadas / segundos << "lecturas/s )";
+
+        emit readChannelFinished();
+    }
+}
+
+/**
+ * Lee el siguiente grupo de lecturas del archivo
+ *
+ * @return @a false si ya no hay lecturas
+ */
+bool Reproductor::cargar() {
+    m_siguiente = 0;
+    m_muestras.resize(0);
+
+    while (m_muestras.isEmpty()) {
+        const bool leido = m_binario ? cargarBinario() : cargarCsv();
+        if (!leido)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Lee hasta FILAS_CSV filas del archivo CSV (ver SumideroCsv). El archivo
+ * no guarda las lecturas del giroscopio, por lo que se reproducen en 0.
+ *
+ * @return @a false si se llego al final del archivo
+ */
+bool Reproductor::cargarCsv() {
+    char linea[512];
+
+    for (int i = 0; i < FILAS_CSV; ++i) {
+        const qint64 bytes = m_archivo.readLine(linea, sizeof(linea));
+        if (bytes <= 0)
+            return !m_muestras.isEmpty();
+
+        // Leer numero de lectura y aceleracion, ignorar el encabezado y las
+        // filas incompletas
+        char* c = linea;
+        char* fin;
+        double valores[4];
+        int campos = 0;
+        for (; campos < 4; ++campos) {
+            valores[campos] = strtod(c, &fin);
+            if (fin == c || (*fin != ',' && campos < 3))
+                break;
+
+            c = fin + 1;
+        }
+
+        if (campos < 4)
+            continue;
+
+        Muestra muestra;
+        muestra.formato = Muestra::FormatoBinario;
+        muestra.secuencia = 0;
+        muestra.tiempo = 0;
+        for (int j = 0; j < 3; ++j) {
+            muestra.accel[j] = static_cast<float>(valores[j + 1]);
+            muestra.gyro[j] = 0;
+        }
+
+        m_muestras.append(muestra);
+    }
+
+    return true;
+}
+
+/**
+ * Lee el siguiente bloque del archivo binario (ver SumideroBinario)
+ *
+ * @return @a false si se llego al final del archivo o el bloque esta
+ *         incompleto
+ */
+bool Reproductor::cargarBinario() {
+    quint32 n;
+    if (m_archivo.read(reinterpret_cast<char*>(&n), sizeof(n)) != sizeof(n))
+        return false;
+
+    const qint64 bytes = static_cast<qint64>(n) * (sizeof(double) + m_canales * sizeof(float));
+    m_bloque = m_archivo.read(bytes);
+    if (m_bloque.size() != bytes)
+        return false;
+
+    // Saltar la columna de tiempos y leer las columnas del acelerometro
+    // y del giroscopio
+    const char* columnas = m_bloque.constData() + n * sizeof(double);
+    m_muestras.resize(static_cast<int>(n));
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+        Muestra& muestra = m_muestras[i];
+        muestra.formato = Muestra::FormatoBinario;
+        muestra.secuencia = 0;
+        muestra.tiempo = 0;
+
+        for (int j = 0; j < 3; ++j) {
+            float accel;
+            float gyro;
+            memcpy(&accel, columnas + ((CanalAccelX + j) * n + i) * sizeof(float), sizeof(float));
+            memcpy(&gyro, columnas + ((CanalGyroX + j) * n + i) * sizeof(float), sizeof(float));
+            muestra.accel[j] = accel * m_escalas[CanalAccelX + j];
+            muestra.gyro[j] = gyro * m_escalas[CanalGyroX + j];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Lee el encabezado del archivo binario, los canales deben estar en el
+ * orden de la version 1 del formato y en el orden de bytes de este equipo
+ *
+ * @return @a false si el archivo no se puede reproducir
+ */
+bool Reproductor::leerEncabezado() {
+    const QByteArray encabezado = m_archivo.read(10);
+    if (encabezado.size() != 10 || encabezado.left(4) != "GMAS")
+        return false;
+
+    quint16 version;
+    quint16 orden;
+    quint16 canales;
+    memcpy(&version, encabezado.constData() + 4, sizeof(version));
+    memcpy(&orden, encabezado.constData() + 6, sizeof(orden));
+    memcpy(&canales, encabezado.constData() + 8, sizeof(canales));
+    if (version != 1 || orden != 0x0102 || canales <= CanalGyroZ)
+        return false;
+
+    // Leer nombre, unidad y escala de cada canal
+    m_canales = canales;
+    for (int i = 0; i < m_canales; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            char longitud;
+            if (!m_archivo.getChar(&longitud))
+                return false;
+
+            const int bytes = static_cast<quint8>(longitud);
+            if (m_archivo.read(bytes).size() != bytes)
+                return false;
+        }
+
+        float escala;
+        if (m_archivo.read(reinterpret_cast<char*>(&escala), sizeof(escala)) != sizeof(escala))
+            return false;
+
+        if (i < NumCanales)
+            m_escalas[i] = escala;
+    }
+
+    return true;
+}
+
+/**
+ * Agrega la trama de telemetria de la @a muestra a la salida, el tiempo
+ * del MCU se calcula a partir de la frecuencia de muestreo
+ */
+void Reproductor::codificar(const Muestra& muestra) {
+    Protocolo::Telemetria telemetria;
+    telemetria.secuencia = static_cast<quint16>(m_enviadas);
+    telemetria.tiempo = static_cast<quint32>(m_enviadas * 1e6 / m_frecuencia);
+    telemetria.config = Configuracion(muestra);
+
+    const float fa = Protocolo::factorAcelerometro(telemetria.config);
+    const float fg = Protocolo::factorGiroscopio(telemetria.config);
+    for (int i = 0; i < 3; ++i) {
+        telemetria.accel[i] = Crudo(muestra.accel[i], fa);
+        telemetria.gyro[i] = Crudo(muestra.gyro[i], fg);
+    }
+
+    const int inicio = m_salida.size();
+    m_salida.resize(inicio + Protocolo::TramaTelemetria);
+    Protocolo::codificarTelemetria(telemetria, reinterpret_cast<quint8*>(m_salida.data() + inicio));
+}
+
+/**
+ * Toma la lectura actual como el nuevo punto de partida del reloj de
+ * reproduccion y ajusta el periodo del temporizador a la velocidad
+ */
+void Reproductor::reiniciarReloj() {
+    m_base = m_enviadas;
+    m_reloj.start();
+
+    if (isOpen() && !m_terminado)
+        m_temporizador->start(m_velocidad > 0 ? PERIODO_ENTREGA : 0);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef REPRODUCTOR_H
+#define REPRODUCTOR_H
+
+#include <QFile>
+#include <QVector>
+#include <QIODevice>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include "Muestra.h"
+
+class QTimer;
+
+//
+// Dispositivo de solo lectura que reproduce un archivo de lecturas
+// grabado por el programa (CSV o binario, ver Sumidero) como si fuera el
+// puerto serial del GMAS.
+//
+// Cada lectura se vuelve a codificar como una trama de telemetria, de
+// modo que la reproduccion pasa por el mismo decodificador, la misma
+// estimacion de la posicion y la misma grafica que una prueba en vivo.
+// Los comandos que se escriben en el dispositivo se descartan.
+//
+// Las lecturas se entregan a la frecuencia de muestreo multiplicada por la
+// velocidad de reproduccion, o tan rapido como el programa las pueda
+// procesar si la velocidad es 0. Al terminar el archivo se emite
+// readChannelFinished().
+//
+class Reproductor : public QIODevice {
+    Q_OBJECT
+
+public:
+    explicit Reproductor(const QString& ruta, QObject* parent = Q_NULLPTR);
+
+    qreal velocidad() const;
+    qreal frecuencia() const;
+    quint64 lecturas() const;
+
+    void cambiarVelocidad(const qreal velocidad);
+    void cambiarFrecuencia(const qreal frecuencia);
+
+    bool isSequential() const;
+    qint64 bytesAvailable() const;
+    bool open(OpenMode modo);
+    void close();
+
+protected:
+    qint64 readData(char* datos, qint64 maximo);
+    qint64 writeData(const char* datos, qint64 bytes);
+
+private slots:
+    void avanzar();
+
+private:
+    bool cargar();
+    bool cargarCsv();
+    bool cargarBinario();
+    bool leerEncabezado();
+    void codificar(const Muestra& muestra);
+    void reiniciarReloj();
+
+private:
+    static const int LECTURAS_POR_CICLO = 4096;
+
+    bool m_binario;
+    bool m_terminado;
+    int m_canales;
+    float m_escalas[NumCanales];
+
+    qreal m_velocidad;
+    qreal m_frecuencia;
+
+    quint64 m_enviadas;
+    quint64 m_base;
+    QElapsedTimer m_reloj;
+    QElapsedTimer m_cronometro;
+
+    QFile m_archivo;
+    QTimer* m_temporizador;
+
+    int m_siguiente;
+    QVector<Muestra> m_muestras;
+    QByteArray m_bloque;
+
+    int m_posicion;
+    QByteArray m_salida;
+};
+
+#endif
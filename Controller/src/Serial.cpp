@@ -21,17 +21,15 @@
  */
 
 #include "Serial.h"
+#include "Adquisicion.h"
 
 #include <QDir>
+#include <climits>
 #include <QtMath>
-#include <QTimer>
-#include <QDebug>
-#include <QDateTime>
+#include <QFileInfo>
 #include <QXYSeries>
 #include <QMetaType>
-#include <QSerialPort>
 #include <QMessageBox>
-#include <QApplication>
 #include <QSerialPortInfo>
 
 //
@@ -42,44 +40,73 @@ Q_DECLARE_METATYPE(QAbstractSeries *)
 Q_DECLARE_METATYPE(QAbstractAxis *)
 
 /**
- * Implementacion de una funcion que elimina los elementos mas viejos de una lista
- * mientras que el numero de lecturas de la lista es mayor al numero maximo de lecturas.
+ * Regresa el canal de las lecturas que le corresponde a la @a signal de
+ * la interfaz grafica y el @a factor para convertirlo a las unidades que
+ * se muestran en pantalla
  */
-template <typename T>
-static void EliminarLecturasViejas(QVector<T> *vector, const int numMaximoElementos) {
-    while (vector->count() > numMaximoElementos)
-        vector->removeFirst();
+int Serial::canalDeSenal(const int signal, qreal* factor) {
+    *factor = 1;
+
+    switch (signal) {
+    case 0:
+        return CanalAccelX;
+    case 1:
+        return CanalAccelY;
+    case 2:
+        return CanalAccelZ;
+    case 4:
+        *factor = 1000;
+        return CanalPosZ;
+    case 5:
+        *factor = 100;
+        return CanalVelZ;
+    default:
+        return CanalAccelP;
+    }
 }
 
 /**
- * Inicializa los miembros de la clase y comienza a buscar
- * dispositivos serial
+ * Inicializa los miembros de la clase, crea el primer dispositivo (sin
+ * conexion) y comienza a buscar dispositivos serial
  */
 Serial::Serial() {
     // Inicializar valores
-    m_velocidad = 0;
+    m_actual = 0;
+    m_escala = escalaMin() * 2;
+    m_anchoGrafica = 800;
     m_numLecturas = 0;
-    m_puerto = Q_NULLPTR;
-    m_gmasHabilitado = false;
-    m_escala = escalaMax() / 2;
 
     // Registrar tipos de datos
     qRegisterMetaType<QAbstractSeries*>();
     qRegisterMetaType<QAbstractAxis*>();
 
+    // Siempre hay un dispositivo actual, aunque no este conectado
+    crearDispositivo();
+
+    // Leer las lecturas procesadas a la misma frecuencia que la grafica
+    m_temporizador.setInterval(1000 / 60);
+    connect(&m_temporizador, &QTimer::timeout,
+            this,            &Serial::sincronizar);
+    m_temporizador.start();
+
     // Comenzar busqueda de dispositivos
     QTimer::singleShot(1000, this, &Serial::actualizarDispositivosSerial);
-
-    // Comenzar a mandar datos de manera periodica
-    QTimer::singleShot(1000, this, &Serial::mandarDatos);
 }
 
 /**
- * Cierra la conexión con el dispositivo serial antes de que la ejecución
- * del programa termine.
+ * Cierra la conexión con todos los dispositivos y detiene los hilos de
+ * adquisicion antes de que la ejecución del programa termine.
  */
 Serial::~Serial() {
-    desconectarDispositivo();
+    qDeleteAll(m_dispositivos);
+    m_dispositivos.clear();
+
+    foreach (QThread* hilo, m_hilos) {
+        hilo->quit();
+        hilo->wait();
+    }
+
+    qDeleteAll(m_hilos);
 }
 
 /**
@@ -94,7 +121,7 @@ int Serial::escala() const {
  * Regresa la amplitud target actual
  */
 qreal Serial::velocidad() const {
-    return m_velocidad;
+    return actual()->velocidad();
 }
 
 /**
@@ -108,7 +135,7 @@ int Serial::escalaMin() const {
  * Regresa la escala maxima
  */
 int Serial::escalaMax() const {
-    return 2000;
+    return 300000;
 }
 
 /**
@@ -130,25 +157,29 @@ qreal Serial::velocidadMax() const {
  * actualizar la gráfica
  */
 quint64 Serial::numLecturas() const {
-    return m_numLecturas;
+    return actual()->numLecturas();
+}
+
+/**
+ * Regresa el historial de lecturas del dispositivo actual, solo se debe
+ * leer desde el hilo de la interfaz grafica o mientras esta bloqueado
+ */
+const BufferCircular<NumCanales>& Serial::lecturas() const {
+    return actual()->lecturas();
 }
 
 /**
  * Regresa @a true si el GMAS esta habilitado
  */
 bool Serial::gmasHabilitado() const {
-    return m_gmasHabilitado;
+    return actual()->gmasHabilitado();
 }
 
 /**
- * Regresa @a true si estamos conectados a algun dispositivo
- * serial
+ * Regresa @a true si el dispositivo actual esta conectado
  */
 bool Serial::conexionConDispositivo() const {
-    if (m_puerto != Q_NULLPTR)
-        return m_puerto->isOpen();
-
-    return false;
+    return actual()->conectado();
 }
 
 /**
@@ -159,84 +190,286 @@ QStringList Serial::dispositivosSerial() const {
 }
 
 /**
- * Intenta establecer una conexión a 115200 baudios con el
- * @a device seleccionado.
+ * Regresa el tiempo de ida y vuelta (en ms) del ultimo comando que el MCU
+ * confirmo, o -1 si el MCU no confirma comandos
+ */
+qreal Serial::latenciaComandos() const {
+    return actual()->latenciaComandos();
+}
+
+/**
+ * Regresa el modo de control del motor (ver Adquisicion::ModoControl)
+ */
+int Serial::modoControl() const {
+    return actual()->modoControl();
+}
+
+/**
+ * Regresa la frecuencia (Hz) o amplitud que se quiere mantener en los
+ * modos de lazo cerrado
+ */
+qreal Serial::consigna() const {
+    return actual()->consigna();
+}
+
+/**
+ * Regresa la consigna maxima para el modo de control actual
+ */
+qreal Serial::consignaMax() const {
+    if (modoControl() == Adquisicion::ControlAmplitud)
+        return 20;
+
+    return 25;
+}
+
+/**
+ * Regresa la señal de la grafica cuyo espectro se analiza
+ */
+int Serial::canalEspectro() const {
+    return actual()->canalEspectro();
+}
+
+/**
+ * Regresa la frecuencia (Hz) de la oscilacion dominante
+ */
+qreal Serial::frecuencia() const {
+    return actual()->frecuencia();
+}
+
+/**
+ * Regresa la amplitud de la oscilacion dominante, en las unidades de la
+ * señal analizada
+ */
+qreal Serial::amplitud() const {
+    return actual()->amplitud();
+}
+
+/**
+ * Regresa la fase (en grados) de la oscilacion dominante
+ */
+qreal Serial::fase() const {
+    return qRadiansToDegrees(static_cast<qreal>(actual()->analisis().fase));
+}
+
+/**
+ * Regresa la razon de amortiguamiento de la oscilacion dominante
+ */
+qreal Serial::amortiguamiento() const {
+    return actual()->analisis().amortiguamiento;
+}
+
+/**
+ * Regresa la frecuencia maxima del espectro (frecuencia de Nyquist)
+ */
+qreal Serial::frecuenciaMaxima() const {
+    return actual()->analisis().resolucion * (Espectro::NUM_BINS - 1);
+}
+
+/**
+ * Regresa el modo de telemetria del dispositivo actual (ver
+ * Protocolo::ModoTelemetria)
+ */
+int Serial::modoTelemetria() const {
+    return actual()->modoTelemetria();
+}
+
+/**
+ * Regresa el numero de muestras del MCU por cada trama que manda el
+ * dispositivo actual
+ */
+int Serial::decimacion() const {
+    return actual()->decimacion();
+}
+
+/**
+ * Regresa la frecuencia (Hz) con la que el MCU muestrea el sensor, la
+ * frecuencia de las tramas es esta entre la decimacion
+ */
+int Serial::frecuenciaMuestreo() const {
+    return Protocolo::FrecuenciaMuestreo;
+}
+
+/**
+ * Regresa la decimacion maxima que acepta el MCU
+ */
+int Serial::maxDecimacion() const {
+    return Protocolo::MaxDecimacion;
+}
+
+/**
+ * Regresa el ultimo resumen de ventana del dispositivo actual, una lista
+ * con el minimo, maximo, media y RMS de cada eje (acelerometro X, Y, Z y
+ * giroscopio X, Y, Z)
+ */
+QVariantList Serial::resumen() const {
+    const ResumenVentana& resumen = actual()->resumen();
+
+    QVariantList ejes;
+    for (int i = 0; i < 6; ++i) {
+        QVariantMap eje;
+        eje["minimo"] = resumen.minimo[i];
+        eje["maximo"] = resumen.maximo[i];
+        eje["media"] = resumen.media[i];
+        eje["rms"] = resumen.rms[i];
+        ejes.append(eje);
+    }
+
+    return ejes;
+}
+
+/**
+ * Regresa la cadena de filtros del dispositivo actual, una lista con el
+ * tipo y los parametros de cada etapa (ver CadenaFiltros::leerEtapas())
+ */
+QVariantList Serial::filtros() const {
+    return actual()->filtros();
+}
+
+/**
+ * Regresa el resumen de las etapas de la ruta de datos (lectura del
+ * puerto, decodificacion, procesamiento, grabador y grafica) del
+ * dispositivo actual
+ */
+Diagnostico* Serial::diagnostico() const {
+    return actual()->diagnostico();
+}
+
+/**
+ * Regresa los puertos (o archivos) de los dispositivos conectados
+ */
+QStringList Serial::puertosAbiertos() const {
+    QStringList puertos;
+    foreach (Dispositivo* dispositivo, m_dispositivos) {
+        if (dispositivo->conectado())
+            puertos.append(dispositivo->puerto());
+    }
+
+    return puertos;
+}
+
+/**
+ * Regresa la lista de dispositivos abiertos (ver Dispositivo)
+ */
+QVariantList Serial::dispositivos() const {
+    QVariantList lista;
+    foreach (Dispositivo* dispositivo, m_dispositivos)
+        lista.append(QVariant::fromValue(dispositivo));
+
+    return lista;
+}
+
+/**
+ * Regresa el indice del dispositivo que se controla y se muestra en la
+ * grafica
+ */
+int Serial::dispositivoActual() const {
+    return m_actual;
+}
+
+/**
+ * Regresa el dispositivo que se controla y se muestra en la grafica
+ */
+Dispositivo* Serial::actual() const {
+    return m_dispositivos.at(m_actual);
+}
+
+/**
+ * Intenta establecer una conexión a 1 Mbaud con el @a device
+ * seleccionado. Si el dispositivo actual ya esta conectado se abre un
+ * dispositivo adicional en uno de los hilos de adquisicion, este metodo
+ * espera a que el hilo termine de abrir el puerto.
  *
  * @return @a true si la conexión se establecio con éxito,
  *         @a false si hubo algún error
  */
 bool Serial::conectarADispositivo(const int device) {
-    // Disconectar el dispositivo actual
-    desconectarDispositivo();
-
-    // Obtener lista de puertos serial
-    QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
-
     // Checar que el dispositivo sea valido
-    assert(device < ports.count());
+    if (device < 0 || device >= m_dispositivosSerial.count())
+        return false;
 
-    // Configurar nuevo dispositivo serial
-    m_puerto = new QSerialPort(ports.at(device));
-    m_puerto->setBaudRate(1000000);
+    const QString puerto = m_dispositivosSerial.at(device);
 
-    // Conectar señales para poder leer datos del dispositivo
-    connect(m_puerto, SIGNAL(readyRead()),
-            this,       SLOT(onDatosRecibidos()));
-    connect(m_puerto, SIGNAL(aboutToClose()),
-            this,       SLOT(desconectarDispositivo()));
-
-    // Intentar abrir una conexion con el dispositivo
-    if (m_puerto->open(QIODevice::ReadWrite)) {
-        // Actualizar UI
-        emit conexionCambiada();
-
-        // Obtener tiempo actual
-        QDateTime tiempo = QDateTime::currentDateTime();
-
-        // Crear carpeta para guardar archivo de lecturas
-        QDir dir = QDir::homePath() + "/" + qApp->applicationName() + "/";
-        if (!dir.exists())
-            dir.mkpath(".");
-
-        // Obtener nombre para archivo de lecturas
-        QString filename = QString("Lecturas-%1-%2.csv")
-                .arg(m_puerto->portName())
-                .arg(tiempo.toString("hh_mm_ss - dd_MMM_yyyy"));
-
-        // Intentar abrir archivo de lecturas
-        m_archivoLecturas.setFileName(dir.filePath(filename));
-        if (!m_archivoLecturas.open(QFile::WriteOnly))
-            qWarning() << "No se puede generar el archivo de lecturas";
-
-        // Escribir titulos al archivo de salidas
-        else {
-            m_archivoLecturas.write("Num. Lectura, "
-                                    "Aceleracion en X,"
-                                    "Aceleracion en Y,"
-                                    "Aceleracion en Z,"
-                                    "Aceleracion Promedio,"
-                                    "Fuerza Resultante\n");
-        }
-
-        // Regresar verdadero para notificar resultado
+    // El puerto ya esta abierto, solo seleccionarlo
+    Dispositivo* dispositivo = buscarDispositivo(puerto);
+    if (dispositivo && dispositivo->conectado()) {
+        cambiarDispositivoActual(m_dispositivos.indexOf(dispositivo));
         return true;
     }
 
+    // Reutilizar el dispositivo si el puerto se desconecto
+    if (!dispositivo)
+        dispositivo = dispositivoLibre();
+
+    // Intentar abrir una conexion con el dispositivo
+    const bool conectado = dispositivo->conectar(puerto);
+
     // Hubo un error al abrir la conexión
-    else {
-        desconectarDispositivo();
+    if (!conectado) {
+        eliminarDispositivo(dispositivo);
         QMessageBox::warning(Q_NULLPTR,
                              tr("Error de comunicación"),
                              tr("Error al intentar establecer una conexión con %1")
-                             .arg(ports.at(device).portName()));
+                             .arg(puerto));
+        return false;
     }
 
-    // Hubo algun error
-    return false;
+    cambiarDispositivoActual(m_dispositivos.indexOf(dispositivo));
+    return true;
 }
 
 /**
- * Actualiza la escala de las graficas
+ * Cierra la conexion con el @a device seleccionado, si hay otros
+ * dispositivos abiertos el dispositivo se elimina de la lista
+ *
+ * @return @a true si el puerto se habia abierto
+ */
+bool Serial::desconectarDispositivo(const int device) {
+    if (device < 0 || device >= m_dispositivosSerial.count())
+        return false;
+
+    Dispositivo* dispositivo = buscarDispositivo(m_dispositivosSerial.at(device));
+    if (!dispositivo)
+        return false;
+
+    dispositivo->desconectar();
+    eliminarDispositivo(dispositivo);
+    return true;
+}
+
+/**
+ * Reproduce el @a archivo de lecturas grabado por el programa como si
+ * fuera un dispositivo conectado. Una @a velocidad de 1 reproduce las
+ * lecturas en tiempo real, una de 2 al doble, etc. y una de 0 tan rapido
+ * como se puedan procesar.
+ */
+bool Serial::reproducirArchivo(const QUrl& archivo, const qreal velocidad) {
+    const QString ruta = archivo.isLocalFile() ? archivo.toLocalFile() : archivo.toString();
+
+    // Intentar abrir el archivo
+    Dispositivo* dispositivo = dispositivoLibre();
+    const bool abierto = dispositivo->reproducir(ruta, velocidad);
+
+    if (!abierto) {
+        eliminarDispositivo(dispositivo);
+        QMessageBox::warning(Q_NULLPTR,
+                             tr("Error de reproducción"),
+                             tr("No se puede reproducir el archivo %1").arg(ruta));
+        return false;
+    }
+
+    cambiarDispositivoActual(m_dispositivos.indexOf(dispositivo));
+    return true;
+}
+
+/**
+ * Pide al dispositivo actual que vuelva a calibrar su sensor
+ */
+void Serial::recalibrar() {
+    actual()->recalibrar();
+}
+
+/**
+ * Actualiza la escala de las graficas de todos los dispositivos
  */
 void Serial::cambiarEscala(const int escala) {
     if (escala < escalaMin())
@@ -246,26 +479,156 @@ void Serial::cambiarEscala(const int escala) {
     else
         m_escala = escala;
 
+    foreach (Dispositivo* dispositivo, m_dispositivos)
+        dispositivo->cambiarVentana(m_escala, m_anchoGrafica);
+
     emit escalaCambiada();
 }
 
 /**
- * Habilita o des-habilita el GMAS
+ * Cambia el ancho (en pixeles) del area de la grafica, las lecturas se
+ * reducen a un minimo y un maximo por pixel
+ */
+void Serial::cambiarAnchoGrafica(const int pixeles) {
+    if (pixeles > 0 && pixeles != m_anchoGrafica) {
+        m_anchoGrafica = pixeles;
+        foreach (Dispositivo* dispositivo, m_dispositivos)
+            dispositivo->cambiarVentana(m_escala, m_anchoGrafica);
+    }
+}
+
+/**
+ * Habilita o des-habilita el GMAS actual
  */
 void Serial::habilitarGmas(const bool enabled) {
-    m_gmasHabilitado = enabled && conexionConDispositivo() && dispositivosSerial().count() > 0;
+    actual()->habilitar(enabled);
     emit gmasEstadoCambiado();
 }
 
 /**
- * Cambia la velocidad target a la que se movera el GMAS
+ * Cambia la velocidad target a la que se movera el GMAS actual
  */
 void Serial::cambiarVelocidad(const qreal velocidad) {
     assert(velocidad >= velocidadMin());
     assert(velocidad <= velocidadMax());
 
-    m_velocidad = velocidad;
+    actual()->cambiarVelocidad(velocidad);
+    emit velocidadCambiada();
+}
+
+/**
+ * Cambia el @a modo de control del motor, en los modos de lazo cerrado la
+ * velocidad se ajusta para mantener la consigna de frecuencia o amplitud
+ * de la señal analizada
+ */
+void Serial::cambiarModoControl(const int modo) {
+    assert(modo >= Adquisicion::ControlManual);
+    assert(modo <= Adquisicion::ControlAmplitud);
+
+    const qreal maxima = modo == Adquisicion::ControlAmplitud ? 20 : 25;
+    actual()->cambiarControl(modo, qMin(consigna(), maxima));
+    emit controlCambiado();
+}
+
+/**
+ * Cambia la frecuencia (Hz) o amplitud que se quiere mantener
+ */
+void Serial::cambiarConsigna(const qreal consigna) {
+    actual()->cambiarControl(modoControl(), qBound(0.0, consigna, consignaMax()));
+    emit controlCambiado();
+}
+
+/**
+ * Cambia la @a signal de la grafica (ver @c actualizarGrafica()) cuyo
+ * espectro se analiza
+ */
+void Serial::cambiarCanalEspectro(const int signal) {
+    assert(signal >= 0);
+    assert(signal <= 5);
+
+    actual()->cambiarCanalEspectro(signal);
+    emit canalEspectroCambiado();
+}
+
+/**
+ * Cambia el @a modo de telemetria del dispositivo actual: muestras crudas,
+ * filtradas o solo el resumen de cada ventana
+ */
+void Serial::cambiarModoTelemetria(const int modo) {
+    assert(modo >= Protocolo::ModoCrudo);
+    assert(modo <= Protocolo::ModoResumen);
+
+    actual()->cambiarTelemetria(modo, decimacion());
+    emit telemetriaCambiada();
+}
+
+/**
+ * Cambia el numero de muestras del MCU por cada trama del dispositivo
+ * actual, se redondea a la potencia de 2 mas cercana que acepta el MCU
+ */
+void Serial::cambiarDecimacion(const int decimacion) {
+    int potencia = 1;
+    while (potencia < Protocolo::MaxDecimacion && potencia * 3 < decimacion * 2)
+        potencia *= 2;
+
+    actual()->cambiarTelemetria(modoTelemetria(), potencia);
+    emit telemetriaCambiada();
+}
+
+/**
+ * Remplaza la cadena de @a filtros del dispositivo actual, cada etapa es
+ * un mapa con su "tipo" y sus parametros (ver CadenaFiltros::leerEtapas())
+ */
+void Serial::cambiarFiltros(const QVariantList& filtros) {
+    actual()->cambiarFiltros(filtros);
+    emit filtrosCambiados();
+}
+
+/**
+ * Selecciona el dispositivo que se controla y se muestra en la grafica,
+ * los demas dispositivos siguen adquiriendo lecturas y conservan su
+ * estado de control
+ */
+void Serial::cambiarDispositivoActual(const int indice) {
+    if (indice < 0 || indice >= m_dispositivos.count() || indice == m_actual)
+        return;
+
+    m_actual = indice;
+
+    emit dispositivoActualCambiado();
+    emit conexionCambiada();
+    emit gmasEstadoCambiado();
     emit velocidadCambiada();
+    emit controlCambiado();
+    emit canalEspectroCambiado();
+    emit espectroCambiado();
+    emit latenciaCambiada();
+    emit telemetriaCambiada();
+    emit resumenCambiado();
+    emit filtrosCambiados();
+}
+
+/**
+ * Remplaza los datos de la gráfica @a series con el ultimo espectro
+ * (amplitud vs frecuencia) de la señal analizada
+ */
+void Serial::actualizarEspectro(QAbstractSeries* series) {
+    assert(series != Q_NULLPTR);
+
+    if (!series->isVisible())
+        return;
+
+    qreal factor;
+    canalDeSenal(canalEspectro(), &factor);
+
+    const QVector<float>& magnitudes = actual()->magnitudes();
+    const int count = magnitudes.count();
+    const qreal resolucion = actual()->analisis().resolucion;
+    m_puntos.resize(count);
+    for (int i = 0; i < count; ++i)
+        m_puntos[i] = QPointF(i * resolucion, static_cast<qreal>(magnitudes[i]) * factor);
+
+    static_cast<QXYSeries*>(series)->replace(m_puntos);
 }
 
 /**
@@ -274,183 +637,214 @@ void Serial::cambiarVelocidad(const qreal velocidad) {
  *   - 0: lecturas de posicion en el eje x
  *   - 1: lecturas de posicion en el eje y
  *   - 2: lecturas de posicion en el eje z
+ *   - 3: aceleracion promedio
+ *   - 4: posicion vertical estimada (mm)
+ *   - 5: velocidad vertical estimada (cm/s)
  */
 void Serial::actualizarGrafica(QAbstractSeries* series, const int signal) {
     // Verificaciones
     assert(signal >= 0);
-    assert(signal <= 3);
+    assert(signal <= 5);
     assert(series != Q_NULLPTR);
 
     // No hacer nada si la grafica no es visible
     if (!series->isVisible())
         return;
 
-    // Obtener puntos para la señal especificada
-    QVector<QPointF>* data = Q_NULLPTR;
-    switch (signal) {
-    case 0:
-        data = &m_lecturasX;
-        break;
-    case 1:
-        data = &m_lecturasY;
-        break;
-    case 2:
-        data = &m_lecturasZ;
-        break;
-    case 3:
-        data = &m_lecturasP;
-        break;
-    }
+    const qint64 inicio = RelojMonotonico();
+
+    // Obtener canal para la señal especificada
+    qreal factor;
+    const int canal = canalDeSenal(signal, &factor);
+
+    // Generar el minimo y el maximo de cada pixel de la ventana,
+    // reutilizando el buffer
+    const BufferCircular<NumCanales>& historial = lecturas();
+    if (historial.isEmpty())
+        m_puntos.clear();
+    else
+        actual()->decimador().puntos(canal, historial.tiempos()[0], factor, &m_puntos);
 
     // Convertir la gráfica a XY y remplazar puntos
-    if (data != Q_NULLPTR)
-        static_cast<QXYSeries*>(series)->replace(*data);
+    static_cast<QXYSeries*>(series)->replace(m_puntos);
+    diagnostico()->registrarDibujo(RelojMonotonico() - inicio);
 }
 
 /**
- * Manda los datos de control al GMAS
+ * Lee las lecturas que los hilos de adquisicion publicaron desde la ultima
+ * llamada, cada dispositivo lee unicamente de su propia cola
  */
-void Serial::mandarDatos() {
-    // Verificar si el puerto esta disponible
-    if (conexionConDispositivo()) {
-        QString datos = tr("%1;").arg(gmasHabilitado() ? velocidad() : 0);
-        m_puerto->write(datos.toUtf8());
+void Serial::sincronizar() {
+    foreach (Dispositivo* dispositivo, m_dispositivos)
+        dispositivo->sincronizar();
+
+    // Recorrer las etiquetas del eje del tiempo con las nuevas lecturas
+    if (numLecturas() != m_numLecturas) {
+        m_numLecturas = numLecturas();
+        emit numLecturasCambiado();
     }
+}
 
-    // Llamar esta funcion de nuevo en 100 ms
-    QTimer::singleShot(100, this, &Serial::mandarDatos);
+/**
+ * Notifica a la interfaz grafica que un dispositivo se conecto o se
+ * desconecto
+ */
+void Serial::onConexionCambiada() {
+    if (sender() == actual())
+        emit gmasEstadoCambiado();
+
+    emit conexionCambiada();
 }
 
 /**
- * Llamado cuando recibimos cualquier número de bytes del dispositivo
- * serial, genera y separa paquetes de datos para su posterior interpretacion
+ * Regresa el dispositivo que abrio el @a puerto especificado (aunque ya se
+ * haya desconectado), o @c Q_NULLPTR si el puerto no se ha abierto
  */
-void Serial::onDatosRecibidos() {
-    // Verificar apuntador del puerto serial
-    if (!m_puerto)
-        return;
+Dispositivo* Serial::buscarDispositivo(const QString& puerto) const {
+    Dispositivo* encontrado = Q_NULLPTR;
+    foreach (Dispositivo* dispositivo, m_dispositivos) {
+        if (dispositivo->puerto() == puerto) {
+            if (dispositivo->conectado())
+                return dispositivo;
+
+            encontrado = dispositivo;
+        }
+    }
+
+    return encontrado;
+}
 
-    // Leer datos del puerto serial
-    m_buffer.append(m_puerto->readAll());
-
-    // El buffer contiene la secuencia de terminacion, lo cual representa un
-    // paquete
-    if (m_buffer.contains(';')) {
-        // Pudimos haber recibido parte del siguiente paquete, o mas de un
-        // paquete, para evitar errores, separamos los paquetes individualmente
-        QList<QByteArray> paquetes = m_buffer.split(';');
-
-        // Verificar si el ultimo paquete esta completo o no
-        if (m_buffer.endsWith(";"))
-            m_buffer.clear();
-        else {
-            m_buffer = paquetes.last();
-            paquetes.removeLast();
+/**
+ * Regresa el dispositivo actual si no esta conectado, de lo contrario
+ * crea un dispositivo adicional
+ */
+Dispositivo* Serial::dispositivoLibre() {
+    if (!actual()->conectado())
+        return actual();
+
+    return crearDispositivo();
+}
+
+/**
+ * Crea un dispositivo sin conexion en el hilo de adquisicion con menos
+ * dispositivos y lo agrega a la lista. Si la variable de entorno
+ * GMAS_DIAGNOSTICO contiene la ruta de un archivo, el resumen de cada
+ * dispositivo se registra en ese archivo (con el numero de dispositivo
+ * a partir del segundo).
+ */
+Dispositivo* Serial::crearDispositivo() {
+    Dispositivo* dispositivo = new Dispositivo(asignarHilo(), this);
+    dispositivo->cambiarVentana(m_escala, m_anchoGrafica);
+    connect(dispositivo, &Dispositivo::conexionCambiada,
+            this,        &Serial::onConexionCambiada);
+    connect(dispositivo, &Dispositivo::espectroCambiado, this, [=]() {
+        if (dispositivo == actual())
+            emit espectroCambiado();
+    });
+    connect(dispositivo, &Dispositivo::latenciaCambiada, this, [=]() {
+        if (dispositivo == actual())
+            emit latenciaCambiada();
+    });
+    connect(dispositivo, &Dispositivo::resumenCambiado, this, [=]() {
+        if (dispositivo == actual())
+            emit resumenCambiado();
+    });
+
+    QString ruta = QString::fromLocal8Bit(qgetenv("GMAS_DIAGNOSTICO"));
+    if (!ruta.isEmpty()) {
+        if (!m_dispositivos.isEmpty()) {
+            const QFileInfo info(ruta);
+            ruta = info.dir().filePath(QString("%1-%2.%3")
+                                       .arg(info.completeBaseName())
+                                       .arg(m_dispositivos.count() + 1)
+                                       .arg(info.suffix()));
         }
 
-        // Leer cada paquete de manera individual
-        foreach (QByteArray paquete, paquetes)
-            interpretarPaquete(paquete);
+        dispositivo->diagnostico()->iniciarRegistro(ruta);
     }
 
-    // Asegurarnos que el tamaño del buffer no excede los limites del programa
-    if (m_buffer.length() >= 1024)
-        m_buffer.clear();
-}
-
-/**
- * Realiza una doble integración con el promedio de los datos anteriores para obtener
- * la posición actual en [x,y,z] del sensor del GMAS.
- */
-void Serial::actualizarPosicion() {
-    // Obtener lecturas en X,Y,Z
-    qreal lecX = static_cast<qreal>(m_lecturasAccl.last().x());
-    qreal lecY = static_cast<qreal>(m_lecturasAccl.last().y());
-    qreal lecZ = static_cast<qreal>(m_lecturasAccl.last().z());
-
-    // Obtener distancia entre el punto de origen y el punto
-    // tri-dimensional reportado por el MCU
-    qreal posP = sqrt(pow(lecX, 2) + pow(lecY, 2) + pow(lecZ, 2));
-
-    // Incrementar contador
-    ++m_numLecturas;
-
-    // Eliminar elementos viejos
-    EliminarLecturasViejas<QPointF>(&m_lecturasX, escala());
-    EliminarLecturasViejas<QPointF>(&m_lecturasY, escala());
-    EliminarLecturasViejas<QPointF>(&m_lecturasZ, escala());
-    EliminarLecturasViejas<QPointF>(&m_lecturasP, escala());
-    EliminarLecturasViejas<QVector3D>(&m_lecturasAccl, escala());
-    EliminarLecturasViejas<QVector3D>(&m_lecturasGyro, escala());
-
-    // Generar puntos de posicion/tiempo
-    QPointF puntoX(m_numLecturas, lecX);
-    QPointF puntoY(m_numLecturas, lecY);
-    QPointF puntoZ(m_numLecturas, lecZ);
-    QPointF puntoP(m_numLecturas, posP);
-
-    // Actualizar lista de posiciones
-    m_lecturasX.append(puntoX);
-    m_lecturasY.append(puntoY);
-    m_lecturasZ.append(puntoZ);
-    m_lecturasP.append(puntoP);
-
-    // Guardar en archivo de lecturas
-    if (m_archivoLecturas.isOpen()) {
-        QString data = tr("%1,%2,%3,%4,%5,%6\n")
-                .arg(m_numLecturas)
-                .arg(lecX)
-                .arg(lecY)
-                .arg(lecZ)
-                .arg(posP)
-                .arg(posP * 0.1275);
-
-        m_archivoLecturas.write(data.toUtf8());
-    }
+    m_dispositivos.append(dispositivo);
+    emit listaDispositivosCambiada();
+    return dispositivo;
 }
 
 /**
- * Termina la conexión con el dispositivo serial actual (si hay alguno conectado)
+ * Elimina el @a dispositivo de la lista, excepto si es el unico (siempre
+ * hay un dispositivo actual)
  */
-void Serial::desconectarDispositivo() {
-    // Verificar si el puerto serial es valido
-    if (m_puerto != Q_NULLPTR) {
-        // Apagar motor
-        if (conexionConDispositivo()) {
-            for (int i = 0; i < 255; ++i)
-                m_puerto->write("0;");
-        }
+void Serial::eliminarDispositivo(Dispositivo* dispositivo) {
+    const int indice = m_dispositivos.indexOf(dispositivo);
+    if (indice < 0 || m_dispositivos.count() == 1)
+        return;
+
+    // Seleccionar otro dispositivo antes de eliminarlo
+    Dispositivo* seleccionado = actual();
+    if (seleccionado == dispositivo)
+        seleccionado = m_dispositivos.at(indice == 0 ? 1 : indice - 1);
 
-        // Cerrar archivo de salida
-        if (m_archivoLecturas.isOpen())
-            m_archivoLecturas.close();
+    m_dispositivos.removeAt(indice);
+    m_actual = -1;
+    cambiarDispositivoActual(m_dispositivos.indexOf(seleccionado));
+    emit listaDispositivosCambiada();
 
-        // Disconectar señales del puerto serial
-        m_puerto->disconnect(this, SLOT(onDatosRecibidos()));
-        m_puerto->disconnect(this, SLOT(desconectarDispositivo()));
+    delete dispositivo;
+}
 
-        // Cerrar y eliminar conexion
-        m_puerto->close();
-        m_puerto->deleteLater();
+/**
+ * Regresa el hilo de adquisicion con menos dispositivos, se crea un hilo
+ * nuevo mientras haya menos hilos que nucleos
+ */
+QThread* Serial::asignarHilo() {
+    QThread* seleccionado = Q_NULLPTR;
+    int minimo = INT_MAX;
+    foreach (QThread* hilo, m_hilos) {
+        int count = 0;
+        foreach (Dispositivo* dispositivo, m_dispositivos) {
+            if (dispositivo->hilo() == hilo)
+                ++count;
+        }
 
-        // Reset apuntador
-        m_puerto = Q_NULLPTR;
+        if (count < minimo) {
+            minimo = count;
+            seleccionado = hilo;
+        }
     }
 
-    // Actualizar UI
-    emit conexionCambiada();
+    if (seleccionado && (minimo == 0 || m_hilos.count() >= qMax(1, QThread::idealThreadCount())))
+        return seleccionado;
+
+    QThread* hilo = new QThread;
+    hilo->setObjectName(QString("Adquisicion-%1").arg(m_hilos.count() + 1));
+    hilo->start(QThread::TimeCriticalPriority);
+    m_hilos.append(hilo);
+    return hilo;
 }
 
 /**
  * Obtiene una lista de dispositivos serial del sistema y alerta al
- * resto de la aplicacion si hubo algún cambio
+ * resto de la aplicacion si hubo algún cambio.
+ *
+ * Los dispositivos que no aparecen como puertos serial (como la
+ * terminal virtual del simulador de AVR/host) se pueden agregar con la
+ * variable de entorno GMAS_DISPOSITIVOS, una lista de rutas separadas
+ * por ':'
  */
 void Serial::actualizarDispositivosSerial() {
     // Buscar dispositivos serial
     QStringList dispositivos;
     foreach(QSerialPortInfo port, QSerialPortInfo::availablePorts()) {
-        if (!port.description().isEmpty())
+        if (!port.description().isEmpty()) {
             dispositivos.append(port.portName());
+        }
+    }
+
+    // Agregar dispositivos de la variable de entorno
+    const QString extra = QString::fromLocal8Bit(qgetenv("GMAS_DISPOSITIVOS"));
+    foreach(QString ruta, extra.split(QDir::listSeparator(),
+                                      QString::SkipEmptyParts)) {
+        if (QFileInfo::exists(ruta)) {
+            dispositivos.append(ruta);
+        }
     }
 
     // Si los dispositivos cambiaron, actualizar la UI
@@ -462,63 +856,3 @@ void Serial::actualizarDispositivosSerial() {
     // Llamar esta funcion dentro de un segundo
     QTimer::singleShot(1000, this, &Serial::actualizarDispositivosSerial);
 }
-
-/**
- * Decodifica las lecturas del acelerometro y giroscopio contenidas en
- * el paquete de @a datos, el cual tiene el sig. formato:
- *
- *          {ACCEL_X,ACCEL_Y,ACCEL_Z,GYRO_X,GYRO_Y,GYRO_Z};
- *
- * Posteriormente, se registran las lecturas del acelerometro y giroscopio
- * en una lista, la cual es usada para calcular la posicion relativa del
- * GMAS.
- */
-void Serial::interpretarPaquete(const QByteArray& datos) {
-    // El paquete esta vacio
-    if (datos.length() <= 0)
-        return;
-
-    // Checar si el paquete es invalido
-    // (el ';' ya fue removido por el proceso de seleccion de paquetes).
-    if (!datos.endsWith("}") || !datos.startsWith("{"))
-        return;
-
-    // Quitar primer caracter y ultimos dos caracteres
-    QByteArray copia = datos;
-    copia.remove(0, 1);
-    copia.chop(2);
-
-    // Generar una lista a partir de los datos del paquete
-    QList<QByteArray> lecturas = copia.split(',');
-
-    // Checar si la lista contiene un numero invalido de elementos
-    if (lecturas.count() != 6)
-        return;
-
-    // Obtener lecturas individuales
-    QString acclX(lecturas.at(0));
-    QString acclY(lecturas.at(1));
-    QString acclZ(lecturas.at(2));
-    QString gyroX(lecturas.at(3));
-    QString gyroY(lecturas.at(4));
-    QString gyroZ(lecturas.at(5));
-
-    // Generar vector de acelerometro
-    QVector3D vectorAccl;
-    vectorAccl.setX(acclX.toFloat());
-    vectorAccl.setY(acclY.toFloat());
-    vectorAccl.setZ(acclZ.toFloat());
-
-    // Generar vector de giroscopio
-    QVector3D vectorGyro;
-    vectorGyro.setX(gyroX.toFloat());
-    vectorGyro.setY(gyroY.toFloat());
-    vectorGyro.setZ(gyroZ.toFloat());
-
-    // Actualizar registro de lecturas
-    m_lecturasAccl.append(vectorAccl);
-    m_lecturasGyro.append(vectorGyro);
-
-    // Calcular posicion y actualizar datos para las graficas
-    QTimer::singleShot(0, this, &Serial::actualizarPosicion);
-}
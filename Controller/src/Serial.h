@@ -23,16 +23,25 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
-#include <QFile>
+#include <QUrl>
+#include <QTimer>
 #include <QObject>
-#include <QVector3D>
+#include <QPointF>
+#include <QThread>
 #include <QStringList>
-#include <QElapsedTimer>
+#include <QVariantList>
 #include <QAbstractSeries>
 
+#include "Dispositivo.h"
+
 QT_CHARTS_USE_NAMESPACE
 
-class QSerialPort;
+//
+// Administrador de los dispositivos abiertos. Cada dispositivo tiene su
+// propia ruta de datos (ver Dispositivo), las adquisiciones se reparten
+// entre un grupo de hilos de adquisicion. Las propiedades de control, de
+// espectro y de diagnostico corresponden al dispositivo actual.
+//
 class Serial : public QObject {
     Q_OBJECT
 
@@ -60,9 +69,9 @@ class Serial : public QObject {
     Q_PROPERTY(qreal velocidadMax
                READ velocidadMax
                CONSTANT)
-    Q_PROPERTY(int numLecturas
+    Q_PROPERTY(quint64 numLecturas
                READ numLecturas
-               CONSTANT)
+               NOTIFY numLecturasCambiado)
     Q_PROPERTY(int escala
                READ escala
                WRITE cambiarEscala
@@ -73,15 +82,95 @@ class Serial : public QObject {
     Q_PROPERTY(bool conexionConDispositivo
                READ conexionConDispositivo
                NOTIFY conexionCambiada)
+    Q_PROPERTY(qreal latenciaComandos
+               READ latenciaComandos
+               NOTIFY latenciaCambiada)
+    Q_PROPERTY(int modoControl
+               READ modoControl
+               WRITE cambiarModoControl
+               NOTIFY controlCambiado)
+    Q_PROPERTY(qreal consigna
+               READ consigna
+               WRITE cambiarConsigna
+               NOTIFY controlCambiado)
+    Q_PROPERTY(qreal consignaMax
+               READ consignaMax
+               NOTIFY controlCambiado)
+    Q_PROPERTY(int canalEspectro
+               READ canalEspectro
+               WRITE cambiarCanalEspectro
+               NOTIFY canalEspectroCambiado)
+    Q_PROPERTY(qreal frecuencia
+               READ frecuencia
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal amplitud
+               READ amplitud
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal fase
+               READ fase
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal amortiguamiento
+               READ amortiguamiento
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(qreal frecuenciaMaxima
+               READ frecuenciaMaxima
+               NOTIFY espectroCambiado)
+    Q_PROPERTY(int modoTelemetria
+               READ modoTelemetria
+               WRITE cambiarModoTelemetria
+               NOTIFY telemetriaCambiada)
+    Q_PROPERTY(int decimacion
+               READ decimacion
+               WRITE cambiarDecimacion
+               NOTIFY telemetriaCambiada)
+    Q_PROPERTY(int frecuenciaMuestreo
+               READ frecuenciaMuestreo
+               CONSTANT)
+    Q_PROPERTY(int maxDecimacion
+               READ maxDecimacion
+               CONSTANT)
+    Q_PROPERTY(QVariantList resumen
+               READ resumen
+               NOTIFY resumenCambiado)
+    Q_PROPERTY(QVariantList filtros
+               READ filtros
+               WRITE cambiarFiltros
+               NOTIFY filtrosCambiados)
+    Q_PROPERTY(Diagnostico* diagnostico
+               READ diagnostico
+               NOTIFY dispositivoActualCambiado)
+    Q_PROPERTY(QStringList puertosAbiertos
+               READ puertosAbiertos
+               NOTIFY conexionCambiada)
+    Q_PROPERTY(QVariantList dispositivos
+               READ dispositivos
+               NOTIFY listaDispositivosCambiada)
+    Q_PROPERTY(int dispositivoActual
+               READ dispositivoActual
+               WRITE cambiarDispositivoActual
+               NOTIFY dispositivoActualCambiado)
+    Q_PROPERTY(Dispositivo* actual
+               READ actual
+               NOTIFY dispositivoActualCambiado)
 
 signals:
     void escalaCambiada();
     void datosRecibidos();
+    void numLecturasCambiado();
     void conexionCambiada();
     void velocidadCambiada();
     void posicionCalculada();
     void gmasEstadoCambiado();
     void dispositivosCambiados();
+    void controlCambiado();
+    void latenciaCambiada();
+    void espectroCambiado();
+    void canalEspectroCambiado();
+    void telemetriaCambiada();
+    void resumenCambiado();
+    void filtrosCambiados();
+    void listaDispositivosCambiada();
+    void dispositivoActualCambiado();
 
 public:
     Serial();
@@ -99,40 +188,80 @@ public:
     bool gmasHabilitado() const;
     bool conexionConDispositivo() const;
     QStringList dispositivosSerial() const;
+
+    qreal latenciaComandos() const;
+
+    int modoControl() const;
+    qreal consigna() const;
+    qreal consignaMax() const;
+
+    int canalEspectro() const;
+    qreal frecuencia() const;
+    qreal amplitud() const;
+    qreal fase() const;
+    qreal amortiguamiento() const;
+    qreal frecuenciaMaxima() const;
+
+    int modoTelemetria() const;
+    int decimacion() const;
+    int frecuenciaMuestreo() const;
+    int maxDecimacion() const;
+    QVariantList resumen() const;
+    QVariantList filtros() const;
+
+    Diagnostico* diagnostico() const;
+
+    QStringList puertosAbiertos() const;
+    QVariantList dispositivos() const;
+    int dispositivoActual() const;
+    Dispositivo* actual() const;
+
+    const BufferCircular<NumCanales>& lecturas() const;
+    static int canalDeSenal(const int signal, qreal* factor);
+
     Q_INVOKABLE bool conectarADispositivo(const int device);
+    Q_INVOKABLE bool desconectarDispositivo(const int device);
+    Q_INVOKABLE bool reproducirArchivo(const QUrl& archivo, const qreal velocidad);
+    Q_INVOKABLE void recalibrar();
 
 public slots:
     void cambiarEscala (const int escala);
+    void cambiarAnchoGrafica(const int pixeles);
     void habilitarGmas(const bool gmasHabilitado);
     void cambiarVelocidad(const qreal velocidad);
+    void cambiarModoControl(const int modo);
+    void cambiarConsigna(const qreal consigna);
+    void cambiarCanalEspectro(const int signal);
+    void cambiarModoTelemetria(const int modo);
+    void cambiarDecimacion(const int decimacion);
+    void cambiarFiltros(const QVariantList& filtros);
+    void cambiarDispositivoActual(const int indice);
+    void actualizarEspectro(QAbstractSeries* series);
     void actualizarGrafica(QAbstractSeries* series, const int signal);
 
 private slots:
-    void mandarDatos();
-    void onDatosRecibidos();
-    void actualizarPosicion();
-    void desconectarDispositivo();
+    void sincronizar();
     void actualizarDispositivosSerial();
-    void interpretarPaquete(const QByteArray& datos);
+    void onConexionCambiada();
+
+private:
+    Dispositivo* buscarDispositivo(const QString& puerto) const;
+    Dispositivo* dispositivoLibre();
+    Dispositivo* crearDispositivo();
+    void eliminarDispositivo(Dispositivo* dispositivo);
+    QThread* asignarHilo();
 
 private:
     int m_escala;
-    qreal m_velocidad;
+    int m_anchoGrafica;
     quint64 m_numLecturas;
-    bool m_gmasHabilitado;
-
-    QFile m_archivoLecturas;
-
-    QVector<QPointF> m_lecturasX;
-    QVector<QPointF> m_lecturasY;
-    QVector<QPointF> m_lecturasZ;
-    QVector<QPointF> m_lecturasP;
+    QVector<QPointF> m_puntos;
 
-    QVector<QVector3D> m_lecturasGyro;
-    QVector<QVector3D> m_lecturasAccl;
+    QTimer m_temporizador;
+    QList<QThread*> m_hilos;
+    QList<Dispositivo*> m_dispositivos;
+    int m_actual;
 
-    QByteArray m_buffer;
-    QSerialPort* m_puerto;
     QList<QString> m_dispositivosSerial;
 };
 
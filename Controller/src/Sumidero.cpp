@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Sumidero.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef Q_OS_WIN
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+/**
+ * Nombre, unidad y factor de escala de cada canal, se registran en el
+ * encabezado de los archivos binarios
+ */
+static const struct {
+    const char* nombre;
+    const char* unidad;
+    float escala;
+} CANALES[] = {
+    { "Aceleracion en X",    "m/s^2", 1 },
+    { "Aceleracion en Y",    "m/s^2", 1 },
+    { "Aceleracion en Z",    "m/s^2", 1 },
+    { "Aceleracion Promedio", "m/s^2", 1 },
+    { "Giro en X",           "deg/s", 1 },
+    { "Giro en Y",           "deg/s", 1 },
+    { "Giro en Z",           "deg/s", 1 },
+    { "Velocidad en X",      "m/s",   1 },
+    { "Velocidad en Y",      "m/s",   1 },
+    { "Velocidad en Z",      "m/s",   1 },
+    { "Posicion en X",       "m",     1 },
+    { "Posicion en Y",       "m",     1 },
+    { "Posicion en Z",       "m",     1 },
+};
+
+Q_STATIC_ASSERT(sizeof(CANALES) / sizeof(CANALES[0]) == NumCanales);
+
+/**
+ * Numero de decimales que se registran en los archivos CSV
+ */
+static const int DECIMALES_CSV = 5;
+
+/**
+ * Numero maximo de bytes que ocupa una fila del archivo CSV
+ */
+static const int BYTES_FILA_CSV = 12 * 32;
+
+/**
+ * Potencias de 10 para redondear los valores a un numero fijo de decimales
+ */
+static const quint64 POTENCIAS_10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL,
+    100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+/**
+ * Escribe el @a valor en @a destino (que debe tener espacio para al menos
+ * 32 caracteres) redondeado a @a decimales, sin ceros al final de la parte
+ * fraccionaria. Es mucho mas rapido que @c QString::arg() y no reserva
+ * memoria.
+ *
+ * @return el numero de caracteres escritos
+ */
+int FormatearDecimal(char* destino, const double valor, const int decimales) {
+    Q_ASSERT(destino != Q_NULLPTR);
+    Q_ASSERT(decimales >= 0 && decimales <= 9);
+
+    // Valores que no se pueden representar con un entero de 64 bits
+    const double absoluto = valor < 0 ? -valor : valor;
+    if (!(absoluto < 1e9))
+        return snprintf(destino, 32, "%g", valor);
+
+    // Redondear el valor y separar la parte entera de la fraccionaria
+    const quint64 potencia = POTENCIAS_10[decimales];
+    const quint64 escalado = static_cast<quint64>(absoluto * potencia + 0.5);
+    quint64 entero = escalado / potencia;
+    quint64 fraccion = escalado % potencia;
+
+    // Escribir signo
+    char* c = destino;
+    if (valor < 0 && escalado != 0)
+        *c++ = '-';
+
+    // Escribir parte entera
+    char digitos[20];
+    int n = 0;
+    do {
+        digitos[n++] = static_cast<char>('0' + entero % 10);
+        entero /= 10;
+    } while (entero > 0);
+
+    while (n > 0)
+        *c++ = digitos[--n];
+
+    // Escribir parte fraccionaria sin ceros al final
+    if (fraccion > 0) {
+        int cifras = decimales;
+        while (fraccion % 10 == 0) {
+            fraccion /= 10;
+            --cifras;
+        }
+
+        *c++ = '.';
+        for (int i = cifras - 1; i >= 0; --i) {
+            c[i] = static_cast<char>('0' + fraccion % 10);
+            fraccion /= 10;
+        }
+
+        c += cifras;
+    }
+
+    return static_cast<int>(c - destino);
+}
+
+/**
+ * Cierra el archivo de salida
+ */
+Sumidero::~Sumidero() {
+    cerrar();
+}
+
+/**
+ * Crea el archivo de salida en la @a ruta especificada (sin extension) y
+ * escribe su encabezado
+ *
+ * @return @a false si no se pudo crear el archivo
+ */
+bool Sumidero::abrir(const QString& ruta) {
+    cerrar();
+
+    m_bytesEscritos = 0;
+    m_archivo.setFileName(ruta + extension());
+    if (!m_archivo.open(QFile::WriteOnly))
+        return false;
+
+    escribirEncabezado();
+    return true;
+}
+
+/**
+ * Escribe los datos pendientes y cierra el archivo de salida
+ */
+void Sumidero::cerrar() {
+    if (m_archivo.isOpen())
+        m_archivo.close();
+}
+
+/**
+ * Escribe los datos pendientes y le pide al sistema operativo que los
+ * guarde en el disco, de manera que una falla de energia no borre las
+ * lecturas de una prueba larga
+ */
+void Sumidero::sincronizar() {
+    if (!m_archivo.isOpen())
+        return;
+
+    m_archivo.flush();
+
+#ifdef Q_OS_WIN
+    _commit(m_archivo.handle());
+#else
+    fsync(m_archivo.handle());
+#endif
+}
+
+/**
+ * Regresa el numero de bytes que se han escrito en el archivo
+ */
+quint64 Sumidero::bytesEscritos() const {
+    return m_bytesEscritos;
+}
+
+/**
+ * Escribe los @a datos en el archivo de salida
+ */
+void Sumidero::escribirBytes(const char* datos, const qint64 bytes) {
+    const qint64 escritos = m_archivo.write(datos, bytes);
+    if (escritos > 0)
+        m_bytesEscritos += static_cast<quint64>(escritos);
+}
+
+/**
+ * Regresa la extension de los archivos CSV
+ */
+QString SumideroCsv::extension() const {
+    return ".csv";
+}
+
+/**
+ * Escribe los titulos de las columnas del archivo CSV
+ */
+void SumideroCsv::escribirEncabezado() {
+    static const char encabezado[] = "Num. Lectura, "
+                                      "Aceleracion en X,"
+                                      "Aceleracion en Y,"
+                                      "Aceleracion en Z,"
+                                      "Aceleracion Promedio,"
+                                      "Fuerza Resultante,"
+                                      "Velocidad en X,"
+                                      "Velocidad en Y,"
+                                      "Velocidad en Z,"
+                                      "Posicion en X,"
+                                      "Posicion en Y,"
+                                      "Posicion en Z\n";
+
+    escribirBytes(encabezado, sizeof(encabezado) - 1);
+}
+
+/**
+ * Escribe una fila por lectura con el numero de lectura, la aceleracion
+ * en cada eje, la aceleracion promedio, la fuerza resultante y la velocidad
+ * y posicion estimadas del sensor
+ */
+void SumideroCsv::escribir(const Lectura* lecturas, const int n) {
+    m_texto.resize(n * BYTES_FILA_CSV);
+
+    char* c = m_texto.data();
+    for (int i = 0; i < n; ++i) {
+        const Lectura& lectura = lecturas[i];
+        const double posP = lectura.valores[CanalAccelP];
+
+        c += FormatearDecimal(c, lectura.tiempo, 0);
+        *c++ = ',';
+        c += FormatearDecimal(c, lectura.valores[CanalAccelX], DECIMALES_CSV);
+        *c++ = ',';
+        c += FormatearDecimal(c, lectura.valores[CanalAccelY], DECIMALES_CSV);
+        *c++ = ',';
+        c += FormatearDecimal(c, lectura.valores[CanalAccelZ], DECIMALES_CSV);
+        *c++ = ',';
+        c += FormatearDecimal(c, posP, DECIMALES_CSV);
+        *c++ = ',';
+        c += FormatearDecimal(c, posP * 0.1275, DECIMALES_CSV);
+        for (int j = CanalVelX; j <= CanalPosZ; ++j) {
+            *c++ = ',';
+            c += FormatearDecimal(c, lectura.valores[j], DECIMALES_CSV);
+        }
+        *c++ = '\n';
+    }
+
+    escribirBytes(m_texto.constData(), c - m_texto.constData());
+}
+
+/**
+ * Regresa la extension de los archivos binarios
+ */
+QString SumideroBinario::extension() const {
+    return ".gmas";
+}
+
+/**
+ * Escribe el encabezado que describe los canales del archivo binario
+ */
+void SumideroBinario::escribirEncabezado() {
+    QByteArray encabezado("GMAS");
+
+    const quint16 version = 1;
+    const quint16 orden = 0x0102;
+    const quint16 canales = NumCanales;
+    encabezado.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    encabezado.append(reinterpret_cast<const char*>(&orden), sizeof(orden));
+    encabezado.append(reinterpret_cast<const char*>(&canales), sizeof(canales));
+
+    for (int i = 0; i < NumCanales; ++i) {
+        const QByteArray nombre = QByteArray(CANALES[i].nombre).left(255);
+        const QByteArray unidad = QByteArray(CANALES[i].unidad).left(255);
+
+        encabezado.append(static_cast<char>(nombre.length()));
+        encabezado.append(nombre);
+        encabezado.append(static_cast<char>(unidad.length()));
+        encabezado.append(unidad);
+        encabezado.append(reinterpret_cast<const char*>(&CANALES[i].escala),
+                          sizeof(CANALES[i].escala));
+    }
+
+    escribirBytes(encabezado.constData(), encabezado.length());
+}
+
+/**
+ * Escribe las @a n lecturas como un bloque de columnas
+ */
+void SumideroBinario::escribir(const Lectura* lecturas, const int n) {
+    const int bytes = static_cast<int>(sizeof(quint32))
+                      + n * static_cast<int>(sizeof(double))
+                      + n * NumCanales * static_cast<int>(sizeof(float));
+    m_bloque.resize(bytes);
+
+    // Escribir numero de lecturas
+    char* c = m_bloque.data();
+    const quint32 cuenta = static_cast<quint32>(n);
+    memcpy(c, &cuenta, sizeof(cuenta));
+    c += sizeof(cuenta);
+
+    // Escribir columna de tiempos
+    for (int i = 0; i < n; ++i) {
+        const double tiempo = lecturas[i].tiempo;
+        memcpy(c, &tiempo, sizeof(tiempo));
+        c += sizeof(tiempo);
+    }
+
+    // Escribir una columna por canal
+    for (int j = 0; j < NumCanales; ++j) {
+        for (int i = 0; i < n; ++i) {
+            memcpy(c, &lecturas[i].valores[j], sizeof(float));
+            c += sizeof(float);
+        }
+    }
+
+    escribirBytes(m_bloque.constData(), bytes);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019 Alex Spataru <https://github.com/alex-spataru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SUMIDERO_H
+#define SUMIDERO_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include "Muestra.h"
+
+//
+// Destino de las lecturas que registra el grabador. Los metodos se llaman
+// unicamente desde el hilo de escritura del grabador.
+//
+class Sumidero {
+public:
+    virtual ~Sumidero();
+
+    bool abrir(const QString& ruta);
+    void cerrar();
+    void sincronizar();
+    quint64 bytesEscritos() const;
+
+    virtual QString extension() const = 0;
+    virtual void escribir(const Lectura* lecturas, const int n) = 0;
+
+protected:
+    virtual void escribirEncabezado() = 0;
+    void escribirBytes(const char* datos, const qint64 bytes);
+
+private:
+    QFile m_archivo;
+    quint64 m_bytesEscritos;
+};
+
+//
+// Registra las lecturas en el formato CSV original del programa
+//
+class SumideroCsv : public Sumidero {
+public:
+    QString extension() const;
+    void escribir(const Lectura* lecturas, const int n);
+
+protected:
+    void escribirEncabezado();
+
+private:
+    QByteArray m_texto;
+};
+
+//
+// Registra las lecturas en un formato binario por columnas:
+//
+//   Encabezado: "GMAS", version (u16), orden de bytes (u16, 0x0102 en el
+//               orden del equipo que genero el archivo), numero de canales
+//               (u16) y para cada canal su nombre, unidad (u8 + UTF-8) y
+//               factor de escala (f32)
+//
+//   Bloques:    numero de lecturas n (u32), n tiempos (f64) y n valores
+//               (f32) de cada canal, un canal despues del otro
+//
+class SumideroBinario : public Sumidero {
+public:
+    QString extension() const;
+    void escribir(const Lectura* lecturas, const int n);
+
+protected:
+    void escribirEncabezado();
+
+private:
+    QByteArray m_bloque;
+};
+
+int FormatearDecimal(char* destino, const double valor, const int decimales);
+
+#endif
@@ -26,15 +26,27 @@
 #include <QQmlApplicationEngine>
 
 #include "Serial.h"
+#include "Consola.h"
+#include "Osciloscopio.h"
 
 int main(int argc, char** argv) {
     QApplication::setApplicationName("GMAS");
     QApplication::setApplicationVersion("1.0");
     QApplication::setOrganizationName("IECSA 05-A");
+
+    // Adquisicion sin interfaz grafica (ver Consola)
+    if (Consola::solicitada(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        Consola consola;
+        return consola.ejecutar(app);
+    }
+
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 
     QApplication app(argc, argv);
 
+    qmlRegisterType<Osciloscopio>("GMAS", 1, 0, "Osciloscopio");
+
     Serial serial;
     QQmlApplicationEngine engine;
     QQuickStyle::setStyle("Imagine");